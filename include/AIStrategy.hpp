@@ -21,12 +21,16 @@ public:
       const std::vector<Position> &successful_hits) = 0;
 
   virtual void on_attack_result(const Position &pos, AttackResult result) = 0;
+
+  // True while finishing off a known ship rather than searching for one
+  virtual bool is_targeting() const noexcept { return false; }
 };
 
 // Easy: pure random attacks
 class RandomStrategy final : public AttackStrategy {
 public:
   RandomStrategy();
+  explicit RandomStrategy(uint32_t seed);
 
   Position get_attack_position(
       const std::unordered_set<Position, Position::Hash> &attacked_positions,
@@ -43,6 +47,7 @@ private:
 class HuntStrategy final : public AttackStrategy {
 public:
   HuntStrategy();
+  explicit HuntStrategy(uint32_t seed);
 
   Position get_attack_position(
       const std::unordered_set<Position, Position::Hash> &attacked_positions,
@@ -50,6 +55,8 @@ public:
 
   void on_attack_result(const Position &pos, AttackResult result) override;
 
+  bool is_targeting() const noexcept override { return !m_hunt_targets.empty(); }
+
 private:
   mutable std::mt19937 m_rng;
   mutable std::uniform_int_distribution<config::GridCoord> m_dist;
@@ -67,6 +74,7 @@ private:
 class TargetStrategy final : public AttackStrategy {
 public:
   TargetStrategy();
+  explicit TargetStrategy(uint32_t seed);
 
   Position get_attack_position(
       const std::unordered_set<Position, Position::Hash> &attacked_positions,
@@ -74,6 +82,8 @@ public:
 
   void on_attack_result(const Position &pos, AttackResult result) override;
 
+  bool is_targeting() const noexcept override { return m_mode == Mode::TARGET; }
+
 private:
   enum class Mode { HUNT, TARGET };
   enum class Direction { NONE, HORIZONTAL, VERTICAL };
@@ -117,4 +127,19 @@ make_strategy(config::Difficulty difficulty) {
   }
 }
 
+// Seeded variant for reproducible simulations
+inline std::unique_ptr<AttackStrategy>
+make_strategy(config::Difficulty difficulty, uint32_t seed) {
+  switch (difficulty) {
+  case config::Difficulty::EASY:
+    return std::make_unique<RandomStrategy>(seed);
+  case config::Difficulty::MEDIUM:
+    return std::make_unique<HuntStrategy>(seed);
+  case config::Difficulty::HARD:
+    return std::make_unique<TargetStrategy>(seed);
+  default:
+    return std::make_unique<RandomStrategy>(seed);
+  }
+}
+
 } // namespace battleship::ai
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Replay.hpp"
+#include "Stats.hpp"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace battleship::analysis {
+
+// Strategy slots: EASY, MEDIUM, HARD, HUMAN, ENGINE
+inline constexpr std::size_t SLOT_COUNT = stats::STRATEGY_COUNT + 2;
+inline constexpr std::size_t SINK_SLOTS = config::TOTAL_SHIPS;
+inline constexpr std::size_t SHIP_SIZES = 4;
+
+std::size_t strategy_slot(uint8_t code) noexcept;
+std::string_view slot_name(std::size_t slot) noexcept;
+
+// One "field op value" condition on a recorded game
+struct Condition {
+  enum class Field : uint8_t { SHOTS, WINNER_SHOTS, WINNER, FIRST, SECOND, ANY };
+  enum class Op : uint8_t { EQ, NE, LT, LE, GT, GE };
+
+  Field field;
+  Op op;
+  uint64_t value;
+
+  // "shots<=60", "winner=1", "first=hard", "any=medium"
+  static std::optional<Condition> parse(std::string_view text);
+
+  bool matches(const replay::GameView &game) const noexcept;
+};
+
+// All conditions must hold (empty filter accepts every game)
+struct Filter {
+  std::vector<Condition> conditions;
+
+  bool matches(const replay::GameView &game) const noexcept {
+    for (const auto &c : conditions) {
+      if (!c.matches(game)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+struct SlotAggregate {
+  uint64_t games{0};
+  uint64_t wins{0};
+  stats::ShotHistogram shots_to_win;
+  std::array<uint64_t, stats::CELL_COUNT> opening_shots{};
+  // sink_order[k][size - 1]: k-th ship sunk by this strategy had that size
+  std::array<std::array<uint64_t, SHIP_SIZES>, SINK_SLOTS> sink_order{};
+
+  void merge(const SlotAggregate &other) noexcept;
+};
+
+// Fixed-size aggregate over any number of games; merges by summation
+class Aggregate {
+public:
+  void add(const replay::GameView &game) noexcept;
+  void merge(const Aggregate &other) noexcept;
+
+  uint64_t games() const noexcept { return m_games; }
+  const SlotAggregate &slot(std::size_t i) const noexcept { return m_slots[i]; }
+
+  // Share of fleets with a ship on the cell, across both sides of every game
+  double cell_prior(std::size_t cell) const noexcept;
+  double cell_hit_rate(std::size_t cell) const noexcept;
+
+  std::string to_text() const;
+  std::string to_csv() const;
+
+private:
+  uint64_t m_games{0};
+  std::array<SlotAggregate, SLOT_COUNT> m_slots{};
+  std::array<uint64_t, stats::CELL_COUNT> m_cell_occupied{};
+  std::array<uint64_t, stats::CELL_COUNT> m_cell_shots{};
+  std::array<uint64_t, stats::CELL_COUNT> m_cell_hits{};
+};
+
+// Splits the blocks of all files into contiguous ranges, one per thread.
+// Every thread reads its range straight from the mapping.
+Aggregate analyze(const std::vector<replay::Reader> &files,
+                  const Filter &filter, unsigned threads);
+
+} // namespace battleship::analysis
@@ -39,6 +39,9 @@ public:
   bool is_game_over() const noexcept;                            // all ships sunk
 
   CellState get_cell_state(const Position &pos) const;
+  bool was_attacked(const Position &pos) const {
+    return m_attacked_positions.contains(pos);
+  }
   const Ship *get_ship_at(const Position &pos) const noexcept;
 
   const std::vector<std::unique_ptr<Ship>> &ships() const noexcept {
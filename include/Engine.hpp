@@ -0,0 +1,193 @@
+#pragma once
+
+#include "AIStrategy.hpp"
+#include "Config.hpp"
+#include "Position.hpp"
+#include "net/Protocol.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+// Engine protocol: attack strategies in other processes, in the spirit of
+// UCI. The game runs the engine as a subprocess and talks to it in lines
+// of text over its stdin/stdout:
+//
+//   bei                          -> id name <name>, then beiok
+//   newgame <game> <seed>           start game <game> (any number at once)
+//   place <game>                 -> fleet <game> <ship> x10, ship = A1h4
+//   observe <game> <cell> <result>...  own shots' results, miss|hit|sunk
+//   go <game>                    -> move <game> <cell>
+//   endgame <game>
+//   quit
+//
+// A place or go for a game the engine does not know is answered with
+// "error <game> <reason>", which forfeits that game. So does an engine that
+// takes longer than the move timeout to answer.
+//
+// Requests may be pipelined: the game sends the commands of many games in
+// one write and reads the replies, which come back in request order, in
+// one go. Observations are batched into the line before each go, so a
+// move costs one round trip however many shots led up to it. Engines
+// should only flush their output when no more input is waiting, and may
+// send "info ..." lines, which are ignored.
+namespace battleship::engine {
+
+using GameId = uint32_t;
+
+// ============================================================================
+// Text encoding
+// ============================================================================
+
+std::string_view result_name(AttackResult result) noexcept;
+std::optional<AttackResult> parse_result(std::string_view text) noexcept;
+
+// "A1h4": start cell, h|v, length
+std::string format_ship(const net::protocol::ShipPlacement &ship);
+std::optional<net::protocol::ShipPlacement> parse_ship(std::string_view text);
+
+// Player seeds of a game: the engine takes the low half of the mixed game
+// seed and the built-in opponent the high half, as in the sim, so a
+// mirrored matchup does not play the same fleet and shots on both sides
+uint32_t engine_seed(uint64_t game_seed) noexcept;
+uint32_t builtin_seed(uint64_t game_seed) noexcept;
+
+// ============================================================================
+// Game side
+// ============================================================================
+
+// An engine subprocess (run through /bin/sh -c) with its stdin and stdout
+// on pipes. Writes are buffered until flush(), so a batch of commands
+// costs one system call.
+class EngineProcess {
+public:
+  explicit EngineProcess(const std::string &command);
+  ~EngineProcess();
+
+  EngineProcess(const EngineProcess &) = delete;
+  EngineProcess &operator=(const EngineProcess &) = delete;
+
+  void write(std::string_view text) { m_output += text; }
+  void flush();
+
+  // Next line without its newline, valid until the next call, or nothing
+  // if the engine wrote none within `timeout`. Throws std::runtime_error
+  // once the engine has exited.
+  std::optional<std::string_view> read_line(std::chrono::milliseconds timeout);
+
+private:
+  pid_t m_pid{-1};
+  int m_stdin{-1};  // our end of the engine's stdin
+  int m_stdout{-1}; // our end of the engine's stdout
+  std::string m_output;
+  std::string m_input;
+  std::size_t m_consumed{0}; // bytes of m_input already returned
+};
+
+struct Reply {
+  enum class Kind : uint8_t { FLEET, MOVE, ERROR };
+
+  Kind kind{Kind::MOVE};
+  GameId game{0};
+  Position move;                                   // MOVE
+  std::vector<net::protocol::ShipPlacement> fleet; // FLEET
+  std::string error;                               // ERROR
+};
+
+// Any number of games against one engine, told apart by game id. Requests
+// queue up until flush(); read_reply() returns the answers in order.
+class EngineClient {
+public:
+  static constexpr std::chrono::milliseconds DEFAULT_MOVE_TIMEOUT{10000};
+
+  // Starts the engine and waits for its handshake. Each reply must follow
+  // the previous one within `move_timeout`.
+  explicit EngineClient(const std::string &command,
+                        std::chrono::milliseconds move_timeout = DEFAULT_MOVE_TIMEOUT);
+
+  const std::string &name() const noexcept { return m_name; }
+
+  GameId new_game(uint64_t seed);
+  void request_fleet(GameId game);
+  // Result of the engine's own shot, sent along with its next go
+  void observe(GameId game, const Position &pos, AttackResult result);
+  void request_move(GameId game);
+  void end_game(GameId game);
+
+  void flush();
+  // Nothing if the engine missed the move timeout
+  std::optional<Reply> read_reply();
+
+  uint64_t round_trips() const noexcept { return m_round_trips; }
+
+private:
+  EngineProcess m_process;
+  std::chrono::milliseconds m_move_timeout;
+  std::string m_name;
+  GameId m_next_game{1};
+  std::unordered_map<GameId, std::string> m_observations; // " <cell> <result>" each
+  uint64_t m_round_trips{0};
+  bool m_awaiting{false}; // requests went out since the last reply was read
+};
+
+// One game against an engine behind the usual strategy interface, so a
+// Player can use it. Plays one move per round trip; the arena below
+// pipelines many games instead.
+class EngineStrategy final : public ai::AttackStrategy {
+public:
+  EngineStrategy(std::shared_ptr<EngineClient> client, uint64_t seed);
+  ~EngineStrategy() override;
+
+  Position get_attack_position(
+      const std::unordered_set<Position, Position::Hash> &attacked_positions,
+      const std::vector<Position> &successful_hits) override;
+
+  void on_attack_result(const Position &pos, AttackResult result) override;
+
+private:
+  std::shared_ptr<EngineClient> m_client;
+  GameId m_game;
+};
+
+// ============================================================================
+// Arena: an engine against a built-in strategy, many games in flight
+// ============================================================================
+
+struct ArenaStats {
+  uint64_t games{0};
+  uint64_t engine_wins{0};
+  uint64_t forfeits{0};          // engine lost on an illegal move or fleet
+  uint64_t timeouts{0};          // forfeits for missing the move timeout
+  uint64_t engine_win_shots{0};  // summed over the engine's wins
+  uint64_t builtin_win_shots{0}; // summed over the built-in's wins
+  uint64_t engine_moves{0};
+  uint64_t round_trips{0};
+  std::chrono::nanoseconds waiting{0}; // blocked on the engine's replies
+
+  void merge(const ArenaStats &other) noexcept;
+};
+
+// Plays games [first_game, first_game + count) of a run against one engine
+// process, keeping `in_flight` games going at once. The engine shoots first
+// in even-numbered games. When the engine misses `move_timeout`, every game
+// waiting on it is forfeited and the rest go on.
+ArenaStats run_arena(const std::string &command, config::Difficulty builtin,
+                     uint64_t master_seed, uint64_t first_game, uint64_t count,
+                     unsigned in_flight, std::chrono::milliseconds move_timeout);
+
+// ============================================================================
+// Engine side
+// ============================================================================
+
+// Answers the protocol on in/out with a built-in strategy until quit or
+// end of input. Output is flushed only once no input is waiting, so
+// pipelined requests get batched replies.
+void serve(std::istream &in, std::ostream &out, config::Difficulty level);
+
+} // namespace battleship::engine
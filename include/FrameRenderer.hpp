@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Board.hpp"
+#include "Game.hpp"
+#include "Renderer.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace battleship {
+
+// Everything needed to draw one frame, copied out of the game state so the
+// renderer never touches live boards
+struct GameSnapshot {
+  static constexpr std::size_t MAX_LOG = 3;
+
+  std::string_view turn_player;
+  std::array<TurnInfo, MAX_LOG> log{};
+  std::size_t log_size{0};
+
+  std::array<Board::DisplayGrid, 2> grids{};
+  std::array<std::string_view, 2> titles{};
+  std::array<std::string_view, 2> names{};
+  std::array<Board::ShipTypeCounts, 2> counts{};
+  std::array<uint8_t, 2> ships_left{};
+};
+
+// Lock-free single-producer/single-consumer triple buffer. The producer
+// always has a private slot to fill, the consumer always reads the newest
+// complete one, and neither ever waits; intermediate snapshots are skipped.
+template <typename T> class SnapshotBuffer {
+public:
+  // Producer side: fill write_slot(), then publish()
+  T &write_slot() noexcept { return m_slots[m_back]; }
+
+  void publish() noexcept {
+    const uint8_t prev =
+        m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+    m_back = prev & INDEX_MASK;
+  }
+
+  // Consumer side: newest snapshot if one arrived since the last call
+  const T *acquire() noexcept {
+    if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) {
+      return nullptr;
+    }
+    const uint8_t prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+    m_front = prev & INDEX_MASK;
+    return &m_slots[m_front];
+  }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x03;
+  static constexpr uint8_t FRESH = 0x04;
+
+  std::array<T, 3> m_slots{};
+  uint8_t m_back{0};  // producer-owned
+  uint8_t m_front{1}; // consumer-owned
+  std::atomic<uint8_t> m_middle{2};
+};
+
+// Draws published snapshots on its own thread at no more than max_fps, so
+// the game loop runs at its own pace and only ever pays for a copy. Each
+// frame only rewrites the cells that changed, so nothing else may print
+// until stop().
+class FrameRenderer {
+public:
+  explicit FrameRenderer(int max_fps);
+
+  FrameRenderer(const FrameRenderer &) = delete;
+  FrameRenderer &operator=(const FrameRenderer &) = delete;
+  ~FrameRenderer();
+
+  GameSnapshot &next_frame() noexcept { return m_buffer.write_slot(); }
+  void publish() noexcept { m_buffer.publish(); }
+
+  // Draws the last published frame, then joins the render thread
+  void stop();
+
+private:
+  SnapshotBuffer<GameSnapshot> m_buffer;
+  std::chrono::nanoseconds m_frame_interval;
+  std::atomic<bool> m_running{true};
+  std::string m_frame; // render thread only, reused every frame
+  DiffRenderer m_screen;
+  std::thread m_thread;
+
+  void run();
+  void draw_pending();
+};
+
+} // namespace battleship
@@ -1,13 +1,28 @@
 #pragma once
 
+#include "Pacing.hpp"
 #include "Player.hpp"
 #include <array>
 #include <memory>
 
 namespace battleship {
 
+namespace replay {
+class Writer;
+}
+
+namespace rating {
+class RatingStore;
+}
+
+class FrameRenderer;
+struct GameSnapshot;
+
 enum class GameMode : uint8_t { PVP, PVE_EASY, PVE_MEDIUM, PVE_HARD, AI_VS_AI };
 
+// Pacing a mode gets unless the caller picks one
+Pacing default_pacing(GameMode mode) noexcept;
+
 enum class GameState : uint8_t { SETUP, IN_PROGRESS, GAME_OVER };
 
 // Battle log entry
@@ -19,13 +34,14 @@ struct TurnInfo {
 
 class Game {
 public:
-  explicit Game(GameMode mode = GameMode::PVE_EASY);
+  explicit Game(GameMode mode = GameMode::PVE_EASY); // mode's default pacing
+  Game(GameMode mode, Pacing pacing);
 
   Game(const Game &) = delete;
   Game &operator=(const Game &) = delete;
   Game(Game &&) = delete;
   Game &operator=(Game &&) = delete;
-  ~Game() = default;
+  ~Game();
 
   void initialize();
   void start();
@@ -34,25 +50,54 @@ public:
 
   GameState state() const noexcept { return m_state; }
   GameMode mode() const noexcept { return m_mode; }
+  const Pacing &pacing() const noexcept { return m_pacing; }
+
+  // Full shot history goes here; the on-screen log keeps only the tail.
+  // Must be set before start(); the writer must outlive the game.
+  void set_replay_writer(replay::Writer *writer) noexcept { m_replay = writer; }
+
+  // Shooting for the second seat in place of its built-in AI, rated as
+  // `rated_as` when given. Must be set before initialize().
+  void set_opponent_strategy(std::unique_ptr<ai::AttackStrategy> strategy,
+                             std::string rated_as = {}) noexcept {
+    m_opponent_strategy = std::move(strategy);
+    m_opponent_name = std::move(rated_as);
+  }
+
+  // The result is rated here once the game ends; the store must outlive
+  // the game
+  void set_rating_store(rating::RatingStore *store) noexcept { m_ratings = store; }
 
 private:
   GameMode m_mode;
+  Pacing m_pacing;
   GameState m_state{GameState::SETUP};
 
   std::array<std::unique_ptr<Player>, 2> m_players;
   std::size_t m_current_player_index{0};
 
   static constexpr std::size_t MAX_BATTLE_LOG = 3;
-  std::vector<TurnInfo> m_battle_log;
-
-  static constexpr int SHOT_DELAY_MS = 1500;
+  std::vector<TurnInfo> m_battle_log; // last MAX_BATTLE_LOG shots
+  TurnInfo m_last_turn{};
+  replay::Writer *m_replay{nullptr};
+  std::unique_ptr<ai::AttackStrategy> m_opponent_strategy;
+  std::string m_opponent_name;
+  bool m_external_opponent{false}; // the second seat shoots with m_opponent_strategy
+  rating::RatingStore *m_ratings{nullptr};
+
+  // AI vs AI draws asynchronously so pacing and redraw rate are independent
+  std::unique_ptr<FrameRenderer> m_frame_renderer;
+  std::string m_frame; // otherwise redrawn in place here
 
   void switch_turn() noexcept;
   void handle_shot(const Position &pos);
   void update_game_state();
   void announce_winner() const;
+  std::string rated_name(std::size_t seat) const;
   void sleep_ms(int milliseconds) const;
-  void display_game_state() const;
+  void pause_after_shot() const;
+  void display_game_state();
+  void fill_snapshot(GameSnapshot &snapshot) const;
 
   Player &current_player() noexcept {
     return *m_players[m_current_player_index];
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace battleship {
+
+// Read-only memory mapping of a whole file (POSIX mmap)
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  std::span<const uint8_t> bytes() const noexcept { return {m_data, m_size}; }
+  std::size_t size() const noexcept { return m_size; }
+  const std::string &path() const noexcept { return m_path; }
+
+private:
+  std::string m_path;
+  const uint8_t *m_data{nullptr};
+  std::size_t m_size{0};
+
+  void unmap() noexcept;
+};
+
+} // namespace battleship
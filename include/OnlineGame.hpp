@@ -1,18 +1,30 @@
 #pragma once
 
 #include "Board.hpp"
+#include "Pacing.hpp"
 #include "Player.hpp"
 #include "net/NetworkManager.hpp"
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 
 namespace battleship {
 
 struct TurnInfo;
 
+// PEER: host and guest each own their board and trust each other.
+// SERVER: a battleship-server deals both fleets and resolves every shot; the
+// client only renders what it is told.
+enum class OnlineMode : uint8_t { PEER, SERVER };
+
 // Online PvP game - one player per PC
 class OnlineGame {
 public:
-  explicit OnlineGame(net::NetworkManager &network);
+  explicit OnlineGame(net::NetworkManager &network,
+                      Pacing pacing = pacing::ONLINE,
+                      OnlineMode mode = OnlineMode::PEER);
 
   void initialize();
   void run();
@@ -23,12 +35,25 @@ private:
   Board m_opponent_board; // Tracking opponent's board (hits/misses only)
 
   std::vector<TurnInfo> m_battle_log;
+  std::string m_frame; // reused by every redraw
   static constexpr std::size_t MAX_BATTLE_LOG = 3;
-  static constexpr int SHOT_DELAY_MS = 1500;
+  Pacing m_pacing;
+  OnlineMode m_mode;
+
+  // How long one network wait runs before the UI gets control back
+  static constexpr std::chrono::milliseconds WAIT_SLICE{100};
 
   bool m_my_turn{false};
   bool m_game_over{false};
 
+  // When our last ATTACK left; its answer is timed against this
+  std::chrono::steady_clock::time_point m_shot_sent{};
+
+  // Server mode: token from GAME_START that gets our seat back after a drop
+  std::optional<uint64_t> m_session;
+  static constexpr int RESUME_ATTEMPTS = 5;
+  static constexpr int RESUME_BACKOFF_MS = 250; // times the attempt number
+
   // Track opponent stats
   uint32_t m_opponent_attacks{0};
   uint32_t m_opponent_hits{0};
@@ -38,8 +63,26 @@ private:
 
   void run_my_turn();
   void run_opponent_turn();
-  void display_state() const;
+
+  // Server mode: the server drives the turn order, we react to messages
+  bool initialize_from_server();
+  bool deal_fleet(const std::vector<net::protocol::ShipPlacement> &fleet);
+  void run_server_client();
+  bool resume_session();
+  bool apply_snapshot(const net::protocol::Snapshot &snapshot);
+  void record_my_shot(const Position &pos, AttackResult result,
+                      const std::vector<Position> &sunk_cells);
+  void apply_opponent_shot(const Position &pos);
+  net::protocol::GameSummary local_summary(net::protocol::Outcome outcome) const;
+  void show_game_over(const net::protocol::GameSummary &summary);
+
+  bool send_attack(const Position &pos);
+  void time_shot();
+
+  void display_state();
+  std::optional<net::Message> wait_for_message(std::string_view status);
   void sleep_ms(int milliseconds) const;
+  void pause_after_shot() const;
   void update_opponent_sunk(std::size_t ship_size);
   uint8_t opponent_ships_total() const noexcept;
 };
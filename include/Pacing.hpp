@@ -0,0 +1,24 @@
+#pragma once
+
+namespace battleship {
+
+// How fast a watched game advances and redraws
+struct Pacing {
+  int shot_delay_ms{1500}; // pause after each shot so it can be followed
+  bool turbo{false};       // no pauses; the game runs at full speed
+  int max_fps{30};         // redraw cap when rendering asynchronously
+
+  int delay_ms() const noexcept { return turbo ? 0 : shot_delay_ms; }
+};
+
+namespace pacing {
+
+inline constexpr Pacing PVP{1000, false, 30};
+inline constexpr Pacing PVE{1500, false, 30};
+inline constexpr Pacing AI_VS_AI{500, false, 30};
+inline constexpr Pacing ONLINE{1500, false, 30};
+inline constexpr Pacing TURBO{0, true, 30};
+
+} // namespace pacing
+
+} // namespace battleship
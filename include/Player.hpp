@@ -5,6 +5,8 @@
 #include "Config.hpp"
 #include "Position.hpp"
 #include <memory>
+#include <optional>
+#include <random>
 #include <string>
 #include <string_view>
 #include <unordered_set>
@@ -25,8 +27,10 @@ enum class PlayerState : uint8_t {
 
 class Player {
 public:
+  // seed: fixes ship placement and AI shots (random_device if unset)
   Player(std::string_view name, PlayerType type,
-         config::Difficulty ai_difficulty = config::Difficulty::EASY);
+         config::Difficulty ai_difficulty = config::Difficulty::EASY,
+         std::optional<uint32_t> seed = std::nullopt);
 
   Player(const Player &) = delete;
   Player &operator=(const Player &) = delete;
@@ -49,6 +53,7 @@ public:
 
   std::string_view name() const noexcept { return m_name; }
   PlayerType type() const noexcept { return m_type; }
+  config::Difficulty difficulty() const noexcept { return m_difficulty; }
   PlayerState state() const noexcept { return m_state; }
   const Board &board() const noexcept { return m_board; }
   Board &board() noexcept { return m_board; }
@@ -59,11 +64,23 @@ public:
   uint16_t successful_hits() const noexcept { return m_successful_hits_count; }
   float accuracy() const noexcept;
 
+  // Replaces the AI's shooting, e.g. with an external engine
+  void set_strategy(std::unique_ptr<ai::AttackStrategy> strategy) noexcept {
+    m_ai_strategy = std::move(strategy);
+  }
+
+  // AI is finishing off a known ship (false for humans)
+  bool is_targeting() const noexcept {
+    return m_ai_strategy && m_ai_strategy->is_targeting();
+  }
+
 private:
   std::string m_name;
   PlayerType m_type;
+  config::Difficulty m_difficulty;
   PlayerState m_state{PlayerState::SETUP};
   Board m_board;
+  std::mt19937 m_rng;
 
   std::unique_ptr<ai::AttackStrategy> m_ai_strategy;
 
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace battleship::rating {
+
+// Glicko: a rating plus how uncertain it is. The deviation shrinks with
+// every game and grows back while a player is idle.
+inline constexpr double INITIAL_RATING = 1500.0;
+inline constexpr double MAX_DEVIATION = 350.0; // also a new player's
+inline constexpr double MIN_DEVIATION = 30.0;
+// Growth per idle day: back to MAX_DEVIATION from 50 in about 100 days
+inline constexpr double DEVIATION_PER_DAY = 34.6;
+
+// Ratings are kept within [0, MAX_RATING)
+inline constexpr double MAX_RATING = 4000.0;
+
+struct Rating {
+  double rating{INITIAL_RATING};
+  double deviation{MAX_DEVIATION};
+};
+
+// New ratings of both players after one game, both computed from the
+// ratings going in
+std::pair<Rating, Rating> glicko(const Rating &winner, const Rating &loser) noexcept;
+
+// Deviation after `days` without a game
+double idle_deviation(double deviation, double days) noexcept;
+
+// Players are identified by a hash of their name
+uint64_t player_id(std::string_view name) noexcept;
+
+// ============================================================================
+// Leaderboard
+// ============================================================================
+
+// Rank order over ratings, in memory. Ratings fall into 1/RESOLUTION-point
+// buckets, best first, with a Fenwick tree of bucket sizes: the bucket
+// holding any rank, and the players above any bucket, are O(log buckets).
+// Within a bucket, players are ordered by exact rating, then by record
+// number, in a treap with subtree sizes, so a rank inside it and a page of
+// ranks are O(log bucket) too. Equal ratings are common (new players, and
+// everyone after the same first result), which is why buckets alone won't do.
+class Leaderboard {
+public:
+  static constexpr std::size_t RESOLUTION = 8;
+  static constexpr std::size_t BUCKET_COUNT =
+      static_cast<std::size_t>(MAX_RATING) * RESOLUTION;
+
+  Leaderboard();
+
+  // Replaces the contents with records 0, 1, 2... rated `ratings`, in
+  // linear time apart from sorting each bucket
+  void assign(std::span<const double> ratings);
+
+  // Record numbers must be added in order 0, 1, 2...
+  void add(uint32_t record, double rating);
+  void update(uint32_t record, double rating);
+
+  std::size_t size() const noexcept { return m_nodes.size(); }
+
+  // 1 = best
+  std::size_t rank(uint32_t record) const noexcept;
+
+  // Records at ranks [first, first + count), best first
+  std::vector<uint32_t> range(std::size_t first, std::size_t count) const;
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  // One per record, so nodes never move and no node is allocated
+  struct Node {
+    double rating;
+    uint32_t left{NONE};
+    uint32_t right{NONE};
+    uint32_t priority; // heap order, a hash of the record number
+    uint32_t size{1};  // nodes in this subtree
+  };
+
+  std::vector<Node> m_nodes;     // by record
+  std::vector<uint32_t> m_roots; // treap of each bucket
+  std::vector<uint32_t> m_tree;  // Fenwick, 1-based over buckets
+
+  static uint32_t bucket_of(double rating) noexcept;
+  static uint32_t priority_of(uint32_t record) noexcept;
+  void count(uint32_t bucket, int delta) noexcept;
+  std::size_t count_before(uint32_t bucket) const noexcept;
+  uint32_t bucket_at(std::size_t rank) const noexcept; // holds rank (1-based)
+
+  // Treap operations; `a` ahead of `b` = better rating, then lower record
+  bool ahead(uint32_t a, uint32_t b) const noexcept;
+  uint32_t size_of(uint32_t node) const noexcept;
+  void resize(uint32_t node) noexcept;
+  uint32_t insert(uint32_t root, uint32_t node) noexcept;
+  uint32_t erase(uint32_t root, uint32_t node) noexcept;
+  std::pair<uint32_t, uint32_t> split(uint32_t root, uint32_t node) noexcept;
+  uint32_t merge(uint32_t left, uint32_t right) noexcept;
+  void collect(uint32_t root, std::size_t &skip, std::size_t count,
+               std::vector<uint32_t> &out) const;
+};
+
+// ============================================================================
+// RatingStore
+// ============================================================================
+
+// PATH: fixed 64-byte records, mapped read-write
+//   [header: HEADER_SIZE bytes]
+//     0 char[8] magic, 8 u32 version, 12 u32 byte order mark,
+//     16 u64 records in use, 24 u64 records allocated
+//   [Record 0][Record 1]...
+//
+// PATH.idx: open-addressing hash index, player id -> record number
+//   [header: HEADER_SIZE bytes]
+//     0 char[8] magic, 8 u32 version, 12 u32 byte order mark,
+//     16 u64 slots (a power of two), 24 u64 records indexed
+//   [Slot 0][Slot 1]...   16 bytes each, linear probing
+//
+// Both are in host byte order and written in place; nothing is parsed on
+// open. The index is derived data: one that does not cover every record
+// (a crash mid-insert) is rebuilt. Updates reach the page cache at once and
+// the disk when the kernel writes them back, or on flush().
+class RatingStore {
+public:
+  static constexpr std::size_t HEADER_SIZE = 64;
+  static constexpr std::size_t NAME_SIZE = 24; // longer names are cut
+  static constexpr std::size_t INITIAL_RECORDS = 1024;
+
+  struct Record {
+    uint64_t id;
+    double rating;
+    double deviation;
+    int64_t last_played; // unix seconds
+    uint32_t games;
+    uint32_t wins;
+    std::array<char, NAME_SIZE> name; // NUL-padded
+
+    std::string_view display_name() const noexcept;
+  };
+  static_assert(sizeof(Record) == 64);
+
+  struct Standing {
+    std::size_t rank{0};
+    std::string name;
+    Rating rating;
+    uint32_t games{0};
+    uint32_t wins{0};
+  };
+
+  // One player's side of a rated game
+  struct Change {
+    Rating before;
+    Rating after;
+    std::size_t rank{0};
+  };
+
+  explicit RatingStore(const std::string &path); // created if missing
+  ~RatingStore();
+
+  RatingStore(const RatingStore &) = delete;
+  RatingStore &operator=(const RatingStore &) = delete;
+
+  std::size_t size() const noexcept { return m_leaderboard.size(); }
+  const std::string &path() const noexcept { return m_path; }
+
+  // Rates one game, adding either player on first sight. Returns the
+  // winner's change, then the loser's.
+  std::pair<Change, Change> record_game(std::string_view winner, std::string_view loser,
+                                        int64_t now);
+
+  // nullopt for a player who never played
+  std::optional<Standing> find(std::string_view name) const;
+
+  // Ranks [first, first + count), best first
+  std::vector<Standing> standings(std::size_t first, std::size_t count) const;
+
+  // Writes dirty pages back to disk
+  void flush();
+
+private:
+  struct Slot {
+    uint64_t id;
+    uint32_t record; // record number + 1; 0 = empty
+    uint32_t reserved;
+  };
+
+  // A file mapped shared and read-write, grown by remapping
+  struct Region {
+    int fd{-1};
+    uint8_t *data{nullptr};
+    std::size_t size{0};
+
+    void open(const std::string &path, std::size_t minimum);
+    void resize(std::size_t bytes);
+    void close() noexcept;
+  };
+
+  std::string m_path;
+  Region m_records;
+  Region m_index;
+  Leaderboard m_leaderboard;
+
+  uint64_t &record_count() noexcept;
+  uint64_t record_count() const noexcept;
+  Record *records() noexcept;
+  const Record *records() const noexcept;
+  uint64_t slot_count() const noexcept;
+  Slot *slots() noexcept;
+  const Slot *slots() const noexcept;
+
+  std::optional<uint32_t> lookup(uint64_t id) const noexcept;
+  uint32_t add(std::string_view name, uint64_t id, int64_t now);
+  void index(uint64_t id, uint32_t record) noexcept;
+  void rebuild_index(uint64_t slots);
+  Standing standing(uint32_t record, std::size_t rank) const;
+};
+
+} // namespace battleship::rating
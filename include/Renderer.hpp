@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Board.hpp"
+#include "Rating.hpp"
+#include <cstdint>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -8,20 +11,28 @@
 namespace battleship {
 
 struct TurnInfo;
+struct GameSnapshot;
 
 // All rendering/display logic consolidated here
 class Renderer {
 public:
-  // Core rendering methods - return formatted strings
+  // Core rendering methods - return formatted strings. Each of the in-game
+  // parts also has a form appending to `out`, which is what a frame reused
+  // from one turn to the next is built with: once it has grown to a full
+  // screen, drawing allocates nothing.
   static std::string render_header();
   static std::string render_turn(std::string_view player_name);
-  static std::string render_battle_log(const std::vector<TurnInfo> &log,
+  static std::string render_battle_log(std::span<const TurnInfo> log,
                                        std::size_t max_entries = 3);
   static std::string render_boards(const Board &left_board,
                                    const Board &right_board,
                                    std::string_view left_title,
                                    std::string_view right_title,
                                    bool hide_left_ships, bool hide_right_ships);
+  static std::string render_boards(const Board::DisplayGrid &left_grid,
+                                   const Board::DisplayGrid &right_grid,
+                                   std::string_view left_title,
+                                   std::string_view right_title);
   static std::string render_statistics(const Board &player_board,
                                        const Board &opponent_board,
                                        std::string_view player_name,
@@ -38,25 +49,104 @@ public:
                                       const Board &loser_board,
                                       uint32_t winner_attacks, float winner_accuracy,
                                       uint32_t loser_attacks, float loser_accuracy);
+  // Both players' rating moves, shown under the game over screen
+  static std::string render_ratings(std::string_view winner_name,
+                                    std::string_view loser_name,
+                                    const rating::RatingStore::Change &winner,
+                                    const rating::RatingStore::Change &loser,
+                                    std::size_t players);
+  static std::string render_leaderboard(
+      std::span<const rating::RatingStore::Standing> standings, std::size_t players);
   static std::string render_game_start(std::string_view first_player);
 
+  // Full in-game screen: header, turn, log, boards, statistics
+  static std::string render_snapshot(const GameSnapshot &snapshot);
+
+  static void render_header(std::string &out);
+  static void render_turn(std::string &out, std::string_view player_name);
+  static void render_battle_log(std::string &out, std::span<const TurnInfo> log,
+                                std::size_t max_entries = 3);
+  static void render_boards(std::string &out, const Board::DisplayGrid &left_grid,
+                            const Board::DisplayGrid &right_grid,
+                            std::string_view left_title, std::string_view right_title);
+  static void render_statistics(std::string &out,
+                                const Board::ShipTypeCounts &player_counts,
+                                uint8_t player_total,
+                                const Board::ShipTypeCounts &opponent_counts,
+                                uint8_t opponent_total, std::string_view player_name,
+                                std::string_view opponent_name);
+  // Replaces the contents of `out`
+  static void render_snapshot(std::string &out, const GameSnapshot &snapshot);
+
+  // Room for any in-game screen, to reserve a frame with up front
+  static constexpr std::size_t FRAME_CAPACITY = 4096;
+
   // ANSI escape sequences
   static std::string clear_screen();
 
 private:
-  static constexpr std::size_t BOX_WIDTH = 51;
-  static constexpr std::size_t BOARD_WIDTH = 23;
-  static constexpr std::size_t GAP_WIDTH = 7;
-
-  static std::string render_single_board(const Board::DisplayGrid &grid);
-  static std::string result_to_string(AttackResult result);
+  static std::string_view result_to_string(AttackResult result);
 };
 
 // Console output - thin wrapper over cout
 class ConsoleRenderer {
 public:
-  static void display(std::string_view content);
+  static void display(std::string_view content); // flushed at once
   static void clear();
+
+  // Straight to stdout in one write(2), after anything cout still holds
+  static void write(std::string_view content);
+};
+
+// Redraws full-screen frames by rewriting only what changed. The frame on
+// screen is kept as a grid of cells, one per terminal column; each new frame
+// is compared against it and only runs of changed cells are sent, each after
+// an ANSI cursor move, all in one write. The first frame, and the first after
+// invalidate(), clears the screen and is drawn whole.
+//
+// Frames are lines of plain text, without tabs or escapes. Anything else
+// printed between frames stays on screen until the next full redraw.
+class DiffRenderer {
+public:
+  void draw(std::string_view frame);
+
+  // What draw() would write, without writing it; empty if nothing changed
+  std::string_view diff(std::string_view frame);
+
+  void invalidate() noexcept { m_valid = false; }
+
+  uint64_t bytes_written() const noexcept { return m_bytes_written; }
+
+private:
+  // A character's UTF-8 bytes, packed; a double-width character is followed
+  // by a WIDE_TAIL for the second column it covers
+  using Cell = uint32_t;
+  static constexpr Cell WIDE_TAIL = 0;
+
+  // Unchanged cells between two changes are resent rather than skipped
+  // when a cursor move would cost more
+  static constexpr std::size_t MERGE_GAP = 6;
+
+  // Rows beyond the row counts are spare, kept for their capacity
+  std::vector<std::vector<Cell>> m_screen;
+  std::vector<std::vector<Cell>> m_next;
+  std::size_t m_screen_rows{0};
+  std::size_t m_next_rows{0};
+  bool m_valid{false};
+
+  // Where the cursor is, and where a frame leaves it
+  std::size_t m_row{0};
+  std::size_t m_col{0};
+  std::size_t m_end_row{0};
+  std::size_t m_end_col{0};
+
+  std::string m_out;
+  uint64_t m_bytes_written{0};
+
+  void parse(std::string_view frame);
+  void diff_row(std::size_t row, std::span<const Cell> before,
+                std::span<const Cell> after);
+  void move_to(std::size_t row, std::size_t col);
 };
 
 } // namespace battleship
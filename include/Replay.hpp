@@ -0,0 +1,237 @@
+#pragma once
+
+#include "Board.hpp"
+#include "Config.hpp"
+#include "MappedFile.hpp"
+#include "Position.hpp"
+#include "Ship.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace battleship {
+class Player;
+}
+
+namespace battleship::replay {
+
+// File layout
+//   [file header: FILE_HEADER_SIZE bytes]
+//   [block 0][block 1]...   each BLOCK_SIZE bytes, the last one may be short
+//
+// Records never straddle blocks, so any block range can be scanned on its
+// own. A record size of 0 (or the end of the file) ends a block early.
+//
+// Record layout (little-endian)
+//   0  u16  record size in bytes
+//   2  u64  game seed, UNSEEDED for interactive games
+//   10 u8   strategies: first in low nibble, second in high nibble
+//   11 u8   winner (0/1)
+//   12 u8   placements[2][TOTAL_SHIPS], in SHIP_CONFIGS order:
+//           cell index (y * 10 + x) | 0x80 if vertical
+//   32 shots, 2 bytes each:
+//           u8 cell index, u8 AttackResult | 0x80 if fired by second player
+
+inline constexpr std::array<char, 8> MAGIC = {'B', 'S', 'R', 'E',
+                                              'P', 'L', 'A', 'Y'};
+inline constexpr uint16_t VERSION = 1;
+inline constexpr std::size_t FILE_HEADER_SIZE = 64;
+inline constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+inline constexpr std::size_t RECORD_HEADER_SIZE = 32;
+inline constexpr std::size_t SHOT_SIZE = 2;
+inline constexpr std::size_t CELL_COUNT =
+    static_cast<std::size_t>(config::GRID_SIZE) * config::GRID_SIZE;
+// Loser fires at most 99 shots (else the winner had no turn), winner 100
+inline constexpr std::size_t MAX_SHOTS = 2 * CELL_COUNT - 1;
+inline constexpr std::size_t MAX_RECORD_SIZE =
+    RECORD_HEADER_SIZE + MAX_SHOTS * SHOT_SIZE;
+
+inline constexpr uint8_t HUMAN = 0x0F;  // strategy code for a human player
+inline constexpr uint8_t ENGINE = 0x0E; // strategy code for an external engine
+// Seed of a game that no seed reproduces: input came from a person or engine
+inline constexpr uint64_t UNSEEDED = UINT64_MAX;
+inline constexpr uint8_t VERTICAL_FLAG = 0x80;
+inline constexpr uint8_t SECOND_PLAYER_FLAG = 0x80;
+
+static_assert(MAX_RECORD_SIZE <= BLOCK_SIZE);
+static_assert(RECORD_HEADER_SIZE == 12 + 2 * config::TOTAL_SHIPS);
+
+// Byte codecs shared by writer and reader
+inline uint8_t encode_cell(const Position &pos) noexcept {
+  return static_cast<uint8_t>(pos.y * config::GRID_SIZE + pos.x);
+}
+
+inline Position decode_cell(uint8_t cell) noexcept {
+  return Position{static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                  static_cast<config::GridCoord>(cell / config::GRID_SIZE)};
+}
+
+struct Placement {
+  Position start;
+  Orientation orientation;
+};
+
+struct Shot {
+  Position pos;
+  AttackResult result;
+  uint8_t shooter; // 0 = first player, 1 = second
+};
+
+// Non-owning view of one record inside a mapped file. Accessors decode
+// lazily straight from the bytes.
+class GameView {
+public:
+  explicit GameView(std::span<const uint8_t> record) noexcept
+      : m_data(record.data()), m_size(record.size()) {}
+
+  uint64_t seed() const noexcept {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+      value |= static_cast<uint64_t>(m_data[2 + i]) << (8 * i);
+    }
+    return value;
+  }
+
+  // Difficulty value, HUMAN or ENGINE
+  uint8_t strategy(std::size_t player) const noexcept {
+    return player == 0 ? (m_data[10] & 0x0F) : (m_data[10] >> 4);
+  }
+
+  uint8_t winner() const noexcept { return m_data[11]; }
+
+  uint8_t placement_byte(std::size_t player, std::size_t ship) const noexcept {
+    return m_data[12 + player * config::TOTAL_SHIPS + ship];
+  }
+
+  Placement placement(std::size_t player, std::size_t ship) const noexcept {
+    const uint8_t byte = placement_byte(player, ship);
+    return {decode_cell(byte & ~VERTICAL_FLAG),
+            (byte & VERTICAL_FLAG) ? Orientation::VERTICAL
+                                   : Orientation::HORIZONTAL};
+  }
+
+  std::size_t shot_count() const noexcept {
+    return (m_size - RECORD_HEADER_SIZE) / SHOT_SIZE;
+  }
+
+  uint8_t shot_cell(std::size_t i) const noexcept {
+    return m_data[RECORD_HEADER_SIZE + i * SHOT_SIZE];
+  }
+
+  Shot shot(std::size_t i) const noexcept {
+    const uint8_t flags = m_data[RECORD_HEADER_SIZE + i * SHOT_SIZE + 1];
+    return {decode_cell(shot_cell(i)),
+            static_cast<AttackResult>(flags & ~SECOND_PLAYER_FLAG),
+            static_cast<uint8_t>((flags & SECOND_PLAYER_FLAG) ? 1 : 0)};
+  }
+
+  std::span<const uint8_t> bytes() const noexcept { return {m_data, m_size}; }
+
+private:
+  const uint8_t *m_data;
+  std::size_t m_size;
+};
+
+// Streaming writer. Owns one block buffer and one record scratch buffer,
+// both allocated up front; recording a game allocates nothing.
+class Writer {
+public:
+  explicit Writer(const std::string &path);
+
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+  ~Writer();
+
+  void begin_game(uint64_t seed, uint8_t first_strategy,
+                  uint8_t second_strategy, const Board &first_board,
+                  const Board &second_board);
+  void record_shot(std::size_t shooter, const Position &pos,
+                   AttackResult result) noexcept;
+  void end_game(std::size_t winner);
+
+  // Copies an already encoded record (e.g. from another file)
+  void append_record(std::span<const uint8_t> record);
+
+  // Writes the games of the partial block so far; the file is a valid
+  // replay up to here even if the process dies before close()
+  void flush();
+
+  // Writes the partial block; the file stays a valid replay
+  void close();
+
+  uint64_t games_written() const noexcept { return m_games; }
+
+private:
+  int m_fd{-1};
+  std::unique_ptr<uint8_t[]> m_block;
+  std::size_t m_block_used{0};
+  std::size_t m_block_flushed{0}; // leading bytes of the block already written
+  std::array<uint8_t, MAX_RECORD_SIZE> m_record{};
+  std::size_t m_record_used{0};
+  uint64_t m_games{0};
+
+  void flush_block(std::size_t length);
+  void write_all(const uint8_t *data, std::size_t length);
+};
+
+// Memory-mapped reader: iterates records in place, nothing is deserialized
+class Reader {
+public:
+  explicit Reader(const std::string &path);
+
+  std::size_t block_count() const noexcept {
+    const std::size_t body = m_file.size() - FILE_HEADER_SIZE;
+    return (body + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  }
+
+  const std::string &path() const noexcept { return m_file.path(); }
+
+  // fn(const GameView &) for every game in blocks [first_block, last_block)
+  template <typename Fn>
+  void for_each_game(std::size_t first_block, std::size_t last_block,
+                     Fn &&fn) const {
+    const auto bytes = m_file.bytes();
+    for (std::size_t b = first_block; b < last_block; ++b) {
+      const std::size_t begin = FILE_HEADER_SIZE + b * BLOCK_SIZE;
+      const std::size_t end = std::min(begin + BLOCK_SIZE, bytes.size());
+
+      std::size_t offset = begin;
+      while (end - offset >= 2) {
+        const std::size_t size = static_cast<std::size_t>(bytes[offset]) |
+                                 (static_cast<std::size_t>(bytes[offset + 1]) << 8);
+        if (size == 0) {
+          break; // block padding
+        }
+        if (size < RECORD_HEADER_SIZE || size > end - offset) {
+          throw std::runtime_error("Corrupt replay record");
+        }
+        fn(GameView(bytes.subspan(offset, size)));
+        offset += size;
+      }
+    }
+  }
+
+  template <typename Fn> void for_each_game(Fn &&fn) const {
+    for_each_game(0, block_count(), std::forward<Fn>(fn));
+  }
+
+private:
+  MappedFile m_file;
+};
+
+// Re-packs the records of several files, in order, into one file. Output
+// bytes depend only on the record sequence, never on how it was split.
+uint64_t concatenate(std::span<const std::string> inputs,
+                     const std::string &output);
+
+// Code stored for a player in the strategies byte
+uint8_t strategy_code(const Player &player) noexcept;
+
+} // namespace battleship::replay
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Config.hpp"
+#include "Replay.hpp"
+#include "Stats.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace battleship::sim {
+
+// SplitMix64 finalizer: turns sequential inputs into independent seeds
+constexpr uint64_t mix64(uint64_t z) noexcept {
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Seed of game #index in a run; depends only on (master, index), so any
+// partition of the index range replays the exact same games
+constexpr uint64_t game_seed(uint64_t master_seed, uint64_t index) noexcept {
+  return mix64(master_seed + (index + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+struct MatchConfig {
+  config::Difficulty first{config::Difficulty::HARD};  // shoots first
+  config::Difficulty second{config::Difficulty::HARD};
+};
+
+struct MatchResult {
+  std::size_t winner{0}; // 0 = first, 1 = second
+  std::array<uint16_t, 2> shots{};
+};
+
+// Headless AI vs AI game, no rendering or delays. Fully determined by seed.
+MatchResult play_match(const MatchConfig &match, uint64_t seed,
+                       stats::SimStats *stats = nullptr,
+                       replay::Writer *replay = nullptr);
+
+// Plays games [first_game, first_game + game_count) of a run
+stats::SimStats run_games(const MatchConfig &match, uint64_t master_seed,
+                          uint64_t first_game, uint64_t game_count,
+                          replay::Writer *replay = nullptr);
+
+// Same range split evenly across threads; each thread owns its accumulator.
+// With a replay path, threads record to part files that are then
+// concatenated in game order, so the file matches a single-threaded run.
+stats::SimStats run_parallel(const MatchConfig &match, uint64_t master_seed,
+                             uint64_t first_game, uint64_t game_count,
+                             unsigned threads,
+                             const std::string &replay_path = {});
+
+// ============================================================================
+// Sharded runs: each process plays a disjoint slice of the game index range
+// of one master seed; merging the slices reproduces the single-process run.
+// ============================================================================
+
+inline constexpr std::string_view STATS_EXTENSION = ".stats";
+inline constexpr std::string_view REPLAY_EXTENSION = ".bsr";
+
+struct ShardSpec {
+  uint32_t index{0};
+  uint32_t count{1};
+
+  uint64_t first_game(uint64_t total_games) const noexcept {
+    return total_games * index / count;
+  }
+  uint64_t game_count(uint64_t total_games) const noexcept {
+    return total_games * (index + 1) / count - first_game(total_games);
+  }
+};
+
+struct ShardHeader {
+  MatchConfig match;
+  uint64_t master_seed{0};
+  uint64_t total_games{0};
+  ShardSpec shard;
+};
+
+// PREFIX.stats: header + SimStats::serialize()
+void write_shard_stats(const std::string &path, const ShardHeader &header,
+                       const stats::SimStats &stats);
+std::pair<ShardHeader, stats::SimStats>
+read_shard_stats(const std::string &path);
+
+// Combines PREFIX.stats (and PREFIX.bsr when every shard has one) of a
+// complete shard set into out_prefix, in shard order. Throws if the shards
+// belong to different runs or some are missing.
+ShardHeader merge_shards(std::span<const std::string> prefixes,
+                         const std::string &out_prefix);
+
+} // namespace battleship::sim
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Board.hpp"
+#include "Renderer.hpp"
+#include "net/NetworkManager.hpp"
+#include "net/Protocol.hpp"
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace battleship {
+
+struct TurnInfo;
+
+// Watches a server match. Both boards are rebuilt from the MATCH_VIEW sent
+// on attach, then kept current by SHOT events until GAME_OVER. The server
+// never sends fleets to spectators, so only hits, misses and sunk ships
+// show. A MATCH_VIEW can also arrive mid-match: the server sends one in
+// place of the events a slow spectator fell behind on.
+class Spectator {
+public:
+  explicit Spectator(net::NetworkManager &network);
+
+  // Until the match ends or the connection drops
+  void run();
+
+private:
+  net::NetworkManager &m_network;
+
+  std::array<Board, 2> m_boards; // shots fired at each side
+  std::array<Board::ShipTypeCounts, 2> m_afloat{
+      Board::ShipTypeCounts{1, 2, 3, 4}, Board::ShipTypeCounts{1, 2, 3, 4}};
+
+  std::vector<TurnInfo> m_battle_log;
+  static constexpr std::size_t MAX_BATTLE_LOG = 3;
+  static constexpr std::array<std::string_view, 2> NAMES{"Player 1", "Player 2"};
+
+  std::optional<uint64_t> m_match; // set by the first MATCH_VIEW
+  uint8_t m_turn{0};
+  uint16_t m_cursor{0};  // shots resolved so far
+  uint16_t m_skipped{0}; // shots only seen through a catch-up view
+  std::string m_frame;   // reused by every redraw
+  DiffRenderer m_screen;
+
+  bool apply_view(const net::protocol::MatchView &view);
+  bool apply_shot(const net::protocol::ShotEvent &shot);
+  void record_sunk(std::size_t side, const net::protocol::ShipPlacement &ship);
+  void show_game_over(const net::protocol::GameSummary &summary) const;
+  void display_state();
+};
+
+} // namespace battleship
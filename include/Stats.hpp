@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Config.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace battleship::stats {
+
+inline constexpr std::size_t CELL_COUNT =
+    static_cast<std::size_t>(config::GRID_SIZE) * config::GRID_SIZE;
+
+// A player can never fire more shots than there are cells
+inline constexpr std::size_t MAX_SHOTS = CELL_COUNT;
+
+inline constexpr std::size_t STRATEGY_COUNT = 3; // EASY, MEDIUM, HARD
+
+std::string_view strategy_name(config::Difficulty difficulty) noexcept;
+
+// One bin per possible shot count, so memory is fixed and merging is a sum
+class ShotHistogram {
+public:
+  using Bins = std::array<uint64_t, MAX_SHOTS + 1>;
+
+  void add(std::size_t shots) noexcept;
+  void merge(const ShotHistogram &other) noexcept;
+
+  uint64_t count() const noexcept { return m_count; }
+  double mean() const noexcept;
+  std::size_t min() const noexcept;
+  std::size_t max() const noexcept;
+
+  // Smallest shot count with at least p% of samples at or below it (p: 0-100)
+  std::size_t percentile(double p) const noexcept;
+
+  const Bins &bins() const noexcept { return m_bins; }
+
+  // Visits every counter in a fixed order (serialization)
+  template <typename Self, typename Fn> static void visit(Self &self, Fn &&fn) {
+    for (auto &bin : self.m_bins) {
+      fn(bin);
+    }
+    fn(self.m_count);
+    fn(self.m_sum);
+  }
+
+private:
+  Bins m_bins{};
+  uint64_t m_count{0};
+  uint64_t m_sum{0};
+};
+
+// Counters for every game one strategy took part in. A mirrored matchup is
+// one game but two seats; per-player averages divide by seats.
+struct StrategyStats {
+  uint64_t games{0};
+  uint64_t seats{0};
+  uint64_t wins{0};
+  ShotHistogram shots_to_win;
+
+  // Indexed by the player's own shot number (0 = first shot)
+  std::array<uint64_t, MAX_SHOTS> shots_by_turn{};
+  std::array<uint64_t, MAX_SHOTS> hits_by_turn{};
+
+  // Cell (y * GRID_SIZE + x) of the first successful hit in each game
+  std::array<uint64_t, CELL_COUNT> first_hits{};
+
+  // Shots fired while hunting vs finishing off a hit ship
+  uint64_t hunt_shots{0};
+  uint64_t target_shots{0};
+
+  void merge(const StrategyStats &other) noexcept;
+
+  double hit_rate(std::size_t turn) const noexcept;
+  double avg_hunt_shots() const noexcept;
+  double avg_target_shots() const noexcept;
+
+  template <typename Self, typename Fn> static void visit(Self &self, Fn &&fn) {
+    fn(self.games);
+    fn(self.seats);
+    fn(self.wins);
+    ShotHistogram::visit(self.shots_to_win, fn);
+    for (auto &n : self.shots_by_turn) {
+      fn(n);
+    }
+    for (auto &n : self.hits_by_turn) {
+      fn(n);
+    }
+    for (auto &n : self.first_hits) {
+      fn(n);
+    }
+    fn(self.hunt_shots);
+    fn(self.target_shots);
+  }
+};
+
+// Aggregate for a whole simulation run. Fixed size regardless of game count;
+// per-thread or per-process instances combine with merge().
+class SimStats {
+public:
+  StrategyStats &strategy(config::Difficulty difficulty) noexcept {
+    return m_strategies[static_cast<std::size_t>(difficulty)];
+  }
+  const StrategyStats &strategy(config::Difficulty difficulty) const noexcept {
+    return m_strategies[static_cast<std::size_t>(difficulty)];
+  }
+
+  void merge(const SimStats &other) noexcept;
+
+  uint64_t total_games() const noexcept;
+
+  // Compact exports: one row per (strategy, metric, key)
+  std::string to_csv() const;
+  std::string to_json() const;
+
+  // Fixed-length little-endian counter dump; equal stats give equal bytes
+  std::string serialize() const;
+  static SimStats deserialize(std::string_view data); // throws on bad size
+
+private:
+  std::array<StrategyStats, STRATEGY_COUNT> m_strategies{};
+};
+
+// Per-player, per-game bookkeeping feeding a StrategyStats; the caller
+// counts the game itself once per strategy
+class GameTracker {
+public:
+  explicit GameTracker(StrategyStats &target) noexcept : m_target(target) {}
+
+  void record_shot(std::size_t cell, bool hit, bool targeting) noexcept;
+  void finish(bool won) noexcept;
+
+  uint16_t shots() const noexcept { return m_shots; }
+
+private:
+  StrategyStats &m_target;
+  uint16_t m_shots{0};
+  bool m_has_hit{false};
+};
+
+} // namespace battleship::stats
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "net/Message.hpp"
+#include <boost/asio/buffer.hpp>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace battleship::net {
+
+// Per-connection receive buffer. Socket reads land after the buffered data
+// and frames are parsed in place from the front, so a message is never
+// copied out of it. When the front frame would run off the end, the unread
+// bytes wrap back to the start; the buffer only grows for a frame larger
+// than its capacity.
+class ReceiveBuffer {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 4096;
+
+  explicit ReceiveBuffer(std::size_t capacity = DEFAULT_CAPACITY);
+
+  // Free space for the next read. Invalidates views returned by next().
+  std::span<char> prepare();
+  void commit(std::size_t bytes) noexcept { m_tail += bytes; }
+
+  bool has_frame() const noexcept;
+
+  // The front frame, left in place
+  std::optional<MessageView> peek() const noexcept { return parse_frame(unread()); }
+
+  // Pops the front frame; the view stays valid until the next prepare()
+  std::optional<MessageView> next() noexcept;
+
+  void clear() noexcept { m_head = m_tail = 0; }
+  std::size_t capacity() const noexcept { return m_data.size(); }
+
+private:
+  std::vector<char> m_data;
+  std::size_t m_head{0}; // first unread byte
+  std::size_t m_tail{0}; // one past the last received byte
+
+  std::string_view unread() const noexcept {
+    return {m_data.data() + m_head, m_tail - m_head};
+  }
+};
+
+// Outgoing frames for one connection. Payloads are copied into buffers
+// recycled from earlier sends, and the whole queue goes out as one gather
+// write of header/payload pairs, so steady-state sending never allocates.
+class SendQueue {
+public:
+  void push(MessageType type, std::string_view payload);
+  // One frame whose payload is prefix followed by payload
+  void push(MessageType type, std::string_view prefix, std::string_view payload);
+
+  bool empty() const noexcept { return m_queued.empty(); }
+  bool in_flight() const noexcept { return !m_in_flight.empty(); }
+
+  // Moves everything queued into the in-flight batch and returns its
+  // buffers, valid until release_batch()
+  std::span<const boost::asio::const_buffer> take_batch();
+
+  // Recycles the in-flight batch once written (or failed)
+  void release_batch();
+
+  // Drops queued and in-flight frames, keeping their buffers
+  void clear();
+
+  // Drops queued frames only; a batch in flight stays valid until released
+  void drop_queued();
+
+private:
+  struct Frame {
+    FrameHeader header;
+    std::string payload;
+  };
+
+  std::vector<Frame> m_queued;
+  std::vector<Frame> m_in_flight;
+  std::vector<std::string> m_free; // recycled payload buffers
+  std::vector<boost::asio::const_buffer> m_gather;
+};
+
+// A whole encoded frame (header and payload) sent to many connections. It
+// is serialized once and never modified; every queue holding it shares the
+// bytes, which are freed when the last write that needs them completes.
+using SharedFrame = std::shared_ptr<const std::string>;
+
+SharedFrame make_shared_frame(MessageType type, std::string_view payload);
+
+// Outgoing shared frames for one watcher. Queueing one copies a pointer,
+// not the bytes, so fanning an event out to thousands of sockets allocates
+// nothing per socket. backlog() lets the owner cut off a slow reader
+// instead of letting its queue grow without bound.
+class BroadcastQueue {
+public:
+  void push(SharedFrame frame);
+
+  bool empty() const noexcept { return m_queued.empty(); }
+
+  // Bytes queued behind the write in flight
+  std::size_t backlog() const noexcept { return m_backlog; }
+
+  // Forgets the queued frames; the batch in flight is unaffected
+  void drop_queued() noexcept;
+
+  // Same contract as SendQueue
+  std::span<const boost::asio::const_buffer> take_batch();
+  void release_batch();
+
+private:
+  std::vector<SharedFrame> m_queued;
+  std::vector<SharedFrame> m_in_flight;
+  std::vector<boost::asio::const_buffer> m_gather;
+  std::size_t m_backlog{0};
+};
+
+} // namespace battleship::net
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <utility> // before asio: Boost 1.74 awaitable.hpp needs std::exchange
+#include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
+
+namespace battleship::net {
+
+// Calls on_expire if still in scope after timeout (zero = never). Going out
+// of scope disarms it even if the timer already fired. on_expire runs on
+// `where` (an io_context or an executor such as the caller's strand).
+class Deadline {
+public:
+  template <typename Where, typename OnExpire>
+  Deadline(Where &&where, std::chrono::milliseconds timeout, OnExpire on_expire)
+      : m_timer(std::forward<Where>(where)), m_state(std::make_shared<State>()) {
+    if (timeout.count() <= 0) {
+      return;
+    }
+    m_timer.expires_after(timeout);
+    m_timer.async_wait([state = m_state, on_expire](const boost::system::error_code &ec) {
+      if (!ec && state->armed) {
+        state->expired = true;
+        on_expire();
+      }
+    });
+  }
+
+  Deadline(const Deadline &) = delete;
+  Deadline &operator=(const Deadline &) = delete;
+
+  ~Deadline() {
+    m_state->armed = false;
+    m_timer.cancel();
+  }
+
+  // Maps the cancellation caused by expiry to a timeout error
+  void throw_if_failed(const boost::system::error_code &ec) const {
+    if (m_state->expired) {
+      throw boost::system::system_error(boost::asio::error::timed_out);
+    }
+    if (ec) {
+      throw boost::system::system_error(ec);
+    }
+  }
+
+private:
+  struct State {
+    bool armed{true};
+    bool expired{false};
+  };
+
+  boost::asio::steady_timer m_timer;
+  std::shared_ptr<State> m_state;
+};
+
+} // namespace battleship::net
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace battleship::net {
+
+using Micros = std::chrono::microseconds;
+
+// Power-of-two buckets: bucket 0 holds 0 us, bucket i holds
+// [2^(i-1), 2^i) us. Fixed size, so recording never allocates.
+class LatencyHistogram {
+public:
+  static constexpr std::size_t BUCKETS = 32;
+  using Buckets = std::array<uint64_t, BUCKETS>;
+
+  void add(Micros sample) noexcept;
+
+  uint64_t count() const noexcept { return m_count; }
+  Micros min() const noexcept { return m_count ? m_min : Micros{0}; }
+  Micros max() const noexcept { return m_max; }
+  double mean_ms() const noexcept;
+
+  // Upper bound of the bucket holding the p-th percentile (p: 0-100)
+  Micros percentile(double p) const noexcept;
+
+  const Buckets &buckets() const noexcept { return m_buckets; }
+
+  // Lower and upper bound of one bucket
+  static Micros bucket_floor(std::size_t bucket) noexcept;
+  static Micros bucket_ceiling(std::size_t bucket) noexcept;
+
+private:
+  Buckets m_buckets{};
+  uint64_t m_count{0};
+  uint64_t m_sum_us{0};
+  Micros m_min{Micros::max()};
+  Micros m_max{0};
+};
+
+// Log-linear buckets, 64 per power of two: percentiles within about 1.6%
+// of the exact value in fixed memory, for load tests that time millions of
+// turns (LatencyHistogram's doubling buckets are too coarse to compare runs)
+class FineHistogram {
+public:
+  void add(Micros sample) noexcept;
+  void merge(const FineHistogram &other) noexcept;
+
+  uint64_t count() const noexcept { return m_count; }
+  double mean_ms() const noexcept;
+
+  // Lower bound of the bucket holding the p-th percentile (p: 0-100)
+  Micros percentile(double p) const noexcept;
+
+private:
+  static constexpr unsigned SUB_BITS = 6;
+  static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BITS;
+  static constexpr std::size_t BUCKETS = SUB_BUCKETS * (32 - SUB_BITS + 1);
+
+  std::array<uint64_t, BUCKETS> m_buckets{};
+  uint64_t m_count{0};
+  uint64_t m_sum_us{0};
+
+  static std::size_t index(uint64_t us) noexcept;
+  static uint64_t floor(std::size_t bucket) noexcept;
+};
+
+// Smoothed RTT and jitter the way TCP estimates them (RFC 6298): srtt moves
+// 1/8 of the way to each sample, jitter (mean deviation) 1/4
+class RttEstimator {
+public:
+  void add(Micros sample) noexcept;
+
+  bool has_sample() const noexcept { return m_samples > 0; }
+  Micros srtt() const noexcept { return m_srtt; }
+  Micros jitter() const noexcept { return m_rttvar; }
+  Micros last() const noexcept { return m_last; }
+
+private:
+  uint64_t m_samples{0};
+  Micros m_srtt{0};
+  Micros m_rttvar{0};
+  Micros m_last{0};
+};
+
+// Everything measured on one connection: ping round trips, plus shots timed
+// from ATTACK sent to its result received (round trip plus the peer's work)
+struct LatencyStats {
+  RttEstimator rtt;
+  LatencyHistogram rtt_histogram;
+  LatencyHistogram shot_histogram;
+  std::optional<Micros> last_shot;
+
+  uint64_t pings_sent{0};
+  uint64_t pongs_received{0};
+  uint64_t stale_samples{0}; // discarded: one side was not reading
+
+  void record_rtt(Micros sample) noexcept;
+  void record_shot(Micros elapsed) noexcept;
+
+  // One line for the online UI (empty until something was measured)
+  std::string status_line() const;
+  // Full dump with histograms, shown when the connection ends
+  std::string report() const;
+};
+
+} // namespace battleship::net
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace battleship::net {
+
+// Message types for protocol
+enum class MessageType : uint8_t {
+  ATTACK = 1,       // Position attack
+  RESULT = 2,       // AttackResult response (1 byte)
+  RESULT_SUNK = 3,  // Sunk ship, see protocol::encode_sunk
+  BOARD_STATE = 4,
+  GAME_START = 5,
+  GAME_OVER = 6,    // protocol::GameSummary
+  YOUR_TURN = 7,
+  PING = 8,
+  PONG = 9,
+  HELLO = 10,       // First message each way; carries protocol::VERSION
+  SNAPSHOT = 11,    // Server match state for a resumed session
+  SHOT = 12,        // Spectators: one resolved shot, protocol::ShotEvent
+  MATCH_VIEW = 13,  // Spectators: catch-up state, protocol::MatchView
+  STREAM = 14,      // Multiplexed: one frame of one stream, see parse_stream
+  STREAM_CREDIT = 15 // Multiplexed: flow control, protocol::encode_credit
+};
+
+// Frame on the wire: type (1 byte) + big-endian payload length (2 bytes) +
+// payload
+inline constexpr std::size_t FRAME_HEADER_SIZE = 3;
+inline constexpr std::size_t MAX_PAYLOAD_SIZE = UINT16_MAX;
+
+using FrameHeader = std::array<char, FRAME_HEADER_SIZE>;
+
+FrameHeader encode_frame_header(MessageType type, std::size_t payload_size) noexcept;
+
+// Whole frame size announced by a header (header included)
+std::size_t frame_size(const char *header) noexcept;
+
+// A received message still sitting in its receive buffer; valid until that
+// buffer takes more data
+struct MessageView {
+  MessageType type;
+  std::string_view payload;
+};
+
+// Parses the frame at the front of data, nullopt until it is complete
+std::optional<MessageView> parse_frame(std::string_view data) noexcept;
+
+// A connection opened with Intent::MULTIPLEX carries many independent
+// streams, one game each. Every frame of a stream travels as the payload of
+// a STREAM frame: stream id (4 bytes, big-endian), the inner frame's type,
+// then its payload.
+using StreamId = uint32_t;
+inline constexpr std::size_t STREAM_HEADER_SIZE = 5;
+
+using StreamHeader = std::array<char, STREAM_HEADER_SIZE>;
+
+StreamHeader encode_stream_header(StreamId stream, MessageType type) noexcept;
+
+struct StreamView {
+  StreamId stream;
+  MessageView message;
+};
+
+// The stream frame inside a STREAM frame's payload; nullopt if too short
+std::optional<StreamView> parse_stream(std::string_view payload) noexcept;
+
+// Owning message, for callers that keep it around
+struct Message {
+  MessageType type;
+  std::string payload;
+
+  static Message copy_of(const MessageView &view) {
+    return Message{view.type, std::string(view.payload)};
+  }
+
+  std::string serialize() const;
+  static std::optional<Message> deserialize(std::string_view data);
+};
+
+} // namespace battleship::net
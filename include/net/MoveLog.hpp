@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Position.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace battleship::net {
+
+// Durable append-only log of hosted matches, so a restarted server picks up
+// every match that was still being played. Fleets are dealt from the match
+// seed, so a match is its START record plus the cells fired at.
+//
+// Segment layout: DIR/moves-NNNNNNNN.wal
+//   [segment header: SEGMENT_HEADER_SIZE bytes]
+//     0  char[8] magic, 8 u16 version, 16 u64 next match id when opened
+//   [record][record]...
+//
+// Record layout (little-endian)
+//   0  u32  FNV-1a of bytes 4..end
+//   4  u8   type
+//   5  u8   body size
+//   6  body: START  u64 match, u64 seed, u64 session[2]
+//            SHOT   u64 match, u8 shooter, u8 cell (y * 10 + x)
+//            END    u64 match
+//
+// Appends only copy into a buffer. A writer thread commits the buffer as
+// one write and one fdatasync per batch, waiting up to the batch delay for
+// more records to join it; callers that must not run ahead of the disk ask
+// to be woken once their records are durable. A torn record at the end of
+// the newest segment is where a crash cut the log and is discarded.
+class MoveLog {
+public:
+  struct Shot {
+    uint8_t shooter;
+    Position cell;
+  };
+
+  // A match that had no END record when the log was opened
+  struct Match {
+    uint64_t id{0};
+    uint64_t seed{0};
+    std::array<uint64_t, 2> sessions{};
+    std::vector<Shot> shots;
+  };
+
+  static constexpr std::array<char, 8> MAGIC = {'B', 'S', 'M', 'O',
+                                                'V', 'L', 'O', 'G'};
+  static constexpr uint16_t VERSION = 1;
+  static constexpr std::size_t SEGMENT_HEADER_SIZE = 32;
+  static constexpr std::size_t RECORD_HEADER_SIZE = 6;
+  static constexpr std::size_t SEGMENT_SIZE = 16 * 1024 * 1024; // rotate past
+  static constexpr std::size_t BATCH_LIMIT = 256 * 1024; // commit early past
+
+  // Replays every segment in `directory` (created if missing), writes the
+  // unfinished matches into a fresh segment and deletes the old ones
+  MoveLog(std::filesystem::path directory, std::chrono::microseconds batch_delay);
+  ~MoveLog(); // commits whatever is pending
+
+  MoveLog(const MoveLog &) = delete;
+  MoveLog &operator=(const MoveLog &) = delete;
+
+  // Unfinished matches found at startup, in match id order
+  const std::vector<Match> &recovered() const noexcept { return m_recovered; }
+  // Above every match id ever logged
+  uint64_t next_match() const noexcept {
+    return m_next_match.load(std::memory_order_relaxed);
+  }
+
+  // Each returns the log position just past its record
+  uint64_t begin(uint64_t match, uint64_t seed, const std::array<uint64_t, 2> &sessions);
+  uint64_t shot(uint64_t match, std::size_t shooter, const Position &cell);
+  uint64_t end(uint64_t match);
+
+  // Log position up to which everything is on disk
+  uint64_t durable() const noexcept { return m_durable.load(std::memory_order_acquire); }
+
+  // Calls `done` on the writer thread once `position` is durable, or right
+  // here if it already is
+  void when_durable(uint64_t position, std::function<void()> done);
+
+  // Records committed and the batches they took, for the shutdown report
+  uint64_t records() const noexcept { return m_records.load(std::memory_order_relaxed); }
+  uint64_t commits() const noexcept { return m_commits.load(std::memory_order_relaxed); }
+
+private:
+  enum class Record : uint8_t { START = 1, SHOT = 2, END = 3 };
+
+  struct Waiter {
+    uint64_t position;
+    std::function<void()> done;
+  };
+
+  // A match starting or ending, applied to m_live_since by the writer once
+  // the batch holding it is written
+  struct Lifecycle {
+    uint64_t match;
+    bool started;
+  };
+
+  std::filesystem::path m_directory;
+  std::chrono::microseconds m_batch_delay;
+  std::vector<Match> m_recovered;
+  std::atomic<uint64_t> m_next_match{0};
+
+  // Writer thread only
+  int m_fd{-1};
+  uint32_t m_segment{0};
+  uint32_t m_first_segment{0}; // oldest not yet deleted
+  std::size_t m_segment_bytes{0};
+  // Live match -> segment holding its START; older segments are deletable
+  std::unordered_map<uint64_t, uint32_t> m_live_since;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::vector<uint8_t> m_pending;
+  std::vector<Lifecycle> m_pending_lifecycle;
+  std::vector<Waiter> m_waiters;
+  std::chrono::steady_clock::time_point m_first_pending;
+  uint64_t m_appended{0};
+  uint64_t m_pending_records{0};
+  bool m_stopping{false};
+
+  std::atomic<uint64_t> m_durable{0};
+  std::atomic<uint64_t> m_commits{0};
+  std::atomic<uint64_t> m_records{0};
+  std::thread m_writer;
+
+  std::filesystem::path segment_path(uint32_t segment) const;
+  void recover(const std::map<uint32_t, std::filesystem::path> &segments);
+  void open_segment(uint32_t segment);
+  void write_all(const uint8_t *data, std::size_t size);
+  void sync_directory() const;
+
+  uint64_t append(Record type, const uint8_t *body, std::size_t size,
+                  const Lifecycle *lifecycle = nullptr);
+  void writer_loop();
+  void rotate();
+};
+
+} // namespace battleship::net
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "net/Buffers.hpp"
+#include "net/Message.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace battleship::net {
+
+// Many independent games over one connection, one stream each (see
+// parse_stream for the framing). Either side opens streams, the connecting
+// side with odd ids and the accepting side with even ones, by sending on
+// them; a stream ends when both sides close() it.
+//
+// Flow control is per stream and credit based: a sender may have at most
+// WINDOW bytes of STREAM frames on a stream that the receiver has not
+// consumed yet, and gets them back with STREAM_CREDIT as the receiver
+// consumes. A stream whose game stops reading stalls on its own instead of
+// filling the socket buffers every other stream shares. Credit goes back in
+// half-window batches, so a frame may cost at most half a window: a sender
+// waiting for room for one has at least that much unreturned, which is
+// enough to make the receiver send credit once it catches up.
+//
+// Transport agnostic: frames go out through outbox(), which the owner
+// writes to its socket, and come in through receive().
+class Multiplexer {
+public:
+  static constexpr uint32_t WINDOW = 4096;
+  static constexpr uint32_t MAX_FRAME_COST = WINDOW / 2; // see stream_cost()
+
+  explicit Multiplexer(bool initiator) noexcept;
+
+  StreamId open();
+  // Ends our side of a stream: nothing more is sent or received on it,
+  // except frames still waiting for credit, which go out first
+  void close(StreamId stream);
+
+  // Queues one frame on a stream, into outbox() right away if the stream
+  // has credit, otherwise as soon as the peer returns enough. Throws
+  // std::invalid_argument for a frame over MAX_FRAME_COST.
+  void send(StreamId stream, MessageType type, std::string_view payload);
+
+  // One frame read from the connection. Returns the stream message a
+  // STREAM frame carries, or nullopt for credit and late frames of closed
+  // streams. A peer breaking the framing or its window throws
+  // std::runtime_error.
+  std::optional<StreamView> receive(const MessageView &frame);
+
+  // The owner is done with a message receive() returned; its bytes are
+  // credited back to the peer once half a window has been consumed
+  void consumed(const StreamView &message);
+
+  SendQueue &outbox() noexcept { return m_outbox; }
+
+  std::size_t streams() const noexcept { return m_streams.size(); }
+  uint64_t stalls() const noexcept { return m_stalls; }
+
+private:
+  struct Pending {
+    MessageType type;
+    std::string payload;
+  };
+
+  struct Stream {
+    uint32_t credit{WINDOW};     // bytes we may still send
+    std::deque<Pending> waiting; // queued while out of credit
+    uint32_t buffered{0};        // received and not yet credited back
+    uint32_t consumed{0};        // part of buffered the owner is done with
+    bool closed{false};          // kept only until waiting drains
+  };
+
+  SendQueue m_outbox;
+  std::unordered_map<StreamId, Stream> m_streams;
+  StreamId m_next_local;
+  StreamId m_last_remote{0};
+  uint64_t m_stalls{0}; // frames that had to wait for credit
+
+  bool is_local(StreamId stream) const noexcept {
+    return (stream & 1) == (m_next_local & 1);
+  }
+  void push(StreamId stream, MessageType type, std::string_view payload);
+  void on_credit(std::string_view payload);
+};
+
+// Bytes a stream frame counts against its window: the whole STREAM frame
+inline constexpr std::size_t stream_cost(std::size_t payload_size) noexcept {
+  return FRAME_HEADER_SIZE + STREAM_HEADER_SIZE + payload_size;
+}
+
+} // namespace battleship::net
@@ -1,50 +1,106 @@
 #pragma once
 
 #include "Position.hpp"
-#include <boost/asio.hpp>
+#include "net/Buffers.hpp"
+#include "net/Latency.hpp"
+#include "net/Message.hpp"
+#include "net/Protocol.hpp"
+#include "net/Transport.hpp"
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace battleship::net {
 
-using boost::asio::ip::tcp;
-
-// Message types for protocol
-enum class MessageType : uint8_t {
-  ATTACK = 1,       // Position attack
-  RESULT = 2,       // AttackResult response (1 byte)
-  RESULT_SUNK = 3,  // Ship sunk with positions "A1,A2,A3"
-  BOARD_STATE = 4,
-  GAME_START = 5,
-  GAME_OVER = 6,
-  YOUR_TURN = 7,
-  PING = 8,
-  PONG = 9
-};
+// Connection timeouts; zero waits forever
+struct Timeouts {
+  std::chrono::milliseconds connect{5000};
+  std::chrono::milliseconds accept{0};
+  std::chrono::milliseconds ping{1000}; // PING period for RTT, zero = never
 
-// Simple message: type (1 byte) + length (2 bytes) + payload
-struct Message {
-  MessageType type;
-  std::string payload;
+  // TCP keepalive period, see enable_keepalive(); zero = off
+  std::chrono::milliseconds keepalive{5000};
 
-  std::string serialize() const;
-  static std::optional<Message> deserialize(const std::string &data);
+  // Drops the connection after this long without hearing from the peer
+  // while pinging it. Only for peers that always answer (a server): a human
+  // peer thinking over a move does not. Zero = never.
+  std::chrono::milliseconds dead_peer{0};
 };
 
-class NetworkManager {
+// One peer connection, over TCP, a Unix domain socket or an in-process
+// channel (see Transport). All I/O runs on io_context(): a read loop fills a
+// receive buffer and a write loop drains a send queue, so nothing waits on
+// the socket unless the caller asks to. Both loops live as long as the
+// connection; the write loop parks on a signal while the queue is empty.
+// They are chains of completion handlers rather than coroutines, their state
+// in handler memory, so neither direction allocates once the buffers are
+// warm. The blocking methods drive io_context() on the calling thread.
+class NetworkManager : private TransportHandler {
 public:
   static constexpr uint16_t DEFAULT_PORT = 7777;
 
-  NetworkManager();
+  explicit NetworkManager(Timeouts timeouts = {});
   ~NetworkManager();
 
+  NetworkManager(const NetworkManager &) = delete;
+  NetworkManager &operator=(const NetworkManager &) = delete;
+
+  // ---- Async API (throws boost::system::system_error on failure, timeout
+  // or cancel) ----
+
+  // Both complete after the HELLO exchange; a peer on another protocol
+  // version is dropped with std::runtime_error
+  awaitable<void> async_host(uint16_t port = DEFAULT_PORT);
+  awaitable<void> async_join(std::string host_ip, uint16_t port = DEFAULT_PORT);
+  // The same over a Unix domain socket; the host replaces a stale socket file
+  awaitable<void> async_host_local(std::string path);
+  awaitable<void> async_join_local(std::string path);
+  // Takes over a transport that is already connected, such as one end of a
+  // ChannelTransport pair made for io_context(), and says HELLO over it
+  awaitable<void> async_attach(std::unique_ptr<Transport> transport, bool is_host);
+
+  // Completes once msg and everything queued before it reached the socket
+  awaitable<void> async_send(Message msg);
+  awaitable<void> async_flush();
+  awaitable<Message> async_receive();
+
+  // Like async_receive(), but the payload stays in the receive buffer. The
+  // view is valid until the io_context next runs.
+  awaitable<MessageView> async_receive_view();
+
+  // Aborts the connect, accept or receive pending when the io_context next
+  // runs. Safe to call from any thread; an open connection stays open.
+  void cancel();
+
+  boost::asio::io_context &io_context() noexcept { return m_io_context; }
+
+  // Runs ready handlers without waiting
+  void poll();
+
+  // ---- Blocking API ----
+
   // Host a game, wait for connection
   bool host(uint16_t port = DEFAULT_PORT);
 
   // Join a hosted game
   bool join(const std::string &host_ip, uint16_t port = DEFAULT_PORT);
 
+  // Unix domain socket and in-process counterparts of the above
+  bool host_local(const std::string &path);
+  bool join_local(const std::string &path);
+  bool attach(std::unique_ptr<Transport> transport, bool is_host);
+
+  // Reconnects to the endpoint of the last join() and presents a server
+  // session token in the HELLO, so the server puts us back in our match
+  bool resume(uint64_t session);
+
+  // Joins a server as a spectator of match `match_id`, or of its most
+  // watched match with protocol::ANY_MATCH
+  bool watch(const std::string &host_ip, uint16_t port, uint64_t match_id);
+
   // Close connection
   void disconnect();
 
@@ -52,30 +108,115 @@ public:
   bool is_connected() const noexcept { return m_connected; }
   bool is_host() const noexcept { return m_is_host; }
 
-  // Send/receive messages
+  // Send/receive messages. send() is queue() followed by flush().
   bool send(const Message &msg);
+  bool send(MessageType type, std::string_view payload = {});
   std::optional<Message> receive();
 
+  // Messages queued between flushes leave in a single write, so one logical
+  // step (say RESULT_SUNK then GAME_OVER) costs one syscall and one segment
+  bool queue(MessageType type, std::string_view payload = {});
+  bool flush();
+
+  // Starts pinging every Timeouts::ping once a game is under way. Not done
+  // on connect: a server lobby takes any traffic as the client hanging up.
+  void start_pinging();
+
+  // Round trips measured by PING/PONG, plus shot timings the game records
+  const LatencyStats &latency() const noexcept { return m_latency; }
+  LatencyStats &latency() noexcept { return m_latency; }
+
+  // TCP_NODELAY on this and later connections (default on: batching is done
+  // by queue()/flush(), so Nagle would only add latency)
+  void set_no_delay(bool enabled);
+
+  // Like receive(), but gives up after timeout so the caller can keep
+  // rendering or thinking between network waits
+  std::optional<Message> receive_for(std::chrono::milliseconds timeout);
+
+  // Zero-copy receive_for(); the view is valid until the next call that
+  // sends, receives or polls
+  std::optional<MessageView> receive_view_for(std::chrono::milliseconds timeout);
+
   // Convenience methods
   bool send_attack(const Position &pos);
-  bool send_result(uint8_t result);
+  bool send_result(AttackResult result);
   bool send_board_state(const std::string &rendered_board);
   bool send_your_turn();
-  bool send_game_over(const std::string &final_screen);
+  bool send_game_over(const protocol::GameSummary &summary);
 
   std::optional<Position> receive_attack();
-  std::optional<uint8_t> receive_result();
+  std::optional<AttackResult> receive_result();
 
 private:
+  // Before m_io_context: its destructor frees a parked write loop's wait
+  HandlerMemory m_park_memory;
   boost::asio::io_context m_io_context;
-  std::unique_ptr<tcp::socket> m_socket;
+  Timeouts m_timeouts;
+  // Shared with pending I/O, which may still complete after a disconnect
+  std::shared_ptr<Transport> m_transport;
   std::unique_ptr<tcp::acceptor> m_acceptor;
+  std::unique_ptr<unix_stream::acceptor> m_local_acceptor;
+
+  ReceiveBuffer m_inbox;
+  SendQueue m_outbox;
+  bool m_writing{false}; // the write loop is not parked
+
+  // Never expire on their own; cancel() wakes every waiter. The write loop
+  // parks on m_outbox_signal, async_flush() on m_flush_signal.
+  boost::asio::steady_timer m_inbox_signal;
+  boost::asio::steady_timer m_outbox_signal;
+  boost::asio::steady_timer m_flush_signal;
 
   bool m_connected{false};
   bool m_is_host{false};
-
-  bool send_raw(const std::string &data);
-  std::optional<std::string> receive_raw(std::size_t length);
+  bool m_no_delay{true};
+
+  LatencyStats m_latency;
+  boost::asio::steady_timer m_ping_timer;
+
+  // Nothing is read while the owner is not running io_context(). Pings that
+  // span such a stall would time the owner, not the network.
+  std::chrono::steady_clock::time_point m_pump_ended{};
+  std::chrono::steady_clock::time_point m_stall_ended{};
+  bool m_stall_pending{false}; // the next read holds what queued up meanwhile
+  bool m_draining_stall{false};
+  std::chrono::steady_clock::time_point m_last_heard{};
+
+  // Last join() target, and what the next HELLO asks of a server
+  std::string m_join_host;
+  uint16_t m_join_port{DEFAULT_PORT};
+  protocol::HelloRequest m_request;
+
+  uint64_t m_connection_id{0}; // stale handlers compare against this
+  uint64_t m_cancel_generation{0};
+
+  template <typename Protocol>
+  awaitable<void> accept(typename Protocol::endpoint endpoint);
+  void on_connected(bool is_host);
+  awaitable<void> handshake();
+
+  // Wakes the write loop if it is parked with messages queued
+  void start_writing();
+  // Next step of the write loop: send what is queued, or park
+  void write_next();
+
+  // PING/PONG never reach receivers: they are answered or timed as soon as
+  // they reach the front of the inbox
+  void drain_control();
+  bool has_message();
+  awaitable<void> ping_loop(uint64_t connection_id);
+
+  void begin_pump() noexcept;
+  void end_pump() noexcept;
+  void on_connection_lost(uint64_t connection_id, const char *what,
+                          const boost::system::error_code &ec);
+  void on_read(Transport &transport, const boost::system::error_code &ec,
+               std::size_t bytes) override;
+  void on_written(Transport &transport, const boost::system::error_code &ec) override;
+
+  // Runs op to completion on the calling thread
+  template <typename T> T run_blocking(awaitable<T> op);
 };
 
 } // namespace battleship::net
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "Board.hpp"
+#include "Position.hpp"
+#include "Ship.hpp"
+#include "net/Message.hpp"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary message payloads. Cells travel as one byte, y * GRID_SIZE + x; a
+// ship as its start cell plus one byte holding its length with the top bit
+// set when vertical.
+namespace battleship::net::protocol {
+
+// Bumped on any incompatible payload or message-order change; peers must
+// match exactly
+inline constexpr uint8_t VERSION = 7;
+
+// What a client wants from a server, carried in its HELLO. MULTIPLEX is
+// for peers only: the connection carries many games as streams (see
+// net::Multiplexer); servers refuse it.
+enum class Intent : uint8_t { PLAY = 0, RESUME = 1, WATCH = 2, MULTIPLEX = 3 };
+
+// WATCH id asking for whichever live match has the most spectators
+inline constexpr uint64_t ANY_MATCH = UINT64_MAX;
+
+struct HelloRequest {
+  Intent intent{Intent::PLAY};
+  uint64_t id{0}; // RESUME: session token, WATCH: match id or ANY_MATCH
+};
+
+// HELLO: "BS" + version, sent by both sides right after connecting. Any
+// intent but PLAY appends its byte and the 8-byte id.
+std::string encode_hello(const HelloRequest &request = {});
+std::optional<uint8_t> decode_hello(std::string_view payload);
+std::optional<HelloRequest> decode_hello_request(std::string_view payload);
+
+// STREAM_CREDIT: stream id and the bytes of STREAM frames on it the
+// receiver has consumed, which the sender may now send again (4 + 4 bytes)
+struct Credit {
+  StreamId stream{0};
+  uint32_t bytes{0};
+};
+
+std::string encode_credit(const Credit &credit);
+std::optional<Credit> decode_credit(std::string_view payload);
+
+// PING/PONG: the sender's 8-byte timestamp, echoed back unchanged
+std::string encode_ping(uint64_t timestamp);
+std::optional<uint64_t> decode_ping(std::string_view payload);
+
+// ATTACK: target cell
+std::string encode_attack(const Position &pos);
+std::optional<Position> decode_attack(std::string_view payload);
+
+// RESULT: one AttackResult byte
+std::string encode_result(AttackResult result);
+std::optional<AttackResult> decode_result(std::string_view payload);
+
+// One ship as dealt or sunk
+struct ShipPlacement {
+  config::ShipType type;
+  Position start;
+  Orientation orientation;
+
+  std::vector<Position> cells() const;
+
+  static ShipPlacement of(const Ship &ship);
+};
+
+// RESULT_SUNK: the sunk ship
+std::string encode_sunk(const Ship &ship);
+std::optional<ShipPlacement> decode_sunk(std::string_view payload);
+
+// GAME_START in server mode: flags (bit 0 = receiver shoots first), the
+// session token that resumes the match after a reconnect, then the
+// receiver's fleet as dealt by the server
+struct GameStart {
+  bool first{false};
+  uint64_t session{0};
+  std::vector<ShipPlacement> fleet;
+};
+
+std::string encode_game_start(bool first, uint64_t session, const Board &fleet);
+std::optional<GameStart> decode_game_start(std::string_view payload);
+
+// GAME_OVER: the receiver's outcome and both sides' shooting, which the
+// receiver renders itself. Index 0 is the receiver, 1 its opponent.
+// Spectators get it as seen by the first player, the only ones told LEFT.
+enum class Outcome : uint8_t { WIN = 1, LOSS = 2, OPPONENT_LEFT = 3, LEFT = 4 };
+
+struct GameSummary {
+  Outcome outcome{Outcome::WIN};
+  std::array<uint16_t, 2> shots{};
+  std::array<uint16_t, 2> hits{};
+
+  // Same game seen from the other side
+  GameSummary flipped() const noexcept;
+};
+
+std::string encode_game_over(const GameSummary &summary);
+std::optional<GameSummary> decode_game_over(std::string_view payload);
+
+// One bit per cell, indexed like the cell byte; 13 bytes on the wire
+using CellSet = std::bitset<config::GRID_SIZE * config::GRID_SIZE>;
+
+// SNAPSHOT: a server match as the receiver sees it, sent instead of
+// replaying the moves it missed while reconnecting. Around 80 bytes.
+struct Snapshot {
+  bool your_turn{false};
+  uint16_t cursor{0};               // shots resolved so far, both sides
+  std::vector<ShipPlacement> fleet; // receiver's ships
+  CellSet incoming;                 // cells the opponent has shot at
+  CellSet shots;                    // cells the receiver has shot at
+  CellSet hits;                     // the subset of shots that hit
+  std::vector<ShipPlacement> sunk;  // opponent ships the receiver sank
+};
+
+std::string encode_snapshot(const Snapshot &snapshot);
+std::optional<Snapshot> decode_snapshot(std::string_view payload);
+
+// SHOT: one resolved shot for spectators. Shooter is the side index (0 =
+// the player who started), plus the ship it sank, if any.
+struct ShotEvent {
+  uint8_t shooter{0};
+  Position target;
+  AttackResult result{AttackResult::MISS};
+  std::optional<ShipPlacement> sunk;
+};
+
+std::string encode_shot(const ShotEvent &shot);
+std::optional<ShotEvent> decode_shot(std::string_view payload);
+
+// MATCH_VIEW: a match as a spectator sees it, sent when one attaches and
+// in place of the events a slow one could not keep up with. Fleets stay
+// hidden: only shots, hits and sunk ships, so watching cannot help a
+// player. Around 70 bytes.
+struct MatchView {
+  struct Side {
+    CellSet shots; // cells this side has shot at
+    CellSet hits;  // the subset of shots that hit
+    std::vector<ShipPlacement> sunk; // opponent ships this side sank
+  };
+
+  uint64_t match{0};
+  uint8_t turn{0};  // side on turn
+  uint16_t cursor{0}; // shots resolved so far, both sides
+  std::array<Side, 2> sides;
+};
+
+std::string encode_match_view(const MatchView &view);
+std::optional<MatchView> decode_match_view(std::string_view payload);
+
+} // namespace battleship::net::protocol
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "net/NetworkManager.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace battleship::net {
+
+class MoveLog;
+
+struct ServerConfig {
+  uint16_t port{NetworkManager::DEFAULT_PORT};
+  unsigned threads{0};          // 0 = one per core
+  std::optional<uint64_t> seed; // fixes every fleet; random if unset
+
+  // Shared-nothing mode: one io_context, acceptor, session table and
+  // allocator per thread, each thread pinned to a core
+  bool sharded{false};
+
+  // TCP_NODELAY on client sockets. Each match step is already flushed as
+  // one write per player, so Nagle only delays it.
+  bool no_delay{true};
+
+  // TCP keepalive on client sockets, see enable_keepalive(); zero = off.
+  // Clients only ping during a game, and not while their user thinks, so
+  // the kernel is what notices a vanished client.
+  std::chrono::milliseconds keepalive{5000};
+
+  // How long a dropped player's seat is held for a resume before the
+  // opponent wins by forfeit; zero = forfeit at once
+  std::chrono::milliseconds resume_grace{30000};
+
+  // House AI-vs-AI matches kept running for spectators, each replaced by a
+  // fresh one when it ends, with one shot per `showcase_pace`
+  unsigned showcase{0};
+  std::chrono::milliseconds showcase_pace{500};
+
+  // Directory of the write-ahead move log (see MoveLog); empty = no log.
+  // Each shot's result waits until the batch holding it is synced, and a
+  // batch stays open at most `log_delay` for more shots to join it.
+  std::string log_directory;
+  std::chrono::microseconds log_delay{1000};
+};
+
+struct ServerStats {
+  uint64_t connections{0};
+  uint64_t active_matches{0};
+  uint64_t completed_matches{0};
+  uint64_t forfeits{0};
+  uint64_t shots{0};
+  uint64_t writes{0}; // socket writes, one per flushed batch
+  uint64_t resumes{0};
+  uint64_t spectators{0}; // attached so far
+  uint64_t catch_ups{0};  // spectator backlogs replaced by a MATCH_VIEW
+  uint64_t restored{0};   // matches rebuilt from the move log at startup
+  uint64_t log_records{0};
+  uint64_t log_commits{0}; // fdatasyncs, each covering a batch of records
+};
+
+// Dedicated match server. Clients connect, wait in a matchmaking queue and
+// are paired into independent matches, each a coroutine on its own strand.
+// The server deals both fleets and resolves every shot; clients only see
+// what the protocol tells them.
+//
+// By default all threads share one io_context. In sharded mode every thread
+// owns a shard with its own SO_REUSEPORT acceptor and runs its matches
+// start to finish; the only cross-core traffic is handing over sockets: a
+// waiting player's to whichever shard accepts the next one, a resuming
+// player's or a spectator's to the shard running its match.
+//
+// GAME_START carries a session token. A dropped player who reconnects with
+// it, on any shard, gets its seat back along with a snapshot of the match:
+// the token names the shard holding the seat, which looks it up in its own
+// session table.
+//
+// Any number of spectators can watch a match, player or showcase. Each
+// event is encoded once and the same buffer is queued to every spectator.
+// The match id names its shard like a token does; a spectator asking for
+// the most watched match is passed from shard to shard, each checking its
+// own matches.
+//
+// With a move log every player match is logged as it is played, and a
+// restarted server rebuilds the unfinished ones with both seats held for a
+// resume, as if both players had just dropped.
+class Server {
+public:
+  explicit Server(ServerConfig config);
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  // Serves until stop(), SIGINT or SIGTERM
+  void run();
+  void stop();
+
+  uint16_t port() const; // bound port (useful with port 0)
+  ServerStats stats() const noexcept;
+
+private:
+  struct Connection;
+  class Match;
+  class Shard;
+
+  ServerConfig m_config;
+  unsigned m_thread_count;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+
+  // Sharded mode: socket of the one player waiting for an opponent, parked
+  // here by one shard and claimed by another (-1 = empty)
+  std::atomic<int> m_parked_fd{-1};
+
+  std::unique_ptr<MoveLog> m_log;
+  uint64_t m_restored{0};
+
+  // Shard owning a match id or session token
+  Shard &shard_of(uint64_t tagged) const noexcept;
+
+  void resume(uint64_t session, tcp::socket socket);
+  void watch(uint64_t match_id, tcp::socket socket);
+};
+
+} // namespace battleship::net
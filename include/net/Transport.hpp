@@ -0,0 +1,308 @@
+#pragma once
+
+#include <utility> // before asio: Boost 1.74 awaitable.hpp needs std::exchange
+#include <boost/asio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace battleship::net {
+
+using boost::asio::ip::tcp;
+using unix_stream = boost::asio::local::stream_protocol;
+
+template <typename T> using awaitable = boost::asio::awaitable<T>;
+
+// What socket I/O runs on, fixed at build time (BATTLESHIP_IO_URING)
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+inline constexpr std::string_view IO_BACKEND = "io_uring";
+#elif defined(__linux__)
+inline constexpr std::string_view IO_BACKEND = "epoll";
+#else
+inline constexpr std::string_view IO_BACKEND = "default";
+#endif
+
+// Kernel heartbeats: keepalive probes after `interval` of silence, then
+// every `interval`, and the connection fails once KEEPALIVE_PROBES in a row
+// go unanswered. Unlike PINGs these are answered by the peer's kernel, so a
+// peer stuck waiting for its user still counts as alive.
+inline constexpr int KEEPALIVE_PROBES = 3;
+void enable_keepalive(tcp::socket &socket, std::chrono::milliseconds interval);
+
+// ============================================================================
+// Handler memory
+// ============================================================================
+
+// Room for the state of one pending asio operation. An operation that is
+// started again and again for the life of a connection (the next read, the
+// next write) reuses it instead of allocating each time; a second one
+// started while the first is pending falls back to the heap. May be
+// released on another thread than the one that took it.
+class HandlerMemory {
+public:
+  // Fits a socket's gather write of up to 64 buffers with room to spare
+  static constexpr std::size_t SIZE = 1024;
+
+  HandlerMemory() = default;
+  HandlerMemory(const HandlerMemory &) = delete;
+  HandlerMemory &operator=(const HandlerMemory &) = delete;
+
+  void *allocate(std::size_t size) {
+    if (size <= sizeof(m_storage) && !m_in_use.exchange(true, std::memory_order_acquire)) {
+      return m_storage;
+    }
+    return ::operator new(size);
+  }
+
+  void deallocate(void *pointer) noexcept {
+    if (pointer == m_storage) {
+      m_in_use.store(false, std::memory_order_release);
+    } else {
+      ::operator delete(pointer);
+    }
+  }
+
+private:
+  alignas(std::max_align_t) std::byte m_storage[SIZE];
+  std::atomic<bool> m_in_use{false};
+};
+
+template <typename T> class HandlerAllocator {
+public:
+  using value_type = T;
+
+  explicit HandlerAllocator(HandlerMemory &memory) noexcept : m_memory(&memory) {}
+  template <typename U>
+  HandlerAllocator(const HandlerAllocator<U> &other) noexcept : m_memory(other.m_memory) {}
+
+  T *allocate(std::size_t count) {
+    return static_cast<T *>(m_memory->allocate(count * sizeof(T)));
+  }
+  void deallocate(T *pointer, std::size_t /*count*/) noexcept {
+    m_memory->deallocate(pointer);
+  }
+
+  template <typename U> bool operator==(const HandlerAllocator<U> &other) const noexcept {
+    return m_memory == other.m_memory;
+  }
+
+private:
+  template <typename> friend class HandlerAllocator;
+  HandlerMemory *m_memory;
+};
+
+// A completion handler whose operation state asio places in `memory`
+template <typename Handler> class MemoryBoundHandler {
+public:
+  using allocator_type = HandlerAllocator<Handler>;
+
+  MemoryBoundHandler(HandlerMemory &memory, Handler handler)
+      : m_memory(&memory), m_handler(std::move(handler)) {}
+
+  allocator_type get_allocator() const noexcept { return allocator_type(*m_memory); }
+
+  template <typename... Args> void operator()(Args &&...args) {
+    m_handler(std::forward<Args>(args)...);
+  }
+
+private:
+  HandlerMemory *m_memory;
+  Handler m_handler;
+};
+
+template <typename Handler>
+MemoryBoundHandler<Handler> bind_memory(HandlerMemory &memory, Handler handler) {
+  return MemoryBoundHandler<Handler>(memory, std::move(handler));
+}
+
+// ============================================================================
+// Transports
+// ============================================================================
+
+class Transport;
+
+// Gets a transport's completions, on the transport's io_context. Must
+// outlive the operations started for it.
+class TransportHandler {
+public:
+  virtual void on_read(Transport &transport, const boost::system::error_code &ec,
+                       std::size_t bytes) = 0;
+  virtual void on_written(Transport &transport, const boost::system::error_code &ec) = 0;
+
+protected:
+  ~TransportHandler() = default;
+};
+
+// The byte stream under a NetworkManager connection. Errors are reported
+// the way sockets report them: eof once the peer closed, operation_aborted
+// after our own close(). I/O completes on the io_context the transport was
+// made for, which must be the NetworkManager's. Transports are owned by
+// shared_ptr: a pending operation keeps its transport alive.
+//
+// One read and one write may be pending at a time. Their state lives in the
+// transport's handler memory, so a connection's steady stream of reads and
+// writes makes no allocations.
+class Transport : public std::enable_shared_from_this<Transport> {
+public:
+  virtual ~Transport() = default;
+
+  // Reads what is there (at least one byte) into `into`
+  virtual void async_read_some(std::span<char> into, TransportHandler &handler) = 0;
+  // Writes all of buffers (or fails)
+  virtual void async_write(std::span<const boost::asio::const_buffer> buffers,
+                           TransportHandler &handler) = 0;
+
+  // Aborts pending I/O; the peer reads eof after what was already sent
+  virtual void close() noexcept = 0;
+  virtual bool is_open() const noexcept = 0;
+
+  // TCP only; no-ops elsewhere
+  virtual void set_no_delay(bool /*enabled*/) {}
+  virtual void enable_keepalive(std::chrono::milliseconds /*interval*/) {}
+
+protected:
+  HandlerMemory m_read_memory;
+  HandlerMemory m_write_memory;
+};
+
+// A stream socket: TCP or a Unix domain socket
+template <typename Protocol> class SocketTransport final : public Transport {
+public:
+  explicit SocketTransport(boost::asio::io_context &io) : m_socket(io) {}
+
+  typename Protocol::socket &socket() noexcept { return m_socket; }
+
+  void async_read_some(std::span<char> into, TransportHandler &handler) override {
+    m_socket.async_read_some(
+        boost::asio::buffer(into.data(), into.size()),
+        bind_memory(m_read_memory, [self = shared_from_this(), &handler](
+                                       const boost::system::error_code &ec,
+                                       std::size_t bytes) { handler.on_read(*self, ec, bytes); }));
+  }
+
+  void async_write(std::span<const boost::asio::const_buffer> buffers,
+                   TransportHandler &handler) override {
+    boost::asio::async_write(
+        m_socket, buffers,
+        bind_memory(m_write_memory, [self = shared_from_this(), &handler](
+                                        const boost::system::error_code &ec,
+                                        std::size_t /*bytes*/) { handler.on_written(*self, ec); }));
+  }
+
+  void close() noexcept override {
+    if (m_socket.is_open()) {
+      boost::system::error_code ignored;
+      m_socket.shutdown(Protocol::socket::shutdown_both, ignored);
+      m_socket.close(ignored);
+    }
+  }
+
+  bool is_open() const noexcept override { return m_socket.is_open(); }
+
+  void set_no_delay(bool enabled) override {
+    if constexpr (std::is_same_v<Protocol, tcp>) {
+      boost::system::error_code ignored;
+      m_socket.set_option(tcp::no_delay(enabled), ignored);
+    }
+  }
+
+  void enable_keepalive(std::chrono::milliseconds interval) override {
+    if constexpr (std::is_same_v<Protocol, tcp>) {
+      net::enable_keepalive(m_socket, interval);
+    }
+  }
+
+private:
+  typename Protocol::socket m_socket;
+};
+
+using TcpTransport = SocketTransport<tcp>;
+using UnixTransport = SocketTransport<unix_stream>;
+
+// One end of an in-process connection: a lock-free single-producer
+// single-consumer byte ring per direction, so co-located games, benchmarks
+// and tests run the whole connection logic without the kernel's network
+// stack. The two ends may live on different threads. A side blocked on an
+// empty or full ring is woken with a post to its io_context, the only
+// time either side takes a lock. Reads and writes complete with a post to
+// our own io_context, like a socket's.
+class ChannelTransport final : public Transport {
+public:
+  static constexpr std::size_t CAPACITY = 64 * 1024; // bytes per direction
+
+  // Two connected ends, completing their I/O on `first` and `second`
+  static std::pair<std::unique_ptr<ChannelTransport>, std::unique_ptr<ChannelTransport>>
+  make_pair(boost::asio::io_context &first, boost::asio::io_context &second);
+
+  ~ChannelTransport() override;
+
+  ChannelTransport(const ChannelTransport &) = delete;
+  ChannelTransport &operator=(const ChannelTransport &) = delete;
+
+  void async_read_some(std::span<char> into, TransportHandler &handler) override;
+  void async_write(std::span<const boost::asio::const_buffer> buffers,
+                   TransportHandler &handler) override;
+
+  void close() noexcept override;
+  bool is_open() const noexcept override { return m_open; }
+
+private:
+  struct Ring {
+    std::unique_ptr<char[]> bytes{new char[CAPACITY]};
+    alignas(64) std::atomic<uint64_t> written{0}; // producer's total
+    alignas(64) std::atomic<uint64_t> read{0};    // consumer's total
+    std::atomic<bool> reader_waiting{false};
+    std::atomic<bool> writer_waiting{false};
+    std::atomic<bool> closed{false}; // by either end
+  };
+
+  // Where to post a wake-up; owner is null once that end is gone
+  struct Side {
+    std::mutex mutex;
+    boost::asio::io_context *io{nullptr};
+    ChannelTransport *owner{nullptr};
+    std::array<HandlerMemory, 2> wake_memory; // by Event
+  };
+
+  struct Channel {
+    std::array<Ring, 2> rings; // ring i is read by side i
+    std::array<Side, 2> sides;
+  };
+
+  enum class Event : uint8_t { READABLE, WRITABLE };
+
+  ChannelTransport(boost::asio::io_context &io, std::shared_ptr<Channel> channel,
+                   std::size_t side);
+
+  boost::asio::io_context &m_io;
+  std::shared_ptr<Channel> m_channel;
+  std::size_t m_side;
+  // Never expire on their own; a wake-up cancels them
+  boost::asio::steady_timer m_readable;
+  boost::asio::steady_timer m_writable;
+  bool m_open{true};
+
+  // The pending read, and the pending write with how far it got
+  std::span<char> m_read_into;
+  TransportHandler *m_read_handler{nullptr};
+  std::span<const boost::asio::const_buffer> m_write_buffers;
+  std::size_t m_write_offset{0}; // into m_write_buffers.front()
+  TransportHandler *m_write_handler{nullptr};
+
+  Ring &inbound() noexcept { return m_channel->rings[m_side]; }
+  Ring &outbound() noexcept { return m_channel->rings[1 - m_side]; }
+  void wake_peer(Event event);
+  // Finish the pending operation as far as the ring allows, then complete
+  // it or wait for the peer's wake-up
+  void continue_read();
+  void continue_write();
+};
+
+} // namespace battleship::net
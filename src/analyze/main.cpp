@@ -0,0 +1,125 @@
+#include "Analysis.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+struct Options {
+  unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+  analysis::Filter filter;
+  std::string csv_path;
+  std::vector<std::string> inputs;
+};
+
+void print_usage() {
+  std::cout
+      << "Usage: battleship-analyze [options] FILE...\n"
+         "  --threads T      worker threads (default: all cores)\n"
+         "  --where COND     only count games matching COND (repeatable)\n"
+         "                   fields: shots winner_shots winner first second any\n"
+         "                   e.g. shots<=120  winner=1  first=hard  any=easy\n"
+         "                   players: easy medium hard human engine\n"
+         "  --csv FILE       write aggregates as CSV\n";
+}
+
+std::optional<Options> parse_args(int argc, char **argv) {
+  Options opts;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      return std::nullopt;
+    }
+    if (!arg.starts_with("--")) {
+      opts.inputs.emplace_back(arg);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << std::format("Missing value for {}\n", arg);
+      return std::nullopt;
+    }
+    const std::string_view value = argv[++i];
+
+    if (arg == "--threads") {
+      unsigned threads = 0;
+      const auto [ptr, ec] =
+          std::from_chars(value.data(), value.data() + value.size(), threads);
+      if (ec != std::errc{} || ptr != value.data() + value.size()) {
+        std::cerr << std::format("Invalid number for {}: {}\n", arg, value);
+        return std::nullopt;
+      }
+      opts.threads = threads;
+    } else if (arg == "--where") {
+      const auto condition = analysis::Condition::parse(value);
+      if (!condition) {
+        std::cerr << std::format("Invalid condition: {}\n", value);
+        return std::nullopt;
+      }
+      opts.filter.conditions.push_back(*condition);
+    } else if (arg == "--csv") {
+      opts.csv_path = value;
+    } else {
+      std::cerr << std::format("Unknown option: {}\n", arg);
+      return std::nullopt;
+    }
+  }
+
+  if (opts.inputs.empty()) {
+    std::cerr << "No replay files given\n";
+    return std::nullopt;
+  }
+  return opts;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto opts = parse_args(argc, argv);
+  if (!opts) {
+    print_usage();
+    return 1;
+  }
+
+  try {
+    std::vector<replay::Reader> files;
+    files.reserve(opts->inputs.size());
+    std::size_t blocks = 0;
+    for (const auto &path : opts->inputs) {
+      files.emplace_back(path);
+      blocks += files.back().block_count();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto totals = analysis::analyze(files, opts->filter, opts->threads);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::format("Scanned {} files, {} blocks in {:.3f}s\n",
+                             files.size(), blocks, elapsed.count());
+    std::cout << totals.to_text();
+
+    if (!opts->csv_path.empty()) {
+      std::ofstream out(opts->csv_path, std::ios::binary);
+      out << totals.to_csv();
+      if (!out) {
+        std::cerr << std::format("Failed to write {}\n", opts->csv_path);
+        return 1;
+      }
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
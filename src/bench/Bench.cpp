@@ -0,0 +1,99 @@
+#include "Bench.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+// Counting replacements for the global allocation functions
+void *operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace battleship::bench {
+
+uint64_t allocation_count() noexcept {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+State::State(uint64_t iterations) noexcept : m_iterations(iterations) {}
+
+void State::pause() noexcept {
+  m_elapsed += std::chrono::steady_clock::now() - m_started;
+  m_allocations += allocation_count() - m_allocs_at_start;
+}
+
+void State::resume() noexcept {
+  m_allocs_at_start = allocation_count();
+  m_started = std::chrono::steady_clock::now();
+}
+
+Runner::Runner(std::chrono::milliseconds min_time, std::string_view filter)
+    : m_min_time(min_time), m_filter(filter) {}
+
+void Runner::add(std::string name, Body body) {
+  m_benchmarks.emplace_back(std::move(name), std::move(body));
+}
+
+std::vector<Result> Runner::run_all() const {
+  std::vector<Result> results;
+  for (const auto &[name, body] : m_benchmarks) {
+    if (!m_filter.empty() && name.find(m_filter) == std::string::npos) {
+      continue;
+    }
+    results.push_back(run_one(name, body));
+  }
+  return results;
+}
+
+Result Runner::run_one(const std::string &name, const Body &body) const {
+  // Grow the iteration count until one run lasts at least min_time
+  uint64_t iterations = 1;
+  while (true) {
+    State state(iterations);
+    state.start();
+    body(state);
+    state.finish();
+
+    const auto elapsed = state.elapsed();
+    if (elapsed >= m_min_time || iterations >= (uint64_t{1} << 40)) {
+      Result result;
+      result.name = name;
+      result.iterations = iterations;
+      result.ns_per_op = static_cast<double>(elapsed.count()) /
+                         static_cast<double>(iterations);
+      result.allocs_per_op = static_cast<double>(state.allocations()) /
+                             static_cast<double>(iterations);
+      result.ops_per_sec =
+          result.ns_per_op > 0 ? 1e9 / result.ns_per_op : 0.0;
+      return result;
+    }
+
+    // Aim 20% past min_time, but never grow more than 100x per step
+    const double per_op = std::max(
+        1.0, static_cast<double>(elapsed.count()) / static_cast<double>(iterations));
+    const double wanted =
+        1.2 * static_cast<double>(
+                  std::chrono::nanoseconds(m_min_time).count()) / per_op;
+    iterations = std::clamp<uint64_t>(static_cast<uint64_t>(wanted),
+                                      iterations + 1, iterations * 100);
+  }
+}
+
+} // namespace battleship::bench
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace battleship::bench {
+
+// Heap allocations made so far by this process (counted by the bench
+// binary's replacement operator new)
+uint64_t allocation_count() noexcept;
+
+// Handed to a benchmark body: run the measured operation iterations()
+// times. Setup work goes between pause() and resume() and is excluded from
+// both time and allocation counts.
+class State {
+public:
+  explicit State(uint64_t iterations) noexcept;
+
+  uint64_t iterations() const noexcept { return m_iterations; }
+
+  void pause() noexcept;
+  void resume() noexcept;
+
+  std::chrono::nanoseconds elapsed() const noexcept { return m_elapsed; }
+  uint64_t allocations() const noexcept { return m_allocations; }
+
+  // Called by the runner
+  void start() noexcept { resume(); }
+  void finish() noexcept { pause(); }
+
+private:
+  uint64_t m_iterations;
+  std::chrono::steady_clock::time_point m_started{};
+  uint64_t m_allocs_at_start{0};
+  std::chrono::nanoseconds m_elapsed{0};
+  uint64_t m_allocations{0};
+};
+
+struct Result {
+  std::string name;
+  uint64_t iterations{0};
+  double ns_per_op{0};
+  double allocs_per_op{0};
+  double ops_per_sec{0};
+};
+
+using Body = std::function<void(State &)>;
+
+class Runner {
+public:
+  explicit Runner(std::chrono::milliseconds min_time,
+                  std::string_view filter = {});
+
+  void add(std::string name, Body body);
+  std::vector<Result> run_all() const;
+
+private:
+  std::chrono::milliseconds m_min_time;
+  std::string m_filter;
+  std::vector<std::pair<std::string, Body>> m_benchmarks;
+
+  Result run_one(const std::string &name, const Body &body) const;
+};
+
+// Keeps a computed value alive so the optimizer cannot drop the work
+template <typename T> inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace battleship::bench
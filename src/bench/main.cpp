@@ -0,0 +1,714 @@
+#include "AIStrategy.hpp"
+#include "Bench.hpp"
+#include "FrameRenderer.hpp"
+#include "Player.hpp"
+#include "Rating.hpp"
+#include "Renderer.hpp"
+#include "Simulation.hpp"
+#include "net/Buffers.hpp"
+#include "net/NetworkManager.hpp"
+#include "net/Protocol.hpp"
+#include "net/Transport.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace battleship;
+using bench::do_not_optimize;
+
+namespace {
+
+using PositionSet = std::unordered_set<Position, Position::Hash>;
+
+constexpr uint64_t BENCH_SEED = 0xB5B5'2024;
+constexpr std::size_t CELL_COUNT = config::GRID_SIZE * config::GRID_SIZE;
+
+struct Options {
+  std::chrono::milliseconds min_time{200};
+  std::string filter;
+  std::string csv_path;
+};
+
+void print_usage() {
+  std::cout << "Usage: battleship-bench [options]\n"
+               "  --filter TEXT    only run benchmarks whose name contains TEXT\n"
+               "  --min-time MS    minimum measured time per benchmark (default 200)\n"
+               "  --csv FILE       also write results as CSV\n";
+}
+
+std::optional<Options> parse_args(int argc, char **argv) {
+  Options opts;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+      return std::nullopt;
+    }
+    const std::string_view value = argv[++i];
+
+    if (arg == "--filter") {
+      opts.filter = value;
+    } else if (arg == "--csv") {
+      opts.csv_path = value;
+    } else if (arg == "--min-time") {
+      uint32_t ms = 0;
+      const auto [ptr, ec] =
+          std::from_chars(value.data(), value.data() + value.size(), ms);
+      if (ec != std::errc{} || ptr != value.data() + value.size() || ms == 0) {
+        std::cerr << std::format("Invalid number for {}: {}\n", arg, value);
+        return std::nullopt;
+      }
+      opts.min_time = std::chrono::milliseconds(ms);
+    } else {
+      std::cerr << std::format("Unknown option: {}\n", arg);
+      return std::nullopt;
+    }
+  }
+  return opts;
+}
+
+// Runs op(i) for i in [0, iterations), calling prepare(n) untimed before
+// every run of up to `batch` operations
+template <typename Prepare, typename Op>
+void batched(bench::State &state, std::size_t batch, Prepare prepare, Op op) {
+  uint64_t remaining = state.iterations();
+  while (remaining > 0) {
+    const std::size_t count =
+        static_cast<std::size_t>(std::min<uint64_t>(remaining, batch));
+    state.pause();
+    prepare(count);
+    state.resume();
+    for (std::size_t i = 0; i < count; ++i) {
+      op(i);
+    }
+    remaining -= count;
+  }
+}
+
+Player make_fleet(uint64_t seed) {
+  Player player("Bench", PlayerType::AI, config::Difficulty::EASY,
+                static_cast<uint32_t>(sim::mix64(seed)));
+  player.auto_place_ships();
+  return player;
+}
+
+Position cell_position(std::size_t cell) {
+  return Position{static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                  static_cast<config::GridCoord>(cell / config::GRID_SIZE)};
+}
+
+// ============================================================================
+// Board
+// ============================================================================
+
+void add_board_benchmarks(bench::Runner &runner) {
+  // Every cell once, in a fixed shuffled order: a realistic hit/miss/sunk mix
+  std::array<Position, CELL_COUNT> order;
+  for (std::size_t i = 0; i < CELL_COUNT; ++i) {
+    order[i] = cell_position(i);
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937_64(BENCH_SEED));
+
+  runner.add("board/attack", [order](bench::State &state) {
+    std::vector<Player> fleets;
+    uint64_t next_seed = 0;
+    batched(
+        state, CELL_COUNT * 16,
+        [&](std::size_t count) {
+          fleets.clear();
+          for (std::size_t i = 0; i < (count + CELL_COUNT - 1) / CELL_COUNT;
+               ++i) {
+            fleets.push_back(make_fleet(next_seed++));
+          }
+        },
+        [&](std::size_t i) {
+          do_not_optimize(
+              fleets[i / CELL_COUNT].board().attack(order[i % CELL_COUNT]));
+        });
+  });
+
+  runner.add("board/can_place_ship", [](bench::State &state) {
+    const Player fleet = make_fleet(1);
+    const Board &board = fleet.board();
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      const std::size_t cell = i % CELL_COUNT;
+      const auto orientation = (i / CELL_COUNT) % 2 == 0
+                                   ? Orientation::HORIZONTAL
+                                   : Orientation::VERTICAL;
+      do_not_optimize(
+          board.can_place_ship(cell_position(cell), 3, orientation));
+    }
+  });
+
+  runner.add("board/auto_place_ships", [](bench::State &state) {
+    std::vector<Player> players;
+    uint64_t next_seed = 0;
+    batched(
+        state, 64,
+        [&](std::size_t count) {
+          players.clear();
+          for (std::size_t i = 0; i < count; ++i) {
+            players.emplace_back("Bench", PlayerType::AI,
+                                 config::Difficulty::EASY,
+                                 static_cast<uint32_t>(next_seed++));
+          }
+        },
+        [&](std::size_t i) { players[i].auto_place_ships(); });
+  });
+}
+
+// ============================================================================
+// Strategies
+// ============================================================================
+
+// A strategy part-way through a game, with the attacker's view of the board
+template <typename Strategy> struct StrategyScenario {
+  Strategy strategy;
+  PositionSet attacked;
+  std::vector<Position> hits;
+};
+
+// Plays one seeded game and stops `fraction` of the way to the winning shot
+template <typename Strategy>
+StrategyScenario<Strategy> make_scenario(double fraction) {
+  const auto play = [](std::size_t stop_after) {
+    StrategyScenario<Strategy> scenario{
+        Strategy(static_cast<uint32_t>(BENCH_SEED)), {}, {}};
+    Player defender = make_fleet(BENCH_SEED);
+    std::size_t shots = 0;
+    while (shots < stop_after && !defender.has_lost()) {
+      const Position pos = scenario.strategy.get_attack_position(
+          scenario.attacked, scenario.hits);
+      const AttackResult result = defender.receive_attack(pos);
+      scenario.attacked.insert(pos);
+      if (result == AttackResult::HIT || result == AttackResult::SUNK) {
+        scenario.hits.push_back(pos);
+      }
+      scenario.strategy.on_attack_result(pos, result);
+      ++shots;
+    }
+    return std::pair{std::move(scenario), shots};
+  };
+
+  const std::size_t game_length = play(CELL_COUNT).second;
+  const auto stop = static_cast<std::size_t>(
+      fraction * static_cast<double>(game_length > 0 ? game_length - 1 : 0));
+  return play(stop).first;
+}
+
+template <typename Strategy>
+void add_strategy_benchmarks(bench::Runner &runner, std::string_view name) {
+  constexpr std::array<std::pair<std::string_view, double>, 3> PHASES = {
+      {{"early", 0.0}, {"mid", 0.5}, {"late", 1.0}}};
+
+  for (const auto &[phase, fraction] : PHASES) {
+    runner.add(
+        std::format("strategy/{}/{}", name, phase),
+        [scenario = make_scenario<Strategy>(fraction)](bench::State &state) {
+          // get_attack_position consumes queued targets, so each call gets
+          // a fresh copy of the prepared strategy
+          std::vector<Strategy> copies;
+          batched(
+              state, 256,
+              [&](std::size_t count) {
+                copies.assign(count, scenario.strategy);
+              },
+              [&](std::size_t i) {
+                do_not_optimize(copies[i].get_attack_position(
+                    scenario.attacked, scenario.hits));
+              });
+        });
+  }
+}
+
+// ============================================================================
+// Rendering
+// ============================================================================
+
+void add_render_benchmarks(bench::Runner &runner) {
+  const auto make_boards = [] {
+    std::pair<Player, Player> players{make_fleet(1), make_fleet(2)};
+    std::mt19937_64 rng(BENCH_SEED);
+    for (std::size_t i = 0; i < 40; ++i) {
+      players.first.receive_attack(cell_position(rng() % CELL_COUNT));
+      players.second.receive_attack(cell_position(rng() % CELL_COUNT));
+    }
+    return players;
+  };
+
+  runner.add("render/boards", [make_boards](bench::State &state) {
+    const auto players = make_boards();
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(Renderer::render_boards(
+          players.first.board(), players.second.board(), "YOUR BOARD",
+          "ENEMY BOARD", false, true));
+    }
+  });
+
+  runner.add("render/statistics", [make_boards](bench::State &state) {
+    const auto players = make_boards();
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(Renderer::render_statistics(
+          players.first.board(), players.second.board(), "Player 1",
+          "Player 2"));
+    }
+  });
+
+  const auto make_snapshot = [](const std::pair<Player, Player> &players) {
+    GameSnapshot snapshot;
+    snapshot.turn_player = "Player 1";
+    for (std::size_t i = 0; i < GameSnapshot::MAX_LOG; ++i) {
+      snapshot.log[i] = {cell_position(i * 7), AttackResult::HIT, "Player 2"};
+    }
+    snapshot.log_size = GameSnapshot::MAX_LOG;
+    snapshot.grids = {players.first.board().render(false),
+                      players.second.board().render(true)};
+    snapshot.titles = {"YOUR BOARD", "ENEMY BOARD"};
+    snapshot.names = {"Player 1", "Player 2"};
+    snapshot.counts = {players.first.board().get_remaining_ship_types(),
+                       players.second.board().get_remaining_ship_types()};
+    snapshot.ships_left = {players.first.board().ships_remaining(),
+                           players.second.board().ships_remaining()};
+    return snapshot;
+  };
+
+  // A whole in-game screen into one reused frame, as the game loop draws it
+  runner.add("render/frame", [make_boards, make_snapshot](bench::State &state) {
+    const auto players = make_boards();
+    const GameSnapshot snapshot = make_snapshot(players);
+
+    std::string frame;
+    frame.reserve(Renderer::FRAME_CAPACITY);
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      Renderer::render_snapshot(frame, snapshot);
+      do_not_optimize(frame.data());
+    }
+  });
+
+  // The terminal update between two frames one shot apart
+  runner.add("render/diff", [make_boards, make_snapshot](bench::State &state) {
+    auto players = make_boards();
+    std::array<std::string, 2> frames;
+    Renderer::render_snapshot(frames[0], make_snapshot(players));
+    players.second.receive_attack(cell_position(99));
+    GameSnapshot shot = make_snapshot(players);
+    shot.log[0] = {cell_position(99), AttackResult::MISS, "Player 1"};
+    std::rotate(shot.log.begin(), shot.log.begin() + 1, shot.log.end());
+    Renderer::render_snapshot(frames[1], shot);
+
+    DiffRenderer screen;
+    do_not_optimize(screen.diff(frames[0]));
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(screen.diff(frames[(i + 1) % 2]).size());
+    }
+  });
+}
+
+// ============================================================================
+// Ratings
+// ============================================================================
+
+// A store in the temp directory holding RATED_PLAYERS players with a game
+// each, built on first use and deleted at exit
+class RatingFixture {
+public:
+  static constexpr std::size_t RATED_PLAYERS = 100'000;
+
+  RatingFixture()
+      : m_path((std::filesystem::temp_directory_path() /
+                std::format("battleship-bench-{}.ratings", ::getpid()))
+                   .string()) {
+    for (std::size_t i = 0; i < RATED_PLAYERS; ++i) {
+      m_names.push_back(std::format("player-{}", i));
+    }
+    m_store = std::make_unique<rating::RatingStore>(m_path);
+    for (std::size_t i = 0; i < RATED_PLAYERS; i += 2) {
+      m_store->record_game(m_names[i], m_names[i + 1], 0);
+    }
+  }
+
+  ~RatingFixture() {
+    m_store.reset();
+    std::error_code ignored;
+    std::filesystem::remove(m_path, ignored);
+    std::filesystem::remove(m_path + ".idx", ignored);
+  }
+
+  rating::RatingStore &store() noexcept { return *m_store; }
+  const std::string &path() const noexcept { return m_path; }
+  const std::string &name(std::size_t i) const noexcept { return m_names[i]; }
+
+  void close() { m_store.reset(); }
+  void reopen() { m_store = std::make_unique<rating::RatingStore>(m_path); }
+
+private:
+  std::string m_path;
+  std::vector<std::string> m_names;
+  std::unique_ptr<rating::RatingStore> m_store;
+};
+
+void add_rating_benchmarks(bench::Runner &runner) {
+  auto fixture = std::make_shared<std::unique_ptr<RatingFixture>>();
+  const auto get = [fixture](bench::State &state) -> RatingFixture & {
+    if (!*fixture) {
+      state.pause();
+      *fixture = std::make_unique<RatingFixture>();
+      state.resume();
+    }
+    return **fixture;
+  };
+
+  runner.add("rating/record_game", [get](bench::State &state) {
+    RatingFixture &ratings = get(state);
+    std::mt19937_64 rng(BENCH_SEED);
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      const std::size_t a = rng() % RatingFixture::RATED_PLAYERS;
+      const std::size_t b = (a + 1 + rng() % (RatingFixture::RATED_PLAYERS - 1)) %
+                            RatingFixture::RATED_PLAYERS;
+      do_not_optimize(ratings.store().record_game(ratings.name(a), ratings.name(b),
+                                                  static_cast<int64_t>(i)));
+    }
+  });
+
+  runner.add("rating/standings_page", [get](bench::State &state) {
+    RatingFixture &ratings = get(state);
+    std::mt19937_64 rng(BENCH_SEED);
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(
+          ratings.store().standings(1 + rng() % RatingFixture::RATED_PLAYERS, 10));
+    }
+  });
+
+  // Map both files and rebuild the in-memory rank order
+  runner.add("rating/open_100k", [get](bench::State &state) {
+    RatingFixture &ratings = get(state);
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      state.pause();
+      ratings.close();
+      state.resume();
+      ratings.reopen();
+    }
+  });
+}
+
+// ============================================================================
+// Position and protocol
+// ============================================================================
+
+void add_codec_benchmarks(bench::Runner &runner) {
+  runner.add("position/try_parse", [](bench::State &state) {
+    constexpr std::array<std::string_view, 4> INPUTS = {"A1", "J10", "e5",
+                                                        "K11"};
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(Position::try_parse(INPUTS[i % INPUTS.size()]));
+    }
+  });
+
+  runner.add("position/to_string", [](bench::State &state) {
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(cell_position(i % CELL_COUNT).to_string());
+    }
+  });
+
+  const Ship battleship(config::ShipType::BATTLESHIP, Position(1, 1),
+                        Orientation::VERTICAL);
+  const net::Message attack{net::MessageType::ATTACK,
+                            net::protocol::encode_attack(Position(4, 4))};
+  const net::Message sunk{net::MessageType::RESULT_SUNK,
+                          net::protocol::encode_sunk(battleship)};
+
+  runner.add("net/decode/attack", [payload = attack.payload](bench::State &state) {
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(net::protocol::decode_attack(payload));
+    }
+  });
+  runner.add("net/decode/result_sunk", [payload = sunk.payload](bench::State &state) {
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      do_not_optimize(net::protocol::decode_sunk(payload));
+    }
+  });
+
+  for (const auto &[name, message] :
+       {std::pair{"attack", attack}, std::pair{"result_sunk", sunk}}) {
+    runner.add(std::format("net/serialize/{}", name),
+               [message](bench::State &state) {
+                 for (uint64_t i = 0; i < state.iterations(); ++i) {
+                   do_not_optimize(message.serialize());
+                 }
+               });
+    runner.add(std::format("net/deserialize/{}", name),
+               [wire = message.serialize()](bench::State &state) {
+                 for (uint64_t i = 0; i < state.iterations(); ++i) {
+                   do_not_optimize(net::Message::deserialize(wire));
+                 }
+               });
+  }
+
+  // One shot's traffic through the connection buffers: queue RESULT and
+  // YOUR_TURN, gather them as one write, parse both back in place
+  runner.add("net/frame_roundtrip", [](bench::State &state) {
+    net::SendQueue outbox;
+    net::ReceiveBuffer inbox;
+    const std::string result = net::protocol::encode_result(AttackResult::HIT);
+
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      outbox.push(net::MessageType::RESULT, result);
+      outbox.push(net::MessageType::YOUR_TURN, {});
+      for (const auto &buffer : outbox.take_batch()) {
+        const auto space = inbox.prepare();
+        std::memcpy(space.data(), buffer.data(), buffer.size());
+        inbox.commit(buffer.size());
+      }
+      outbox.release_batch();
+      while (const auto view = inbox.next()) {
+        do_not_optimize(view->payload.data());
+      }
+    }
+  });
+
+  // Per PONG: estimator update plus histogram bucket
+  runner.add("net/latency/record_rtt", [](bench::State &state) {
+    net::LatencyStats stats;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      stats.record_rtt(net::Micros(100 + static_cast<int64_t>(i & 1023)));
+    }
+    do_not_optimize(stats.rtt.srtt());
+  });
+
+  // One SHOT fanned out to 1000 spectators: encoded once, then a pointer
+  // per queue; allocs/op should not grow with the spectator count
+  runner.add("net/fanout/shot_x1000", [](bench::State &state) {
+    std::vector<net::BroadcastQueue> spectators(1000);
+    const std::string shot = net::protocol::encode_shot(
+        {0, Position(3, 4), AttackResult::HIT, std::nullopt});
+
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+      const net::SharedFrame frame = net::make_shared_frame(net::MessageType::SHOT, shot);
+      for (auto &outbox : spectators) {
+        outbox.push(frame);
+        do_not_optimize(outbox.take_batch().data());
+        outbox.release_batch();
+      }
+    }
+  });
+}
+
+// ============================================================================
+// Transports
+// ============================================================================
+
+enum class TransportKind : uint8_t { TCP, UNIX, CHANNEL };
+
+constexpr uint16_t BENCH_PORT = 17797;
+constexpr std::size_t STREAM_BATCH = 64;
+
+// Drives op on the manager's io_context, without the console messages of
+// the blocking API
+void run_to_completion(net::NetworkManager &network, net::awaitable<void> op) {
+  auto done = boost::asio::co_spawn(network.io_context(), std::move(op),
+                                    boost::asio::use_future);
+  network.io_context().restart();
+  while (done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    network.io_context().run_one();
+  }
+  done.get();
+}
+
+// A connected pair whose host echoes every message back from its own
+// thread, answering a batch with one write, until the guest hangs up
+class EchoPair {
+public:
+  explicit EchoPair(TransportKind kind)
+      : m_socket_path(std::format("/tmp/battleship-bench-{}.sock", ::getpid())) {
+    if (kind == TransportKind::CHANNEL) {
+      auto [host_end, guest_end] = net::ChannelTransport::make_pair(
+          m_host.io_context(), m_guest.io_context());
+      m_echo = std::thread([this, end = std::move(host_end)]() mutable {
+        run_to_completion(m_host, m_host.async_attach(std::move(end), true));
+        echo();
+      });
+      run_to_completion(m_guest, m_guest.async_attach(std::move(guest_end), false));
+      return;
+    }
+
+    std::promise<void> listening;
+    m_echo = std::thread([this, kind, &listening] {
+      auto accept = kind == TransportKind::TCP
+                        ? m_host.async_host(BENCH_PORT)
+                        : m_host.async_host_local(m_socket_path);
+      listening.set_value();
+      run_to_completion(m_host, std::move(accept));
+      echo();
+    });
+    listening.get_future().wait();
+
+    // The acceptor opens once the host thread runs; retry until it has
+    for (int attempt = 0;; ++attempt) {
+      try {
+        run_to_completion(m_guest, kind == TransportKind::TCP
+                                       ? m_guest.async_join("127.0.0.1", BENCH_PORT)
+                                       : m_guest.async_join_local(m_socket_path));
+        return;
+      } catch (const boost::system::system_error &) {
+        if (attempt == 1000) {
+          throw;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  }
+
+  EchoPair(const EchoPair &) = delete;
+  EchoPair &operator=(const EchoPair &) = delete;
+
+  ~EchoPair() {
+    m_guest.disconnect();
+    m_echo.join();
+    ::unlink(m_socket_path.c_str());
+  }
+
+  net::NetworkManager &guest() noexcept { return m_guest; }
+
+private:
+  net::NetworkManager m_host;
+  net::NetworkManager m_guest;
+  std::string m_socket_path;
+  std::thread m_echo;
+
+  void echo() {
+    while (m_host.is_connected()) {
+      auto view = m_host.receive_view_for(std::chrono::milliseconds(100));
+      while (view) {
+        m_host.queue(view->type, view->payload);
+        view = m_host.receive_view_for(std::chrono::milliseconds(0));
+      }
+      m_host.flush();
+    }
+  }
+};
+
+void expect_reply(net::NetworkManager &network) {
+  if (!network.receive_view_for(std::chrono::seconds(5))) {
+    throw std::runtime_error("Transport benchmark lost its echo");
+  }
+}
+
+// Per-message cost of the full connection stack on each transport: one
+// ATTACK out and back per op, and the same in batches of STREAM_BATCH
+void add_transport_benchmarks(bench::Runner &runner) {
+  const std::string attack = net::protocol::encode_attack(Position(4, 4));
+
+  for (const auto &[name, kind] :
+       {std::pair{"tcp", TransportKind::TCP}, std::pair{"unix", TransportKind::UNIX},
+        std::pair{"channel", TransportKind::CHANNEL}}) {
+    runner.add(std::format("net/transport/{}/roundtrip", name),
+               [kind, attack](bench::State &state) {
+                 state.pause();
+                 auto pair = std::make_unique<EchoPair>(kind);
+                 net::NetworkManager &guest = pair->guest();
+                 state.resume();
+
+                 for (uint64_t i = 0; i < state.iterations(); ++i) {
+                   guest.send(net::MessageType::ATTACK, attack);
+                   expect_reply(guest);
+                 }
+
+                 state.pause();
+                 pair.reset();
+                 state.resume();
+               });
+
+    runner.add(std::format("net/transport/{}/stream", name),
+               [kind, attack](bench::State &state) {
+                 state.pause();
+                 auto pair = std::make_unique<EchoPair>(kind);
+                 net::NetworkManager &guest = pair->guest();
+                 state.resume();
+
+                 for (uint64_t sent = 0; sent < state.iterations();) {
+                   const uint64_t count =
+                       std::min<uint64_t>(state.iterations() - sent, STREAM_BATCH);
+                   for (uint64_t i = 0; i < count; ++i) {
+                     guest.queue(net::MessageType::ATTACK, attack);
+                   }
+                   guest.flush();
+                   for (uint64_t i = 0; i < count; ++i) {
+                     expect_reply(guest);
+                   }
+                   sent += count;
+                 }
+
+                 state.pause();
+                 pair.reset();
+                 state.resume();
+               });
+  }
+}
+
+std::string to_csv(const std::vector<bench::Result> &results) {
+  std::string out = "name,iterations,ns_per_op,allocs_per_op,ops_per_sec\n";
+  for (const auto &r : results) {
+    out += std::format("{},{},{:.2f},{:.3f},{:.0f}\n", r.name, r.iterations,
+                       r.ns_per_op, r.allocs_per_op, r.ops_per_sec);
+  }
+  return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto opts = parse_args(argc, argv);
+  if (!opts) {
+    print_usage();
+    return 1;
+  }
+
+  try {
+    bench::Runner runner(opts->min_time, opts->filter);
+    add_board_benchmarks(runner);
+    add_strategy_benchmarks<ai::RandomStrategy>(runner, "easy");
+    add_strategy_benchmarks<ai::HuntStrategy>(runner, "medium");
+    add_strategy_benchmarks<ai::TargetStrategy>(runner, "hard");
+    add_render_benchmarks(runner);
+    add_rating_benchmarks(runner);
+    add_codec_benchmarks(runner);
+    add_transport_benchmarks(runner);
+
+    std::cout << std::format("{:<32} {:>12} {:>10} {:>14}\n", "benchmark",
+                             "ns/op", "allocs/op", "ops/s");
+    const auto results = runner.run_all();
+    for (const auto &r : results) {
+      std::cout << std::format("{:<32} {:>12.1f} {:>10.2f} {:>14.0f}\n",
+                               r.name, r.ns_per_op, r.allocs_per_op,
+                               r.ops_per_sec);
+    }
+
+    if (!opts->csv_path.empty()) {
+      std::ofstream out(opts->csv_path, std::ios::binary);
+      out << to_csv(results);
+      if (!out) {
+        std::cerr << std::format("Failed to write {}\n", opts->csv_path);
+        return 1;
+      }
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
@@ -1,17 +1,49 @@
 #include "AIStrategy.hpp"
 #include <algorithm>
+#include <array>
+#include <stdexcept>
 
 namespace battleship::ai {
 
 // Use centralized direction constant
 using config::CARDINAL_DIRECTIONS;
 
+namespace {
+
+// Uniform pick among remaining cells once rejection sampling gives up
+Position pick_unattacked(
+    const std::unordered_set<Position, Position::Hash> &attacked,
+    std::mt19937 &rng) {
+  std::array<Position, config::GRID_SIZE * config::GRID_SIZE> free_cells;
+  std::size_t count = 0;
+
+  for (config::GridCoord y = 0; y < config::GRID_SIZE; ++y) {
+    for (config::GridCoord x = 0; x < config::GRID_SIZE; ++x) {
+      const Position pos{x, y};
+      if (!attacked.contains(pos)) {
+        free_cells[count++] = pos;
+      }
+    }
+  }
+
+  if (count == 0) {
+    throw std::runtime_error("AI failed to find valid attack position");
+  }
+
+  std::uniform_int_distribution<std::size_t> idx_dist(0, count - 1);
+  return free_cells[idx_dist(rng)];
+}
+
+} // namespace
+
 // ============================================================================
 // Easy AI: Pure random shots
 // ============================================================================
 
-RandomStrategy::RandomStrategy()
-    : m_rng(std::random_device{}()), m_dist(0, config::GRID_SIZE - 1) {}
+RandomStrategy::RandomStrategy() : RandomStrategy(std::random_device{}()) {}
+
+RandomStrategy::RandomStrategy(uint32_t seed)
+    : m_rng(seed), m_dist(0, config::GRID_SIZE - 1) {}
 
 Position RandomStrategy::get_attack_position(
     const std::unordered_set<Position, Position::Hash> &attacked_positions,
@@ -25,7 +57,7 @@ Position RandomStrategy::get_attack_position(
     pos = Position{m_dist(m_rng), m_dist(m_rng)};
     ++attempts;
     if (attempts > MAX_ATTEMPTS) {
-      throw std::runtime_error("AI failed to find valid attack position");
+      return pick_unattacked(attacked_positions, m_rng);
     }
   } while (attacked_positions.contains(pos));
 
@@ -39,8 +71,10 @@ void RandomStrategy::on_attack_result([[maybe_unused]] const Position &pos,
 // Medium AI: Random until hit, then check adjacent, track direction on 2+ hits
 // ============================================================================
 
-HuntStrategy::HuntStrategy()
-    : m_rng(std::random_device{}()), m_dist(0, config::GRID_SIZE - 1) {}
+HuntStrategy::HuntStrategy() : HuntStrategy(std::random_device{}()) {}
+
+HuntStrategy::HuntStrategy(uint32_t seed)
+    : m_rng(seed), m_dist(0, config::GRID_SIZE - 1) {}
 
 Position HuntStrategy::get_attack_position(
     const std::unordered_set<Position, Position::Hash> &attacked_positions,
@@ -110,7 +144,7 @@ Position HuntStrategy::get_random_position(
     pos = Position{m_dist(m_rng), m_dist(m_rng)};
     ++attempts;
     if (attempts > MAX_ATTEMPTS) {
-      throw std::runtime_error("AI failed to find valid attack position");
+      return pick_unattacked(attacked, m_rng);
     }
   } while (attacked.contains(pos));
 
@@ -121,8 +155,10 @@ Position HuntStrategy::get_random_position(
 // Hard AI: Chessboard pattern hunt + directional targeting
 // ============================================================================
 
-TargetStrategy::TargetStrategy()
-    : m_rng(std::random_device{}()), m_dist(0, config::GRID_SIZE - 1) {
+TargetStrategy::TargetStrategy() : TargetStrategy(std::random_device{}()) {}
+
+TargetStrategy::TargetStrategy(uint32_t seed)
+    : m_rng(seed), m_dist(0, config::GRID_SIZE - 1) {
   // Pre-build chessboard pattern (50 cells)
   m_chessboard_cells.reserve(50);
   for (config::GridCoord y = 0; y < config::GRID_SIZE; ++y) {
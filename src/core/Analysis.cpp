@@ -0,0 +1,433 @@
+#include "Analysis.hpp"
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <thread>
+
+namespace battleship::analysis {
+
+namespace {
+
+// Ship size of each fleet slot, in the order placements are recorded
+constexpr std::array<uint8_t, config::TOTAL_SHIPS> FLEET_SIZES = [] {
+  std::array<uint8_t, config::TOTAL_SHIPS> sizes{};
+  std::size_t k = 0;
+  for (const auto &cfg : config::SHIP_CONFIGS) {
+    for (uint8_t i = 0; i < cfg.count; ++i) {
+      sizes[k++] = cfg.size();
+    }
+  }
+  return sizes;
+}();
+
+constexpr std::array<double, 3> REPORTED_PERCENTILES = {50.0, 90.0, 99.0};
+
+double ratio(uint64_t num, uint64_t den) noexcept {
+  return den == 0 ? 0.0 : static_cast<double>(num) / static_cast<double>(den);
+}
+
+std::string cell_name(std::size_t cell) {
+  return replay::decode_cell(static_cast<uint8_t>(cell)).to_string();
+}
+
+std::optional<uint64_t> parse_value(std::string_view text) {
+  for (const auto level : {config::Difficulty::EASY, config::Difficulty::MEDIUM,
+                           config::Difficulty::HARD}) {
+    if (text == stats::strategy_name(level)) {
+      return static_cast<uint64_t>(level);
+    }
+  }
+  if (text == "human") {
+    return replay::HUMAN;
+  }
+  if (text == "engine") {
+    return replay::ENGINE;
+  }
+
+  uint64_t value = 0;
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+bool compare(uint64_t lhs, Condition::Op op, uint64_t rhs) noexcept {
+  switch (op) {
+  case Condition::Op::EQ:
+    return lhs == rhs;
+  case Condition::Op::NE:
+    return lhs != rhs;
+  case Condition::Op::LT:
+    return lhs < rhs;
+  case Condition::Op::LE:
+    return lhs <= rhs;
+  case Condition::Op::GT:
+    return lhs > rhs;
+  case Condition::Op::GE:
+    return lhs >= rhs;
+  }
+  return false;
+}
+
+std::size_t winner_shots(const replay::GameView &game) noexcept {
+  const uint8_t winner = game.winner();
+  std::size_t shots = 0;
+  for (std::size_t i = 0; i < game.shot_count(); ++i) {
+    shots += game.shot(i).shooter == winner ? 1 : 0;
+  }
+  return shots;
+}
+
+} // namespace
+
+std::size_t strategy_slot(uint8_t code) noexcept {
+  if (code < stats::STRATEGY_COUNT) {
+    return code;
+  }
+  return code == replay::ENGINE ? stats::STRATEGY_COUNT + 1 : stats::STRATEGY_COUNT;
+}
+
+std::string_view slot_name(std::size_t slot) noexcept {
+  if (slot < stats::STRATEGY_COUNT) {
+    return stats::strategy_name(static_cast<config::Difficulty>(slot));
+  }
+  return slot == stats::STRATEGY_COUNT ? "human" : "engine";
+}
+
+// ============================================================================
+// Filtering
+// ============================================================================
+
+std::optional<Condition> Condition::parse(std::string_view text) {
+  // Longest operators first so "<=" is not read as "<"
+  static constexpr std::array<std::pair<std::string_view, Op>, 7> OPS = {
+      {{"<=", Op::LE},
+       {">=", Op::GE},
+       {"!=", Op::NE},
+       {"==", Op::EQ},
+       {"<", Op::LT},
+       {">", Op::GT},
+       {"=", Op::EQ}}};
+  static constexpr std::array<std::pair<std::string_view, Field>, 6> FIELDS = {
+      {{"shots", Field::SHOTS},
+       {"winner_shots", Field::WINNER_SHOTS},
+       {"winner", Field::WINNER},
+       {"first", Field::FIRST},
+       {"second", Field::SECOND},
+       {"any", Field::ANY}}};
+
+  for (const auto &[token, op] : OPS) {
+    const auto at = text.find(token);
+    if (at == std::string_view::npos) {
+      continue;
+    }
+    const auto name = text.substr(0, at);
+    const auto value = parse_value(text.substr(at + token.size()));
+    if (!value) {
+      return std::nullopt;
+    }
+    for (const auto &[field_name, field] : FIELDS) {
+      if (name == field_name) {
+        return Condition{field, op, *value};
+      }
+    }
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+bool Condition::matches(const replay::GameView &game) const noexcept {
+  switch (field) {
+  case Field::SHOTS:
+    return compare(game.shot_count(), op, value);
+  case Field::WINNER_SHOTS:
+    return compare(winner_shots(game), op, value);
+  case Field::WINNER:
+    return compare(game.winner(), op, value);
+  case Field::FIRST:
+    return compare(game.strategy(0), op, value);
+  case Field::SECOND:
+    return compare(game.strategy(1), op, value);
+  case Field::ANY:
+    return compare(game.strategy(0), op, value) ||
+           compare(game.strategy(1), op, value);
+  }
+  return false;
+}
+
+// ============================================================================
+// Aggregation
+// ============================================================================
+
+void SlotAggregate::merge(const SlotAggregate &other) noexcept {
+  games += other.games;
+  wins += other.wins;
+  shots_to_win.merge(other.shots_to_win);
+  for (std::size_t i = 0; i < opening_shots.size(); ++i) {
+    opening_shots[i] += other.opening_shots[i];
+  }
+  for (std::size_t k = 0; k < SINK_SLOTS; ++k) {
+    for (std::size_t s = 0; s < SHIP_SIZES; ++s) {
+      sink_order[k][s] += other.sink_order[k][s];
+    }
+  }
+}
+
+void Aggregate::add(const replay::GameView &game) noexcept {
+  ++m_games;
+
+  // Cell -> fleet slot + 1 for each side, rebuilt from placement bytes
+  std::array<std::array<uint8_t, stats::CELL_COUNT>, 2> ship_at{};
+  for (std::size_t p = 0; p < 2; ++p) {
+    for (std::size_t k = 0; k < config::TOTAL_SHIPS; ++k) {
+      const auto placement = game.placement(p, k);
+      for (uint8_t i = 0; i < FLEET_SIZES[k]; ++i) {
+        const Position pos =
+            placement.orientation == Orientation::HORIZONTAL
+                ? Position{static_cast<config::GridCoord>(placement.start.x + i),
+                           placement.start.y}
+                : Position{placement.start.x,
+                           static_cast<config::GridCoord>(placement.start.y + i)};
+        if (!pos.is_valid()) {
+          continue;
+        }
+        const uint8_t cell = replay::encode_cell(pos);
+        ship_at[p][cell] = static_cast<uint8_t>(k + 1);
+        ++m_cell_occupied[cell];
+      }
+    }
+  }
+
+  const std::array<std::size_t, 2> slots = {strategy_slot(game.strategy(0)),
+                                            strategy_slot(game.strategy(1))};
+  std::array<std::size_t, 2> shots{};
+  std::array<std::size_t, 2> sunk{};
+
+  for (std::size_t i = 0; i < game.shot_count(); ++i) {
+    const auto shot = game.shot(i);
+    const uint8_t cell = game.shot_cell(i);
+    if (cell >= stats::CELL_COUNT) {
+      continue;
+    }
+    auto &slot = m_slots[slots[shot.shooter]];
+
+    if (shots[shot.shooter]++ == 0) {
+      ++slot.opening_shots[cell];
+    }
+
+    ++m_cell_shots[cell];
+    if (shot.result == AttackResult::HIT || shot.result == AttackResult::SUNK) {
+      ++m_cell_hits[cell];
+    }
+
+    if (shot.result == AttackResult::SUNK) {
+      const uint8_t ship = ship_at[1 - shot.shooter][cell];
+      if (ship > 0 && sunk[shot.shooter] < SINK_SLOTS) {
+        ++slot.sink_order[sunk[shot.shooter]][FLEET_SIZES[ship - 1] - 1];
+      }
+      ++sunk[shot.shooter];
+    }
+  }
+
+  for (std::size_t p = 0; p < 2; ++p) {
+    auto &slot = m_slots[slots[p]];
+    ++slot.games;
+    if (p == game.winner()) {
+      ++slot.wins;
+      slot.shots_to_win.add(shots[p]);
+    }
+  }
+}
+
+void Aggregate::merge(const Aggregate &other) noexcept {
+  m_games += other.m_games;
+  for (std::size_t i = 0; i < SLOT_COUNT; ++i) {
+    m_slots[i].merge(other.m_slots[i]);
+  }
+  for (std::size_t c = 0; c < stats::CELL_COUNT; ++c) {
+    m_cell_occupied[c] += other.m_cell_occupied[c];
+    m_cell_shots[c] += other.m_cell_shots[c];
+    m_cell_hits[c] += other.m_cell_hits[c];
+  }
+}
+
+double Aggregate::cell_prior(std::size_t cell) const noexcept {
+  return ratio(m_cell_occupied[cell], 2 * m_games);
+}
+
+double Aggregate::cell_hit_rate(std::size_t cell) const noexcept {
+  return ratio(m_cell_hits[cell], m_cell_shots[cell]);
+}
+
+std::string Aggregate::to_text() const {
+  std::string out = std::format("{} games\n", m_games);
+
+  for (std::size_t s = 0; s < SLOT_COUNT; ++s) {
+    const auto &slot = m_slots[s];
+    if (slot.games == 0) {
+      continue;
+    }
+
+    out += std::format("\n[{}] games {} wins {} ({:.1f}%)\n", slot_name(s),
+                       slot.games, slot.wins,
+                       100.0 * ratio(slot.wins, slot.games));
+    out += std::format("  shots to win: mean {:.1f}", slot.shots_to_win.mean());
+    for (const double p : REPORTED_PERCENTILES) {
+      out += std::format(" p{} {}", p, slot.shots_to_win.percentile(p));
+    }
+    out += '\n';
+
+    // Five most common opening cells
+    std::array<std::size_t, stats::CELL_COUNT> order{};
+    for (std::size_t c = 0; c < order.size(); ++c) {
+      order[c] = c;
+    }
+    std::partial_sort(order.begin(), order.begin() + 5, order.end(),
+                      [&slot](std::size_t a, std::size_t b) {
+                        return slot.opening_shots[a] > slot.opening_shots[b];
+                      });
+    out += "  opening shots:";
+    for (std::size_t i = 0; i < 5; ++i) {
+      out += std::format(" {} {:.1f}%", cell_name(order[i]),
+                         100.0 * ratio(slot.opening_shots[order[i]], slot.games));
+    }
+    out += '\n';
+
+    out += "  sink order (size share per kill):\n";
+    for (std::size_t k = 0; k < SINK_SLOTS; ++k) {
+      const auto &sizes = slot.sink_order[k];
+      const uint64_t total = sizes[0] + sizes[1] + sizes[2] + sizes[3];
+      if (total == 0) {
+        continue;
+      }
+      out += std::format("    #{:<2} 1:{:5.1f}% 2:{:5.1f}% 3:{:5.1f}% 4:{:5.1f}%\n",
+                         k + 1, 100.0 * ratio(sizes[0], total),
+                         100.0 * ratio(sizes[1], total),
+                         100.0 * ratio(sizes[2], total),
+                         100.0 * ratio(sizes[3], total));
+    }
+  }
+
+  out += "\nShip prior per cell (%):\n    A    B    C    D    E    F    G    H    I    J\n";
+  for (std::size_t y = 0; y < config::GRID_SIZE; ++y) {
+    out += std::format("{:2}", y + 1);
+    for (std::size_t x = 0; x < config::GRID_SIZE; ++x) {
+      out += std::format(" {:4.1f}",
+                         100.0 * cell_prior(y * config::GRID_SIZE + x));
+    }
+    out += '\n';
+  }
+
+  return out;
+}
+
+std::string Aggregate::to_csv() const {
+  std::string out = "strategy,metric,key,value\n";
+
+  for (std::size_t s = 0; s < SLOT_COUNT; ++s) {
+    const auto &slot = m_slots[s];
+    if (slot.games == 0) {
+      continue;
+    }
+    const auto name = slot_name(s);
+
+    out += std::format("{},games,,{}\n", name, slot.games);
+    out += std::format("{},wins,,{}\n", name, slot.wins);
+    const auto &bins = slot.shots_to_win.bins();
+    for (std::size_t i = 0; i < bins.size(); ++i) {
+      if (bins[i] > 0) {
+        out += std::format("{},shots_to_win,{},{}\n", name, i, bins[i]);
+      }
+    }
+    for (std::size_t c = 0; c < stats::CELL_COUNT; ++c) {
+      if (slot.opening_shots[c] > 0) {
+        out += std::format("{},opening_shot,{},{}\n", name, cell_name(c),
+                           slot.opening_shots[c]);
+      }
+    }
+    for (std::size_t k = 0; k < SINK_SLOTS; ++k) {
+      for (std::size_t size = 0; size < SHIP_SIZES; ++size) {
+        if (slot.sink_order[k][size] > 0) {
+          out += std::format("{},sink_order,{}:{},{}\n", name, k + 1, size + 1,
+                             slot.sink_order[k][size]);
+        }
+      }
+    }
+  }
+
+  for (std::size_t c = 0; c < stats::CELL_COUNT; ++c) {
+    out += std::format("all,cell_prior,{},{:.5f}\n", cell_name(c),
+                       cell_prior(c));
+    out += std::format("all,cell_hit_rate,{},{:.5f}\n", cell_name(c),
+                       cell_hit_rate(c));
+  }
+
+  return out;
+}
+
+// ============================================================================
+// Parallel scan
+// ============================================================================
+
+Aggregate analyze(const std::vector<replay::Reader> &files,
+                  const Filter &filter, unsigned threads) {
+  // Global block numbering: file f owns [first_block[f], first_block[f + 1])
+  std::vector<std::size_t> first_block(files.size() + 1, 0);
+  for (std::size_t f = 0; f < files.size(); ++f) {
+    first_block[f + 1] = first_block[f] + files[f].block_count();
+  }
+  const std::size_t total_blocks = first_block.back();
+
+  threads = std::max(1u, std::min<unsigned>(
+                             threads, static_cast<unsigned>(
+                                          std::max<std::size_t>(total_blocks, 1))));
+
+  auto scan = [&](std::size_t begin, std::size_t end, Aggregate &out) {
+    for (std::size_t f = 0; f < files.size(); ++f) {
+      const std::size_t lo = std::max(begin, first_block[f]);
+      const std::size_t hi = std::min(end, first_block[f + 1]);
+      if (lo >= hi) {
+        continue;
+      }
+      files[f].for_each_game(lo - first_block[f], hi - first_block[f],
+                             [&](const replay::GameView &game) {
+                               if (filter.matches(game)) {
+                                 out.add(game);
+                               }
+                             });
+    }
+  };
+
+  std::vector<Aggregate> partials(threads);
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+
+  for (unsigned t = 0; t < threads; ++t) {
+    const std::size_t begin = total_blocks * t / threads;
+    const std::size_t end = total_blocks * (t + 1) / threads;
+    workers.emplace_back([&, t, begin, end] {
+      try {
+        scan(begin, end, partials[t]);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+
+  Aggregate total;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers[t].join();
+    total.merge(partials[t]);
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return total;
+}
+
+} // namespace battleship::analysis
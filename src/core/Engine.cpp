@@ -0,0 +1,702 @@
+#include "Engine.hpp"
+#include "Player.hpp"
+#include "Simulation.hpp"
+#include "Stats.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstring>
+#include <format>
+#include <istream>
+#include <ostream>
+#include <poll.h>
+#include <spawn.h>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+
+extern char **environ;
+
+namespace battleship::engine {
+
+namespace {
+
+constexpr std::size_t READ_CHUNK = 4096;
+constexpr std::string_view HANDSHAKE = "bei";
+constexpr std::string_view HANDSHAKE_DONE = "beiok";
+
+// Splits off the first space-separated token
+std::string_view next_token(std::string_view &line) noexcept {
+  const auto start = line.find_first_not_of(' ');
+  if (start == std::string_view::npos) {
+    line = {};
+    return {};
+  }
+  line.remove_prefix(start);
+  const auto end = std::min(line.find(' '), line.size());
+  const std::string_view token = line.substr(0, end);
+  line.remove_prefix(end);
+  return token;
+}
+
+template <typename T> std::optional<T> parse_number(std::string_view text) noexcept {
+  T value{};
+  const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+[[noreturn]] void protocol_error(std::string_view line) {
+  throw std::runtime_error(std::format("Unexpected engine output: {}", line));
+}
+
+} // namespace
+
+// ============================================================================
+// Text encoding
+// ============================================================================
+
+std::string_view result_name(AttackResult result) noexcept {
+  switch (result) {
+  case AttackResult::HIT:
+    return "hit";
+  case AttackResult::SUNK:
+    return "sunk";
+  default:
+    return "miss";
+  }
+}
+
+std::optional<AttackResult> parse_result(std::string_view text) noexcept {
+  if (text == "miss") {
+    return AttackResult::MISS;
+  }
+  if (text == "hit") {
+    return AttackResult::HIT;
+  }
+  if (text == "sunk") {
+    return AttackResult::SUNK;
+  }
+  return std::nullopt;
+}
+
+std::string format_ship(const net::protocol::ShipPlacement &ship) {
+  return std::format("{}{}{}", ship.start.to_string(),
+                     ship.orientation == Orientation::VERTICAL ? 'v' : 'h',
+                     static_cast<int>(ship.type));
+}
+
+std::optional<net::protocol::ShipPlacement> parse_ship(std::string_view text) {
+  const auto split = text.find_first_of("hv", 1);
+  if (split == std::string_view::npos || split + 2 != text.size()) {
+    return std::nullopt;
+  }
+  const auto start = Position::try_parse(text.substr(0, split));
+  const int length = text[split + 1] - '0';
+  if (!start || length < 1 || length > 4) {
+    return std::nullopt;
+  }
+  const bool vertical = text[split] == 'v';
+  if ((vertical ? start->y : start->x) + length > config::GRID_SIZE) {
+    return std::nullopt;
+  }
+  return net::protocol::ShipPlacement{
+      static_cast<config::ShipType>(length), *start,
+      vertical ? Orientation::VERTICAL : Orientation::HORIZONTAL};
+}
+
+uint32_t engine_seed(uint64_t game_seed) noexcept {
+  return static_cast<uint32_t>(sim::mix64(game_seed));
+}
+
+uint32_t builtin_seed(uint64_t game_seed) noexcept {
+  return static_cast<uint32_t>(sim::mix64(game_seed) >> 32);
+}
+
+// ============================================================================
+// EngineProcess
+// ============================================================================
+
+EngineProcess::EngineProcess(const std::string &command) {
+  // A dead engine must surface as a failed write, not kill the game
+  std::signal(SIGPIPE, SIG_IGN);
+
+  int to_engine[2];
+  int from_engine[2];
+  if (::pipe(to_engine) != 0) {
+    throw std::runtime_error(std::format("pipe: {}", std::strerror(errno)));
+  }
+  if (::pipe(from_engine) != 0) {
+    ::close(to_engine[0]);
+    ::close(to_engine[1]);
+    throw std::runtime_error(std::format("pipe: {}", std::strerror(errno)));
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, to_engine[0], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, from_engine[1], STDOUT_FILENO);
+  for (const int fd : {to_engine[0], to_engine[1], from_engine[0], from_engine[1]}) {
+    posix_spawn_file_actions_addclose(&actions, fd);
+  }
+
+  const char *argv[] = {"/bin/sh", "-c", command.c_str(), nullptr};
+  const int error = ::posix_spawn(&m_pid, "/bin/sh", &actions, nullptr,
+                                  const_cast<char *const *>(argv), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(to_engine[0]);
+  ::close(from_engine[1]);
+  m_stdin = to_engine[1];
+  m_stdout = from_engine[0];
+
+  if (error != 0) {
+    ::close(m_stdin);
+    ::close(m_stdout);
+    throw std::runtime_error(
+        std::format("Cannot start engine '{}': {}", command, std::strerror(error)));
+  }
+}
+
+// Closing its stdin asks the engine to exit; one that lingers is killed
+EngineProcess::~EngineProcess() {
+  m_output = "quit\n";
+  try {
+    flush();
+  } catch (const std::exception &) {
+    // already gone
+  }
+  ::close(m_stdin);
+  ::close(m_stdout);
+
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    if (::waitpid(m_pid, nullptr, WNOHANG) != 0) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ::kill(m_pid, SIGKILL);
+  ::waitpid(m_pid, nullptr, 0);
+}
+
+void EngineProcess::flush() {
+  std::size_t written = 0;
+  while (written < m_output.size()) {
+    const ssize_t n =
+        ::write(m_stdin, m_output.data() + written, m_output.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      m_output.clear();
+      throw std::runtime_error(std::format("Engine exited: {}", std::strerror(errno)));
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  m_output.clear();
+}
+
+std::optional<std::string_view>
+EngineProcess::read_line(std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    const auto newline = m_input.find('\n', m_consumed);
+    if (newline != std::string::npos) {
+      std::string_view line(m_input.data() + m_consumed, newline - m_consumed);
+      m_consumed = newline + 1;
+      if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+      }
+      return line;
+    }
+
+    // Whole lines are gone; keep the partial one and read more
+    m_input.erase(0, m_consumed);
+    m_consumed = 0;
+
+    const auto left = std::chrono::ceil<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    pollfd readable{m_stdout, POLLIN, 0};
+    const int ready = ::poll(&readable, 1, static_cast<int>(std::max<int64_t>(left.count(), 0)));
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready == 0) {
+      return std::nullopt;
+    }
+
+    const std::size_t kept = m_input.size();
+    m_input.resize(kept + READ_CHUNK);
+    const ssize_t n = ::read(m_stdout, m_input.data() + kept, READ_CHUNK);
+    if (n < 0 && errno == EINTR) {
+      m_input.resize(kept);
+      continue;
+    }
+    if (n <= 0) {
+      m_input.resize(kept);
+      throw std::runtime_error("Engine exited");
+    }
+    m_input.resize(kept + static_cast<std::size_t>(n));
+  }
+}
+
+// ============================================================================
+// EngineClient
+// ============================================================================
+
+EngineClient::EngineClient(const std::string &command,
+                           std::chrono::milliseconds move_timeout)
+    : m_process(command), m_move_timeout(move_timeout) {
+  m_process.write(std::format("{}\n", HANDSHAKE));
+  m_process.flush();
+
+  while (true) {
+    const auto next = m_process.read_line(m_move_timeout);
+    if (!next) {
+      throw std::runtime_error(
+          std::format("Engine '{}' did not answer the handshake", command));
+    }
+    std::string_view line = *next;
+    const std::string_view word = next_token(line);
+    if (word == HANDSHAKE_DONE) {
+      break;
+    }
+    if (word == "id" && next_token(line) == "name") {
+      const auto start = line.find_first_not_of(' ');
+      m_name = start == std::string_view::npos ? "" : std::string(line.substr(start));
+    }
+  }
+  if (m_name.empty()) {
+    m_name = command;
+  }
+}
+
+GameId EngineClient::new_game(uint64_t seed) {
+  const GameId game = m_next_game++;
+  m_process.write(std::format("newgame {} {}\n", game, seed));
+  return game;
+}
+
+void EngineClient::request_fleet(GameId game) {
+  m_process.write(std::format("place {}\n", game));
+}
+
+void EngineClient::observe(GameId game, const Position &pos, AttackResult result) {
+  std::string &pending = m_observations[game];
+  pending += ' ';
+  pending += pos.to_string();
+  pending += ' ';
+  pending += result_name(result);
+}
+
+void EngineClient::request_move(GameId game) {
+  if (const auto it = m_observations.find(game);
+      it != m_observations.end() && !it->second.empty()) {
+    m_process.write(std::format("observe {}{}\n", game, it->second));
+    it->second.clear();
+  }
+  m_process.write(std::format("go {}\n", game));
+}
+
+void EngineClient::end_game(GameId game) {
+  m_observations.erase(game);
+  m_process.write(std::format("endgame {}\n", game));
+}
+
+void EngineClient::flush() {
+  m_process.flush();
+  m_awaiting = true;
+}
+
+std::optional<Reply> EngineClient::read_reply() {
+  if (m_awaiting) {
+    ++m_round_trips;
+    m_awaiting = false;
+  }
+
+  while (true) {
+    const auto next = m_process.read_line(m_move_timeout);
+    if (!next) {
+      return std::nullopt;
+    }
+    const std::string_view full = *next;
+    std::string_view line = full;
+    const std::string_view word = next_token(line);
+    if (word.empty() || word == "info") {
+      continue;
+    }
+
+    const auto game = parse_number<GameId>(next_token(line));
+    if (!game) {
+      protocol_error(full);
+    }
+
+    Reply reply;
+    reply.game = *game;
+    if (word == "move") {
+      const auto pos = Position::try_parse(next_token(line));
+      if (!pos) {
+        protocol_error(full);
+      }
+      reply.kind = Reply::Kind::MOVE;
+      reply.move = *pos;
+      return reply;
+    }
+    if (word == "fleet") {
+      reply.kind = Reply::Kind::FLEET;
+      for (auto token = next_token(line); !token.empty(); token = next_token(line)) {
+        const auto ship = parse_ship(token);
+        if (!ship) {
+          protocol_error(full);
+        }
+        reply.fleet.push_back(*ship);
+      }
+      return reply;
+    }
+    if (word == "error") {
+      reply.kind = Reply::Kind::ERROR;
+      const auto start = line.find_first_not_of(' ');
+      reply.error = start == std::string_view::npos ? "" : std::string(line.substr(start));
+      return reply;
+    }
+    protocol_error(full);
+  }
+}
+
+// ============================================================================
+// EngineStrategy
+// ============================================================================
+
+EngineStrategy::EngineStrategy(std::shared_ptr<EngineClient> client, uint64_t seed)
+    : m_client(std::move(client)), m_game(m_client->new_game(seed)) {}
+
+// Sent with the next request of another game, or never if there is none
+EngineStrategy::~EngineStrategy() { m_client->end_game(m_game); }
+
+Position EngineStrategy::get_attack_position(
+    const std::unordered_set<Position, Position::Hash> &attacked_positions,
+    const std::vector<Position> & /*successful_hits*/) {
+  m_client->request_move(m_game);
+  m_client->flush();
+  const auto answer = m_client->read_reply();
+  if (!answer) {
+    throw std::runtime_error(std::format("{} ran out of time", m_client->name()));
+  }
+  const Reply &reply = *answer;
+  if (reply.kind == Reply::Kind::ERROR) {
+    throw std::runtime_error(std::format("{}: {}", m_client->name(), reply.error));
+  }
+  if (reply.kind != Reply::Kind::MOVE || reply.game != m_game) {
+    throw std::runtime_error(std::format("{} answered out of turn", m_client->name()));
+  }
+  if (attacked_positions.contains(reply.move)) {
+    throw std::runtime_error(std::format("{} fired at {} twice", m_client->name(),
+                                         reply.move.to_string()));
+  }
+  return reply.move;
+}
+
+void EngineStrategy::on_attack_result(const Position &pos, AttackResult result) {
+  m_client->observe(m_game, pos, result);
+}
+
+// ============================================================================
+// Arena
+// ============================================================================
+
+void ArenaStats::merge(const ArenaStats &other) noexcept {
+  games += other.games;
+  engine_wins += other.engine_wins;
+  forfeits += other.forfeits;
+  timeouts += other.timeouts;
+  engine_win_shots += other.engine_win_shots;
+  builtin_win_shots += other.builtin_win_shots;
+  engine_moves += other.engine_moves;
+  round_trips += other.round_trips;
+  waiting += other.waiting;
+}
+
+namespace {
+
+// One arena game: the engine's fleet on our side of the pipe, and the
+// built-in player it plays against
+struct ArenaGame {
+  ArenaGame(uint64_t index, uint64_t seed, config::Difficulty builtin)
+      : index(index), seed(seed),
+        builtin("Built-in", PlayerType::AI, builtin, builtin_seed(seed)),
+        engine_turn(index % 2 == 0) {
+    this->builtin.auto_place_ships();
+    this->builtin.set_state(PlayerState::ACTIVE);
+  }
+
+  uint64_t index;
+  uint64_t seed;
+  GameId id{0};
+  Board engine_fleet;
+  Player builtin;
+  bool engine_turn;
+  bool placed{false};
+  bool awaiting{false}; // a request of ours is unanswered
+  std::array<uint16_t, 2> shots{}; // engine, built-in
+};
+
+// The fleet an engine sent: exactly the standard ships, legally placed
+bool place_fleet(Board &board, const std::vector<net::protocol::ShipPlacement> &fleet) {
+  std::array<uint8_t, 5> counts{}; // by length
+  for (const auto &ship : fleet) {
+    ++counts[static_cast<uint8_t>(ship.type)];
+    if (!board.place_ship(ship.type, ship.start, ship.orientation)) {
+      return false;
+    }
+  }
+  return std::all_of(config::SHIP_CONFIGS.begin(), config::SHIP_CONFIGS.end(),
+                     [&counts](const config::ShipConfig &ship) {
+                       return counts[static_cast<uint8_t>(ship.type)] == ship.count;
+                     });
+}
+
+} // namespace
+
+ArenaStats run_arena(const std::string &command, config::Difficulty builtin,
+                     uint64_t master_seed, uint64_t first_game, uint64_t count,
+                     unsigned in_flight, std::chrono::milliseconds move_timeout) {
+  using Clock = std::chrono::steady_clock;
+
+  EngineClient client(command, move_timeout);
+  ArenaStats stats;
+  std::unordered_map<GameId, std::unique_ptr<ArenaGame>> games;
+  // Forfeited on time with a request unanswered: their late reply is dropped
+  std::unordered_set<GameId> abandoned;
+  uint64_t next = 0;
+  std::size_t expected = 0; // replies owed by the engine
+
+  const auto start_game = [&] {
+    const uint64_t index = first_game + next++;
+    auto game = std::make_unique<ArenaGame>(index, sim::game_seed(master_seed, index),
+                                            builtin);
+    game->id = client.new_game(game->seed);
+    client.request_fleet(game->id);
+    game->awaiting = true;
+    ++expected;
+    games.emplace(game->id, std::move(game));
+  };
+  const auto finish = [&](ArenaGame &game, bool engine_won) {
+    ++stats.games;
+    if (engine_won) {
+      ++stats.engine_wins;
+      stats.engine_win_shots += game.shots[0];
+    } else {
+      stats.builtin_win_shots += game.shots[1];
+    }
+    client.end_game(game.id);
+  };
+
+  for (unsigned i = 0; i < std::max(1u, in_flight) && next < count; ++i) {
+    start_game();
+  }
+
+  while (!games.empty()) {
+    // The built-in side moves locally until every game waits on the engine
+    std::vector<GameId> done;
+    for (auto &[id, game] : games) {
+      while (game->placed && !game->engine_turn) {
+        const Position pos = game->builtin.get_attack();
+        const AttackResult result = game->engine_fleet.attack(pos);
+        game->builtin.record_attack_result(pos, result);
+        ++game->shots[1];
+        if (game->engine_fleet.is_game_over()) {
+          finish(*game, false);
+          done.push_back(id);
+          break;
+        }
+        game->engine_turn = result == AttackResult::MISS;
+      }
+      if (game->placed && game->engine_turn) {
+        client.request_move(id);
+        game->awaiting = true;
+        ++expected;
+      }
+    }
+    for (const GameId id : done) {
+      games.erase(id);
+      if (next < count) {
+        start_game();
+      }
+    }
+    if (expected == 0) {
+      continue;
+    }
+
+    // One write for every request, then all the replies
+    const auto waited_from = Clock::now();
+    client.flush();
+    std::vector<Reply> replies;
+    replies.reserve(expected);
+    bool timed_out = false;
+    while (expected > 0) {
+      auto reply = client.read_reply();
+      if (!reply) {
+        timed_out = true;
+        break;
+      }
+      if (abandoned.erase(reply->game) == 0) {
+        replies.push_back(std::move(*reply));
+        --expected;
+      }
+    }
+    stats.waiting += Clock::now() - waited_from;
+
+    done.clear();
+    for (const Reply &reply : replies) {
+      const auto it = games.find(reply.game);
+      if (it == games.end()) {
+        throw std::runtime_error(
+            std::format("{} answered for unknown game {}", client.name(), reply.game));
+      }
+      ArenaGame &game = *it->second;
+      game.awaiting = false;
+
+      bool forfeit = false;
+      if (reply.kind == Reply::Kind::ERROR) {
+        forfeit = true;
+      } else if (reply.kind == Reply::Kind::FLEET) {
+        game.placed = true;
+        forfeit = !place_fleet(game.engine_fleet, reply.fleet);
+      } else {
+        ++stats.engine_moves;
+        const AttackResult result = reply.move.is_valid()
+                                        ? game.builtin.receive_attack(reply.move)
+                                        : AttackResult::INVALID_COORD;
+        forfeit = result == AttackResult::ALREADY_ATTACKED ||
+                  result == AttackResult::INVALID_COORD;
+        if (!forfeit) {
+          ++game.shots[0];
+          if (game.builtin.has_lost()) {
+            finish(game, true);
+            done.push_back(reply.game);
+            continue;
+          }
+          client.observe(reply.game, reply.move, result);
+          game.engine_turn = result != AttackResult::MISS;
+        }
+      }
+      if (forfeit) {
+        ++stats.forfeits;
+        finish(game, false);
+        done.push_back(reply.game);
+      }
+    }
+    if (timed_out) {
+      // Whatever the engine still owes counts as lost on time
+      for (auto &[id, game] : games) {
+        if (game->awaiting) {
+          ++stats.forfeits;
+          ++stats.timeouts;
+          finish(*game, false);
+          done.push_back(id);
+          abandoned.insert(id);
+        }
+      }
+      expected = 0;
+    }
+    for (const GameId id : done) {
+      games.erase(id);
+      if (next < count) {
+        start_game();
+      }
+    }
+  }
+
+  client.flush(); // the last endgames
+  stats.round_trips = client.round_trips();
+  return stats;
+}
+
+// ============================================================================
+// Engine side
+// ============================================================================
+
+void serve(std::istream &in, std::ostream &out, config::Difficulty level) {
+  std::unordered_map<GameId, std::unique_ptr<Player>> games;
+  std::string buffer;
+
+  const auto find = [&games](std::string_view token) -> Player * {
+    const auto id = parse_number<GameId>(token);
+    const auto it = id ? games.find(*id) : games.end();
+    return it == games.end() ? nullptr : it->second.get();
+  };
+  const auto ensure_placed = [](Player &player) {
+    if (player.state() == PlayerState::SETUP) {
+      player.auto_place_ships();
+      player.set_state(PlayerState::ACTIVE);
+    }
+  };
+
+  while (std::getline(in, buffer)) {
+    std::string_view line = buffer;
+    const std::string_view command = next_token(line);
+    const std::string_view game = next_token(line);
+
+    if (command == HANDSHAKE) {
+      out << std::format("id name battleship {}\n{}\n", stats::strategy_name(level),
+                         HANDSHAKE_DONE);
+    } else if (command == "newgame") {
+      const auto id = parse_number<GameId>(game);
+      const auto seed = parse_number<uint64_t>(next_token(line));
+      if (id && seed) {
+        games[*id] = std::make_unique<Player>("Engine", PlayerType::AI, level,
+                                              engine_seed(*seed));
+      }
+    } else if (command == "place") {
+      if (Player *player = find(game)) {
+        ensure_placed(*player);
+        out << "fleet " << game;
+        for (const auto &ship : player->board().ships()) {
+          out << ' ' << format_ship(net::protocol::ShipPlacement::of(*ship));
+        }
+        out << '\n';
+      } else {
+        out << "error " << game << " unknown game\n";
+      }
+    } else if (command == "observe") {
+      if (Player *player = find(game)) {
+        while (true) {
+          const auto pos = Position::try_parse(next_token(line));
+          const auto result = parse_result(next_token(line));
+          if (!pos || !result) {
+            break;
+          }
+          player->record_attack_result(*pos, *result);
+        }
+      }
+    } else if (command == "go") {
+      if (Player *player = find(game)) {
+        ensure_placed(*player);
+        out << "move " << game << ' ' << player->get_attack().to_string() << '\n';
+      } else {
+        out << "error " << game << " unknown game\n"; // a reply is owed all the same
+      }
+    } else if (command == "endgame") {
+      if (const auto id = parse_number<GameId>(game)) {
+        games.erase(*id);
+      }
+    } else if (command == "quit") {
+      break;
+    } else if (!command.empty()) {
+      out << "info unknown command " << command << '\n';
+    }
+
+    // Pipelined requests get one batch of replies
+    if (in.rdbuf()->in_avail() <= 0) {
+      out.flush();
+    }
+  }
+  out.flush();
+}
+
+} // namespace battleship::engine
@@ -0,0 +1,48 @@
+#include "FrameRenderer.hpp"
+#include "Renderer.hpp"
+#include <algorithm>
+
+namespace battleship {
+
+FrameRenderer::FrameRenderer(int max_fps)
+    : m_frame_interval(std::chrono::nanoseconds(1'000'000'000) /
+                       std::max(1, max_fps)),
+      m_thread([this] { run(); }) {
+  m_frame.reserve(Renderer::FRAME_CAPACITY);
+}
+
+FrameRenderer::~FrameRenderer() { stop(); }
+
+void FrameRenderer::stop() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  m_running.store(false, std::memory_order_release);
+  m_thread.join();
+  draw_pending();
+}
+
+void FrameRenderer::run() {
+  auto next_frame = std::chrono::steady_clock::now();
+
+  while (m_running.load(std::memory_order_acquire)) {
+    draw_pending();
+    next_frame += m_frame_interval;
+
+    // Fell behind (slow terminal): skip missed frames instead of bursting
+    const auto now = std::chrono::steady_clock::now();
+    if (next_frame < now) {
+      next_frame = now;
+    }
+    std::this_thread::sleep_until(next_frame);
+  }
+}
+
+void FrameRenderer::draw_pending() {
+  if (const GameSnapshot *snapshot = m_buffer.acquire()) {
+    Renderer::render_snapshot(m_frame, *snapshot);
+    m_screen.draw(m_frame);
+  }
+}
+
+} // namespace battleship
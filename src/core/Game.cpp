@@ -1,12 +1,33 @@
 #include "Game.hpp"
+#include "FrameRenderer.hpp"
+#include "Rating.hpp"
 #include "Renderer.hpp"
+#include "Replay.hpp"
+#include "Stats.hpp"
+#include <algorithm>
 #include <chrono>
+#include <format>
 #include <iostream>
 #include <thread>
 
 namespace battleship {
 
-Game::Game(GameMode mode) : m_mode(mode) {}
+Pacing default_pacing(GameMode mode) noexcept {
+  switch (mode) {
+  case GameMode::PVP:
+    return pacing::PVP;
+  case GameMode::AI_VS_AI:
+    return pacing::AI_VS_AI;
+  default:
+    return pacing::PVE;
+  }
+}
+
+Game::Game(GameMode mode) : Game(mode, default_pacing(mode)) {}
+
+Game::Game(GameMode mode, Pacing pacing) : m_mode(mode), m_pacing(pacing) {}
+
+Game::~Game() = default;
 
 void Game::initialize() {
   switch (m_mode) {
@@ -41,6 +62,11 @@ void Game::initialize() {
     break;
   }
 
+  if (m_opponent_strategy && m_players[1]->type() == PlayerType::AI) {
+    m_players[1]->set_strategy(std::move(m_opponent_strategy));
+    m_external_opponent = true;
+  }
+
   for (auto &player : m_players) {
     if (player) {
       player->auto_place_ships();
@@ -56,6 +82,16 @@ void Game::start() {
   }
 
   m_state = GameState::IN_PROGRESS;
+  if (m_mode == GameMode::AI_VS_AI) {
+    m_frame_renderer = std::make_unique<FrameRenderer>(m_pacing.max_fps);
+  }
+  if (m_replay) {
+    // Recorded apart from the built-in level whose seat it took
+    const uint8_t second = m_external_opponent ? replay::ENGINE
+                                               : replay::strategy_code(*m_players[1]);
+    m_replay->begin_game(replay::UNSEEDED, replay::strategy_code(*m_players[0]),
+                         second, m_players[0]->board(), m_players[1]->board());
+  }
   ConsoleRenderer::display(Renderer::render_game_start(current_player().name()));
 }
 
@@ -72,13 +108,11 @@ void Game::run_turn() {
 
   bool continue_turn = true;
   while (continue_turn && m_state != GameState::GAME_OVER) {
-    ConsoleRenderer::clear();
     display_game_state();
 
     const Position attack_pos = current.get_attack();
     handle_shot(attack_pos);
 
-    ConsoleRenderer::clear();
     display_game_state();
 
     update_game_state();
@@ -87,17 +121,17 @@ void Game::run_turn() {
       break;
     }
 
-    const auto &last_result = m_battle_log.back().result;
+    const auto &last_result = m_last_turn.result;
     continue_turn =
         (last_result == AttackResult::HIT || last_result == AttackResult::SUNK);
 
     if (continue_turn) {
-      sleep_ms(SHOT_DELAY_MS);
+      pause_after_shot();
     }
   }
 
   if (m_state != GameState::GAME_OVER) {
-    sleep_ms(SHOT_DELAY_MS);
+    pause_after_shot();
     switch_turn();
   }
 }
@@ -109,12 +143,27 @@ void Game::handle_shot(const Position &pos) {
   const AttackResult result = opponent.receive_attack(pos);
   current.record_attack_result(pos, result);
 
-  m_battle_log.emplace_back(TurnInfo{pos, result, current.name()});
+  m_last_turn = TurnInfo{pos, result, current.name()};
+  if (m_battle_log.size() == MAX_BATTLE_LOG) {
+    m_battle_log.erase(m_battle_log.begin());
+  }
+  m_battle_log.emplace_back(m_last_turn);
+
+  if (m_replay) {
+    m_replay->record_shot(m_current_player_index, pos, result);
+  }
 }
 
 void Game::update_game_state() {
   if (opponent_player().has_lost()) {
     m_state = GameState::GAME_OVER;
+    if (m_replay) {
+      m_replay->end_game(m_current_player_index);
+      m_replay->flush(); // a session ended by Ctrl+C keeps its games
+    }
+    if (m_frame_renderer) {
+      m_frame_renderer->stop();
+    }
     ConsoleRenderer::clear();
     announce_winner();
   }
@@ -128,8 +177,30 @@ void Game::announce_winner() const {
       winner.name(), loser.name(), winner.board(), loser.board(),
       winner.total_attacks(), winner.accuracy(), loser.total_attacks(),
       loser.accuracy());
-
   ConsoleRenderer::display(output);
+
+  const std::string winner_key = rated_name(m_current_player_index);
+  const std::string loser_key = rated_name(1 - m_current_player_index);
+  if (m_ratings && winner_key != loser_key) {
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+    const auto [won, lost] = m_ratings->record_game(winner_key, loser_key, now);
+    ConsoleRenderer::display(Renderer::render_ratings(winner.name(), loser.name(), won,
+                                                      lost, m_ratings->size()));
+  }
+}
+
+// Humans by name; built-in AIs by level, so each level has one rating
+std::string Game::rated_name(std::size_t seat) const {
+  const Player &player = *m_players[seat];
+  if (player.type() == PlayerType::HUMAN) {
+    return std::string(player.name());
+  }
+  if (seat == 1 && !m_opponent_name.empty()) {
+    return m_opponent_name;
+  }
+  return std::format("Computer ({})", stats::strategy_name(player.difficulty()));
 }
 
 void Game::switch_turn() noexcept {
@@ -140,29 +211,47 @@ void Game::sleep_ms(int milliseconds) const {
   std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
 }
 
-void Game::display_game_state() const {
-  const auto &current = current_player();
-  const bool is_pvp = (m_mode == GameMode::PVP);
+void Game::pause_after_shot() const {
+  if (const int delay = m_pacing.delay_ms(); delay > 0) {
+    sleep_ms(delay);
+  }
+}
+
+void Game::display_game_state() {
+  if (m_frame_renderer) {
+    fill_snapshot(m_frame_renderer->next_frame());
+    m_frame_renderer->publish();
+    return;
+  }
 
-  std::string output;
-  output.reserve(2048);
+  GameSnapshot snapshot;
+  fill_snapshot(snapshot);
+  Renderer::render_snapshot(m_frame, snapshot);
+  ConsoleRenderer::clear();
+  ConsoleRenderer::display(m_frame);
+}
 
-  output += Renderer::render_header();
-  output += Renderer::render_turn(current.name());
-  output += Renderer::render_battle_log(m_battle_log, MAX_BATTLE_LOG);
+void Game::fill_snapshot(GameSnapshot &snapshot) const {
+  static_assert(MAX_BATTLE_LOG <= GameSnapshot::MAX_LOG);
+  const bool is_pvp = (m_mode == GameMode::PVP);
 
-  const std::string left_title = is_pvp ? "PLAYER 1 BOARD" : "YOUR BOARD";
-  const std::string right_title = is_pvp ? "PLAYER 2 BOARD" : "COMPUTER'S BOARD";
+  snapshot.turn_player = current_player().name();
 
-  output += Renderer::render_boards(m_players[0]->board(), m_players[1]->board(),
-                                    left_title, right_title, is_pvp, true);
+  snapshot.log_size = std::min(m_battle_log.size(), GameSnapshot::MAX_LOG);
+  std::copy(m_battle_log.end() - static_cast<std::ptrdiff_t>(snapshot.log_size),
+            m_battle_log.end(), snapshot.log.begin());
 
-  const std::string p1_name = is_pvp ? "Player 1" : "Player";
-  const std::string p2_name = is_pvp ? "Player 2" : "Computer";
-  output += Renderer::render_statistics(m_players[0]->board(),
-                                        m_players[1]->board(), p1_name, p2_name);
+  snapshot.grids[0] = m_players[0]->board().render(is_pvp);
+  snapshot.grids[1] = m_players[1]->board().render(true);
+  snapshot.titles = {is_pvp ? "PLAYER 1 BOARD" : "YOUR BOARD",
+                     is_pvp ? "PLAYER 2 BOARD" : "COMPUTER'S BOARD"};
+  snapshot.names = {is_pvp ? "Player 1" : "Player",
+                    is_pvp ? "Player 2" : "Computer"};
 
-  ConsoleRenderer::display(output);
+  for (std::size_t i = 0; i < m_players.size(); ++i) {
+    snapshot.counts[i] = m_players[i]->board().get_remaining_ship_types();
+    snapshot.ships_left[i] = m_players[i]->board().ships_remaining();
+  }
 }
 
 } // namespace battleship
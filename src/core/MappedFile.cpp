@@ -0,0 +1,64 @@
+#include "MappedFile.hpp"
+#include <fcntl.h>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace battleship {
+
+MappedFile::MappedFile(const std::string &path) : m_path(path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(std::format("Cannot open {}", path));
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error(std::format("Cannot stat {}", path));
+  }
+
+  m_size = static_cast<std::size_t>(st.st_size);
+  if (m_size > 0) {
+    void *addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error(std::format("Cannot mmap {}", path));
+    }
+    ::madvise(addr, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t *>(addr);
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_path(std::move(other.m_path)),
+      m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    m_path = std::move(other.m_path);
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() { unmap(); }
+
+void MappedFile::unmap() noexcept {
+  if (m_data) {
+    ::munmap(const_cast<uint8_t *>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
+
+} // namespace battleship
@@ -1,19 +1,34 @@
 #include "OnlineGame.hpp"
 #include "Game.hpp"
 #include "Renderer.hpp"
+#include "net/Protocol.hpp"
 #include <chrono>
+#include <format>
+#include <iostream>
 #include <thread>
 
 namespace battleship {
 
-OnlineGame::OnlineGame(net::NetworkManager &network) : m_network(network) {}
+OnlineGame::OnlineGame(net::NetworkManager &network, Pacing pacing,
+                       OnlineMode mode)
+    : m_network(network), m_pacing(pacing), m_mode(mode) {}
 
 void OnlineGame::initialize() {
+  if (m_mode == OnlineMode::SERVER) {
+    if (!initialize_from_server()) {
+      m_game_over = true;
+      return;
+    }
+    m_network.start_pinging();
+    return;
+  }
+
   const std::string name = m_network.is_host() ? "Host" : "Guest";
   m_local_player = std::make_unique<Player>(name, PlayerType::HUMAN);
   m_local_player->auto_place_ships();
 
   m_my_turn = m_network.is_host();
+  m_network.start_pinging();
 
   std::string msg = "Ships placed. ";
   msg += m_my_turn ? "You go first!\n" : "Opponent goes first.\n";
@@ -21,15 +36,21 @@ void OnlineGame::initialize() {
 }
 
 void OnlineGame::run() {
-  while (!m_game_over && m_network.is_connected()) {
-    display_state();
+  if (m_mode == OnlineMode::SERVER) {
+    run_server_client();
+  } else {
+    while (!m_game_over && m_network.is_connected()) {
+      display_state();
 
-    if (m_my_turn) {
-      run_my_turn();
-    } else {
-      run_opponent_turn();
+      if (m_my_turn) {
+        run_my_turn();
+      } else {
+        run_opponent_turn();
+      }
     }
   }
+
+  ConsoleRenderer::display(m_network.latency().report());
 }
 
 void OnlineGame::run_my_turn() {
@@ -42,44 +63,35 @@ void OnlineGame::run_my_turn() {
     ConsoleRenderer::display("Your turn! ");
     const Position attack_pos = m_local_player->get_attack();
 
-    if (!m_network.send_attack(attack_pos)) {
+    if (!send_attack(attack_pos)) {
       ConsoleRenderer::display("Failed to send attack\n");
       return;
     }
 
-    auto msg = m_network.receive();
+    auto msg = wait_for_message("Waiting for result...");
     if (!msg) {
       ConsoleRenderer::display("Failed to receive result\n");
       return;
     }
+    time_shot();
 
     // Check for game over (we won)
     if (msg->type == net::MessageType::GAME_OVER) {
+      if (const auto summary = net::protocol::decode_game_over(msg->payload)) {
+        show_game_over(*summary);
+      }
       m_game_over = true;
-      ConsoleRenderer::clear();
-      ConsoleRenderer::display(msg->payload);
       return;
     }
 
     // Handle SUNK with ship positions
     if (msg->type == net::MessageType::RESULT_SUNK) {
-      std::vector<Position> ship_cells;
-      std::string payload = msg->payload;
-      std::size_t pos_start = 0;
-
-      while (pos_start < payload.size()) {
-        std::size_t comma = payload.find(',', pos_start);
-        std::string pos_str =
-            (comma == std::string::npos)
-                ? payload.substr(pos_start)
-                : payload.substr(pos_start, comma - pos_start);
-        if (auto p = Position::try_parse(pos_str)) {
-          ship_cells.push_back(*p);
-        }
-        if (comma == std::string::npos)
-          break;
-        pos_start = comma + 1;
+      const auto ship = net::protocol::decode_sunk(msg->payload);
+      if (!ship) {
+        ConsoleRenderer::display("Invalid sunk ship from opponent\n");
+        return;
       }
+      const std::vector<Position> ship_cells = ship->cells();
 
       m_local_player->record_attack_result(attack_pos, AttackResult::SUNK);
       m_opponent_board.mark_sunk_ship(ship_cells);
@@ -89,17 +101,31 @@ void OnlineGame::run_my_turn() {
           TurnInfo{attack_pos, AttackResult::SUNK, m_local_player->name()});
       display_state();
 
+      // The last sinking arrives in the same write as GAME_OVER
+      if (opponent_ships_total() == 0) {
+        auto over = wait_for_message("Waiting for result...");
+        if (over && over->type == net::MessageType::GAME_OVER) {
+          if (const auto summary = net::protocol::decode_game_over(over->payload)) {
+            show_game_over(*summary);
+          }
+        }
+        m_game_over = true;
+        return;
+      }
+
       continue_turn = true;
-      sleep_ms(SHOT_DELAY_MS);
+      pause_after_shot();
       continue;
     }
 
-    if (msg->type != net::MessageType::RESULT || msg->payload.empty()) {
+    const auto decoded = msg->type == net::MessageType::RESULT
+                             ? net::protocol::decode_result(msg->payload)
+                             : std::nullopt;
+    if (!decoded) {
       ConsoleRenderer::display("Unexpected message type\n");
       return;
     }
-
-    const auto result = static_cast<AttackResult>(msg->payload[0]);
+    const AttackResult result = *decoded;
 
     m_local_player->record_attack_result(attack_pos, result);
     m_opponent_board.mark_attack(attack_pos, result);
@@ -113,23 +139,21 @@ void OnlineGame::run_my_turn() {
         (result == AttackResult::HIT || result == AttackResult::SUNK);
 
     if (continue_turn) {
-      sleep_ms(SHOT_DELAY_MS);
+      pause_after_shot();
     }
   }
 
   if (!m_game_over) {
     m_my_turn = false;
     m_network.send_your_turn();
-    sleep_ms(SHOT_DELAY_MS);
+    pause_after_shot();
   }
 }
 
 void OnlineGame::run_opponent_turn() {
-  ConsoleRenderer::display("Waiting for opponent's attack...\n");
-
   bool continue_turn = true;
   while (continue_turn && !m_game_over && m_network.is_connected()) {
-    auto msg = m_network.receive();
+    auto msg = wait_for_message("Waiting for opponent's attack...");
     if (!msg) {
       ConsoleRenderer::display("Connection lost\n");
       return;
@@ -144,7 +168,7 @@ void OnlineGame::run_opponent_turn() {
       continue;
     }
 
-    auto attack_pos = Position::try_parse(msg->payload);
+    auto attack_pos = net::protocol::decode_attack(msg->payload);
     if (!attack_pos) {
       continue;
     }
@@ -160,81 +184,370 @@ void OnlineGame::run_opponent_turn() {
     m_battle_log.emplace_back(TurnInfo{*attack_pos, result, "Opponent"});
     display_state();
 
-    // Check if we lost
-    if (m_local_player->has_lost()) {
-      m_game_over = true;
-
-      const float opponent_accuracy =
-          m_opponent_attacks > 0
-              ? static_cast<float>(m_opponent_hits) / m_opponent_attacks
-              : 0.0f;
-
-      const std::string winner_screen = Renderer::render_game_over(
-          "You", "Opponent", m_opponent_board, m_local_player->board(),
-          m_opponent_attacks, opponent_accuracy, m_local_player->total_attacks(),
-          m_local_player->accuracy());
-
-      m_network.send_game_over(winner_screen);
-
-      ConsoleRenderer::clear();
-      const std::string loser_screen = Renderer::render_game_over(
-          "Opponent", m_local_player->name(), m_opponent_board,
-          m_local_player->board(), m_opponent_attacks, opponent_accuracy,
-          m_local_player->total_attacks(), m_local_player->accuracy());
-      ConsoleRenderer::display(loser_screen);
-      return;
-    }
-
     // Send result back
     if (result == AttackResult::SUNK && ship) {
-      std::string positions;
-      for (const auto &pos : ship->positions()) {
-        if (!positions.empty())
-          positions += ",";
-        positions += pos.to_string();
-      }
-      net::Message sunk_msg;
-      sunk_msg.type = net::MessageType::RESULT_SUNK;
-      sunk_msg.payload = positions;
-      m_network.send(sunk_msg);
+      m_network.queue(net::MessageType::RESULT_SUNK,
+                      net::protocol::encode_sunk(*ship));
     } else {
-      m_network.send_result(static_cast<uint8_t>(result));
+      m_network.queue(net::MessageType::RESULT,
+                      net::protocol::encode_result(result));
+    }
+
+    // Check if we lost; GAME_OVER leaves in the same write as the final
+    // sinking and the winner renders its own screen from the tally
+    if (m_local_player->has_lost()) {
+      const auto summary = local_summary(net::protocol::Outcome::LOSS);
+      m_network.send_game_over(summary.flipped());
+      show_game_over(summary);
+      return;
     }
+    m_network.flush();
 
     continue_turn =
         (result == AttackResult::HIT || result == AttackResult::SUNK);
 
     if (continue_turn) {
-      sleep_ms(SHOT_DELAY_MS);
+      pause_after_shot();
     }
   }
 }
 
-void OnlineGame::display_state() const {
+// Shots are timed from ATTACK sent to the first answer received
+bool OnlineGame::send_attack(const Position &pos) {
+  m_shot_sent = std::chrono::steady_clock::now();
+  return m_network.send_attack(pos);
+}
+
+void OnlineGame::time_shot() {
+  m_network.latency().record_shot(std::chrono::duration_cast<net::Micros>(
+      std::chrono::steady_clock::now() - m_shot_sent));
+}
+
+void OnlineGame::display_state() {
   ConsoleRenderer::clear();
 
-  std::string output;
-  output.reserve(2048);
+  std::string &output = m_frame;
+  output.clear();
 
-  output += Renderer::render_header();
+  Renderer::render_header(output);
   output += m_my_turn ? "\u3010 Your Turn \u3011\n\n" : "\u3010 Opponent's Turn \u3011\n\n";
-  output += Renderer::render_battle_log(m_battle_log, MAX_BATTLE_LOG);
-  output += Renderer::render_boards(m_local_player->board(), m_opponent_board,
-                                    "YOUR BOARD", "OPPONENT'S BOARD", false, true);
+  Renderer::render_battle_log(output, m_battle_log, MAX_BATTLE_LOG);
+  Renderer::render_boards(output, m_local_player->board().render(false),
+                          m_opponent_board.render(true), "YOUR BOARD",
+                          "OPPONENT'S BOARD");
 
   const auto your_counts = m_local_player->board().get_remaining_ship_types();
   const auto your_total = m_local_player->board().ships_remaining();
 
-  output += Renderer::render_statistics(your_counts, your_total, m_opponent_ships,
-                                        opponent_ships_total(), "You", "Opponent");
+  Renderer::render_statistics(output, your_counts, your_total, m_opponent_ships,
+                              opponent_ships_total(), "You", "Opponent");
+  output += m_network.latency().status_line();
 
   ConsoleRenderer::display(output);
 }
 
+// ============================================================================
+// Server mode
+// ============================================================================
+
+bool OnlineGame::initialize_from_server() {
+  auto msg = wait_for_message("Waiting for an opponent...");
+  if (!msg || msg->type != net::MessageType::GAME_START) {
+    ConsoleRenderer::display("Server closed the connection\n");
+    return false;
+  }
+  const auto start = net::protocol::decode_game_start(msg->payload);
+  if (!start) {
+    ConsoleRenderer::display("Invalid fleet from server\n");
+    return false;
+  }
+
+  if (!deal_fleet(start->fleet)) {
+    ConsoleRenderer::display("Invalid fleet from server\n");
+    return false;
+  }
+  m_local_player->set_state(PlayerState::READY);
+  m_my_turn = start->first;
+  m_session = start->session;
+
+  ConsoleRenderer::display(m_my_turn ? "Opponent found. You go first!\n"
+                                     : "Opponent found. Opponent goes first.\n");
+  return true;
+}
+
+// Fresh local player with the fleet the server dealt
+bool OnlineGame::deal_fleet(const std::vector<net::protocol::ShipPlacement> &fleet) {
+  m_local_player = std::make_unique<Player>("You", PlayerType::HUMAN);
+  for (const auto &ship : fleet) {
+    if (!m_local_player->place_ship(ship.type, ship.start, ship.orientation)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void OnlineGame::run_server_client() {
+  std::optional<Position> pending_attack;
+
+  while (!m_game_over && m_network.is_connected()) {
+    display_state();
+
+    auto msg = wait_for_message(pending_attack ? "Waiting for result..."
+                                : m_my_turn    ? "Waiting for server..."
+                                               : "Waiting for opponent's attack...");
+    if (!msg) {
+      if (resume_session()) {
+        pending_attack.reset();
+        continue;
+      }
+      ConsoleRenderer::display("Connection lost\n");
+      return;
+    }
+
+    switch (msg->type) {
+    case net::MessageType::YOUR_TURN: {
+      m_my_turn = true;
+      m_local_player->set_state(PlayerState::ACTIVE);
+      display_state();
+      ConsoleRenderer::display("Your turn! ");
+      pending_attack = m_local_player->get_attack();
+      if (!send_attack(*pending_attack)) {
+        // The server sends YOUR_TURN again with the snapshot
+        pending_attack.reset();
+        if (!resume_session()) {
+          ConsoleRenderer::display("Failed to send attack\n");
+          return;
+        }
+      }
+      break;
+    }
+    case net::MessageType::RESULT: {
+      const auto result = net::protocol::decode_result(msg->payload);
+      if (pending_attack && result) {
+        time_shot();
+        record_my_shot(*pending_attack, *result, {});
+        pending_attack.reset();
+      }
+      break;
+    }
+    case net::MessageType::RESULT_SUNK: {
+      const auto ship = net::protocol::decode_sunk(msg->payload);
+      if (pending_attack && ship) {
+        time_shot();
+        record_my_shot(*pending_attack, AttackResult::SUNK, ship->cells());
+        pending_attack.reset();
+      }
+      break;
+    }
+    case net::MessageType::ATTACK:
+      if (const auto pos = net::protocol::decode_attack(msg->payload)) {
+        apply_opponent_shot(*pos);
+      }
+      break;
+    case net::MessageType::GAME_OVER: {
+      const auto summary = net::protocol::decode_game_over(msg->payload);
+      m_game_over = true;
+      if (!summary) {
+        ConsoleRenderer::display("\nInvalid game result from server\n");
+      } else if (summary->outcome == net::protocol::Outcome::OPPONENT_LEFT) {
+        ConsoleRenderer::display("\nOpponent left the game. You win!\n");
+      } else {
+        show_game_over(*summary);
+      }
+      return;
+    }
+    default:
+      break;
+    }
+  }
+}
+
+// Reconnects and rebuilds the game from the server's snapshot. Any moves
+// made meanwhile are in the snapshot; nothing is replayed.
+bool OnlineGame::resume_session() {
+  if (!m_session || m_game_over) {
+    return false;
+  }
+
+  for (int attempt = 1; attempt <= RESUME_ATTEMPTS; ++attempt) {
+    ConsoleRenderer::display(std::format(
+        "\nConnection lost, resuming ({}/{})...\n", attempt, RESUME_ATTEMPTS));
+    if (m_network.resume(*m_session)) {
+      // Messages queued for the old connection may arrive first
+      while (auto msg = wait_for_message("Resuming...")) {
+        if (msg->type != net::MessageType::SNAPSHOT) {
+          continue;
+        }
+        const auto snapshot = net::protocol::decode_snapshot(msg->payload);
+        if (!snapshot || !apply_snapshot(*snapshot)) {
+          return false;
+        }
+        m_network.start_pinging();
+        return true;
+      }
+      return false; // the server closed: our match is over
+    }
+    sleep_ms(RESUME_BACKOFF_MS * attempt);
+  }
+  return false;
+}
+
+bool OnlineGame::apply_snapshot(const net::protocol::Snapshot &snapshot) {
+  if (!deal_fleet(snapshot.fleet)) {
+    ConsoleRenderer::display("Invalid fleet from server\n");
+    return false;
+  }
+
+  m_opponent_board.clear();
+  m_opponent_ships = Board::ShipTypeCounts{1, 2, 3, 4};
+  m_opponent_attacks = 0;
+  m_opponent_hits = 0;
+
+  for (std::size_t cell = 0; cell < snapshot.shots.size(); ++cell) {
+    const Position pos(static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                       static_cast<config::GridCoord>(cell / config::GRID_SIZE));
+    if (snapshot.incoming[cell]) {
+      m_local_player->receive_attack(pos);
+      ++m_opponent_attacks;
+      m_opponent_hits += m_local_player->board().get_ship_at(pos) != nullptr;
+    }
+    if (snapshot.shots[cell]) {
+      const AttackResult result =
+          snapshot.hits[cell] ? AttackResult::HIT : AttackResult::MISS;
+      m_local_player->record_attack_result(pos, result);
+      m_opponent_board.mark_attack(pos, result);
+    }
+  }
+  for (const auto &ship : snapshot.sunk) {
+    const std::vector<Position> cells = ship.cells();
+    m_opponent_board.mark_sunk_ship(cells);
+    update_opponent_sunk(cells.size());
+  }
+
+  m_my_turn = snapshot.your_turn;
+  m_local_player->set_state(PlayerState::WAITING);
+
+  // The battle log stops at the drop; the cursor says how much it missed
+  const std::size_t missed =
+      snapshot.cursor > m_battle_log.size() ? snapshot.cursor - m_battle_log.size() : 0;
+  display_state();
+  ConsoleRenderer::display(std::format(
+      "Resumed ({} move{} played while reconnecting)\n", missed, missed == 1 ? "" : "s"));
+  return true;
+}
+
+void OnlineGame::record_my_shot(const Position &pos, AttackResult result,
+                                const std::vector<Position> &sunk_cells) {
+  if (result == AttackResult::ALREADY_ATTACKED ||
+      result == AttackResult::INVALID_COORD) {
+    ConsoleRenderer::display("Invalid target, try again\n");
+    return; // the server hands the turn straight back
+  }
+
+  m_local_player->record_attack_result(pos, result);
+  if (result == AttackResult::SUNK) {
+    m_opponent_board.mark_sunk_ship(sunk_cells);
+    update_opponent_sunk(sunk_cells.size());
+  } else {
+    m_opponent_board.mark_attack(pos, result);
+  }
+  m_battle_log.emplace_back(TurnInfo{pos, result, m_local_player->name()});
+
+  if (result == AttackResult::MISS) {
+    m_my_turn = false;
+    m_local_player->set_state(PlayerState::WAITING);
+  }
+  display_state();
+  pause_after_shot();
+}
+
+void OnlineGame::apply_opponent_shot(const Position &pos) {
+  const AttackResult result = m_local_player->receive_attack(pos);
+
+  ++m_opponent_attacks;
+  if (result == AttackResult::HIT || result == AttackResult::SUNK) {
+    ++m_opponent_hits;
+  }
+  m_battle_log.emplace_back(TurnInfo{pos, result, "Opponent"});
+
+  display_state();
+  pause_after_shot();
+}
+
+// Our own view of the finished game; the peer gets it flipped
+net::protocol::GameSummary OnlineGame::local_summary(
+    net::protocol::Outcome outcome) const {
+  net::protocol::GameSummary summary;
+  summary.outcome = outcome;
+  summary.shots = {m_local_player->total_attacks(),
+                   static_cast<uint16_t>(m_opponent_attacks)};
+  summary.hits = {m_local_player->successful_hits(),
+                  static_cast<uint16_t>(m_opponent_hits)};
+  return summary;
+}
+
+void OnlineGame::show_game_over(const net::protocol::GameSummary &summary) {
+  m_game_over = true;
+
+  const auto accuracy = [&summary](std::size_t side) {
+    return summary.shots[side] > 0
+               ? static_cast<float>(summary.hits[side]) / summary.shots[side]
+               : 0.0f;
+  };
+  const uint32_t my_attacks = summary.shots[0];
+  const float my_accuracy = accuracy(0);
+  const uint32_t opponent_attacks = summary.shots[1];
+  const float opponent_accuracy = accuracy(1);
+
+  ConsoleRenderer::clear();
+  ConsoleRenderer::display(
+      summary.outcome == net::protocol::Outcome::WIN
+          ? Renderer::render_game_over("You", "Opponent",
+                                       m_local_player->board(), m_opponent_board,
+                                       my_attacks, my_accuracy,
+                                       opponent_attacks, opponent_accuracy)
+          : Renderer::render_game_over("Opponent", "You", m_opponent_board,
+                                       m_local_player->board(),
+                                       opponent_attacks, opponent_accuracy,
+                                       my_attacks, my_accuracy));
+}
+
+std::optional<net::Message>
+OnlineGame::wait_for_message(std::string_view status) {
+  const auto started = std::chrono::steady_clock::now();
+  long long shown_seconds = -1;
+
+  // Short slices keep the status line live instead of parking in read()
+  while (m_network.is_connected()) {
+    if (auto msg = m_network.receive_for(WAIT_SLICE)) {
+      if (shown_seconds >= 0) {
+        ConsoleRenderer::display("\n");
+      }
+      return msg;
+    }
+
+    const auto waited = std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::steady_clock::now() - started)
+                            .count();
+    if (waited != shown_seconds) {
+      shown_seconds = waited;
+      ConsoleRenderer::display(std::format("\r{} {}s", status, waited));
+      std::cout.flush();
+    }
+  }
+  return std::nullopt;
+}
+
 void OnlineGame::sleep_ms(int milliseconds) const {
   std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
 }
 
+void OnlineGame::pause_after_shot() const {
+  if (const int delay = m_pacing.delay_ms(); delay > 0) {
+    sleep_ms(delay);
+  }
+}
+
 void OnlineGame::update_opponent_sunk(std::size_t ship_size) {
   switch (ship_size) {
   case 4:
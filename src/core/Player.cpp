@@ -9,15 +9,16 @@
 namespace battleship {
 
 Player::Player(std::string_view name, PlayerType type,
-               config::Difficulty ai_difficulty)
-    : m_name(name), m_type(type) {
+               config::Difficulty ai_difficulty, std::optional<uint32_t> seed)
+    : m_name(name), m_type(type), m_difficulty(ai_difficulty),
+      m_rng(seed ? *seed : std::random_device{}()) {
 
   if (name.empty()) {
     throw std::invalid_argument("Player name cannot be empty");
   }
 
   if (m_type == PlayerType::AI) {
-    m_ai_strategy = ai::make_strategy(ai_difficulty);
+    m_ai_strategy = ai::make_strategy(ai_difficulty, m_rng());
   }
 }
 
@@ -35,8 +36,7 @@ void Player::auto_place_ships() {
     throw std::runtime_error("Cannot auto-place ships after setup phase");
   }
 
-  std::random_device rd;
-  std::mt19937 gen(rd());
+  std::mt19937 &gen = m_rng;
   std::uniform_int_distribution<config::GridCoord> dist(0,
                                                         Board::GRID_SIZE - 1);
   std::uniform_int_distribution<uint8_t> bool_dist(0, 1);
@@ -0,0 +1,631 @@
+#include "Rating.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <numbers>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace battleship::rating {
+
+namespace {
+
+// Glicko's scale factor, ln(10) / 400
+constexpr double Q = std::numbers::ln10 / 400.0;
+constexpr double SECONDS_PER_DAY = 86400.0;
+
+constexpr std::array<char, 8> STORE_MAGIC = {'B', 'S', 'R', 'A', 'T', 'I', 'N', 'G'};
+constexpr std::array<char, 8> INDEX_MAGIC = {'B', 'S', 'R', 'A', 'T', 'I', 'D', 'X'};
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304; // reads differently elsewhere
+
+// Both files start with one of these
+struct Header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t count;    // records in use / records indexed
+  uint64_t capacity; // records allocated / index slots
+  std::array<uint8_t, 32> reserved;
+};
+static_assert(sizeof(Header) == RatingStore::HEADER_SIZE);
+
+bool is_blank(const Header &header) noexcept {
+  return std::all_of(header.magic.begin(), header.magic.end(),
+                     [](char c) { return c == 0; });
+}
+
+bool is_valid(const Header &header, const std::array<char, 8> &magic) noexcept {
+  return header.magic == magic && header.version == VERSION &&
+         header.byte_order == BYTE_ORDER_MARK;
+}
+
+void stamp(Header &header, const std::array<char, 8> &magic) noexcept {
+  header.magic = magic;
+  header.version = VERSION;
+  header.byte_order = BYTE_ORDER_MARK;
+}
+
+double g(double deviation) noexcept {
+  return 1.0 / std::sqrt(1.0 + 3.0 * Q * Q * deviation * deviation /
+                                   (std::numbers::pi * std::numbers::pi));
+}
+
+// `player`'s rating after scoring `score` (1 = win, 0 = loss) against
+// `opponent`
+Rating update(const Rating &player, const Rating &opponent, double score) noexcept {
+  const double weight = g(opponent.deviation);
+  const double expected =
+      1.0 / (1.0 + std::pow(10.0, -weight * (player.rating - opponent.rating) / 400.0));
+  const double inverse_d2 = Q * Q * weight * weight * expected * (1.0 - expected);
+  const double precision = 1.0 / (player.deviation * player.deviation) + inverse_d2;
+
+  Rating out;
+  out.rating = player.rating + Q / precision * weight * (score - expected);
+  out.deviation = std::max(MIN_DEVIATION, std::sqrt(1.0 / precision));
+  return out;
+}
+
+} // namespace
+
+std::pair<Rating, Rating> glicko(const Rating &winner, const Rating &loser) noexcept {
+  return {update(winner, loser, 1.0), update(loser, winner, 0.0)};
+}
+
+double idle_deviation(double deviation, double days) noexcept {
+  if (days <= 0) {
+    return deviation;
+  }
+  return std::min(MAX_DEVIATION, std::sqrt(deviation * deviation +
+                                           DEVIATION_PER_DAY * DEVIATION_PER_DAY * days));
+}
+
+// FNV-1a: stable across runs and builds, unlike std::hash
+uint64_t player_id(std::string_view name) noexcept {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (const char c : name) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+// ============================================================================
+// Leaderboard
+// ============================================================================
+
+Leaderboard::Leaderboard() : m_roots(BUCKET_COUNT, NONE), m_tree(BUCKET_COUNT + 1) {}
+
+uint32_t Leaderboard::bucket_of(double rating) noexcept {
+  const double clamped = std::clamp(rating, 0.0, MAX_RATING);
+  const auto bucket = static_cast<std::size_t>((MAX_RATING - clamped) * RESOLUTION);
+  return static_cast<uint32_t>(std::min(bucket, BUCKET_COUNT - 1));
+}
+
+void Leaderboard::count(uint32_t bucket, int delta) noexcept {
+  for (std::size_t i = bucket + 1; i <= BUCKET_COUNT; i += i & (~i + 1)) {
+    m_tree[i] = static_cast<uint32_t>(static_cast<int64_t>(m_tree[i]) + delta);
+  }
+}
+
+// Players in buckets [0, bucket)
+std::size_t Leaderboard::count_before(uint32_t bucket) const noexcept {
+  std::size_t total = 0;
+  for (std::size_t i = bucket; i > 0; i -= i & (~i + 1)) {
+    total += m_tree[i];
+  }
+  return total;
+}
+
+// Fenwick descent: the last bucket whose predecessors hold fewer than rank
+uint32_t Leaderboard::bucket_at(std::size_t rank) const noexcept {
+  std::size_t position = 0;
+  std::size_t left = rank;
+  for (std::size_t step = std::bit_floor(BUCKET_COUNT); step > 0; step >>= 1) {
+    if (position + step <= BUCKET_COUNT && m_tree[position + step] < left) {
+      position += step;
+      left -= m_tree[position];
+    }
+  }
+  return static_cast<uint32_t>(position);
+}
+
+bool Leaderboard::ahead(uint32_t a, uint32_t b) const noexcept {
+  const double x = m_nodes[a].rating;
+  const double y = m_nodes[b].rating;
+  return x != y ? x > y : a < b;
+}
+
+uint32_t Leaderboard::size_of(uint32_t node) const noexcept {
+  return node == NONE ? 0 : m_nodes[node].size;
+}
+
+void Leaderboard::resize(uint32_t node) noexcept {
+  Node &n = m_nodes[node];
+  n.size = 1 + size_of(n.left) + size_of(n.right);
+}
+
+// Descends by key until the new node outranks the subtree in heap order,
+// then splits that subtree around it
+uint32_t Leaderboard::insert(uint32_t root, uint32_t node) noexcept {
+  if (root == NONE) {
+    return node;
+  }
+  Node &r = m_nodes[root];
+  if (m_nodes[node].priority > r.priority) {
+    const auto [front, back] = split(root, node);
+    m_nodes[node].left = front;
+    m_nodes[node].right = back;
+    resize(node);
+    return node;
+  }
+  if (ahead(node, root)) {
+    r.left = insert(r.left, node);
+  } else {
+    r.right = insert(r.right, node);
+  }
+  resize(root);
+  return root;
+}
+
+// The nodes of `root` ahead of `node`, and the rest
+std::pair<uint32_t, uint32_t> Leaderboard::split(uint32_t root, uint32_t node) noexcept {
+  if (root == NONE) {
+    return {NONE, NONE};
+  }
+  Node &r = m_nodes[root];
+  if (ahead(root, node)) {
+    const auto [front, back] = split(r.right, node);
+    r.right = front;
+    resize(root);
+    return {root, back};
+  }
+  const auto [front, back] = split(r.left, node);
+  r.left = back;
+  resize(root);
+  return {front, root};
+}
+
+uint32_t Leaderboard::erase(uint32_t root, uint32_t node) noexcept {
+  if (root == node) {
+    Node &n = m_nodes[node];
+    const uint32_t rest = merge(n.left, n.right);
+    n.left = n.right = NONE;
+    n.size = 1;
+    return rest;
+  }
+  Node &r = m_nodes[root];
+  if (ahead(node, root)) {
+    r.left = erase(r.left, node);
+  } else {
+    r.right = erase(r.right, node);
+  }
+  resize(root);
+  return root;
+}
+
+// Every node of `left` is ahead of every node of `right`
+uint32_t Leaderboard::merge(uint32_t left, uint32_t right) noexcept {
+  if (left == NONE) {
+    return right;
+  }
+  if (right == NONE) {
+    return left;
+  }
+  if (m_nodes[left].priority > m_nodes[right].priority) {
+    m_nodes[left].right = merge(m_nodes[left].right, right);
+    resize(left);
+    return left;
+  }
+  m_nodes[right].left = merge(left, m_nodes[right].left);
+  resize(right);
+  return right;
+}
+
+// In order, skipping the first `skip` nodes, until `out` holds `count`
+void Leaderboard::collect(uint32_t root, std::size_t &skip, std::size_t count,
+                          std::vector<uint32_t> &out) const {
+  if (root == NONE || out.size() >= count) {
+    return;
+  }
+  const Node &r = m_nodes[root];
+  if (skip >= r.size) {
+    skip -= r.size;
+    return;
+  }
+  collect(r.left, skip, count, out);
+  if (out.size() < count) {
+    if (skip > 0) {
+      --skip;
+    } else {
+      out.push_back(root);
+    }
+  }
+  collect(r.right, skip, count, out);
+}
+
+// murmur3's finalizer, so priorities are unrelated to record order
+uint32_t Leaderboard::priority_of(uint32_t record) noexcept {
+  uint32_t priority = record;
+  priority = (priority ^ (priority >> 16)) * 0x85EBCA6B;
+  priority = (priority ^ (priority >> 13)) * 0xC2B2AE35;
+  return priority ^ (priority >> 16);
+}
+
+void Leaderboard::assign(std::span<const double> ratings) {
+  m_nodes.clear();
+  m_nodes.reserve(ratings.size());
+  m_roots.assign(BUCKET_COUNT, NONE);
+  m_tree.assign(BUCKET_COUNT + 1, 0);
+
+  // Records grouped by bucket, each group in record order
+  std::vector<uint32_t> starts(BUCKET_COUNT + 1);
+  for (uint32_t record = 0; record < ratings.size(); ++record) {
+    m_nodes.push_back(Node{ratings[record], NONE, NONE, priority_of(record), 1});
+    ++starts[bucket_of(ratings[record]) + 1];
+  }
+  for (std::size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+    m_tree[bucket + 1] = starts[bucket + 1];
+    starts[bucket + 1] += starts[bucket];
+  }
+  std::vector<uint32_t> order(ratings.size());
+  std::vector<uint32_t> fill(starts.begin(), starts.end() - 1);
+  for (uint32_t record = 0; record < ratings.size(); ++record) {
+    order[fill[bucket_of(ratings[record])]++] = record;
+  }
+
+  // Fenwick tree from the bucket sizes, each node passing its sum up once
+  for (std::size_t i = 1; i <= BUCKET_COUNT; ++i) {
+    if (const std::size_t parent = i + (i & (~i + 1)); parent <= BUCKET_COUNT) {
+      m_tree[parent] += m_tree[i];
+    }
+  }
+
+  // Each bucket's treap from its sorted records: a Cartesian tree by
+  // priority, built along its right spine
+  std::vector<uint32_t> spine;
+  const auto pop = [&] {
+    const uint32_t node = spine.back();
+    spine.pop_back();
+    resize(node);
+    return node;
+  };
+  for (std::size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+    const auto first = order.begin() + starts[bucket];
+    const auto last = order.begin() + starts[bucket + 1];
+    if (first == last) {
+      continue;
+    }
+    std::sort(first, last, [this](uint32_t a, uint32_t b) { return ahead(a, b); });
+    for (auto it = first; it != last; ++it) {
+      uint32_t below = NONE;
+      while (!spine.empty() && m_nodes[spine.back()].priority < m_nodes[*it].priority) {
+        below = pop();
+      }
+      m_nodes[*it].left = below;
+      if (!spine.empty()) {
+        m_nodes[spine.back()].right = *it;
+      }
+      spine.push_back(*it);
+    }
+    uint32_t root = NONE;
+    while (!spine.empty()) {
+      root = pop();
+    }
+    m_roots[bucket] = root;
+  }
+}
+
+void Leaderboard::add(uint32_t record, double rating) {
+  if (record != m_nodes.size()) {
+    throw std::invalid_argument("Leaderboard records must be added in order");
+  }
+  m_nodes.push_back(Node{rating, NONE, NONE, priority_of(record), 1});
+  const uint32_t bucket = bucket_of(rating);
+  m_roots[bucket] = insert(m_roots[bucket], record);
+  count(bucket, 1);
+}
+
+void Leaderboard::update(uint32_t record, double rating) {
+  const uint32_t from = bucket_of(m_nodes[record].rating);
+  m_roots[from] = erase(m_roots[from], record);
+  count(from, -1);
+
+  m_nodes[record].rating = rating;
+  const uint32_t to = bucket_of(rating);
+  m_roots[to] = insert(m_roots[to], record);
+  count(to, 1);
+}
+
+std::size_t Leaderboard::rank(uint32_t record) const noexcept {
+  const uint32_t bucket = bucket_of(m_nodes[record].rating);
+  std::size_t above = count_before(bucket);
+  for (uint32_t t = m_roots[bucket]; t != record;) {
+    if (ahead(record, t)) {
+      t = m_nodes[t].left;
+    } else {
+      above += size_of(m_nodes[t].left) + 1;
+      t = m_nodes[t].right;
+    }
+  }
+  return above + size_of(m_nodes[record].left) + 1;
+}
+
+std::vector<uint32_t> Leaderboard::range(std::size_t first, std::size_t count) const {
+  std::vector<uint32_t> out;
+  if (first == 0 || first > size()) {
+    return out;
+  }
+  out.reserve(std::min(count, size() - first + 1));
+
+  uint32_t bucket = bucket_at(first);
+  std::size_t skip = first - 1 - count_before(bucket);
+  for (; out.size() < count && bucket < BUCKET_COUNT; ++bucket) {
+    collect(m_roots[bucket], skip, count, out);
+  }
+  return out;
+}
+
+// ============================================================================
+// RatingStore
+// ============================================================================
+
+void RatingStore::Region::open(const std::string &path, std::size_t minimum) {
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error(std::format("Cannot open {}", path));
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    throw std::runtime_error(std::format("Cannot stat {}", path));
+  }
+  resize(std::max(static_cast<std::size_t>(st.st_size), minimum));
+}
+
+// New bytes read as zero
+void RatingStore::Region::resize(std::size_t bytes) {
+  if (data) {
+    ::munmap(data, size);
+    data = nullptr;
+  }
+  if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    throw std::runtime_error("Cannot grow rating store");
+  }
+  void *addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error("Cannot mmap rating store");
+  }
+  data = static_cast<uint8_t *>(addr);
+  size = bytes;
+}
+
+void RatingStore::Region::close() noexcept {
+  if (data) {
+    ::munmap(data, size);
+    data = nullptr;
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+std::string_view RatingStore::Record::display_name() const noexcept {
+  return {name.data(), strnlen(name.data(), name.size())};
+}
+
+RatingStore::RatingStore(const std::string &path) : m_path(path) {
+  try {
+    m_records.open(path, HEADER_SIZE + INITIAL_RECORDS * sizeof(Record));
+    auto &header = *reinterpret_cast<Header *>(m_records.data);
+    if (is_blank(header)) {
+      stamp(header, STORE_MAGIC);
+      header.capacity = INITIAL_RECORDS;
+    }
+    if (!is_valid(header, STORE_MAGIC) || header.count > header.capacity ||
+        m_records.size < HEADER_SIZE + header.capacity * sizeof(Record)) {
+      throw std::runtime_error(std::format("Not a rating store: {}", path));
+    }
+
+    m_index.open(path + ".idx", HEADER_SIZE);
+    const auto &index = *reinterpret_cast<const Header *>(m_index.data);
+    if (!is_valid(index, INDEX_MAGIC) || index.count != header.count ||
+        !std::has_single_bit(index.capacity) || index.capacity < 2 * header.count ||
+        m_index.size < HEADER_SIZE + index.capacity * sizeof(Slot)) {
+      rebuild_index(std::bit_ceil(std::max<uint64_t>(2 * INITIAL_RECORDS, 2 * header.count)));
+    }
+  } catch (...) {
+    m_records.close();
+    m_index.close();
+    throw;
+  }
+
+  std::vector<double> ratings(record_count());
+  for (uint32_t record = 0; record < ratings.size(); ++record) {
+    ratings[record] = records()[record].rating;
+  }
+  m_leaderboard.assign(ratings);
+}
+
+RatingStore::~RatingStore() {
+  m_records.close();
+  m_index.close();
+}
+
+uint64_t &RatingStore::record_count() noexcept {
+  return reinterpret_cast<Header *>(m_records.data)->count;
+}
+
+uint64_t RatingStore::record_count() const noexcept {
+  return reinterpret_cast<const Header *>(m_records.data)->count;
+}
+
+RatingStore::Record *RatingStore::records() noexcept {
+  return reinterpret_cast<Record *>(m_records.data + HEADER_SIZE);
+}
+
+const RatingStore::Record *RatingStore::records() const noexcept {
+  return reinterpret_cast<const Record *>(m_records.data + HEADER_SIZE);
+}
+
+uint64_t RatingStore::slot_count() const noexcept {
+  return reinterpret_cast<const Header *>(m_index.data)->capacity;
+}
+
+RatingStore::Slot *RatingStore::slots() noexcept {
+  return reinterpret_cast<Slot *>(m_index.data + HEADER_SIZE);
+}
+
+const RatingStore::Slot *RatingStore::slots() const noexcept {
+  return reinterpret_cast<const Slot *>(m_index.data + HEADER_SIZE);
+}
+
+// Fibonacci hashing spreads ids that differ only in low bits
+std::optional<uint32_t> RatingStore::lookup(uint64_t id) const noexcept {
+  const uint64_t mask = slot_count() - 1;
+  const Slot *table = slots();
+  for (uint64_t i = (id * 0x9E3779B97F4A7C15ULL) >> 32 & mask;; i = (i + 1) & mask) {
+    if (table[i].record == 0) {
+      return std::nullopt;
+    }
+    if (table[i].id == id) {
+      return table[i].record - 1;
+    }
+  }
+}
+
+void RatingStore::index(uint64_t id, uint32_t record) noexcept {
+  const uint64_t mask = slot_count() - 1;
+  Slot *table = slots();
+  uint64_t i = (id * 0x9E3779B97F4A7C15ULL) >> 32 & mask;
+  while (table[i].record != 0) {
+    i = (i + 1) & mask;
+  }
+  table[i] = {id, record + 1, 0};
+}
+
+// Marked stale first, so a crash halfway leaves an index that is rebuilt
+void RatingStore::rebuild_index(uint64_t slot_total) {
+  if (m_index.size >= HEADER_SIZE) {
+    reinterpret_cast<Header *>(m_index.data)->count = 0;
+  }
+  m_index.resize(HEADER_SIZE + slot_total * sizeof(Slot));
+  auto &header = *reinterpret_cast<Header *>(m_index.data);
+  stamp(header, INDEX_MAGIC);
+  header.count = 0;
+  header.capacity = slot_total;
+  std::memset(slots(), 0, slot_total * sizeof(Slot));
+
+  const uint64_t count = record_count();
+  for (uint32_t record = 0; record < count; ++record) {
+    index(records()[record].id, record);
+  }
+  reinterpret_cast<Header *>(m_index.data)->count = count;
+}
+
+// The record is complete before the count covers it, and the index entry
+// follows the count
+uint32_t RatingStore::add(std::string_view name, uint64_t id, int64_t now) {
+  auto *header = reinterpret_cast<Header *>(m_records.data);
+  if (header->count == header->capacity) {
+    const uint64_t capacity = header->capacity * 2;
+    m_records.resize(HEADER_SIZE + capacity * sizeof(Record));
+    header = reinterpret_cast<Header *>(m_records.data);
+    header->capacity = capacity;
+  }
+
+  const auto record = static_cast<uint32_t>(header->count);
+  Record &entry = records()[record];
+  entry = Record{id, INITIAL_RATING, MAX_DEVIATION, now, 0, 0, {}};
+  std::memcpy(entry.name.data(), name.data(), std::min(name.size(), NAME_SIZE));
+  ++header->count;
+
+  if (2 * header->count > slot_count()) {
+    rebuild_index(slot_count() * 2);
+  } else {
+    index(id, record);
+    ++reinterpret_cast<Header *>(m_index.data)->count;
+  }
+  m_leaderboard.add(record, INITIAL_RATING);
+  return record;
+}
+
+std::pair<RatingStore::Change, RatingStore::Change>
+RatingStore::record_game(std::string_view winner, std::string_view loser, int64_t now) {
+  const uint64_t winner_id = player_id(winner);
+  const uint64_t loser_id = player_id(loser);
+  if (winner_id == loser_id) {
+    throw std::invalid_argument("A rated game needs two different players");
+  }
+  // Both added before taking references: adding may remap the file
+  const auto find_or_add = [&](std::string_view name, uint64_t id) {
+    const auto record = lookup(id);
+    return record ? *record : add(name, id, now);
+  };
+  const uint32_t w = find_or_add(winner, winner_id);
+  const uint32_t l = find_or_add(loser, loser_id);
+  Record &a = records()[w];
+  Record &b = records()[l];
+
+  const auto rating_of = [now](const Record &record) {
+    return Rating{record.rating,
+                  idle_deviation(record.deviation,
+                                 static_cast<double>(now - record.last_played) /
+                                     SECONDS_PER_DAY)};
+  };
+  const Rating winner_before{a.rating, a.deviation};
+  const Rating loser_before{b.rating, b.deviation};
+  const auto [winner_after, loser_after] = glicko(rating_of(a), rating_of(b));
+
+  a.rating = winner_after.rating;
+  a.deviation = winner_after.deviation;
+  a.last_played = now;
+  ++a.games;
+  ++a.wins;
+  b.rating = loser_after.rating;
+  b.deviation = loser_after.deviation;
+  b.last_played = now;
+  ++b.games;
+
+  m_leaderboard.update(w, a.rating);
+  m_leaderboard.update(l, b.rating);
+  return {Change{winner_before, winner_after, m_leaderboard.rank(w)},
+          Change{loser_before, loser_after, m_leaderboard.rank(l)}};
+}
+
+RatingStore::Standing RatingStore::standing(uint32_t record, std::size_t rank) const {
+  const Record &entry = records()[record];
+  return Standing{rank, std::string(entry.display_name()),
+                  Rating{entry.rating, entry.deviation}, entry.games, entry.wins};
+}
+
+std::optional<RatingStore::Standing> RatingStore::find(std::string_view name) const {
+  if (const auto record = lookup(player_id(name))) {
+    return standing(*record, m_leaderboard.rank(*record));
+  }
+  return std::nullopt;
+}
+
+std::vector<RatingStore::Standing> RatingStore::standings(std::size_t first,
+                                                          std::size_t count) const {
+  const std::vector<uint32_t> records = m_leaderboard.range(first, count);
+  std::vector<Standing> out;
+  out.reserve(records.size());
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    out.push_back(standing(records[i], first + i));
+  }
+  return out;
+}
+
+void RatingStore::flush() {
+  if (::msync(m_records.data, m_records.size, MS_SYNC) != 0 ||
+      ::msync(m_index.data, m_index.size, MS_SYNC) != 0) {
+    throw std::runtime_error(std::format("Cannot flush {}", m_path));
+  }
+}
+
+} // namespace battleship::rating
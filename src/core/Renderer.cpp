@@ -1,25 +1,139 @@
 #include "Renderer.hpp"
+#include "FrameRenderer.hpp"
 #include "Game.hpp"
-#include "StringUtils.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
 #include <format>
 #include <iostream>
+#include <iterator>
+#include <unistd.h>
 
 namespace battleship {
 
+namespace {
+
+constexpr std::size_t BOX_WIDTH = 51;
+constexpr std::size_t BOARD_WIDTH = 23;
+constexpr std::size_t GAP_WIDTH = 7;
+
+// Text assembled at compile time. Builders run twice over the same steps:
+// once with TextSize to learn the length, then into a StaticText of it.
+struct TextSize {
+  std::size_t size{0};
+
+  constexpr void append(std::string_view text, std::size_t times = 1) {
+    size += text.size() * times;
+  }
+};
+
+template <std::size_t N> struct StaticText {
+  std::array<char, N> data{};
+  std::size_t size{0};
+
+  constexpr void append(std::string_view text, std::size_t times = 1) {
+    for (std::size_t i = 0; i < times; ++i) {
+      for (const char c : text) {
+        data[size++] = c;
+      }
+    }
+  }
+
+  constexpr std::string_view view() const { return {data.data(), size}; }
+};
+
+template <typename Build> constexpr std::size_t text_size(Build build) {
+  TextSize size;
+  build(size);
+  return size.size;
+}
+
+template <std::size_t N, typename Build> constexpr StaticText<N> make_text(Build build) {
+  StaticText<N> text;
+  build(text);
+  return text;
+}
+
+constexpr auto build_header = [](auto &text) {
+  constexpr std::string_view title = "BATTLESHIP";
+  constexpr std::size_t left = (BOX_WIDTH - title.size()) / 2;
+  text.append("\u2554");
+  text.append("\u2550", BOX_WIDTH);
+  text.append("\u2557\n\u2551");
+  text.append(" ", left);
+  text.append(title);
+  text.append(" ", BOX_WIDTH - title.size() - left);
+  text.append("\u2551\n\u255A");
+  text.append("\u2550", BOX_WIDTH);
+  text.append("\u255D\n\n");
+};
+
+// "   A B C D E F G H I J" over both boards
+constexpr auto build_column_labels = [](auto &text) {
+  for (std::size_t board = 0; board < 2; ++board) {
+    text.append(board == 0 ? "   " : "          ");
+    for (uint8_t x = 0; x < Board::GRID_SIZE; ++x) {
+      const char label[] = {static_cast<char>('A' + x), ' '};
+      text.append({label, x + 1u < Board::GRID_SIZE ? 2u : 1u});
+    }
+  }
+  text.append("\n");
+};
+
+constexpr auto HEADER = make_text<text_size(build_header)>(build_header);
+constexpr auto COLUMN_LABELS =
+    make_text<text_size(build_column_labels)>(build_column_labels);
+
+// " 1 " ... "10 ", as "{:2} " would print them
+constexpr auto ROW_LABELS = [] {
+  static_assert(Board::GRID_SIZE < 100);
+  std::array<std::array<char, 3>, Board::GRID_SIZE> labels{};
+  for (uint8_t y = 0; y < Board::GRID_SIZE; ++y) {
+    const int row = y + 1;
+    labels[y] = {row < 10 ? ' ' : static_cast<char>('0' + row / 10),
+                 static_cast<char>('0' + row % 10), ' '};
+  }
+  return labels;
+}();
+
+// Same padding as str::center, without the temporary
+void append_centered(std::string &out, std::string_view text, std::size_t width) {
+  const std::size_t padding = text.size() < width ? width - text.size() : 0;
+  out.append(padding / 2, ' ');
+  out += text;
+  out.append(padding - padding / 2, ' ');
+}
+
+void append_row(std::string &out, const Board::DisplayGrid &grid, uint8_t y) {
+  out.append(ROW_LABELS[y].data(), ROW_LABELS[y].size());
+  for (uint8_t x = 0; x < Board::GRID_SIZE; ++x) {
+    out += grid[y][x];
+    out += ' ';
+  }
+}
+
+} // namespace
+
 std::string Renderer::render_header() {
   std::string result;
-  result.reserve(128);
-  result += "\u2554" + str::repeat("\u2550", BOX_WIDTH) + "\u2557\n";
-  result += "\u2551" + str::center("BATTLESHIP", BOX_WIDTH) + "\u2551\n";
-  result += "\u255A" + str::repeat("\u2550", BOX_WIDTH) + "\u255D\n\n";
+  result.reserve(HEADER.size);
+  render_header(result);
   return result;
 }
 
+void Renderer::render_header(std::string &out) { out += HEADER.view(); }
+
 std::string Renderer::render_turn(std::string_view player_name) {
-  return std::format("\u3010 {}'s Turn \u3011\n\n", player_name);
+  std::string result;
+  render_turn(result, player_name);
+  return result;
+}
+
+void Renderer::render_turn(std::string &out, std::string_view player_name) {
+  std::format_to(std::back_inserter(out), "\u3010 {}'s Turn \u3011\n\n", player_name);
 }
 
-std::string Renderer::result_to_string(AttackResult result) {
+std::string_view Renderer::result_to_string(AttackResult result) {
   switch (result) {
   case AttackResult::MISS:
     return "MISS";
@@ -35,39 +149,30 @@ std::string Renderer::result_to_string(AttackResult result) {
   return "Unknown";
 }
 
-std::string Renderer::render_battle_log(const std::vector<TurnInfo> &log,
+std::string Renderer::render_battle_log(std::span<const TurnInfo> log,
                                         std::size_t max_entries) {
+  std::string result;
+  render_battle_log(result, log, max_entries);
+  return result;
+}
+
+void Renderer::render_battle_log(std::string &out, std::span<const TurnInfo> log,
+                                 std::size_t max_entries) {
   if (log.empty()) {
-    return "";
+    return;
   }
 
-  std::string result = "\u3010 BATTLE LOG \u3011\n";
+  out += "\u3010 BATTLE LOG \u3011\n";
   const std::size_t start_idx =
       log.size() > max_entries ? log.size() - max_entries : 0;
 
   for (std::size_t i = start_idx; i < log.size(); ++i) {
     const auto &entry = log[i];
-    result += std::format("  {} attacked {} \u2192 {}\n", entry.attacker_name,
-                          entry.attack_pos.to_string(),
-                          result_to_string(entry.result));
+    std::format_to(std::back_inserter(out), "  {} attacked {}{} \u2192 {}\n",
+                   entry.attacker_name, static_cast<char>('A' + entry.attack_pos.x),
+                   entry.attack_pos.y + 1, result_to_string(entry.result));
   }
-  result += "\n";
-  return result;
-}
-
-std::string Renderer::render_single_board(const Board::DisplayGrid &grid) {
-  std::string result;
-  result.reserve(256);
-  result += "   A B C D E F G H I J\n";
-  for (uint8_t y = 0; y < Board::GRID_SIZE; ++y) {
-    result += std::format("{:2} ", y + 1);
-    for (uint8_t x = 0; x < Board::GRID_SIZE; ++x) {
-      result += grid[y][x];
-      result += ' ';
-    }
-    result += '\n';
-  }
-  return result;
+  out += '\n';
 }
 
 std::string Renderer::render_boards(const Board &left_board,
@@ -76,39 +181,40 @@ std::string Renderer::render_boards(const Board &left_board,
                                     std::string_view right_title,
                                     bool hide_left_ships,
                                     bool hide_right_ships) {
+  return render_boards(left_board.render(hide_left_ships),
+                       right_board.render(hide_right_ships), left_title,
+                       right_title);
+}
+
+std::string Renderer::render_boards(const Board::DisplayGrid &left_grid,
+                                    const Board::DisplayGrid &right_grid,
+                                    std::string_view left_title,
+                                    std::string_view right_title) {
   std::string result;
   result.reserve(512);
+  render_boards(result, left_grid, right_grid, left_title, right_title);
+  return result;
+}
 
+void Renderer::render_boards(std::string &out, const Board::DisplayGrid &left_grid,
+                             const Board::DisplayGrid &right_grid,
+                             std::string_view left_title,
+                             std::string_view right_title) {
   // Titles
-  result += str::center(std::string(left_title), BOARD_WIDTH);
-  result += std::string(GAP_WIDTH, ' ');
-  result += str::center(std::string(right_title), BOARD_WIDTH) + "\n";
+  append_centered(out, left_title, BOARD_WIDTH);
+  out.append(GAP_WIDTH, ' ');
+  append_centered(out, right_title, BOARD_WIDTH);
+  out += '\n';
 
-  // Get rendered grids
-  const auto left_grid = left_board.render(hide_left_ships);
-  const auto right_grid = right_board.render(hide_right_ships);
-
-  // Column headers
-  result += "   A B C D E F G H I J       ";
-  result += "   A B C D E F G H I J\n";
+  out += COLUMN_LABELS.view();
 
   // Rows side by side
   for (uint8_t y = 0; y < Board::GRID_SIZE; ++y) {
-    result += std::format("{:2} ", y + 1);
-    for (uint8_t x = 0; x < Board::GRID_SIZE; ++x) {
-      result += left_grid[y][x];
-      result += ' ';
-    }
-    result += "       ";
-    result += std::format("{:2} ", y + 1);
-    for (uint8_t x = 0; x < Board::GRID_SIZE; ++x) {
-      result += right_grid[y][x];
-      result += ' ';
-    }
-    result += '\n';
+    append_row(out, left_grid, y);
+    out.append(GAP_WIDTH, ' ');
+    append_row(out, right_grid, y);
+    out += '\n';
   }
-
-  return result;
 }
 
 std::string Renderer::render_statistics(const Board &player_board,
@@ -128,19 +234,31 @@ std::string Renderer::render_statistics(const Board::ShipTypeCounts &player_coun
                                         uint8_t opponent_total,
                                         std::string_view player_name,
                                         std::string_view opponent_name) {
-  std::string result = "\n\u3010 STATISTICS \u3011\n";
-  result += std::format("  {}: {} ships (B:{} C:{} D:{} P:{})\n", player_name,
-                        player_total, player_counts.battleships,
-                        player_counts.cruisers, player_counts.destroyers,
-                        player_counts.patrol_boats);
-  result += std::format("  {}: {} ships (B:{} C:{} D:{} P:{})\n", opponent_name,
-                        opponent_total, opponent_counts.battleships,
-                        opponent_counts.cruisers, opponent_counts.destroyers,
-                        opponent_counts.patrol_boats);
-  result += "\n";
+  std::string result;
+  result.reserve(128);
+  render_statistics(result, player_counts, player_total, opponent_counts,
+                    opponent_total, player_name, opponent_name);
   return result;
 }
 
+void Renderer::render_statistics(std::string &out,
+                                 const Board::ShipTypeCounts &player_counts,
+                                 uint8_t player_total,
+                                 const Board::ShipTypeCounts &opponent_counts,
+                                 uint8_t opponent_total, std::string_view player_name,
+                                 std::string_view opponent_name) {
+  out += "\n\u3010 STATISTICS \u3011\n";
+  std::format_to(std::back_inserter(out), "  {}: {} ships (B:{} C:{} D:{} P:{})\n",
+                 player_name, player_total, player_counts.battleships,
+                 player_counts.cruisers, player_counts.destroyers,
+                 player_counts.patrol_boats);
+  std::format_to(std::back_inserter(out), "  {}: {} ships (B:{} C:{} D:{} P:{})\n",
+                 opponent_name, opponent_total, opponent_counts.battleships,
+                 opponent_counts.cruisers, opponent_counts.destroyers,
+                 opponent_counts.patrol_boats);
+  out += '\n';
+}
+
 std::string Renderer::render_game_over(std::string_view winner_name,
                                        std::string_view loser_name,
                                        const Board &winner_board,
@@ -168,19 +286,237 @@ std::string Renderer::render_game_over(std::string_view winner_name,
   return result;
 }
 
+std::string Renderer::render_ratings(std::string_view winner_name,
+                                     std::string_view loser_name,
+                                     const rating::RatingStore::Change &winner,
+                                     const rating::RatingStore::Change &loser,
+                                     std::size_t players) {
+  std::string result = "\u3010 RATINGS \u3011\n";
+  for (const auto &[name, change] : {std::pair{winner_name, &winner},
+                                     std::pair{loser_name, &loser}}) {
+    result += std::format("  {}: {:.0f} \u2192 {:.0f} ({:+.0f}, \u00B1{:.0f}), rank {} of {}\n",
+                          name, change->before.rating, change->after.rating,
+                          change->after.rating - change->before.rating,
+                          change->after.deviation, change->rank, players);
+  }
+  result += "\n";
+  return result;
+}
+
+std::string Renderer::render_leaderboard(
+    std::span<const rating::RatingStore::Standing> standings, std::size_t players) {
+  std::string result = render_header();
+  result += std::format("\u3010 LEADERBOARD \u3011 {} players\n\n", players);
+  if (standings.empty()) {
+    result += "  No rated games yet\n";
+  }
+  for (const auto &standing : standings) {
+    result += std::format("  {:>3}. {:<24} {:>5.0f} \u00B1{:<4.0f} {} games, {} wins\n",
+                          standing.rank, standing.name, standing.rating.rating,
+                          standing.rating.deviation, standing.games, standing.wins);
+  }
+  result += "\n";
+  return result;
+}
+
 std::string Renderer::render_game_start(std::string_view first_player) {
   std::string result = "\n=== BATTLESHIP GAME STARTED ===\n";
   result += std::format("{} goes first!\n", first_player);
   return result;
 }
 
+std::string Renderer::render_snapshot(const GameSnapshot &snapshot) {
+  std::string output;
+  output.reserve(FRAME_CAPACITY);
+  render_snapshot(output, snapshot);
+  return output;
+}
+
+void Renderer::render_snapshot(std::string &out, const GameSnapshot &snapshot) {
+  out.clear();
+  render_header(out);
+  render_turn(out, snapshot.turn_player);
+  render_battle_log(out, {snapshot.log.data(), snapshot.log_size},
+                    GameSnapshot::MAX_LOG);
+  render_boards(out, snapshot.grids[0], snapshot.grids[1], snapshot.titles[0],
+                snapshot.titles[1]);
+  render_statistics(out, snapshot.counts[0], snapshot.ships_left[0],
+                    snapshot.counts[1], snapshot.ships_left[1], snapshot.names[0],
+                    snapshot.names[1]);
+}
+
 std::string Renderer::clear_screen() { return "\033[2J\033[1;1H"; }
 
 // ConsoleRenderer
 void ConsoleRenderer::display(std::string_view content) {
-  std::cout << content;
+  std::cout << content << std::flush;
 }
 
 void ConsoleRenderer::clear() { std::cout << "\033[2J\033[1;1H"; }
 
+void ConsoleRenderer::write(std::string_view content) {
+  std::cout.flush();
+  while (!content.empty()) {
+    const ssize_t written = ::write(STDOUT_FILENO, content.data(), content.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    content.remove_prefix(static_cast<std::size_t>(written));
+  }
+}
+
+// ============================================================================
+// DiffRenderer
+// ============================================================================
+
+namespace {
+
+// East Asian wide ranges that turn up in text: CJK, Hangul, fullwidth
+// forms and emoji. The brackets around section titles are among them.
+bool is_wide(uint32_t code) noexcept {
+  return (code >= 0x1100 && code <= 0x115F) || (code >= 0x2E80 && code <= 0xA4CF) ||
+         (code >= 0xAC00 && code <= 0xD7A3) || (code >= 0xF900 && code <= 0xFAFF) ||
+         (code >= 0xFE30 && code <= 0xFE4F) || (code >= 0xFF00 && code <= 0xFF60) ||
+         (code >= 0xFFE0 && code <= 0xFFE6) || (code >= 0x1F300 && code <= 0x1F64F) ||
+         (code >= 0x1F900 && code <= 0x1F9FF) || (code >= 0x20000 && code <= 0x3FFFD);
+}
+
+} // namespace
+
+void DiffRenderer::draw(std::string_view frame) {
+  const std::string_view out = diff(frame);
+  if (!out.empty()) {
+    ConsoleRenderer::write(out);
+    m_bytes_written += out.size();
+  }
+}
+
+std::string_view DiffRenderer::diff(std::string_view frame) {
+  m_out.clear();
+  parse(frame);
+
+  if (!m_valid) {
+    m_out += "\033[2J\033[1;1H";
+    m_out += frame;
+    m_row = m_end_row;
+    m_col = m_end_col;
+    m_valid = true;
+  } else {
+    const std::size_t rows = std::max(m_screen_rows, m_next_rows);
+    for (std::size_t row = 0; row < rows; ++row) {
+      diff_row(row,
+               row < m_screen_rows ? std::span<const Cell>(m_screen[row])
+                                   : std::span<const Cell>(),
+               row < m_next_rows ? std::span<const Cell>(m_next[row])
+                                 : std::span<const Cell>());
+    }
+    move_to(m_end_row, m_end_col);
+  }
+
+  std::swap(m_screen, m_next);
+  m_screen_rows = m_next_rows;
+  return m_out;
+}
+
+void DiffRenderer::parse(std::string_view frame) {
+  m_next_rows = 0;
+  const auto next_row = [this]() -> std::vector<Cell> & {
+    if (m_next.size() == m_next_rows) {
+      m_next.emplace_back();
+    }
+    auto &row = m_next[m_next_rows++];
+    row.clear();
+    return row;
+  };
+
+  std::vector<Cell> *row = &next_row();
+  for (std::size_t i = 0; i < frame.size();) {
+    const auto lead = static_cast<uint8_t>(frame[i]);
+    if (lead == '\n') {
+      row = &next_row();
+      ++i;
+      continue;
+    }
+
+    const std::size_t length = std::min<std::size_t>(
+        lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4, frame.size() - i);
+    Cell cell = 0;
+    uint32_t code = length == 1 ? lead : lead & (0x3F >> (length - 1));
+    for (std::size_t k = 0; k < length; ++k) {
+      const auto byte = static_cast<uint8_t>(frame[i + k]);
+      cell |= static_cast<Cell>(byte) << (8 * k);
+      if (k > 0) {
+        code = (code << 6) | (byte & 0x3F);
+      }
+    }
+    i += length;
+
+    row->push_back(cell);
+    if (length > 2 && is_wide(code)) {
+      row->push_back(WIDE_TAIL);
+    }
+  }
+
+  // A frame ending in a newline leaves the cursor on the empty row after it
+  m_end_row = m_next_rows - 1;
+  m_end_col = row->size();
+}
+
+void DiffRenderer::diff_row(std::size_t row, std::span<const Cell> before,
+                            std::span<const Cell> after) {
+  const auto same = [&](std::size_t col) {
+    return col < before.size() && before[col] == after[col];
+  };
+
+  std::size_t col = 0;
+  while (col < after.size()) {
+    if (same(col)) {
+      ++col;
+      continue;
+    }
+
+    // A run of changes, taking in short stretches of unchanged cells
+    const std::size_t first = after[col] == WIDE_TAIL ? col - 1 : col;
+    std::size_t last = col + 1;
+    for (std::size_t k = last, unchanged = 0; k < after.size() && unchanged <= MERGE_GAP;
+         ++k) {
+      if (same(k)) {
+        ++unchanged;
+      } else {
+        last = k + 1;
+        unchanged = 0;
+      }
+    }
+    while (last < after.size() && after[last] == WIDE_TAIL) {
+      ++last;
+    }
+
+    move_to(row, first);
+    for (std::size_t k = first; k < last; ++k) {
+      for (Cell cell = after[k]; cell != 0; cell >>= 8) {
+        m_out += static_cast<char>(cell & 0xFF);
+      }
+    }
+    m_col = last;
+    col = last;
+  }
+
+  if (before.size() > after.size()) {
+    move_to(row, after.size());
+    m_out += "\033[K";
+  }
+}
+
+void DiffRenderer::move_to(std::size_t row, std::size_t col) {
+  if (row == m_row && col == m_col) {
+    return;
+  }
+  std::format_to(std::back_inserter(m_out), "\033[{};{}H", row + 1, col + 1);
+  m_row = row;
+  m_col = col;
+}
+
 } // namespace battleship
@@ -0,0 +1,208 @@
+#include "Replay.hpp"
+#include "Player.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <unistd.h>
+
+namespace battleship::replay {
+
+namespace {
+
+void put_u16(uint8_t *out, uint16_t value) noexcept {
+  out[0] = static_cast<uint8_t>(value & 0xFF);
+  out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void put_u64(uint8_t *out, uint64_t value) noexcept {
+  for (std::size_t i = 0; i < 8; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+void encode_fleet(uint8_t *out, const Board &board) {
+  const auto &ships = board.ships();
+  if (ships.size() != config::TOTAL_SHIPS) {
+    throw std::invalid_argument("Replay requires a fully placed fleet");
+  }
+  for (std::size_t i = 0; i < ships.size(); ++i) {
+    const auto positions = ships[i]->positions();
+    uint8_t byte = encode_cell(positions.front());
+    if (ships[i]->orientation() == Orientation::VERTICAL) {
+      byte |= VERTICAL_FLAG;
+    }
+    out[i] = byte;
+  }
+}
+
+} // namespace
+
+uint64_t concatenate(std::span<const std::string> inputs,
+                     const std::string &output) {
+  Writer writer(output);
+  for (const auto &path : inputs) {
+    const Reader reader(path);
+    reader.for_each_game(
+        [&writer](const GameView &game) { writer.append_record(game.bytes()); });
+  }
+  writer.close();
+  return writer.games_written();
+}
+
+uint8_t strategy_code(const Player &player) noexcept {
+  return player.type() == PlayerType::HUMAN
+             ? HUMAN
+             : static_cast<uint8_t>(player.difficulty());
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+Writer::Writer(const std::string &path)
+    : m_block(std::make_unique<uint8_t[]>(BLOCK_SIZE)) {
+  m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (m_fd < 0) {
+    throw std::runtime_error(std::format("Cannot create replay {}", path));
+  }
+
+  std::array<uint8_t, FILE_HEADER_SIZE> header{};
+  std::memcpy(header.data(), MAGIC.data(), MAGIC.size());
+  put_u16(header.data() + 8, VERSION);
+  put_u64(header.data() + 16, BLOCK_SIZE);
+  write_all(header.data(), header.size());
+}
+
+Writer::~Writer() {
+  try {
+    close();
+  } catch (...) {
+    // Destructor must not throw; explicit close() reports errors
+  }
+}
+
+void Writer::begin_game(uint64_t seed, uint8_t first_strategy,
+                        uint8_t second_strategy, const Board &first_board,
+                        const Board &second_board) {
+  uint8_t *rec = m_record.data();
+  put_u64(rec + 2, seed);
+  rec[10] = static_cast<uint8_t>((first_strategy & 0x0F) |
+                                 ((second_strategy & 0x0F) << 4));
+  rec[11] = 0;
+  encode_fleet(rec + 12, first_board);
+  encode_fleet(rec + 12 + config::TOTAL_SHIPS, second_board);
+  m_record_used = RECORD_HEADER_SIZE;
+}
+
+void Writer::record_shot(std::size_t shooter, const Position &pos,
+                         AttackResult result) noexcept {
+  if (m_record_used + SHOT_SIZE > m_record.size()) {
+    return;
+  }
+  uint8_t flags = static_cast<uint8_t>(result);
+  if (shooter != 0) {
+    flags |= SECOND_PLAYER_FLAG;
+  }
+  m_record[m_record_used] = encode_cell(pos);
+  m_record[m_record_used + 1] = flags;
+  m_record_used += SHOT_SIZE;
+}
+
+void Writer::end_game(std::size_t winner) {
+  m_record[11] = static_cast<uint8_t>(winner);
+  put_u16(m_record.data(), static_cast<uint16_t>(m_record_used));
+  append_record({m_record.data(), m_record_used});
+  m_record_used = 0;
+}
+
+void Writer::append_record(std::span<const uint8_t> record) {
+  if (m_fd < 0) {
+    throw std::runtime_error("Replay writer is closed");
+  }
+  if (record.size() < RECORD_HEADER_SIZE || record.size() > MAX_RECORD_SIZE) {
+    throw std::invalid_argument("Invalid replay record size");
+  }
+
+  if (BLOCK_SIZE - m_block_used < record.size()) {
+    // Zero padding marks the end of the block
+    std::fill(m_block.get() + m_block_used, m_block.get() + BLOCK_SIZE, 0);
+    flush_block(BLOCK_SIZE);
+  }
+
+  std::memcpy(m_block.get() + m_block_used, record.data(), record.size());
+  m_block_used += record.size();
+  ++m_games;
+}
+
+void Writer::flush() {
+  if (m_fd < 0) {
+    throw std::runtime_error("Replay writer is closed");
+  }
+  // The file ends in a short block for now; the rest of it follows later
+  write_all(m_block.get() + m_block_flushed, m_block_used - m_block_flushed);
+  m_block_flushed = m_block_used;
+}
+
+void Writer::close() {
+  if (m_fd < 0) {
+    return;
+  }
+  if (m_block_used > 0) {
+    flush_block(m_block_used);
+  }
+  ::close(m_fd);
+  m_fd = -1;
+}
+
+void Writer::flush_block(std::size_t length) {
+  write_all(m_block.get() + m_block_flushed, length - m_block_flushed);
+  m_block_used = 0;
+  m_block_flushed = 0;
+}
+
+void Writer::write_all(const uint8_t *data, std::size_t length) {
+  while (length > 0) {
+    const ssize_t written = ::write(m_fd, data, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(
+          std::format("Replay write failed: {}", std::strerror(errno)));
+    }
+    data += written;
+    length -= static_cast<std::size_t>(written);
+  }
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+Reader::Reader(const std::string &path) : m_file(path) {
+  const auto bytes = m_file.bytes();
+  if (bytes.size() < FILE_HEADER_SIZE ||
+      !std::equal(MAGIC.begin(), MAGIC.end(), bytes.begin())) {
+    throw std::runtime_error(std::format("{} is not a replay file", path));
+  }
+
+  const uint16_t version =
+      static_cast<uint16_t>(bytes[8] | (static_cast<uint16_t>(bytes[9]) << 8));
+  if (version != VERSION) {
+    throw std::runtime_error(
+        std::format("{}: unsupported replay version {}", path, version));
+  }
+
+  uint64_t block_size = 0;
+  for (std::size_t i = 0; i < 8; ++i) {
+    block_size |= static_cast<uint64_t>(bytes[16 + i]) << (8 * i);
+  }
+  if (block_size != BLOCK_SIZE) {
+    throw std::runtime_error(
+        std::format("{}: unsupported block size {}", path, block_size));
+  }
+}
+
+} // namespace battleship::replay
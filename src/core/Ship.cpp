@@ -14,6 +14,9 @@ void Ship::validate_and_build_positions(const Position &start_pos) {
   }
 
   const auto ship_size = size();
+  if (ship_size < 1 || ship_size > m_positions.size()) {
+    throw std::invalid_argument("Invalid ship type");
+  }
 
   // Check boundaries
   if (m_orientation == Orientation::HORIZONTAL) {
@@ -0,0 +1,307 @@
+#include "Simulation.hpp"
+#include "Player.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace battleship::sim {
+
+namespace {
+
+constexpr std::array<char, 8> STATS_MAGIC = {'B', 'S', 'S', 'T',
+                                             'A', 'T', 'S', '2'};
+constexpr std::size_t STATS_HEADER_SIZE = 40;
+
+void put_le(std::string &out, uint64_t value, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    out += static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint64_t get_le(std::string_view data, std::size_t offset, std::size_t bytes) {
+  uint64_t value = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(data[offset + i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+bool same_run(const ShardHeader &a, const ShardHeader &b) noexcept {
+  return a.match.first == b.match.first && a.match.second == b.match.second &&
+         a.master_seed == b.master_seed && a.total_games == b.total_games &&
+         a.shard.count == b.shard.count;
+}
+
+} // namespace
+
+MatchResult play_match(const MatchConfig &match, uint64_t seed,
+                       stats::SimStats *stats, replay::Writer *replay) {
+  const uint64_t mixed = mix64(seed);
+  std::array<Player, 2> players{
+      Player("Computer 1", PlayerType::AI, match.first,
+             static_cast<uint32_t>(mixed)),
+      Player("Computer 2", PlayerType::AI, match.second,
+             static_cast<uint32_t>(mixed >> 32))};
+
+  for (auto &player : players) {
+    player.auto_place_ships();
+    player.set_state(PlayerState::ACTIVE);
+  }
+
+  if (replay) {
+    replay->begin_game(seed, replay::strategy_code(players[0]),
+                       replay::strategy_code(players[1]), players[0].board(),
+                       players[1].board());
+  }
+
+  std::array<std::optional<stats::GameTracker>, 2> trackers;
+  if (stats) {
+    trackers[0].emplace(stats->strategy(match.first));
+    trackers[1].emplace(stats->strategy(match.second));
+  }
+
+  MatchResult result;
+  std::size_t current = 0;
+
+  while (true) {
+    Player &attacker = players[current];
+    Player &defender = players[1 - current];
+
+    const bool targeting = attacker.is_targeting();
+    const Position pos = attacker.get_attack();
+    const AttackResult outcome = defender.receive_attack(pos);
+    attacker.record_attack_result(pos, outcome);
+
+    const bool hit =
+        outcome == AttackResult::HIT || outcome == AttackResult::SUNK;
+    ++result.shots[current];
+    if (replay) {
+      replay->record_shot(current, pos, outcome);
+    }
+    if (trackers[current]) {
+      trackers[current]->record_shot(
+          static_cast<std::size_t>(pos.y) * config::GRID_SIZE + pos.x, hit,
+          targeting);
+    }
+
+    if (defender.has_lost()) {
+      result.winner = current;
+      break;
+    }
+    if (!hit) {
+      current = 1 - current;
+    }
+  }
+
+  for (std::size_t i = 0; i < trackers.size(); ++i) {
+    if (trackers[i]) {
+      trackers[i]->finish(i == result.winner);
+    }
+  }
+  if (stats) {
+    // A mirrored matchup is still one game for its strategy
+    ++stats->strategy(match.first).games;
+    if (match.second != match.first) {
+      ++stats->strategy(match.second).games;
+    }
+  }
+  if (replay) {
+    replay->end_game(result.winner);
+  }
+
+  return result;
+}
+
+stats::SimStats run_games(const MatchConfig &match, uint64_t master_seed,
+                          uint64_t first_game, uint64_t game_count,
+                          replay::Writer *replay) {
+  stats::SimStats stats;
+  for (uint64_t i = 0; i < game_count; ++i) {
+    play_match(match, game_seed(master_seed, first_game + i), &stats, replay);
+  }
+  return stats;
+}
+
+stats::SimStats run_parallel(const MatchConfig &match, uint64_t master_seed,
+                             uint64_t first_game, uint64_t game_count,
+                             unsigned threads,
+                             const std::string &replay_path) {
+  threads = std::max(1u, threads);
+  if (threads == 1 || game_count < threads) {
+    std::optional<replay::Writer> writer;
+    if (!replay_path.empty()) {
+      writer.emplace(replay_path);
+    }
+    auto stats = run_games(match, master_seed, first_game, game_count,
+                           writer ? &*writer : nullptr);
+    if (writer) {
+      writer->close();
+    }
+    return stats;
+  }
+
+  std::vector<stats::SimStats> partials(threads);
+  std::vector<std::string> part_paths;
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+
+  if (!replay_path.empty()) {
+    for (unsigned t = 0; t < threads; ++t) {
+      part_paths.push_back(std::format("{}.part{}", replay_path, t));
+    }
+  }
+
+  for (unsigned t = 0; t < threads; ++t) {
+    const uint64_t begin = game_count * t / threads;
+    const uint64_t end = game_count * (t + 1) / threads;
+    workers.emplace_back([&, t, begin, end] {
+      try {
+        std::optional<replay::Writer> writer;
+        if (!part_paths.empty()) {
+          writer.emplace(part_paths[t]);
+        }
+        partials[t] = run_games(match, master_seed, first_game + begin,
+                                end - begin, writer ? &*writer : nullptr);
+        if (writer) {
+          writer->close();
+        }
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+
+  stats::SimStats total;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers[t].join();
+    total.merge(partials[t]);
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  if (!part_paths.empty()) {
+    replay::concatenate(part_paths, replay_path);
+    for (const auto &part : part_paths) {
+      std::remove(part.c_str());
+    }
+  }
+  return total;
+}
+
+void write_shard_stats(const std::string &path, const ShardHeader &header,
+                       const stats::SimStats &stats) {
+  std::string data(STATS_MAGIC.begin(), STATS_MAGIC.end());
+  put_le(data, header.master_seed, 8);
+  put_le(data, header.total_games, 8);
+  put_le(data, header.shard.index, 4);
+  put_le(data, header.shard.count, 4);
+  put_le(data, static_cast<uint8_t>(header.match.first), 1);
+  put_le(data, static_cast<uint8_t>(header.match.second), 1);
+  data.resize(STATS_HEADER_SIZE, '\0');
+  data += stats.serialize();
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+  if (!out) {
+    throw std::runtime_error(std::format("Cannot write {}", path));
+  }
+}
+
+std::pair<ShardHeader, stats::SimStats>
+read_shard_stats(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error(std::format("Cannot open {}", path));
+  }
+  const std::string data((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+
+  if (data.size() < STATS_HEADER_SIZE ||
+      std::memcmp(data.data(), STATS_MAGIC.data(), STATS_MAGIC.size()) != 0) {
+    throw std::runtime_error(std::format("{} is not a shard stats file", path));
+  }
+
+  ShardHeader header;
+  header.master_seed = get_le(data, 8, 8);
+  header.total_games = get_le(data, 16, 8);
+  header.shard.index = static_cast<uint32_t>(get_le(data, 24, 4));
+  header.shard.count = static_cast<uint32_t>(get_le(data, 28, 4));
+  header.match.first = static_cast<config::Difficulty>(get_le(data, 32, 1));
+  header.match.second = static_cast<config::Difficulty>(get_le(data, 33, 1));
+
+  if (header.shard.count == 0 || header.shard.index >= header.shard.count) {
+    throw std::runtime_error(std::format("{}: invalid shard numbering", path));
+  }
+
+  return {header, stats::SimStats::deserialize(
+                      std::string_view(data).substr(STATS_HEADER_SIZE))};
+}
+
+ShardHeader merge_shards(std::span<const std::string> prefixes,
+                         const std::string &out_prefix) {
+  if (prefixes.empty()) {
+    throw std::invalid_argument("No shards to merge");
+  }
+
+  std::vector<std::pair<ShardHeader, std::string>> shards;
+  stats::SimStats merged;
+
+  for (const auto &prefix : prefixes) {
+    auto [header, shard_stats] =
+        read_shard_stats(prefix + std::string(STATS_EXTENSION));
+    if (!shards.empty() && !same_run(shards.front().first, header)) {
+      throw std::runtime_error(
+          std::format("{} belongs to a different run", prefix));
+    }
+    merged.merge(shard_stats);
+    shards.emplace_back(header, prefix);
+  }
+
+  const ShardHeader &first = shards.front().first;
+  if (shards.size() != first.shard.count) {
+    throw std::runtime_error(std::format("Expected {} shards, got {}",
+                                         first.shard.count, shards.size()));
+  }
+
+  std::ranges::sort(shards, {}, [](const auto &s) { return s.first.shard.index; });
+  for (std::size_t i = 0; i < shards.size(); ++i) {
+    if (shards[i].first.shard.index != i) {
+      throw std::runtime_error(std::format("Shard {} is missing", i));
+    }
+  }
+
+  ShardHeader result = first;
+  result.shard = ShardSpec{};
+  write_shard_stats(out_prefix + std::string(STATS_EXTENSION), result, merged);
+
+  std::vector<std::string> replays;
+  for (const auto &[header, prefix] : shards) {
+    auto path = prefix + std::string(REPLAY_EXTENSION);
+    if (std::filesystem::exists(path)) {
+      replays.push_back(std::move(path));
+    }
+  }
+  if (!replays.empty()) {
+    if (replays.size() != shards.size()) {
+      throw std::runtime_error("Some shards have no replay file");
+    }
+    replay::concatenate(replays, out_prefix + std::string(REPLAY_EXTENSION));
+  }
+
+  return result;
+}
+
+} // namespace battleship::sim
@@ -0,0 +1,184 @@
+#include "Spectator.hpp"
+#include "Game.hpp"
+#include "Renderer.hpp"
+#include <format>
+#include <iterator>
+
+namespace battleship {
+
+namespace {
+
+uint8_t total(const Board::ShipTypeCounts &counts) noexcept {
+  return counts.battleships + counts.cruisers + counts.destroyers +
+         counts.patrol_boats;
+}
+
+} // namespace
+
+Spectator::Spectator(net::NetworkManager &network) : m_network(network) {}
+
+void Spectator::run() {
+  while (true) {
+    const auto msg = m_network.receive();
+    if (!msg) {
+      ConsoleRenderer::display(m_match ? "Connection to the server lost\n"
+                                       : "No match to watch on this server\n");
+      return;
+    }
+
+    bool valid = true;
+    switch (msg->type) {
+    case net::MessageType::MATCH_VIEW: {
+      const auto view = net::protocol::decode_match_view(msg->payload);
+      valid = view && apply_view(*view);
+      break;
+    }
+    case net::MessageType::SHOT: {
+      const auto shot = net::protocol::decode_shot(msg->payload);
+      valid = m_match && shot && apply_shot(*shot);
+      break;
+    }
+    case net::MessageType::GAME_OVER: {
+      const auto summary = net::protocol::decode_game_over(msg->payload);
+      if (!summary) {
+        valid = false;
+        break;
+      }
+      show_game_over(*summary);
+      m_network.disconnect();
+      return;
+    }
+    default:
+      continue;
+    }
+
+    if (!valid) {
+      ConsoleRenderer::display("Invalid match data from server\n");
+      m_network.disconnect();
+      return;
+    }
+    display_state();
+  }
+}
+
+// Starts over from the view; the battle log restarts with the next shot
+bool Spectator::apply_view(const net::protocol::MatchView &view) {
+  if (m_match && *m_match == view.match && view.cursor > m_cursor) {
+    m_skipped += view.cursor - m_cursor;
+  }
+  m_match = view.match;
+  m_turn = view.turn;
+  m_cursor = view.cursor;
+  m_battle_log.clear();
+
+  for (std::size_t side = 0; side < m_boards.size(); ++side) {
+    m_boards[side].clear();
+    m_afloat[side] = Board::ShipTypeCounts{1, 2, 3, 4};
+  }
+
+  for (std::size_t shooter = 0; shooter < view.sides.size(); ++shooter) {
+    const auto &seen = view.sides[shooter];
+    Board &target = m_boards[1 - shooter];
+    for (std::size_t cell = 0; cell < seen.shots.size(); ++cell) {
+      if (seen.shots[cell]) {
+        const Position pos(static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                           static_cast<config::GridCoord>(cell / config::GRID_SIZE));
+        target.mark_attack(pos, seen.hits[cell] ? AttackResult::HIT : AttackResult::MISS);
+      }
+    }
+    for (const auto &ship : seen.sunk) {
+      record_sunk(1 - shooter, ship);
+    }
+  }
+  return true;
+}
+
+bool Spectator::apply_shot(const net::protocol::ShotEvent &shot) {
+  if (shot.result != AttackResult::MISS && shot.result != AttackResult::HIT &&
+      shot.result != AttackResult::SUNK) {
+    return false;
+  }
+
+  const std::size_t defender = 1 - shot.shooter;
+  m_boards[defender].mark_attack(shot.target, shot.result);
+  if (shot.sunk) {
+    record_sunk(defender, *shot.sunk);
+  }
+
+  m_battle_log.emplace_back(TurnInfo{shot.target, shot.result, NAMES[shot.shooter]});
+  m_turn = shot.result == AttackResult::MISS ? static_cast<uint8_t>(defender)
+                                             : shot.shooter;
+  ++m_cursor;
+  return true;
+}
+
+void Spectator::record_sunk(std::size_t side,
+                            const net::protocol::ShipPlacement &ship) {
+  m_boards[side].mark_sunk_ship(ship.cells());
+
+  Board::ShipTypeCounts &afloat = m_afloat[side];
+  uint8_t *count = nullptr;
+  switch (ship.type) {
+  case config::ShipType::BATTLESHIP:
+    count = &afloat.battleships;
+    break;
+  case config::ShipType::CRUISER:
+    count = &afloat.cruisers;
+    break;
+  case config::ShipType::DESTROYER:
+    count = &afloat.destroyers;
+    break;
+  case config::ShipType::PATROL_BOAT:
+    count = &afloat.patrol_boats;
+    break;
+  }
+  if (count && *count > 0) {
+    --*count;
+  }
+}
+
+// The summary is the first player's, so WIN and OPPONENT_LEFT mean side 0 won
+void Spectator::show_game_over(const net::protocol::GameSummary &summary) const {
+  using net::protocol::Outcome;
+  const std::size_t winner =
+      summary.outcome == Outcome::WIN || summary.outcome == Outcome::OPPONENT_LEFT ? 0 : 1;
+  const std::size_t loser = 1 - winner;
+
+  const auto accuracy = [&summary](std::size_t side) {
+    return summary.shots[side] > 0
+               ? static_cast<float>(summary.hits[side]) / summary.shots[side]
+               : 0.0f;
+  };
+
+  ConsoleRenderer::clear();
+  ConsoleRenderer::display(Renderer::render_game_over(
+      NAMES[winner], NAMES[loser], m_boards[winner], m_boards[loser],
+      summary.shots[winner], accuracy(winner), summary.shots[loser],
+      accuracy(loser)));
+  if (summary.outcome == Outcome::OPPONENT_LEFT || summary.outcome == Outcome::LEFT) {
+    ConsoleRenderer::display(std::format("{} left the match\n", NAMES[loser]));
+  }
+}
+
+void Spectator::display_state() {
+  std::string &output = m_frame;
+  output.clear();
+
+  Renderer::render_header(output);
+  Renderer::render_turn(output, NAMES[m_turn]);
+  Renderer::render_battle_log(output, m_battle_log, MAX_BATTLE_LOG);
+  Renderer::render_boards(output, m_boards[0].render(true), m_boards[1].render(true),
+                          "PLAYER 1", "PLAYER 2");
+  Renderer::render_statistics(output, m_afloat[0], total(m_afloat[0]), m_afloat[1],
+                              total(m_afloat[1]), NAMES[0], NAMES[1]);
+  std::format_to(std::back_inserter(output), "  Watching match #{}, {} shots",
+                 *m_match, m_cursor);
+  if (m_skipped > 0) {
+    std::format_to(std::back_inserter(output), " ({} skipped to catch up)", m_skipped);
+  }
+  output += '\n';
+
+  m_screen.draw(output);
+}
+
+} // namespace battleship
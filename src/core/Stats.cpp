@@ -0,0 +1,324 @@
+#include "Stats.hpp"
+#include "Position.hpp"
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+namespace battleship::stats {
+
+namespace {
+
+constexpr std::array<config::Difficulty, STRATEGY_COUNT> ALL_STRATEGIES = {
+    config::Difficulty::EASY, config::Difficulty::MEDIUM,
+    config::Difficulty::HARD};
+
+constexpr std::array<double, 3> REPORTED_PERCENTILES = {50.0, 90.0, 99.0};
+
+double ratio(uint64_t num, uint64_t den) noexcept {
+  return den == 0 ? 0.0 : static_cast<double>(num) / static_cast<double>(den);
+}
+
+std::string cell_name(std::size_t cell) {
+  return Position{static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                  static_cast<config::GridCoord>(cell / config::GRID_SIZE)}
+      .to_string();
+}
+
+} // namespace
+
+std::string_view strategy_name(config::Difficulty difficulty) noexcept {
+  switch (difficulty) {
+  case config::Difficulty::EASY:
+    return "easy";
+  case config::Difficulty::MEDIUM:
+    return "medium";
+  case config::Difficulty::HARD:
+    return "hard";
+  }
+  return "unknown";
+}
+
+// ============================================================================
+// ShotHistogram
+// ============================================================================
+
+void ShotHistogram::add(std::size_t shots) noexcept {
+  ++m_bins[std::min(shots, MAX_SHOTS)];
+  ++m_count;
+  m_sum += shots;
+}
+
+void ShotHistogram::merge(const ShotHistogram &other) noexcept {
+  for (std::size_t i = 0; i < m_bins.size(); ++i) {
+    m_bins[i] += other.m_bins[i];
+  }
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+}
+
+double ShotHistogram::mean() const noexcept { return ratio(m_sum, m_count); }
+
+std::size_t ShotHistogram::min() const noexcept {
+  const auto it = std::ranges::find_if(m_bins, [](uint64_t n) { return n > 0; });
+  return it == m_bins.end() ? 0 : static_cast<std::size_t>(it - m_bins.begin());
+}
+
+std::size_t ShotHistogram::max() const noexcept {
+  for (std::size_t i = m_bins.size(); i > 0; --i) {
+    if (m_bins[i - 1] > 0) {
+      return i - 1;
+    }
+  }
+  return 0;
+}
+
+std::size_t ShotHistogram::percentile(double p) const noexcept {
+  if (m_count == 0) {
+    return 0;
+  }
+
+  // Rank of the target sample, 1-based (nearest-rank method)
+  const double clamped = std::clamp(p, 0.0, 100.0);
+  auto rank = static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(m_count) + 0.5);
+  rank = std::clamp<uint64_t>(rank, 1, m_count);
+
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < m_bins.size(); ++i) {
+    seen += m_bins[i];
+    if (seen >= rank) {
+      return i;
+    }
+  }
+  return MAX_SHOTS;
+}
+
+// ============================================================================
+// StrategyStats
+// ============================================================================
+
+void StrategyStats::merge(const StrategyStats &other) noexcept {
+  games += other.games;
+  seats += other.seats;
+  wins += other.wins;
+  shots_to_win.merge(other.shots_to_win);
+
+  for (std::size_t i = 0; i < MAX_SHOTS; ++i) {
+    shots_by_turn[i] += other.shots_by_turn[i];
+    hits_by_turn[i] += other.hits_by_turn[i];
+  }
+  for (std::size_t i = 0; i < CELL_COUNT; ++i) {
+    first_hits[i] += other.first_hits[i];
+  }
+
+  hunt_shots += other.hunt_shots;
+  target_shots += other.target_shots;
+}
+
+double StrategyStats::hit_rate(std::size_t turn) const noexcept {
+  if (turn >= MAX_SHOTS) {
+    return 0.0;
+  }
+  return ratio(hits_by_turn[turn], shots_by_turn[turn]);
+}
+
+double StrategyStats::avg_hunt_shots() const noexcept {
+  return ratio(hunt_shots, seats);
+}
+
+double StrategyStats::avg_target_shots() const noexcept {
+  return ratio(target_shots, seats);
+}
+
+// ============================================================================
+// SimStats
+// ============================================================================
+
+void SimStats::merge(const SimStats &other) noexcept {
+  for (std::size_t i = 0; i < STRATEGY_COUNT; ++i) {
+    m_strategies[i].merge(other.m_strategies[i]);
+  }
+}
+
+uint64_t SimStats::total_games() const noexcept {
+  // Every game has exactly one winner
+  uint64_t total = 0;
+  for (const auto &s : m_strategies) {
+    total += s.wins;
+  }
+  return total;
+}
+
+std::string SimStats::to_csv() const {
+  std::string out = "strategy,metric,key,value\n";
+
+  for (const auto difficulty : ALL_STRATEGIES) {
+    const auto &s = strategy(difficulty);
+    if (s.games == 0) {
+      continue;
+    }
+    const auto name = strategy_name(difficulty);
+
+    out += std::format("{},games,,{}\n", name, s.games);
+    out += std::format("{},seats,,{}\n", name, s.seats);
+    out += std::format("{},wins,,{}\n", name, s.wins);
+    out += std::format("{},shots_to_win_mean,,{:.3f}\n", name,
+                       s.shots_to_win.mean());
+    for (const double p : REPORTED_PERCENTILES) {
+      out += std::format("{},shots_to_win_p,{},{}\n", name, p,
+                         s.shots_to_win.percentile(p));
+    }
+    out += std::format("{},avg_hunt_shots,,{:.3f}\n", name, s.avg_hunt_shots());
+    out += std::format("{},avg_target_shots,,{:.3f}\n", name,
+                       s.avg_target_shots());
+
+    const auto &bins = s.shots_to_win.bins();
+    for (std::size_t i = 0; i < bins.size(); ++i) {
+      if (bins[i] > 0) {
+        out += std::format("{},shots_to_win,{},{}\n", name, i, bins[i]);
+      }
+    }
+    for (std::size_t turn = 0; turn < MAX_SHOTS; ++turn) {
+      if (s.shots_by_turn[turn] > 0) {
+        out += std::format("{},hit_rate,{},{:.4f}\n", name, turn + 1,
+                           s.hit_rate(turn));
+      }
+    }
+    for (std::size_t cell = 0; cell < CELL_COUNT; ++cell) {
+      if (s.first_hits[cell] > 0) {
+        out += std::format("{},first_hit,{},{}\n", name, cell_name(cell),
+                           s.first_hits[cell]);
+      }
+    }
+  }
+
+  return out;
+}
+
+std::string SimStats::to_json() const {
+  std::string out = "{\"strategies\":[";
+  bool first_strategy = true;
+
+  for (const auto difficulty : ALL_STRATEGIES) {
+    const auto &s = strategy(difficulty);
+    if (s.games == 0) {
+      continue;
+    }
+    if (!first_strategy) {
+      out += ',';
+    }
+    first_strategy = false;
+
+    out += std::format("{{\"name\":\"{}\",\"games\":{},\"seats\":{},\"wins\":{},",
+                       strategy_name(difficulty), s.games, s.seats, s.wins);
+    out += std::format("\"avg_hunt_shots\":{:.3f},\"avg_target_shots\":{:.3f},",
+                       s.avg_hunt_shots(), s.avg_target_shots());
+
+    out += std::format("\"shots_to_win\":{{\"mean\":{:.3f}",
+                       s.shots_to_win.mean());
+    for (const double p : REPORTED_PERCENTILES) {
+      out += std::format(",\"p{}\":{}", p, s.shots_to_win.percentile(p));
+    }
+    out += ",\"bins\":{";
+    const auto &bins = s.shots_to_win.bins();
+    bool first_bin = true;
+    for (std::size_t i = 0; i < bins.size(); ++i) {
+      if (bins[i] == 0) {
+        continue;
+      }
+      out += std::format("{}\"{}\":{}", first_bin ? "" : ",", i, bins[i]);
+      first_bin = false;
+    }
+    out += "}},";
+
+    // Trailing turns nobody reached are trimmed
+    std::size_t last_turn = MAX_SHOTS;
+    while (last_turn > 0 && s.shots_by_turn[last_turn - 1] == 0) {
+      --last_turn;
+    }
+    out += "\"hit_rate\":[";
+    for (std::size_t turn = 0; turn < last_turn; ++turn) {
+      out += std::format("{}{:.4f}", turn == 0 ? "" : ",", s.hit_rate(turn));
+    }
+    out += "],\"first_hits\":[";
+    for (std::size_t cell = 0; cell < CELL_COUNT; ++cell) {
+      out += std::format("{}{}", cell == 0 ? "" : ",", s.first_hits[cell]);
+    }
+    out += "]}";
+  }
+
+  out += "]}\n";
+  return out;
+}
+
+std::string SimStats::serialize() const {
+  std::string out;
+  out.reserve(sizeof(SimStats));
+  for (const auto &s : m_strategies) {
+    StrategyStats::visit(s, [&out](uint64_t value) {
+      for (std::size_t i = 0; i < 8; ++i) {
+        out += static_cast<char>(value >> (8 * i));
+      }
+    });
+  }
+  return out;
+}
+
+SimStats SimStats::deserialize(std::string_view data) {
+  SimStats result;
+  std::size_t offset = 0;
+
+  for (auto &s : result.m_strategies) {
+    StrategyStats::visit(s, [&data, &offset](uint64_t &value) {
+      if (offset + 8 > data.size()) {
+        throw std::runtime_error("Truncated statistics data");
+      }
+      value = 0;
+      for (std::size_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[offset + i]))
+                 << (8 * i);
+      }
+      offset += 8;
+    });
+  }
+
+  if (offset != data.size()) {
+    throw std::runtime_error("Unexpected statistics data size");
+  }
+  return result;
+}
+
+// ============================================================================
+// GameTracker
+// ============================================================================
+
+void GameTracker::record_shot(std::size_t cell, bool hit,
+                              bool targeting) noexcept {
+  if (m_shots < MAX_SHOTS) {
+    ++m_target.shots_by_turn[m_shots];
+    if (hit) {
+      ++m_target.hits_by_turn[m_shots];
+    }
+  }
+  ++m_shots;
+
+  if (hit && !m_has_hit && cell < CELL_COUNT) {
+    ++m_target.first_hits[cell];
+    m_has_hit = true;
+  }
+
+  if (targeting) {
+    ++m_target.target_shots;
+  } else {
+    ++m_target.hunt_shots;
+  }
+}
+
+void GameTracker::finish(bool won) noexcept {
+  ++m_target.seats;
+  if (won) {
+    ++m_target.wins;
+    m_target.shots_to_win.add(m_shots);
+  }
+}
+
+} // namespace battleship::stats
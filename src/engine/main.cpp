@@ -0,0 +1,53 @@
+#include "Engine.hpp"
+#include "Stats.hpp"
+#include <format>
+#include <iostream>
+#include <string_view>
+
+using namespace battleship;
+
+namespace {
+
+void print_usage() {
+  std::cout << "Usage: battleship-engine [options]\n"
+               "Speaks the engine protocol (see Engine.hpp) on stdin/stdout.\n"
+               "  --level LEVEL    easy|medium|hard (default hard)\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  config::Difficulty level = config::Difficulty::HARD;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--level" && i + 1 < argc) {
+      const std::string_view value = argv[++i];
+      bool known = false;
+      for (const auto candidate : {config::Difficulty::EASY, config::Difficulty::MEDIUM,
+                                   config::Difficulty::HARD}) {
+        if (value == stats::strategy_name(candidate)) {
+          level = candidate;
+          known = true;
+        }
+      }
+      if (!known) {
+        std::cerr << std::format("Unknown strategy: {}\n", value);
+        return 1;
+      }
+    } else {
+      print_usage();
+      return 1;
+    }
+  }
+
+  try {
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+    engine::serve(std::cin, std::cout, level);
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
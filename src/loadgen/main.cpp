@@ -0,0 +1,884 @@
+#include "Player.hpp"
+#include "Simulation.hpp"
+#include "Stats.hpp"
+#include "net/Buffers.hpp"
+#include "net/Latency.hpp"
+#include "net/Multiplexer.hpp"
+#include "net/NetworkManager.hpp"
+#include "net/Protocol.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace battleship;
+
+namespace {
+
+namespace asio = boost::asio;
+using boost::system::error_code;
+using net::awaitable;
+using net::tcp;
+using Clock = std::chrono::steady_clock;
+
+// SERVER: every bot joins a battleship-server, which pairs them up.
+// PEER: half the bots host, half join them, and each pair plays the
+// OnlineGame peer protocol (each side resolves shots on its own board).
+enum class Mode : uint8_t { SERVER, PEER };
+
+struct Options {
+  Mode mode{Mode::SERVER};
+  std::string host{"127.0.0.1"};
+  uint16_t port{net::NetworkManager::DEFAULT_PORT};
+  unsigned connections{1000};
+  unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+  std::chrono::seconds duration{10};
+  uint64_t matches{0}; // stop after this many finished matches, 0 = run for duration
+  unsigned streams{0}; // peer mode: games multiplexed per connection, 0 = one connection each
+  uint64_t seed{1};
+  config::Difficulty level{config::Difficulty::HARD};
+  pid_t server_pid{0}; // also account this process's CPU and system calls
+};
+
+constexpr std::chrono::milliseconds RETRY_DELAY{100};
+constexpr std::size_t RECEIVE_BUFFER = 512;
+
+void print_usage() {
+  std::cout << "Usage: battleship-loadgen [options]\n"
+               "  --mode server|peer  play through a battleship-server (default) or\n"
+               "                      host and join peer games locally\n"
+               "  --connect HOST:PORT server address (default 127.0.0.1:7777)\n"
+               "  --connections N     concurrent bots (default 1000)\n"
+               "  --threads T         event loops (default: all cores)\n"
+               "  --duration S        seconds to run (default 10)\n"
+               "  --matches N         stop after N finished matches instead\n"
+               "  --streams N         peer mode: play N games at once over each\n"
+               "                      connection, multiplexed (default: a connection\n"
+               "                      per game)\n"
+               "  --level LEVEL       easy|medium|hard bot strategy (default hard)\n"
+               "  --seed S            seeds every bot's fleet and shots (default 1)\n"
+               "  --server-pid PID    also report that process's system calls and CPU\n";
+}
+
+std::optional<uint64_t> parse_number(std::string_view text) {
+  uint64_t value = 0;
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<config::Difficulty> parse_difficulty(std::string_view text) {
+  for (const auto level : {config::Difficulty::EASY, config::Difficulty::MEDIUM,
+                           config::Difficulty::HARD}) {
+    if (text == stats::strategy_name(level)) {
+      return level;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<Options> parse_args(int argc, char **argv) {
+  Options opts;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      return std::nullopt;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << std::format("Missing value for {}\n", arg);
+      return std::nullopt;
+    }
+    const std::string_view value = argv[++i];
+
+    if (arg == "--mode") {
+      if (value != "server" && value != "peer") {
+        std::cerr << std::format("Unknown mode: {}\n", value);
+        return std::nullopt;
+      }
+      opts.mode = value == "peer" ? Mode::PEER : Mode::SERVER;
+    } else if (arg == "--connect") {
+      const auto colon = value.rfind(':');
+      const auto port = colon == std::string_view::npos
+                            ? std::nullopt
+                            : parse_number(value.substr(colon + 1));
+      if (!port || *port > UINT16_MAX) {
+        std::cerr << std::format("Invalid address (expected HOST:PORT): {}\n", value);
+        return std::nullopt;
+      }
+      opts.host = value.substr(0, colon);
+      opts.port = static_cast<uint16_t>(*port);
+    } else if (arg == "--level") {
+      const auto level = parse_difficulty(value);
+      if (!level) {
+        std::cerr << std::format("Unknown strategy: {}\n", value);
+        return std::nullopt;
+      }
+      opts.level = *level;
+    } else {
+      const auto number = parse_number(value);
+      if (!number) {
+        std::cerr << std::format("Invalid number for {}: {}\n", arg, value);
+        return std::nullopt;
+      }
+      if (arg == "--connections" && *number > 0) {
+        opts.connections = static_cast<unsigned>(*number);
+      } else if (arg == "--threads" && *number > 0) {
+        opts.threads = static_cast<unsigned>(*number);
+      } else if (arg == "--duration") {
+        opts.duration = std::chrono::seconds(*number);
+      } else if (arg == "--matches") {
+        opts.matches = *number;
+      } else if (arg == "--streams") {
+        opts.streams = static_cast<unsigned>(*number);
+      } else if (arg == "--seed") {
+        opts.seed = *number;
+      } else if (arg == "--server-pid" && *number > 0) {
+        opts.server_pid = static_cast<pid_t>(*number);
+      } else {
+        std::cerr << std::format("Unknown option: {}\n", arg);
+        return std::nullopt;
+      }
+    }
+  }
+
+  if (opts.mode == Mode::PEER && opts.connections < 2) {
+    std::cerr << "--mode peer needs at least 2 connections\n";
+    return std::nullopt;
+  }
+  if (opts.mode == Mode::SERVER && opts.streams > 0) {
+    std::cerr << "--streams needs --mode peer: servers play one match per connection\n";
+    return std::nullopt;
+  }
+  return opts;
+}
+
+// Thousands of sockets need more than the usual 1024 descriptors
+void raise_file_limit() {
+  rlimit limit{};
+  if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+double to_ms(net::Micros us) { return static_cast<double>(us.count()) / 1000.0; }
+
+// ============================================================================
+// Process accounting
+// ============================================================================
+
+// System calls are counted with the raw_syscalls:sys_enter tracepoint, one
+// perf counter per thread, which needs tracefs mounted and perf events
+// allowed. /proc/.../io is no substitute: it misses the sendmsg/recvmsg
+// that sockets use.
+struct Usage {
+  double cpu_seconds{0};
+  uint64_t syscalls{0};
+  bool counted{true}; // false: syscalls unknown
+};
+
+std::optional<uint64_t> syscall_tracepoint() {
+  for (const char *path : {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                           "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"}) {
+    std::ifstream in(path);
+    uint64_t id = 0;
+    if (in >> id) {
+      return id;
+    }
+  }
+  return std::nullopt;
+}
+
+// Counter for one thread (0 = the calling one), -1 if unavailable
+int open_syscall_counter(pid_t tid) {
+  static const std::optional<uint64_t> tracepoint = syscall_tracepoint();
+  if (!tracepoint) {
+    return -1;
+  }
+  perf_event_attr attr{};
+  attr.type = PERF_TYPE_TRACEPOINT;
+  attr.size = sizeof(attr);
+  attr.config = *tracepoint;
+  return static_cast<int>(::syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+}
+
+uint64_t read_counter(int fd) {
+  uint64_t value = 0;
+  return fd >= 0 && ::read(fd, &value, sizeof(value)) == sizeof(value) ? value : 0;
+}
+
+// The calling thread from construction to sample(): what an event loop
+// thread costs, without the main thread's progress reporting
+class ThreadMeter {
+public:
+  ThreadMeter() : m_counter(open_syscall_counter(0)), m_cpu_start(cpu_now()) {}
+
+  ~ThreadMeter() {
+    if (m_counter >= 0) {
+      ::close(m_counter);
+    }
+  }
+
+  ThreadMeter(const ThreadMeter &) = delete;
+  ThreadMeter &operator=(const ThreadMeter &) = delete;
+
+  // Must run on the same thread
+  Usage sample() const {
+    return {cpu_now() - m_cpu_start, read_counter(m_counter), m_counter >= 0};
+  }
+
+private:
+  int m_counter;
+  double m_cpu_start;
+
+  static double cpu_now() {
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+  }
+};
+
+// Another process, all the threads it has at construction
+class ProcessMeter {
+public:
+  explicit ProcessMeter(pid_t pid) : m_root(std::format("/proc/{}", pid)) {
+    std::error_code ec;
+    for (const auto &task : std::filesystem::directory_iterator(m_root + "/task", ec)) {
+      const auto tid = parse_number(task.path().filename().string());
+      const int fd = tid ? open_syscall_counter(static_cast<pid_t>(*tid)) : -1;
+      if (fd < 0) {
+        close_all();
+        break;
+      }
+      m_counters.push_back(fd);
+    }
+    if (ec) {
+      throw std::runtime_error(std::format("No process {}", pid));
+    }
+    m_start = totals();
+  }
+
+  ~ProcessMeter() { close_all(); }
+
+  ProcessMeter(const ProcessMeter &) = delete;
+  ProcessMeter &operator=(const ProcessMeter &) = delete;
+
+  Usage sample() const {
+    const Usage now = totals();
+    return {now.cpu_seconds - m_start.cpu_seconds, now.syscalls - m_start.syscalls,
+            now.counted};
+  }
+
+private:
+  std::string m_root;
+  std::vector<int> m_counters;
+  Usage m_start;
+
+  void close_all() {
+    for (const int fd : m_counters) {
+      ::close(fd);
+    }
+    m_counters.clear();
+  }
+
+  Usage totals() const {
+    Usage usage;
+    usage.counted = !m_counters.empty();
+    for (const int fd : m_counters) {
+      usage.syscalls += read_counter(fd);
+    }
+
+    // utime and stime are fields 14 and 15, counted after the ")" that
+    // ends the command name
+    std::ifstream in(m_root + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(in)), {});
+    std::istringstream fields(stat.substr(stat.rfind(')') + 2));
+    std::string field;
+    uint64_t utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; ++i) {
+      if (i == 14) {
+        utime = parse_number(field).value_or(0);
+      } else if (i == 15) {
+        stime = parse_number(field).value_or(0);
+      }
+    }
+    usage.cpu_seconds =
+        static_cast<double>(utime + stime) / static_cast<double>(::sysconf(_SC_CLK_TCK));
+    return usage;
+  }
+};
+
+// ============================================================================
+// Worker: one event loop and the bots on it
+// ============================================================================
+
+struct Worker {
+  asio::io_context io_context{1};
+  tcp::acceptor acceptor{io_context}; // peer mode: where this worker's hosts listen
+
+  // Read by the progress line while running
+  std::atomic<uint64_t> games{0}; // finished by one bot, two per match
+  std::atomic<uint64_t> messages{0}; // frames sent plus received
+  std::atomic<uint64_t> errors{0};
+  std::atomic<uint64_t> stalls{0}; // --streams: frames that waited for credit
+
+  // ATTACK sent -> its result received; read after join
+  net::FineHistogram turns;
+  Usage usage; // of the event loop thread, read after join
+};
+
+struct Shared {
+  const Options &options;
+  std::atomic<bool> stopping{false};
+  std::atomic<uint64_t> games{0};
+};
+
+// Where a bot's frames go: the queue of its own connection, or its stream
+// of a multiplexed one
+struct Link {
+  net::SendQueue *queue{nullptr};
+  net::Multiplexer *mux{nullptr};
+  net::StreamId stream{0};
+
+  void send(net::MessageType type, std::string_view payload) const {
+    if (mux) {
+      mux->send(stream, type, payload);
+    } else {
+      queue->push(type, payload);
+    }
+  }
+};
+
+// One bot playing one game. It only turns incoming messages into outgoing
+// ones; the connection loop that owns it does the I/O, so everything a
+// batch of incoming frames produces leaves in one write, as in the client.
+class Bot {
+public:
+  Bot(Worker &worker, Link link, Mode mode, bool first, config::Difficulty level,
+      uint32_t seed)
+      : m_worker(worker), m_link(link), m_mode(mode),
+        m_player("Bot", PlayerType::AI, level, seed) {
+    if (mode == Mode::PEER) {
+      m_player.auto_place_ships();
+      m_my_turn = first;
+    }
+    m_player.set_state(PlayerState::ACTIVE);
+  }
+
+  // Queues the opening shot if this bot fires first
+  void start() {
+    if (m_my_turn) {
+      fire();
+    }
+  }
+
+  // False on anything the protocol does not allow
+  bool handle(const net::MessageView &message);
+
+  // GAME_OVER sent or received
+  bool over() const noexcept { return m_over; }
+
+private:
+  Worker &m_worker;
+  Link m_link;
+  Mode m_mode;
+  Player m_player;
+
+  bool m_my_turn{false};
+  bool m_over{false};
+  Position m_target{};
+  Clock::time_point m_shot_sent{};
+  uint8_t m_sunk{0}; // opponent ships sunk
+  uint16_t m_incoming{0};
+  uint16_t m_incoming_hits{0};
+
+  void fire();
+  void answer(std::string_view payload);
+  bool on_result(AttackResult result);
+  void queue(net::MessageType type, std::string_view payload = {});
+};
+
+bool Bot::handle(const net::MessageView &message) {
+  switch (message.type) {
+  case net::MessageType::GAME_START: // the server dealt us a fleet we never look at
+  case net::MessageType::PONG:
+    return true;
+  case net::MessageType::YOUR_TURN:
+    fire();
+    return true;
+  case net::MessageType::ATTACK:
+    if (m_mode == Mode::PEER) {
+      answer(message.payload);
+    }
+    return true; // server mode: just the opponent's shot on our fleet
+  case net::MessageType::RESULT: {
+    const auto result = net::protocol::decode_result(message.payload);
+    return result && on_result(*result);
+  }
+  case net::MessageType::RESULT_SUNK:
+    ++m_sunk;
+    return net::protocol::decode_sunk(message.payload) && on_result(AttackResult::SUNK);
+  case net::MessageType::GAME_OVER:
+    m_over = true;
+    return net::protocol::decode_game_over(message.payload).has_value();
+  default:
+    return false;
+  }
+}
+
+void Bot::fire() {
+  m_target = m_player.get_attack();
+  m_shot_sent = Clock::now();
+  queue(net::MessageType::ATTACK, net::protocol::encode_attack(m_target));
+}
+
+// Peer mode: the opponent shot at our board
+void Bot::answer(std::string_view payload) {
+  const auto pos = net::protocol::decode_attack(payload);
+  if (!pos) {
+    return;
+  }
+  const Ship *ship = m_player.board().get_ship_at(*pos);
+  const AttackResult result = m_player.receive_attack(*pos);
+  ++m_incoming;
+  m_incoming_hits += result == AttackResult::HIT || result == AttackResult::SUNK;
+  if (result == AttackResult::SUNK && ship) {
+    queue(net::MessageType::RESULT_SUNK, net::protocol::encode_sunk(*ship));
+  } else {
+    queue(net::MessageType::RESULT, net::protocol::encode_result(result));
+  }
+
+  // As in OnlineGame, the loser reports the end in the same write, from
+  // the winner's side
+  if (m_player.has_lost()) {
+    net::protocol::GameSummary summary;
+    summary.outcome = net::protocol::Outcome::WIN;
+    summary.shots = {m_incoming, m_player.total_attacks()};
+    summary.hits = {m_incoming_hits, m_player.successful_hits()};
+    queue(net::MessageType::GAME_OVER, net::protocol::encode_game_over(summary));
+    m_over = true;
+  }
+}
+
+bool Bot::on_result(AttackResult result) {
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      Clock::now() - m_shot_sent);
+  m_worker.turns.add(elapsed);
+  m_player.record_attack_result(m_target, result);
+
+  // Server mode waits for YOUR_TURN; a peer decides for itself
+  if (m_mode == Mode::PEER && m_sunk < config::TOTAL_SHIPS) {
+    if (result == AttackResult::HIT || result == AttackResult::SUNK) {
+      fire();
+    } else {
+      queue(net::MessageType::YOUR_TURN);
+    }
+  }
+  return true;
+}
+
+void Bot::queue(net::MessageType type, std::string_view payload) {
+  m_link.send(type, payload);
+  m_worker.messages.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Connection loops
+// ============================================================================
+
+// Counts a game one of our bots finished. Both sides of every match are
+// ours: two games per match.
+void finish_game(Worker &worker, Shared &shared) {
+  worker.games.fetch_add(1, std::memory_order_relaxed);
+  if (shared.options.matches > 0 &&
+      shared.games.fetch_add(1) + 1 >= 2 * shared.options.matches) {
+    shared.stopping = true;
+  }
+}
+
+uint32_t bot_seed(const Options &options, unsigned index, uint64_t &round) {
+  return static_cast<uint32_t>(
+      sim::game_seed(options.seed, (uint64_t{index} << 32) | round++));
+}
+
+awaitable<bool> receive(tcp::socket &socket, net::ReceiveBuffer &inbox) {
+  error_code ec;
+  const std::span<char> space = inbox.prepare();
+  const std::size_t bytes = co_await socket.async_read_some(
+      asio::buffer(space.data(), space.size()),
+      asio::redirect_error(asio::use_awaitable, ec));
+  inbox.commit(ec ? 0 : bytes);
+  co_return !ec;
+}
+
+awaitable<bool> flush(tcp::socket &socket, net::SendQueue &outbox) {
+  if (outbox.empty()) {
+    co_return true;
+  }
+  error_code ec;
+  co_await asio::async_write(socket, outbox.take_batch(),
+                             asio::redirect_error(asio::use_awaitable, ec));
+  outbox.release_batch();
+  co_return !ec;
+}
+
+bool greeted_by(const net::MessageView &view) {
+  return view.type == net::MessageType::HELLO &&
+         net::protocol::decode_hello(view.payload) == net::protocol::VERSION;
+}
+
+// One game over its own connection; true once it ran to GAME_OVER
+awaitable<bool> play_single(Worker &worker, tcp::socket &socket, const Options &options,
+                            bool host, uint32_t seed) {
+  net::ReceiveBuffer inbox{RECEIVE_BUFFER};
+  net::SendQueue outbox;
+  Bot bot(worker, Link{&outbox}, options.mode, host, options.level, seed);
+
+  outbox.push(net::MessageType::HELLO, net::protocol::encode_hello());
+  worker.messages.fetch_add(1, std::memory_order_relaxed);
+  bot.start(); // a peer host shoots first
+  if (!co_await flush(socket, outbox)) {
+    co_return false;
+  }
+
+  bool greeted = false;
+  while (!bot.over()) {
+    if (!co_await receive(socket, inbox)) {
+      co_return false;
+    }
+    uint64_t received = 0;
+    while (const auto view = inbox.next()) {
+      ++received;
+      if (!greeted) {
+        if (!greeted_by(*view)) {
+          co_return false;
+        }
+        greeted = true;
+      } else if (!bot.handle(*view)) {
+        co_return false;
+      }
+    }
+    worker.messages.fetch_add(received, std::memory_order_relaxed);
+    if (!co_await flush(socket, outbox)) {
+      co_return false;
+    }
+  }
+  co_return true;
+}
+
+// Peer mode with --streams: many games at once over one connection, one
+// bot per stream. The connecting side keeps `streams` games going, opening
+// a new stream (and shooting first on it) whenever one ends; the accepting
+// side starts a bot for each stream it sees. True if the connection closed
+// cleanly after the last game.
+awaitable<bool> play_multiplexed(Worker &worker, Shared &shared, tcp::socket &socket,
+                                 bool initiator, unsigned index, uint64_t &round) {
+  const Options &options = shared.options;
+  net::ReceiveBuffer inbox{RECEIVE_BUFFER};
+  net::Multiplexer mux(initiator);
+  std::unordered_map<net::StreamId, std::unique_ptr<Bot>> bots;
+
+  const auto start_bot = [&](net::StreamId stream, bool first) -> Bot & {
+    auto bot = std::make_unique<Bot>(worker, Link{nullptr, &mux, stream}, Mode::PEER,
+                                     first, options.level,
+                                     bot_seed(options, index, round));
+    return *bots.emplace(stream, std::move(bot)).first->second;
+  };
+  const auto stopping = [&shared] {
+    return shared.stopping.load(std::memory_order_relaxed);
+  };
+
+  mux.outbox().push(net::MessageType::HELLO,
+                    net::protocol::encode_hello(
+                        initiator ? net::protocol::HelloRequest{net::protocol::Intent::MULTIPLEX}
+                                  : net::protocol::HelloRequest{}));
+  if (initiator) {
+    for (unsigned i = 0; i < options.streams; ++i) {
+      start_bot(mux.open(), true).start();
+    }
+  }
+  if (!co_await flush(socket, mux.outbox())) {
+    co_return false;
+  }
+
+  bool greeted = false;
+  uint64_t stalls = 0; // already added to the worker's count
+  while (!initiator || !bots.empty()) {
+    if (!co_await receive(socket, inbox)) {
+      co_return !initiator && bots.empty(); // the initiator hangs up when done
+    }
+    uint64_t received = 0;
+    while (const auto view = inbox.next()) {
+      if (!greeted) {
+        const auto hello = net::protocol::decode_hello_request(view->payload);
+        if (!greeted_by(*view) || !hello ||
+            (hello->intent == net::protocol::Intent::MULTIPLEX) == initiator) {
+          co_return false;
+        }
+        greeted = true;
+        continue;
+      }
+
+      const auto message = mux.receive(*view);
+      if (!message) {
+        continue;
+      }
+      ++received;
+      auto it = bots.find(message->stream);
+      Bot &bot = it != bots.end() ? *it->second : start_bot(message->stream, false);
+      if (!bot.handle(message->message)) {
+        co_return false;
+      }
+      mux.consumed(*message);
+
+      if (bot.over()) {
+        bots.erase(message->stream);
+        mux.close(message->stream);
+        finish_game(worker, shared);
+        if (initiator && !stopping()) {
+          start_bot(mux.open(), true).start();
+        }
+      }
+    }
+    worker.messages.fetch_add(received, std::memory_order_relaxed);
+    worker.stalls.fetch_add(mux.stalls() - std::exchange(stalls, mux.stalls()),
+                            std::memory_order_relaxed);
+    if (!co_await flush(socket, mux.outbox())) {
+      co_return false;
+    }
+  }
+  co_return true;
+}
+
+// Plays games back to back until told to stop: a connection each, or with
+// --streams a multiplexed connection at a time
+awaitable<void> run_bot(Worker &worker, Shared &shared, unsigned index,
+                        tcp::endpoint endpoint, bool host) {
+  const Options &options = shared.options;
+  asio::steady_timer retry(worker.io_context);
+  uint64_t round = 0;
+
+  while (!shared.stopping.load(std::memory_order_relaxed)) {
+    error_code ec;
+    tcp::socket socket(worker.io_context);
+    if (host) {
+      co_await worker.acceptor.async_accept(socket,
+                                            asio::redirect_error(asio::use_awaitable, ec));
+    } else {
+      co_await socket.async_connect(endpoint,
+                                    asio::redirect_error(asio::use_awaitable, ec));
+    }
+    if (!ec) {
+      socket.set_option(tcp::no_delay(true), ec);
+    }
+
+    bool finished = false;
+    if (!ec) {
+      try {
+        if (options.streams > 0) {
+          // The guest connects, so it is the side opening streams
+          finished = co_await play_multiplexed(worker, shared, socket, !host, index, round);
+        } else {
+          finished = co_await play_single(worker, socket, options, host,
+                                          bot_seed(options, index, round));
+          if (finished) {
+            finish_game(worker, shared);
+          }
+        }
+      } catch (const std::exception &e) {
+        std::cerr << std::format("Bot error: {}\n", e.what());
+      }
+    }
+
+    if (!finished && !shared.stopping.load(std::memory_order_relaxed)) {
+      worker.errors.fetch_add(1, std::memory_order_relaxed);
+      retry.expires_after(RETRY_DELAY);
+      co_await retry.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+    }
+    socket.close(ec);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse_args(argc, argv);
+  if (!options) {
+    print_usage();
+    return 1;
+  }
+  raise_file_limit();
+
+  try {
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < options->threads; ++i) {
+      workers.push_back(std::make_unique<Worker>());
+    }
+    Shared shared{*options};
+
+    tcp::endpoint server;
+    if (options->mode == Mode::SERVER) {
+      asio::io_context resolver_context;
+      tcp::resolver resolver(resolver_context);
+      server = *resolver.resolve(options->host, std::to_string(options->port)).begin();
+    }
+
+    // Bots go round-robin over the workers; in peer mode each host and its
+    // guest share a worker, so a game never crosses threads
+    for (unsigned i = 0; i < options->connections; ++i) {
+      Worker &worker = *workers[(options->mode == Mode::PEER ? i / 2 : i) % workers.size()];
+      tcp::endpoint endpoint = server;
+      bool host = false;
+      if (options->mode == Mode::PEER) {
+        if (!worker.acceptor.is_open()) {
+          worker.acceptor.open(tcp::v4());
+          worker.acceptor.bind({asio::ip::address_v4::loopback(), 0});
+          worker.acceptor.listen(asio::socket_base::max_listen_connections);
+        }
+        endpoint = worker.acceptor.local_endpoint();
+        host = i % 2 == 0;
+      }
+      asio::co_spawn(worker.io_context, run_bot(worker, shared, i, endpoint, host),
+                     asio::detached);
+    }
+
+    std::optional<ProcessMeter> server_meter;
+    if (options->server_pid > 0) {
+      server_meter.emplace(options->server_pid);
+    }
+
+    std::cout << std::format("{} bots on {} threads ({}), {} mode{}\n",
+                             options->connections, options->threads, net::IO_BACKEND,
+                             options->mode == Mode::PEER ? "peer" : "server",
+                             options->mode == Mode::SERVER
+                                 ? std::format(" against {}:{}", options->host, options->port)
+                             : options->streams > 0
+                                 ? std::format(", {} games per connection", options->streams)
+                                 : std::string{});
+
+    const auto started = Clock::now();
+    std::vector<std::thread> threads;
+    for (auto &worker : workers) {
+      threads.emplace_back([&worker] {
+        const ThreadMeter meter;
+        worker->io_context.run();
+        worker->usage = meter.sample();
+      });
+    }
+
+    // Progress once a second until the duration or game count is reached
+    uint64_t last_games = 0;
+    for (auto tick = started + std::chrono::seconds(1);; tick += std::chrono::seconds(1)) {
+      while (Clock::now() < tick && !shared.stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      if (options->matches == 0 && Clock::now() - started >= options->duration) {
+        shared.stopping = true;
+      }
+      if (shared.stopping) {
+        break;
+      }
+      uint64_t games = 0;
+      for (const auto &worker : workers) {
+        games += worker->games.load(std::memory_order_relaxed);
+      }
+      std::cout << std::format("  {:>4}s: {} matches/s\n",
+                               std::chrono::duration_cast<std::chrono::seconds>(
+                                   Clock::now() - started).count(),
+                               (games - last_games) / 2);
+      last_games = games;
+    }
+
+    const double elapsed =
+        std::chrono::duration<double>(Clock::now() - started).count();
+    Usage server_usage;
+    if (server_meter) {
+      server_usage = server_meter->sample();
+    }
+    for (auto &worker : workers) {
+      worker->io_context.stop();
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    uint64_t games = 0, messages = 0, errors = 0, stalls = 0;
+    net::FineHistogram turns;
+    Usage usage;
+    for (const auto &worker : workers) {
+      games += worker->games;
+      messages += worker->messages;
+      errors += worker->errors;
+      stalls += worker->stalls;
+      turns.merge(worker->turns);
+      usage.cpu_seconds += worker->usage.cpu_seconds;
+      usage.syscalls += worker->usage.syscalls;
+      usage.counted = usage.counted && worker->usage.counted;
+    }
+
+    // Both sides of every match are ours, so each match finishes two games
+    std::cout << std::format("Matches:  {} in {:.1f} s, {:.1f}/s\n", games / 2, elapsed,
+                             static_cast<double>(games) / 2 / elapsed);
+    std::cout << std::format("Messages: {} sent + received, {:.0f}/s\n", messages,
+                             static_cast<double>(messages) / elapsed);
+    std::cout << std::format(
+        "Turns:    {} timed (ATTACK -> result), p50 {:.3f} ms, p99 {:.3f} ms, "
+        "p999 {:.3f} ms\n",
+        turns.count(), to_ms(turns.percentile(50)), to_ms(turns.percentile(99)),
+        to_ms(turns.percentile(99.9)));
+    if (options->streams > 0) {
+      std::cout << std::format("Streams:  {} frames waited for flow-control credit\n",
+                               stalls);
+    }
+    // Every timed turn is one shot
+    const uint64_t shots = std::max<uint64_t>(turns.count(), 1);
+    const auto per_shot = [shots](const Usage &u) {
+      if (!u.counted) {
+        return std::string("n/a (needs tracefs and perf events)");
+      }
+      return std::format("{:.2f}/shot", static_cast<double>(u.syscalls) /
+                                            static_cast<double>(shots));
+    };
+    const auto per_match = [games](const Usage &u) {
+      return u.cpu_seconds * 1000.0 / static_cast<double>(std::max<uint64_t>(games / 2, 1));
+    };
+    std::cout << std::format("Syscalls: loadgen {}", per_shot(usage));
+    if (server_meter) {
+      std::cout << std::format(", server {}", per_shot(server_usage));
+    }
+    std::cout << std::format("\nCPU:      loadgen {:.3f} ms/match", per_match(usage));
+    if (server_meter) {
+      std::cout << std::format(", server {:.3f} ms/match", per_match(server_usage));
+    }
+    std::cout << '\n';
+    std::cout << std::format("Errors:   {} failed connections or games\n", errors);
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
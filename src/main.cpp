@@ -1,9 +1,20 @@
+#include "Engine.hpp"
 #include "Game.hpp"
 #include "OnlineGame.hpp"
+#include "Rating.hpp"
+#include "Renderer.hpp"
+#include "Replay.hpp"
+#include "Spectator.hpp"
 #include "net/NetworkManager.hpp"
+#include <charconv>
+#include <cstdlib>
 #include <format>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string_view>
 
 using namespace battleship;
 
@@ -17,10 +28,62 @@ void print_menu() {
   std::cout << "  5. Player vs Computer (Medium)\n";
   std::cout << "  6. Player vs Computer (Hard)\n";
   std::cout << "  7. Computer vs Computer (Watch)\n";
+  std::cout << "  8. Computer vs Computer (Turbo)\n";
+  std::cout << "  9. Player vs Player (Online - Server)\n";
+  std::cout << " 10. Watch a Server Match\n";
+  std::cout << " 11. Player vs External Engine\n";
+  std::cout << " 12. Leaderboard\n";
   std::cout << "  0. Exit\n";
   std::cout << "\nChoice: ";
 }
 
+// Local results are rated in battleship.ratings in the working directory,
+// or wherever BATTLESHIP_RATINGS points. Unrated if it cannot be opened.
+rating::RatingStore *rating_store() {
+  static const std::unique_ptr<rating::RatingStore> store =
+      []() -> std::unique_ptr<rating::RatingStore> {
+    const char *path = std::getenv("BATTLESHIP_RATINGS");
+    try {
+      return std::make_unique<rating::RatingStore>(path ? path : "battleship.ratings");
+    } catch (const std::exception &e) {
+      std::cerr << std::format("Ratings disabled: {}\n", e.what());
+      return nullptr;
+    }
+  }();
+  return store.get();
+}
+
+// Set by --record FILE: every local and engine game is appended to it, in
+// the format battleship-sim writes and battleship-analyze reads
+std::unique_ptr<replay::Writer> g_recorder;
+
+// Set by --delay MS: the pause after each shot in every mode but Turbo,
+// instead of the mode's own default
+std::optional<int> g_shot_delay;
+
+bool parse_delay(std::string_view text, int &delay) {
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), delay);
+  return ec == std::errc{} && ptr == text.data() + text.size() && delay >= 0;
+}
+
+Pacing paced(Pacing pacing) {
+  if (g_shot_delay && !pacing.turbo) {
+    pacing.shot_delay_ms = *g_shot_delay;
+  }
+  return pacing;
+}
+
+void show_leaderboard() {
+  constexpr std::size_t SHOWN = 10;
+  const rating::RatingStore *store = rating_store();
+  if (!store) {
+    return;
+  }
+  const auto standings = store->standings(1, SHOWN);
+  ConsoleRenderer::display(Renderer::render_leaderboard(standings, store->size()));
+}
+
 void run_online_host() {
   net::NetworkManager network;
   if (!network.host()) {
@@ -28,7 +91,7 @@ void run_online_host() {
     return;
   }
 
-  OnlineGame game(network);
+  OnlineGame game(network, paced(pacing::ONLINE));
   game.initialize();
   game.run();
 }
@@ -44,11 +107,81 @@ void run_online_join() {
     return;
   }
 
-  OnlineGame game(network);
+  OnlineGame game(network, paced(pacing::ONLINE));
+  game.initialize();
+  game.run();
+}
+
+// Reads "host[:port]"; the port defaults to NetworkManager::DEFAULT_PORT
+std::optional<std::pair<std::string, uint16_t>> read_server_address() {
+  std::string address;
+  std::cout << "Enter server address (host[:port]): ";
+  std::cin >> address;
+
+  // Optional ":port" suffix
+  uint16_t port = net::NetworkManager::DEFAULT_PORT;
+  if (const auto colon = address.rfind(':'); colon != std::string::npos) {
+    const std::string_view digits = std::string_view(address).substr(colon + 1);
+    const auto [ptr, ec] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), port);
+    if (ec != std::errc{} || ptr != digits.data() + digits.size()) {
+      std::cerr << "Invalid port\n";
+      return std::nullopt;
+    }
+    address.resize(colon);
+  }
+  return std::pair{std::move(address), port};
+}
+
+void run_online_server() {
+  const auto address = read_server_address();
+  if (!address) {
+    return;
+  }
+
+  // The server answers every PING, so five silent seconds mean a dead link
+  // rather than an opponent still thinking
+  net::NetworkManager network(net::Timeouts{.dead_peer = std::chrono::milliseconds(5000)});
+  if (!network.join(address->first, address->second)) {
+    std::cerr << "Failed to connect to server\n";
+    return;
+  }
+
+  OnlineGame game(network, paced(pacing::ONLINE), OnlineMode::SERVER);
   game.initialize();
   game.run();
 }
 
+void run_spectator() {
+  const auto address = read_server_address();
+  if (!address) {
+    return;
+  }
+
+  std::string match;
+  std::cout << "Match number (or * for the most watched): ";
+  std::cin >> match;
+
+  uint64_t match_id = net::protocol::ANY_MATCH;
+  if (match != "*") {
+    const auto [ptr, ec] =
+        std::from_chars(match.data(), match.data() + match.size(), match_id);
+    if (ec != std::errc{} || ptr != match.data() + match.size()) {
+      std::cerr << "Invalid match number\n";
+      return;
+    }
+  }
+
+  net::NetworkManager network;
+  if (!network.watch(address->first, address->second, match_id)) {
+    std::cerr << "Failed to connect to server\n";
+    return;
+  }
+
+  Spectator spectator(network);
+  spectator.run();
+}
+
 // Returns: -1 = exit, 0 = online host, 1 = online join, 2+ = GameMode
 [[nodiscard]] int get_menu_choice() {
   int choice;
@@ -63,8 +196,10 @@ void run_online_join() {
   return choice;
 }
 
-void run_local_game(GameMode mode) {
-  Game game(mode);
+// Plays a local or engine game to the end, rated and recorded
+void play_local_game(Game &game) {
+  game.set_rating_store(rating_store());
+  game.set_replay_writer(g_recorder.get());
   game.initialize();
   game.start();
 
@@ -73,8 +208,56 @@ void run_local_game(GameMode mode) {
   }
 }
 
-int main() {
+void run_local_game(GameMode mode, const Pacing &pacing) {
+  Game game(mode, pacing);
+  play_local_game(game);
+}
+
+void run_local_game(GameMode mode) {
+  run_local_game(mode, paced(default_pacing(mode)));
+}
+
+void run_engine_game() {
+  std::string command;
+  std::cout << "Engine command (e.g. ./battleship-engine --level medium): ";
+  std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  std::getline(std::cin, command);
+  if (command.empty()) {
+    return;
+  }
+
+  auto client = std::make_shared<engine::EngineClient>(command);
+  std::cout << std::format("Playing against {}\n", client->name());
+
+  Game game(GameMode::PVE_HARD, paced(default_pacing(GameMode::PVE_HARD)));
+  game.set_opponent_strategy(
+      std::make_unique<engine::EngineStrategy>(client, std::random_device{}()),
+      client->name());
+  play_local_game(game);
+}
+
+int main(int argc, char **argv) {
+  // cout buffers on its own; frames go out through one write(2) each
+  std::ios::sync_with_stdio(false);
+
   try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string_view arg = argv[i];
+      const std::string_view value = i + 1 < argc ? argv[++i] : "";
+      int delay = -1;
+      if (arg == "--record" && !value.empty()) {
+        g_recorder = std::make_unique<replay::Writer>(std::string(value));
+      } else if (arg == "--delay" && parse_delay(value, delay)) {
+        g_shot_delay = delay;
+      } else {
+        std::cerr << "Usage: battleship [--record FILE] [--delay MS]\n"
+                     "  --record FILE  append every local and engine game to FILE\n"
+                     "  --delay MS     pause after each shot instead of the "
+                     "mode's default\n";
+        return 1;
+      }
+    }
+
     while (true) {
       print_menu();
       const int choice = get_menu_choice();
@@ -104,6 +287,21 @@ int main() {
       case 7:
         run_local_game(GameMode::AI_VS_AI);
         break;
+      case 8:
+        run_local_game(GameMode::AI_VS_AI, pacing::TURBO);
+        break;
+      case 9:
+        run_online_server();
+        break;
+      case 10:
+        run_spectator();
+        break;
+      case 11:
+        run_engine_game();
+        break;
+      case 12:
+        show_leaderboard();
+        continue;
       default:
         std::cout << "Invalid choice\n";
         continue;
@@ -0,0 +1,145 @@
+#include "net/Buffers.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace battleship::net {
+
+// ============================================================================
+// ReceiveBuffer
+// ============================================================================
+
+ReceiveBuffer::ReceiveBuffer(std::size_t capacity)
+    : m_data(std::max(capacity, FRAME_HEADER_SIZE)) {}
+
+std::span<char> ReceiveBuffer::prepare() {
+  if (m_head == m_tail) {
+    m_head = m_tail = 0;
+  }
+
+  // Room the front frame needs from m_head on: all of it once its header is
+  // in, otherwise at least one more byte
+  const std::size_t buffered = m_tail - m_head;
+  std::size_t needed = buffered + 1;
+  if (buffered >= FRAME_HEADER_SIZE) {
+    needed = std::max(needed, frame_size(m_data.data() + m_head));
+  }
+
+  if (m_head + needed > m_data.size()) {
+    std::memmove(m_data.data(), m_data.data() + m_head, buffered);
+    m_head = 0;
+    m_tail = buffered;
+    if (needed > m_data.size()) {
+      m_data.resize(std::bit_ceil(needed));
+    }
+  }
+  return {m_data.data() + m_tail, m_data.size() - m_tail};
+}
+
+bool ReceiveBuffer::has_frame() const noexcept {
+  return parse_frame(unread()).has_value();
+}
+
+std::optional<MessageView> ReceiveBuffer::next() noexcept {
+  const auto view = parse_frame(unread());
+  if (view) {
+    m_head += FRAME_HEADER_SIZE + view->payload.size();
+  }
+  return view;
+}
+
+// ============================================================================
+// SendQueue
+// ============================================================================
+
+void SendQueue::push(MessageType type, std::string_view payload) {
+  push(type, {}, payload);
+}
+
+void SendQueue::push(MessageType type, std::string_view prefix,
+                     std::string_view payload) {
+  std::string buffer;
+  if (!m_free.empty()) {
+    buffer = std::move(m_free.back());
+    m_free.pop_back();
+  }
+  buffer.assign(prefix);
+  buffer.append(payload);
+  m_queued.push_back(Frame{encode_frame_header(type, buffer.size()),
+                           std::move(buffer)});
+}
+
+std::span<const boost::asio::const_buffer> SendQueue::take_batch() {
+  std::swap(m_queued, m_in_flight);
+
+  m_gather.clear();
+  for (const Frame &frame : m_in_flight) {
+    m_gather.emplace_back(frame.header.data(), frame.header.size());
+    if (!frame.payload.empty()) {
+      m_gather.emplace_back(frame.payload.data(), frame.payload.size());
+    }
+  }
+  return m_gather;
+}
+
+void SendQueue::release_batch() {
+  for (Frame &frame : m_in_flight) {
+    m_free.push_back(std::move(frame.payload));
+  }
+  m_in_flight.clear();
+  m_gather.clear();
+}
+
+void SendQueue::clear() {
+  release_batch();
+  std::swap(m_queued, m_in_flight);
+  release_batch();
+}
+
+void SendQueue::drop_queued() {
+  for (Frame &frame : m_queued) {
+    m_free.push_back(std::move(frame.payload));
+  }
+  m_queued.clear();
+}
+
+// ============================================================================
+// BroadcastQueue
+// ============================================================================
+
+SharedFrame make_shared_frame(MessageType type, std::string_view payload) {
+  const FrameHeader header = encode_frame_header(type, payload.size());
+  auto frame = std::make_shared<std::string>();
+  frame->reserve(header.size() + payload.size());
+  frame->append(header.data(), header.size());
+  frame->append(payload);
+  return frame;
+}
+
+void BroadcastQueue::push(SharedFrame frame) {
+  m_backlog += frame->size();
+  m_queued.push_back(std::move(frame));
+}
+
+void BroadcastQueue::drop_queued() noexcept {
+  m_queued.clear();
+  m_backlog = 0;
+}
+
+std::span<const boost::asio::const_buffer> BroadcastQueue::take_batch() {
+  std::swap(m_queued, m_in_flight);
+  m_backlog = 0;
+
+  m_gather.clear();
+  for (const SharedFrame &frame : m_in_flight) {
+    m_gather.emplace_back(frame->data(), frame->size());
+  }
+  return m_gather;
+}
+
+void BroadcastQueue::release_batch() {
+  m_in_flight.clear();
+  m_gather.clear();
+}
+
+} // namespace battleship::net
@@ -0,0 +1,203 @@
+#include "net/Latency.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+
+namespace battleship::net {
+
+namespace {
+
+constexpr std::size_t BAR_WIDTH = 30;
+
+double to_ms(Micros us) noexcept { return static_cast<double>(us.count()) / 1000.0; }
+
+std::string render_histogram(const LatencyHistogram &histogram) {
+  const auto &buckets = histogram.buckets();
+  const uint64_t peak = *std::max_element(buckets.begin(), buckets.end());
+  if (peak == 0) {
+    return {};
+  }
+
+  std::string out;
+  for (std::size_t i = 0; i < buckets.size(); ++i) {
+    if (buckets[i] == 0) {
+      continue;
+    }
+    const auto bar = static_cast<std::size_t>(
+        std::ceil(static_cast<double>(buckets[i]) * BAR_WIDTH / peak));
+    out += std::format("    {:>9.3f} - {:<9.3f} ms {:<{}} {}\n",
+                       to_ms(LatencyHistogram::bucket_floor(i)),
+                       to_ms(LatencyHistogram::bucket_ceiling(i)),
+                       std::string(bar, '#'), BAR_WIDTH, buckets[i]);
+  }
+  return out;
+}
+
+} // namespace
+
+// ============================================================================
+// LatencyHistogram
+// ============================================================================
+
+void LatencyHistogram::add(Micros sample) noexcept {
+  const auto us = static_cast<uint64_t>(std::max<int64_t>(sample.count(), 0));
+  const std::size_t bucket = std::min<std::size_t>(std::bit_width(us), BUCKETS - 1);
+  ++m_buckets[bucket];
+  ++m_count;
+  m_sum_us += us;
+  m_min = std::min(m_min, sample);
+  m_max = std::max(m_max, sample);
+}
+
+double LatencyHistogram::mean_ms() const noexcept {
+  return m_count ? static_cast<double>(m_sum_us) / m_count / 1000.0 : 0.0;
+}
+
+Micros LatencyHistogram::percentile(double p) const noexcept {
+  if (m_count == 0) {
+    return Micros{0};
+  }
+  const auto target =
+      static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(m_count)));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    seen += m_buckets[i];
+    if (seen >= std::max<uint64_t>(target, 1)) {
+      return std::min(bucket_ceiling(i), m_max);
+    }
+  }
+  return m_max;
+}
+
+Micros LatencyHistogram::bucket_floor(std::size_t bucket) noexcept {
+  return Micros{bucket == 0 ? 0 : int64_t{1} << (bucket - 1)};
+}
+
+Micros LatencyHistogram::bucket_ceiling(std::size_t bucket) noexcept {
+  return Micros{int64_t{1} << bucket};
+}
+
+// ============================================================================
+// FineHistogram
+// ============================================================================
+
+void FineHistogram::add(Micros sample) noexcept {
+  const auto us = static_cast<uint64_t>(std::max<int64_t>(sample.count(), 0));
+  ++m_buckets[index(std::min<uint64_t>(us, UINT32_MAX))];
+  ++m_count;
+  m_sum_us += us;
+}
+
+void FineHistogram::merge(const FineHistogram &other) noexcept {
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    m_buckets[i] += other.m_buckets[i];
+  }
+  m_count += other.m_count;
+  m_sum_us += other.m_sum_us;
+}
+
+double FineHistogram::mean_ms() const noexcept {
+  return m_count ? static_cast<double>(m_sum_us) / m_count / 1000.0 : 0.0;
+}
+
+Micros FineHistogram::percentile(double p) const noexcept {
+  const auto target = static_cast<uint64_t>(p / 100.0 * static_cast<double>(m_count));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    seen += m_buckets[i];
+    if (seen > target) {
+      return Micros{static_cast<int64_t>(floor(i))};
+    }
+  }
+  return Micros{0};
+}
+
+// Values below 64 us get a bucket each; above, the top 7 bits select it
+std::size_t FineHistogram::index(uint64_t us) noexcept {
+  if (us < SUB_BUCKETS) {
+    return us;
+  }
+  const unsigned shift = static_cast<unsigned>(std::bit_width(us)) - SUB_BITS - 1;
+  return SUB_BUCKETS * (shift + 1) + ((us >> shift) - SUB_BUCKETS);
+}
+
+uint64_t FineHistogram::floor(std::size_t bucket) noexcept {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  const uint64_t shift = bucket / SUB_BUCKETS - 1;
+  return (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+}
+
+// ============================================================================
+// RttEstimator
+// ============================================================================
+
+void RttEstimator::add(Micros sample) noexcept {
+  m_last = sample;
+  if (m_samples++ == 0) {
+    m_srtt = sample;
+    m_rttvar = sample / 2;
+    return;
+  }
+  const Micros deviation = sample > m_srtt ? sample - m_srtt : m_srtt - sample;
+  m_rttvar += (deviation - m_rttvar) / 4;
+  m_srtt += (sample - m_srtt) / 8;
+}
+
+// ============================================================================
+// LatencyStats
+// ============================================================================
+
+void LatencyStats::record_rtt(Micros sample) noexcept {
+  rtt.add(sample);
+  rtt_histogram.add(sample);
+}
+
+void LatencyStats::record_shot(Micros elapsed) noexcept {
+  shot_histogram.add(elapsed);
+  last_shot = elapsed;
+}
+
+std::string LatencyStats::status_line() const {
+  std::string out;
+  if (rtt.has_sample()) {
+    out += std::format("RTT {:.2f} ms (jitter {:.2f} ms)", to_ms(rtt.srtt()),
+                       to_ms(rtt.jitter()));
+  }
+  if (last_shot) {
+    out += std::format("{}last shot {:.2f} ms, p99 {:.2f} ms",
+                       out.empty() ? "" : " | ", to_ms(*last_shot),
+                       to_ms(shot_histogram.percentile(99)));
+  }
+  return out.empty() ? out : "  Network: " + out + "\n";
+}
+
+std::string LatencyStats::report() const {
+  std::string out = "\n【 NETWORK 】\n";
+  out += std::format("  Pings: {} sent, {} answered, {} stale samples dropped\n",
+                     pings_sent, pongs_received, stale_samples);
+
+  if (rtt.has_sample()) {
+    out += std::format(
+        "  RTT: srtt {:.3f} ms, jitter {:.3f} ms, min {:.3f}, mean {:.3f}, "
+        "p50 {:.3f}, p99 {:.3f}, max {:.3f} ms\n",
+        to_ms(rtt.srtt()), to_ms(rtt.jitter()), to_ms(rtt_histogram.min()),
+        rtt_histogram.mean_ms(), to_ms(rtt_histogram.percentile(50)),
+        to_ms(rtt_histogram.percentile(99)), to_ms(rtt_histogram.max()));
+    out += render_histogram(rtt_histogram);
+  }
+  if (shot_histogram.count() > 0) {
+    out += std::format(
+        "  Shots: {} timed, min {:.3f}, mean {:.3f}, p50 {:.3f}, p99 {:.3f}, "
+        "max {:.3f} ms\n",
+        shot_histogram.count(), to_ms(shot_histogram.min()),
+        shot_histogram.mean_ms(), to_ms(shot_histogram.percentile(50)),
+        to_ms(shot_histogram.percentile(99)), to_ms(shot_histogram.max()));
+    out += render_histogram(shot_histogram);
+  }
+  return out;
+}
+
+} // namespace battleship::net
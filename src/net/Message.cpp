@@ -0,0 +1,66 @@
+#include "net/Message.hpp"
+
+namespace battleship::net {
+
+FrameHeader encode_frame_header(MessageType type, std::size_t payload_size) noexcept {
+  const auto len = static_cast<uint16_t>(payload_size);
+  return {static_cast<char>(type), static_cast<char>(len >> 8),
+          static_cast<char>(len & 0xFF)};
+}
+
+std::size_t frame_size(const char *header) noexcept {
+  const std::size_t len = (static_cast<uint8_t>(header[1]) << 8) |
+                          static_cast<uint8_t>(header[2]);
+  return FRAME_HEADER_SIZE + len;
+}
+
+std::optional<MessageView> parse_frame(std::string_view data) noexcept {
+  if (data.size() < FRAME_HEADER_SIZE) {
+    return std::nullopt;
+  }
+  const std::size_t size = frame_size(data.data());
+  if (data.size() < size) {
+    return std::nullopt;
+  }
+  return MessageView{static_cast<MessageType>(static_cast<uint8_t>(data[0])),
+                     data.substr(FRAME_HEADER_SIZE, size - FRAME_HEADER_SIZE)};
+}
+
+StreamHeader encode_stream_header(StreamId stream, MessageType type) noexcept {
+  return {static_cast<char>(stream >> 24), static_cast<char>(stream >> 16),
+          static_cast<char>(stream >> 8), static_cast<char>(stream),
+          static_cast<char>(type)};
+}
+
+std::optional<StreamView> parse_stream(std::string_view payload) noexcept {
+  if (payload.size() < STREAM_HEADER_SIZE) {
+    return std::nullopt;
+  }
+  StreamId stream = 0;
+  for (std::size_t i = 0; i < 4; ++i) {
+    stream = (stream << 8) | static_cast<uint8_t>(payload[i]);
+  }
+  return StreamView{stream,
+                    MessageView{static_cast<MessageType>(static_cast<uint8_t>(payload[4])),
+                                payload.substr(STREAM_HEADER_SIZE)}};
+}
+
+std::string Message::serialize() const {
+  const FrameHeader header = encode_frame_header(type, payload.size());
+
+  std::string result;
+  result.reserve(FRAME_HEADER_SIZE + payload.size());
+  result.append(header.data(), header.size());
+  result += payload;
+  return result;
+}
+
+std::optional<Message> Message::deserialize(std::string_view data) {
+  const auto view = parse_frame(data);
+  if (!view) {
+    return std::nullopt;
+  }
+  return copy_of(*view);
+}
+
+} // namespace battleship::net
@@ -0,0 +1,470 @@
+#include "net/MoveLog.hpp"
+#include "MappedFile.hpp"
+#include "Replay.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace battleship::net {
+
+namespace {
+
+constexpr std::size_t START_SIZE = 32;
+constexpr std::size_t SHOT_SIZE = 10;
+constexpr std::size_t END_SIZE = 8;
+constexpr std::size_t MAX_RECORD_SIZE = MoveLog::RECORD_HEADER_SIZE + START_SIZE;
+
+constexpr std::string_view SEGMENT_PREFIX = "moves-";
+constexpr std::string_view SEGMENT_EXTENSION = ".wal";
+
+void put_u16(uint8_t *out, uint16_t value) noexcept {
+  out[0] = static_cast<uint8_t>(value & 0xFF);
+  out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void put_u32(uint8_t *out, uint32_t value) noexcept {
+  for (std::size_t i = 0; i < 4; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+void put_u64(uint8_t *out, uint64_t value) noexcept {
+  for (std::size_t i = 0; i < 8; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint16_t get_u16(const uint8_t *in) noexcept {
+  return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t get_u32(const uint8_t *in) noexcept {
+  uint32_t value = 0;
+  for (std::size_t i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+uint64_t get_u64(const uint8_t *in) noexcept {
+  uint64_t value = 0;
+  for (std::size_t i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+// Catches torn and garbled records, not malice
+uint32_t fnv1a(const uint8_t *data, std::size_t size) noexcept {
+  uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Frames one record into `out`, returning its size
+std::size_t encode_record(uint8_t *out, uint8_t type, const uint8_t *body,
+                          std::size_t size) noexcept {
+  out[4] = type;
+  out[5] = static_cast<uint8_t>(size);
+  std::memcpy(out + MoveLog::RECORD_HEADER_SIZE, body, size);
+  put_u32(out, fnv1a(out + 4, MoveLog::RECORD_HEADER_SIZE - 4 + size));
+  return MoveLog::RECORD_HEADER_SIZE + size;
+}
+
+std::array<uint8_t, START_SIZE> start_body(uint64_t match, uint64_t seed,
+                                           const std::array<uint64_t, 2> &sessions) {
+  std::array<uint8_t, START_SIZE> body{};
+  put_u64(body.data(), match);
+  put_u64(body.data() + 8, seed);
+  put_u64(body.data() + 16, sessions[0]);
+  put_u64(body.data() + 24, sessions[1]);
+  return body;
+}
+
+std::array<uint8_t, SHOT_SIZE> shot_body(uint64_t match, std::size_t shooter,
+                                         const Position &cell) {
+  std::array<uint8_t, SHOT_SIZE> body{};
+  put_u64(body.data(), match);
+  body[8] = static_cast<uint8_t>(shooter);
+  body[9] = replay::encode_cell(cell);
+  return body;
+}
+
+// Segment number from "moves-NNNNNNNN.wal", nullopt for anything else
+std::optional<uint32_t> segment_number(const std::filesystem::path &path) {
+  const std::string name = path.filename().string();
+  if (!name.starts_with(SEGMENT_PREFIX) || !name.ends_with(SEGMENT_EXTENSION)) {
+    return std::nullopt;
+  }
+  const char *first = name.data() + SEGMENT_PREFIX.size();
+  const char *last = name.data() + name.size() - SEGMENT_EXTENSION.size();
+  uint32_t number = 0;
+  const auto [ptr, ec] = std::from_chars(first, last, number);
+  if (ec != std::errc{} || ptr != last) {
+    return std::nullopt;
+  }
+  return number;
+}
+
+} // namespace
+
+// ============================================================================
+// Recovery
+// ============================================================================
+
+MoveLog::MoveLog(std::filesystem::path directory,
+                 std::chrono::microseconds batch_delay)
+    : m_directory(std::move(directory)), m_batch_delay(batch_delay) {
+  std::filesystem::create_directories(m_directory);
+
+  std::map<uint32_t, std::filesystem::path> segments;
+  for (const auto &entry : std::filesystem::directory_iterator(m_directory)) {
+    if (const auto number = segment_number(entry.path())) {
+      segments.emplace(*number, entry.path());
+    } else if (entry.path().extension() == ".tmp") {
+      std::filesystem::remove(entry.path()); // checkpoint a crash cut short
+    }
+  }
+  recover(segments);
+
+  // Checkpoint: the unfinished matches alone, in a segment that only
+  // appears once complete, so the old ones can go
+  const uint32_t first = segments.empty() ? 1 : segments.rbegin()->first + 1;
+  const std::filesystem::path staging = segment_path(first).string() + ".tmp";
+  m_fd = ::open(staging.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (m_fd < 0) {
+    throw std::runtime_error(std::format("Cannot create move log {}", staging.string()));
+  }
+  m_segment = first;
+  m_first_segment = first;
+
+  std::array<uint8_t, SEGMENT_HEADER_SIZE> header{};
+  std::memcpy(header.data(), MAGIC.data(), MAGIC.size());
+  put_u16(header.data() + 8, VERSION);
+  put_u64(header.data() + 16, m_next_match.load());
+  std::vector<uint8_t> checkpoint(header.begin(), header.end());
+
+  std::array<uint8_t, MAX_RECORD_SIZE> record{};
+  const auto add = [&](Record type, std::span<const uint8_t> body) {
+    const std::size_t size =
+        encode_record(record.data(), static_cast<uint8_t>(type), body.data(), body.size());
+    checkpoint.insert(checkpoint.end(), record.begin(), record.begin() + size);
+  };
+  for (const Match &match : m_recovered) {
+    add(Record::START, start_body(match.id, match.seed, match.sessions));
+    for (const Shot &shot : match.shots) {
+      add(Record::SHOT, shot_body(match.id, shot.shooter, shot.cell));
+    }
+    m_live_since.emplace(match.id, m_segment);
+  }
+  write_all(checkpoint.data(), checkpoint.size());
+  if (::fdatasync(m_fd) != 0) {
+    throw std::runtime_error("Cannot sync move log");
+  }
+  m_segment_bytes = checkpoint.size();
+
+  std::filesystem::rename(staging, segment_path(first));
+  sync_directory();
+  for (const auto &[number, path] : segments) {
+    std::filesystem::remove(path);
+  }
+  sync_directory();
+
+  m_writer = std::thread([this] { writer_loop(); });
+}
+
+MoveLog::~MoveLog() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_one();
+  if (m_writer.joinable()) {
+    m_writer.join();
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+}
+
+std::filesystem::path MoveLog::segment_path(uint32_t segment) const {
+  return m_directory / std::format("{}{:08}{}", SEGMENT_PREFIX, segment, SEGMENT_EXTENSION);
+}
+
+// Only the newest segment may end in a torn record: older ones were synced
+// in full before the next was created
+void MoveLog::recover(const std::map<uint32_t, std::filesystem::path> &segments) {
+  std::map<uint64_t, Match> live;
+
+  for (auto it = segments.begin(); it != segments.end(); ++it) {
+    const bool newest = std::next(it) == segments.end();
+    const MappedFile file(it->second.string());
+    const std::span<const uint8_t> bytes = file.bytes();
+    const auto corrupt = [&] {
+      return std::runtime_error(std::format("Corrupt move log {}", file.path()));
+    };
+
+    if (bytes.size() < SEGMENT_HEADER_SIZE ||
+        std::memcmp(bytes.data(), MAGIC.data(), MAGIC.size()) != 0 ||
+        get_u16(bytes.data() + 8) != VERSION) {
+      throw corrupt();
+    }
+    m_next_match = std::max(m_next_match.load(), get_u64(bytes.data() + 16));
+
+    std::size_t offset = SEGMENT_HEADER_SIZE;
+    while (offset < bytes.size()) {
+      const uint8_t *record = bytes.data() + offset;
+      const std::size_t left = bytes.size() - offset;
+      if (left < RECORD_HEADER_SIZE || left < RECORD_HEADER_SIZE + record[5] ||
+          get_u32(record) != fnv1a(record + 4, RECORD_HEADER_SIZE - 4 + record[5])) {
+        if (!newest) {
+          throw corrupt();
+        }
+        break; // torn tail: those shots never reached a player
+      }
+
+      const auto type = static_cast<Record>(record[4]);
+      const std::size_t size = record[5];
+      const uint8_t *body = record + RECORD_HEADER_SIZE;
+      const uint64_t id = size >= 8 ? get_u64(body) : 0;
+
+      if (type == Record::START && size == START_SIZE) {
+        // A repeat comes from a checkpoint and carries the whole match again
+        live[id] = Match{id, get_u64(body + 8), {get_u64(body + 16), get_u64(body + 24)}, {}};
+        m_next_match = std::max(m_next_match.load(), id + 1);
+      } else if (type == Record::SHOT && size == SHOT_SIZE && body[8] < 2 &&
+                 body[9] < replay::CELL_COUNT) {
+        if (const auto match = live.find(id); match != live.end()) {
+          match->second.shots.push_back(Shot{body[8], replay::decode_cell(body[9])});
+        }
+      } else if (type == Record::END && size == END_SIZE) {
+        live.erase(id);
+      } else {
+        throw corrupt();
+      }
+      offset += RECORD_HEADER_SIZE + size;
+    }
+  }
+
+  for (auto &[id, match] : live) {
+    m_recovered.push_back(std::move(match));
+  }
+}
+
+void MoveLog::open_segment(uint32_t segment) {
+  const std::filesystem::path path = segment_path(segment);
+  m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (m_fd < 0) {
+    throw std::runtime_error(std::format("Cannot create move log {}", path.string()));
+  }
+  m_segment = segment;
+
+  std::array<uint8_t, SEGMENT_HEADER_SIZE> header{};
+  std::memcpy(header.data(), MAGIC.data(), MAGIC.size());
+  put_u16(header.data() + 8, VERSION);
+  put_u64(header.data() + 16, m_next_match.load(std::memory_order_relaxed));
+  write_all(header.data(), header.size());
+  if (::fdatasync(m_fd) != 0) {
+    throw std::runtime_error("Cannot sync move log");
+  }
+  m_segment_bytes = header.size();
+  sync_directory();
+}
+
+void MoveLog::write_all(const uint8_t *data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t n = ::write(m_fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Cannot write move log");
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+  }
+}
+
+// Makes segment creation, renames and deletions durable
+void MoveLog::sync_directory() const {
+  const int fd = ::open(m_directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+}
+
+// ============================================================================
+// Appending
+// ============================================================================
+
+uint64_t MoveLog::begin(uint64_t match, uint64_t seed,
+                        const std::array<uint64_t, 2> &sessions) {
+  const auto body = start_body(match, seed, sessions);
+  const Lifecycle started{match, true};
+  return append(Record::START, body.data(), body.size(), &started);
+}
+
+uint64_t MoveLog::shot(uint64_t match, std::size_t shooter, const Position &cell) {
+  const auto body = shot_body(match, shooter, cell);
+  return append(Record::SHOT, body.data(), body.size());
+}
+
+uint64_t MoveLog::end(uint64_t match) {
+  std::array<uint8_t, END_SIZE> body{};
+  put_u64(body.data(), match);
+  const Lifecycle ended{match, false};
+  return append(Record::END, body.data(), body.size(), &ended);
+}
+
+uint64_t MoveLog::append(Record type, const uint8_t *body, std::size_t size,
+                         const Lifecycle *lifecycle) {
+  std::array<uint8_t, MAX_RECORD_SIZE> record{};
+  const std::size_t length =
+      encode_record(record.data(), static_cast<uint8_t>(type), body, size);
+
+  bool wake = false;
+  uint64_t position = 0;
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_pending.empty()) {
+      m_first_pending = std::chrono::steady_clock::now();
+      wake = true;
+    }
+    m_pending.insert(m_pending.end(), record.begin(), record.begin() + length);
+    ++m_pending_records;
+    if (lifecycle) {
+      m_pending_lifecycle.push_back(*lifecycle);
+      if (lifecycle->started) {
+        m_next_match.store(std::max(m_next_match.load(std::memory_order_relaxed),
+                                    lifecycle->match + 1),
+                           std::memory_order_relaxed);
+      }
+    }
+    m_appended += length;
+    position = m_appended;
+    wake = wake || m_pending.size() >= BATCH_LIMIT;
+  }
+  if (wake) {
+    m_wake.notify_one();
+  }
+  return position;
+}
+
+void MoveLog::when_durable(uint64_t position, std::function<void()> done) {
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_durable.load(std::memory_order_relaxed) < position) {
+      m_waiters.push_back(Waiter{position, std::move(done)});
+      return;
+    }
+  }
+  done();
+}
+
+// ============================================================================
+// Group commit
+// ============================================================================
+
+// One write and one fdatasync per batch. A batch closes BATCH_LIMIT bytes
+// or the batch delay after its first record, whichever comes first; records
+// appended during the sync make up the next one.
+void MoveLog::writer_loop() {
+  std::vector<uint8_t> batch;
+  std::vector<Lifecycle> lifecycle;
+  std::vector<Waiter> ready;
+
+  std::unique_lock lock(m_mutex);
+  while (true) {
+    m_wake.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+    if (m_pending.empty()) {
+      break; // stopping with nothing left
+    }
+    if (!m_stopping && m_batch_delay.count() > 0) {
+      m_wake.wait_until(lock, m_first_pending + m_batch_delay, [this] {
+        return m_stopping || m_pending.size() >= BATCH_LIMIT;
+      });
+    }
+
+    batch.swap(m_pending);
+    lifecycle.swap(m_pending_lifecycle);
+    const uint64_t position = m_appended;
+    const uint64_t records = std::exchange(m_pending_records, 0);
+    lock.unlock();
+
+    try {
+      write_all(batch.data(), batch.size());
+      if (::fdatasync(m_fd) != 0) {
+        throw std::runtime_error("Cannot sync move log");
+      }
+      m_segment_bytes += batch.size();
+      for (const Lifecycle &change : lifecycle) {
+        if (change.started) {
+          m_live_since.emplace(change.match, m_segment);
+        } else {
+          m_live_since.erase(change.match);
+        }
+      }
+      if (m_segment_bytes >= SEGMENT_SIZE) {
+        rotate();
+      }
+    } catch (const std::exception &e) {
+      // After a failed fsync the kernel may have dropped the dirty pages;
+      // acknowledging anything more would be a lie
+      std::cerr << "Move log error: " << e.what() << "\n";
+      std::abort();
+    }
+    batch.clear();
+    lifecycle.clear();
+    ++m_commits;
+    m_records += records;
+
+    lock.lock();
+    m_durable.store(position, std::memory_order_release);
+    const auto waiting = std::partition(m_waiters.begin(), m_waiters.end(),
+                                        [position](const Waiter &waiter) {
+                                          return waiter.position > position;
+                                        });
+    std::move(waiting, m_waiters.end(), std::back_inserter(ready));
+    m_waiters.erase(waiting, m_waiters.end());
+    lock.unlock();
+
+    for (const Waiter &waiter : ready) {
+      waiter.done();
+    }
+    ready.clear();
+    lock.lock();
+  }
+}
+
+// Starts the next segment and deletes every segment older than the oldest
+// START a live match still needs
+void MoveLog::rotate() {
+  ::close(m_fd);
+  m_fd = -1;
+  open_segment(m_segment + 1);
+
+  uint32_t needed = m_segment;
+  for (const auto &[match, segment] : m_live_since) {
+    needed = std::min(needed, segment);
+  }
+  for (; m_first_segment < needed; ++m_first_segment) {
+    std::error_code ignored;
+    std::filesystem::remove(segment_path(m_first_segment), ignored);
+  }
+  sync_directory();
+}
+
+} // namespace battleship::net
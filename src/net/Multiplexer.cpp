@@ -0,0 +1,138 @@
+#include "net/Multiplexer.hpp"
+#include "net/Protocol.hpp"
+#include <format>
+#include <stdexcept>
+
+namespace battleship::net {
+
+Multiplexer::Multiplexer(bool initiator) noexcept
+    : m_next_local(initiator ? 1 : 2) {}
+
+StreamId Multiplexer::open() {
+  const StreamId stream = m_next_local;
+  m_next_local += 2;
+  m_streams.try_emplace(stream);
+  return stream;
+}
+
+void Multiplexer::close(StreamId stream) {
+  const auto it = m_streams.find(stream);
+  if (it == m_streams.end()) {
+    return;
+  }
+  if (it->second.waiting.empty()) {
+    m_streams.erase(it);
+  } else {
+    it->second.closed = true;
+  }
+}
+
+void Multiplexer::send(StreamId stream, MessageType type, std::string_view payload) {
+  const auto it = m_streams.find(stream);
+  if (it == m_streams.end()) {
+    return;
+  }
+  Stream &state = it->second;
+  const auto cost = static_cast<uint32_t>(stream_cost(payload.size()));
+  if (state.closed) {
+    return;
+  }
+  if (cost > MAX_FRAME_COST) {
+    throw std::invalid_argument("Frame larger than half a stream window");
+  }
+  if (!state.waiting.empty() || cost > state.credit) {
+    state.waiting.push_back(Pending{type, std::string(payload)});
+    ++m_stalls;
+    return;
+  }
+  state.credit -= cost;
+  push(stream, type, payload);
+}
+
+void Multiplexer::push(StreamId stream, MessageType type, std::string_view payload) {
+  const StreamHeader header = encode_stream_header(stream, type);
+  m_outbox.push(MessageType::STREAM, {header.data(), header.size()}, payload);
+}
+
+std::optional<StreamView> Multiplexer::receive(const MessageView &frame) {
+  if (frame.type == MessageType::STREAM_CREDIT) {
+    on_credit(frame.payload);
+    return std::nullopt;
+  }
+  const auto message = frame.type == MessageType::STREAM
+                           ? parse_stream(frame.payload)
+                           : std::nullopt;
+  if (!message || message->stream == 0) {
+    throw std::runtime_error("Invalid frame on a multiplexed connection");
+  }
+
+  auto it = m_streams.find(message->stream);
+  if (it == m_streams.end()) {
+    // Ids only go up, so an old one is a stream we already closed
+    if (is_local(message->stream) || message->stream <= m_last_remote) {
+      return std::nullopt;
+    }
+    m_last_remote = message->stream;
+    it = m_streams.try_emplace(message->stream).first;
+  }
+
+  Stream &state = it->second;
+  state.buffered += static_cast<uint32_t>(stream_cost(message->message.payload.size()));
+  if (state.buffered > WINDOW) {
+    throw std::runtime_error(
+        std::format("Peer overran the window of stream {}", message->stream));
+  }
+  if (state.closed) {
+    consumed(*message); // nobody reads it, but the peer may wait for the credit
+    return std::nullopt;
+  }
+  return message;
+}
+
+void Multiplexer::consumed(const StreamView &message) {
+  const auto it = m_streams.find(message.stream);
+  if (it == m_streams.end()) {
+    return;
+  }
+  Stream &state = it->second;
+  state.consumed += static_cast<uint32_t>(stream_cost(message.message.payload.size()));
+  if (state.consumed >= WINDOW / 2) {
+    m_outbox.push(MessageType::STREAM_CREDIT,
+                  protocol::encode_credit({message.stream, state.consumed}));
+    state.buffered -= state.consumed;
+    state.consumed = 0;
+  }
+}
+
+void Multiplexer::on_credit(std::string_view payload) {
+  const auto credit = protocol::decode_credit(payload);
+  if (!credit) {
+    throw std::runtime_error("Invalid STREAM_CREDIT");
+  }
+  const auto it = m_streams.find(credit->stream);
+  if (it == m_streams.end()) {
+    return; // closed meanwhile
+  }
+
+  Stream &state = it->second;
+  if (credit->bytes > WINDOW - state.credit) {
+    throw std::runtime_error(
+        std::format("Peer returned more credit than stream {} used", credit->stream));
+  }
+  state.credit += credit->bytes;
+  while (!state.waiting.empty()) {
+    const Pending &next = state.waiting.front();
+    const auto cost = static_cast<uint32_t>(stream_cost(next.payload.size()));
+    if (cost > state.credit) {
+      break;
+    }
+    state.credit -= cost;
+    push(credit->stream, next.type, next.payload);
+    state.waiting.pop_front();
+  }
+  if (state.closed && state.waiting.empty()) {
+    m_streams.erase(it);
+  }
+}
+
+} // namespace battleship::net
@@ -1,59 +1,505 @@
 #include "net/NetworkManager.hpp"
+#include "net/Deadline.hpp"
+#include "net/Protocol.hpp"
+#include <algorithm>
+#include <format>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
 
 namespace battleship::net {
 
-// Message serialization: [type:1][length:2][payload:N]
-std::string Message::serialize() const {
-  std::string result;
-  result.reserve(3 + payload.size());
+namespace {
 
-  result += static_cast<char>(type);
+namespace asio = boost::asio;
+using boost::system::error_code;
+using boost::system::system_error;
+using Clock = std::chrono::steady_clock;
 
-  const uint16_t len = static_cast<uint16_t>(payload.size());
-  result += static_cast<char>(len >> 8);
-  result += static_cast<char>(len & 0xFF);
+// A gap this long between runs of the io_context counts as a stall
+constexpr auto STALL = std::chrono::milliseconds(50);
 
-  result += payload;
-  return result;
+uint64_t now_us() noexcept {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<Micros>(Clock::now().time_since_epoch()).count());
 }
 
-std::optional<Message> Message::deserialize(const std::string &data) {
-  if (data.size() < 3) {
-    return std::nullopt;
+} // namespace
+
+NetworkManager::NetworkManager(Timeouts timeouts)
+    : m_timeouts(timeouts), m_inbox_signal(m_io_context),
+      m_outbox_signal(m_io_context), m_flush_signal(m_io_context),
+      m_ping_timer(m_io_context) {
+  m_inbox_signal.expires_at(asio::steady_timer::time_point::max());
+  m_outbox_signal.expires_at(asio::steady_timer::time_point::max());
+  m_flush_signal.expires_at(asio::steady_timer::time_point::max());
+}
+
+NetworkManager::~NetworkManager() { disconnect(); }
+
+// ============================================================================
+// Async API
+// ============================================================================
+
+awaitable<void> NetworkManager::async_host(uint16_t port) {
+  co_await accept<tcp>(tcp::endpoint(tcp::v4(), port));
+}
+
+awaitable<void> NetworkManager::async_host_local(std::string path) {
+  ::unlink(path.c_str()); // left behind by an earlier host
+  co_await accept<unix_stream>(unix_stream::endpoint(path));
+}
+
+template <typename Protocol>
+awaitable<void> NetworkManager::accept(typename Protocol::endpoint endpoint) {
+  disconnect();
+  const uint64_t cancel_generation = m_cancel_generation;
+
+  using Acceptor = typename Protocol::acceptor;
+  std::unique_ptr<Acceptor> &acceptor = [this]() -> std::unique_ptr<Acceptor> & {
+    if constexpr (std::is_same_v<Protocol, tcp>) {
+      return m_acceptor;
+    } else {
+      return m_local_acceptor;
+    }
+  }();
+  acceptor = std::make_unique<Acceptor>(m_io_context, endpoint);
+  auto transport = std::make_shared<SocketTransport<Protocol>>(m_io_context);
+  m_transport = transport;
+
+  error_code ec;
+  {
+    Deadline deadline(m_io_context, m_timeouts.accept, [&acceptor] {
+      error_code ignored;
+      if (acceptor) {
+        acceptor->cancel(ignored);
+      }
+    });
+    co_await acceptor->async_accept(transport->socket(),
+                                    asio::redirect_error(asio::use_awaitable, ec));
+    deadline.throw_if_failed(ec);
+  }
+  if (cancel_generation != m_cancel_generation) {
+    throw system_error(asio::error::operation_aborted);
   }
 
-  Message msg;
-  msg.type = static_cast<MessageType>(static_cast<uint8_t>(data[0]));
+  on_connected(true);
+  co_await handshake();
+}
 
-  const uint16_t len =
-      (static_cast<uint8_t>(data[1]) << 8) | static_cast<uint8_t>(data[2]);
+awaitable<void> NetworkManager::async_join(std::string host_ip, uint16_t port) {
+  disconnect();
+  const uint64_t cancel_generation = m_cancel_generation;
 
-  if (data.size() < 3 + static_cast<std::size_t>(len)) {
-    return std::nullopt;
+  auto transport = std::make_shared<TcpTransport>(m_io_context);
+  m_transport = transport;
+  m_join_host = host_ip;
+  m_join_port = port;
+
+  error_code ec;
+  {
+    // One budget covers both name resolution and the TCP handshake
+    tcp::resolver resolver(m_io_context);
+    Deadline deadline(m_io_context, m_timeouts.connect, [&resolver, &transport] {
+      resolver.cancel();
+      transport->close();
+    });
+
+    const auto endpoints = co_await resolver.async_resolve(
+        host_ip, std::to_string(port),
+        asio::redirect_error(asio::use_awaitable, ec));
+    deadline.throw_if_failed(ec);
+
+    co_await asio::async_connect(transport->socket(), endpoints,
+                                 asio::redirect_error(asio::use_awaitable, ec));
+    deadline.throw_if_failed(ec);
+  }
+  if (cancel_generation != m_cancel_generation) {
+    throw system_error(asio::error::operation_aborted);
   }
 
-  msg.payload = data.substr(3, len);
-  return msg;
+  on_connected(false);
+  co_await handshake();
 }
 
-NetworkManager::NetworkManager() = default;
+awaitable<void> NetworkManager::async_join_local(std::string path) {
+  disconnect();
+  const uint64_t cancel_generation = m_cancel_generation;
 
-NetworkManager::~NetworkManager() { disconnect(); }
+  auto transport = std::make_shared<UnixTransport>(m_io_context);
+  m_transport = transport;
 
-bool NetworkManager::host(uint16_t port) {
+  error_code ec;
+  {
+    Deadline deadline(m_io_context, m_timeouts.connect,
+                      [&transport] { transport->close(); });
+    co_await transport->socket().async_connect(
+        unix_stream::endpoint(path), asio::redirect_error(asio::use_awaitable, ec));
+    deadline.throw_if_failed(ec);
+  }
+  if (cancel_generation != m_cancel_generation) {
+    throw system_error(asio::error::operation_aborted);
+  }
+
+  on_connected(false);
+  co_await handshake();
+}
+
+awaitable<void> NetworkManager::async_attach(std::unique_ptr<Transport> transport,
+                                             bool is_host) {
+  disconnect();
+  m_transport = std::move(transport);
+  on_connected(is_host);
+  co_await handshake();
+}
+
+awaitable<void> NetworkManager::async_send(Message msg) {
+  if (!m_connected) {
+    throw system_error(asio::error::not_connected);
+  }
+  m_outbox.push(msg.type, msg.payload);
+  co_await async_flush();
+}
+
+// Waits until everything queued has reached the socket
+awaitable<void> NetworkManager::async_flush() {
+  start_writing();
+  while (m_writing && m_connected) {
+    error_code ec;
+    co_await m_flush_signal.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  }
+  if (!m_connected) {
+    throw system_error(asio::error::connection_reset);
+  }
+}
+
+awaitable<Message> NetworkManager::async_receive() {
+  co_return Message::copy_of(co_await async_receive_view());
+}
+
+awaitable<MessageView> NetworkManager::async_receive_view() {
+  const uint64_t cancel_generation = m_cancel_generation;
+
+  // Messages that arrived before a disconnect are still delivered
+  while (!has_message()) {
+    if (!m_connected) {
+      throw system_error(asio::error::not_connected);
+    }
+    if (cancel_generation != m_cancel_generation) {
+      throw system_error(asio::error::operation_aborted);
+    }
+    error_code ec;
+    co_await m_inbox_signal.async_wait(
+        asio::redirect_error(asio::use_awaitable, ec));
+  }
+  co_return *m_inbox.next();
+}
+
+void NetworkManager::cancel() {
+  asio::post(m_io_context, [this] {
+    ++m_cancel_generation;
+    error_code ignored;
+    if (m_acceptor) {
+      m_acceptor->cancel(ignored);
+    }
+    if (m_local_acceptor) {
+      m_local_acceptor->cancel(ignored);
+    }
+    if (m_transport && !m_connected) {
+      m_transport->close(); // aborts a pending connect
+    }
+    m_inbox_signal.cancel();
+  });
+}
+
+void NetworkManager::poll() {
+  begin_pump();
+  m_io_context.restart();
+  m_io_context.poll();
+  end_pump();
+}
+
+// ============================================================================
+// Connection I/O loops
+// ============================================================================
+
+void NetworkManager::on_connected(bool is_host) {
+  ++m_connection_id;
+  m_connected = true;
+  m_is_host = is_host;
+  m_inbox.clear();
+  m_outbox.clear();
+  m_writing = false;
+  m_last_heard = Clock::now();
+  if (m_request.intent != protocol::Intent::RESUME) {
+    m_latency = {}; // a resumed session keeps counting
+  }
+
+  m_transport->set_no_delay(m_no_delay);
+  m_transport->enable_keepalive(m_timeouts.keepalive);
+
+  m_transport->async_read_some(m_inbox.prepare(), *this);
+  write_next();
+}
+
+void NetworkManager::start_writing() {
+  if (!m_writing && m_connected && !m_outbox.empty()) {
+    m_writing = true;
+    m_outbox_signal.cancel();
+  }
+}
+
+// Each side sends HELLO first thing and expects one back within the
+// connect timeout. Anything else means an incompatible peer.
+awaitable<void> NetworkManager::handshake() {
+  std::optional<Message> reply;
+  error_code ec;
   try {
-    m_acceptor = std::make_unique<tcp::acceptor>(
-        m_io_context, tcp::endpoint(tcp::v4(), port));
+    Message hello{MessageType::HELLO, protocol::encode_hello(m_request)};
+    co_await async_send(std::move(hello));
+
+    Deadline deadline(m_io_context, m_timeouts.connect, [this] {
+      ++m_cancel_generation;
+      m_inbox_signal.cancel();
+    });
+    try {
+      reply = co_await async_receive();
+    } catch (const system_error &e) {
+      ec = e.code();
+    }
+    deadline.throw_if_failed(ec);
+  } catch (...) {
+    disconnect();
+    throw;
+  }
 
-    std::cout << "Waiting for opponent on port " << port << "...\n";
+  const auto version = reply->type == MessageType::HELLO
+                           ? protocol::decode_hello(reply->payload)
+                           : std::nullopt;
+  if (version != protocol::VERSION) {
+    disconnect();
+    throw std::runtime_error(
+        version ? std::format("Peer speaks protocol v{}, this build speaks v{}",
+                              *version, protocol::VERSION)
+                : std::string("Peer did not send a protocol handshake"));
+  }
+  const auto request = protocol::decode_hello_request(reply->payload);
+  if (request && request->intent == protocol::Intent::MULTIPLEX) {
+    disconnect();
+    throw std::runtime_error("Peer wants to multiplex games over one connection");
+  }
+}
 
-    m_socket = std::make_unique<tcp::socket>(m_io_context);
-    m_acceptor->accept(*m_socket);
+void NetworkManager::on_connection_lost(uint64_t connection_id,
+                                        const char *what,
+                                        const error_code &ec) {
+  if (connection_id != m_connection_id || !m_connected) {
+    return; // already torn down by disconnect()
+  }
+  // An orderly close (eof) is how every finished game ends
+  if (ec != asio::error::operation_aborted && ec != asio::error::eof) {
+    std::cerr << what << " error: " << ec.message() << "\n";
+  }
+  m_connected = false;
+  m_writing = false;
+  m_outbox.clear();
+  m_inbox_signal.cancel();
+  m_outbox_signal.cancel();
+  m_flush_signal.cancel();
+  m_ping_timer.cancel();
+}
+
+// ============================================================================
+// Control frames
+// ============================================================================
+
+void NetworkManager::drain_control() {
+  while (const auto view = m_inbox.peek()) {
+    if (view->type != MessageType::PING && view->type != MessageType::PONG) {
+      return;
+    }
+    m_inbox.next();
+
+    const auto timestamp = protocol::decode_ping(view->payload);
+    if (!timestamp) {
+      continue;
+    }
+
+    if (view->type == MessageType::PING) {
+      // Answering a PING that waited out our stall would time it for the peer
+      if (!m_draining_stall) {
+        m_outbox.push(MessageType::PONG, view->payload);
+        start_writing();
+      }
+    } else if (Clock::time_point(Micros(*timestamp)) < m_stall_ended) {
+      ++m_latency.stale_samples;
+    } else {
+      ++m_latency.pongs_received;
+      m_latency.record_rtt(Micros(now_us() - *timestamp));
+    }
+  }
+}
 
-    m_connected = true;
-    m_is_host = true;
+bool NetworkManager::has_message() {
+  drain_control();
+  return m_inbox.has_frame();
+}
+
+awaitable<void> NetworkManager::ping_loop(uint64_t connection_id) {
+  while (connection_id == m_connection_id && m_connected) {
+    m_ping_timer.expires_after(m_timeouts.ping);
+    error_code ec;
+    co_await m_ping_timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+    if (ec || connection_id != m_connection_id || !m_connected) {
+      co_return;
+    }
+
+    if (m_timeouts.dead_peer.count() > 0 &&
+        Clock::now() - m_last_heard > m_timeouts.dead_peer) {
+      on_connection_lost(connection_id, "Heartbeat", asio::error::timed_out);
+      m_transport->close();
+      co_return;
+    }
+
+    m_outbox.push(MessageType::PING, protocol::encode_ping(now_us()));
+    ++m_latency.pings_sent;
+    start_writing();
+  }
+}
+
+void NetworkManager::start_pinging() {
+  if (m_connected && m_timeouts.ping.count() > 0) {
+    asio::co_spawn(m_io_context, ping_loop(m_connection_id), asio::detached);
+  }
+}
+
+void NetworkManager::begin_pump() noexcept {
+  const auto now = Clock::now();
+  if (now - m_pump_ended > STALL) {
+    m_stall_ended = now;
+    m_stall_pending = true;
+    // Whatever the peer sent meanwhile has not been read yet
+    m_last_heard = std::max(m_last_heard, now);
+  }
+}
+
+void NetworkManager::end_pump() noexcept { m_pump_ended = Clock::now(); }
+
+// Reads whatever the socket has straight into m_inbox; frames are parsed
+// there only when someone receives them
+void NetworkManager::on_read(Transport &transport, const error_code &ec,
+                             std::size_t bytes) {
+  if (&transport != m_transport.get() || !m_connected) {
+    return; // a connection already torn down
+  }
+  if (ec) {
+    on_connection_lost(m_connection_id, "Receive", ec);
+    return;
+  }
+  m_inbox.commit(bytes);
+  m_last_heard = Clock::now();
+
+  // The first read after a stall holds everything that queued up during it
+  m_draining_stall = std::exchange(m_stall_pending, false);
+  const bool ready = has_message();
+  m_draining_stall = false;
+  if (ready) {
+    m_inbox_signal.cancel();
+  }
+  m_transport->async_read_some(m_inbox.prepare(), *this);
+}
+
+// Everything queued while the previous batch was on the wire goes out
+// together as one gather write
+void NetworkManager::write_next() {
+  if (!m_outbox.empty()) {
+    m_writing = true;
+    m_transport->async_write(m_outbox.take_batch(), *this);
+    return;
+  }
+
+  m_writing = false;
+  m_flush_signal.cancel();
+  m_outbox_signal.async_wait(bind_memory(
+      m_park_memory, [this, connection_id = m_connection_id](const error_code &) {
+        if (connection_id == m_connection_id && m_connected) {
+          write_next();
+        }
+      }));
+}
 
+void NetworkManager::on_written(Transport &transport, const error_code &ec) {
+  if (&transport != m_transport.get() || !m_connected) {
+    return; // buffers already recycled by disconnect()
+  }
+  m_outbox.release_batch();
+  if (ec) {
+    on_connection_lost(m_connection_id, "Send", ec);
+    return;
+  }
+  write_next();
+}
+
+// ============================================================================
+// Blocking API
+// ============================================================================
+
+template <typename T> T NetworkManager::run_blocking(awaitable<T> op) {
+  bool done = false;
+  std::exception_ptr error;
+  std::optional<T> result;
+
+  asio::co_spawn(m_io_context, std::move(op),
+                 [&](std::exception_ptr e, T value) {
+                   done = true;
+                   error = e;
+                   if (!e) {
+                     result.emplace(std::move(value));
+                   }
+                 });
+
+  begin_pump();
+  m_io_context.restart();
+  while (!done && m_io_context.run_one() > 0) {
+  }
+  end_pump();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if (!done) {
+    throw system_error(asio::error::operation_aborted);
+  }
+  return std::move(*result);
+}
+
+template <> void NetworkManager::run_blocking(awaitable<void> op) {
+  bool done = false;
+  std::exception_ptr error;
+
+  asio::co_spawn(m_io_context, std::move(op), [&](std::exception_ptr e) {
+    done = true;
+    error = e;
+  });
+
+  begin_pump();
+  m_io_context.restart();
+  while (!done && m_io_context.run_one() > 0) {
+  }
+  end_pump();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if (!done) {
+    throw system_error(asio::error::operation_aborted);
+  }
+}
+
+bool NetworkManager::host(uint16_t port) {
+  try {
+    std::cout << "Waiting for opponent on port " << port << "...\n" << std::flush;
+    run_blocking(async_host(port));
     std::cout << "Opponent connected!\n";
     return true;
 
@@ -65,18 +511,8 @@ bool NetworkManager::host(uint16_t port) {
 
 bool NetworkManager::join(const std::string &host_ip, uint16_t port) {
   try {
-    m_socket = std::make_unique<tcp::socket>(m_io_context);
-
-    tcp::resolver resolver(m_io_context);
-    auto endpoints = resolver.resolve(host_ip, std::to_string(port));
-
     std::cout << "Connecting to " << host_ip << ":" << port << "...\n";
-
-    boost::asio::connect(*m_socket, endpoints);
-
-    m_connected = true;
-    m_is_host = false;
-
+    run_blocking(async_join(host_ip, port));
     std::cout << "Connected to host!\n";
     return true;
 
@@ -86,123 +522,191 @@ bool NetworkManager::join(const std::string &host_ip, uint16_t port) {
   }
 }
 
-void NetworkManager::disconnect() {
-  if (m_socket && m_socket->is_open()) {
-    boost::system::error_code ec;
-    m_socket->shutdown(tcp::socket::shutdown_both, ec);
-    m_socket->close(ec);
+bool NetworkManager::host_local(const std::string &path) {
+  try {
+    std::cout << "Waiting for opponent on " << path << "...\n";
+    run_blocking(async_host_local(path));
+    std::cout << "Opponent connected!\n";
+    return true;
+
+  } catch (const std::exception &e) {
+    std::cerr << "Host error: " << e.what() << "\n";
+    return false;
   }
-  m_socket.reset();
-  m_acceptor.reset();
-  m_connected = false;
 }
 
-bool NetworkManager::send(const Message &msg) {
-  return send_raw(msg.serialize());
+bool NetworkManager::join_local(const std::string &path) {
+  try {
+    run_blocking(async_join_local(path));
+    return true;
+
+  } catch (const std::exception &e) {
+    std::cerr << "Join error: " << e.what() << "\n";
+    return false;
+  }
 }
 
-std::optional<Message> NetworkManager::receive() {
-  // Read header (3 bytes)
-  auto header = receive_raw(3);
-  if (!header) {
-    return std::nullopt;
+bool NetworkManager::attach(std::unique_ptr<Transport> transport, bool is_host) {
+  try {
+    run_blocking(async_attach(std::move(transport), is_host));
+    return true;
+
+  } catch (const std::exception &e) {
+    std::cerr << "Handshake error: " << e.what() << "\n";
+    return false;
   }
+}
 
-  const uint16_t payload_len = (static_cast<uint8_t>((*header)[1]) << 8) |
-                               static_cast<uint8_t>((*header)[2]);
+bool NetworkManager::resume(uint64_t session) {
+  if (m_join_host.empty()) {
+    return false;
+  }
+  m_request = {protocol::Intent::RESUME, session};
+  const bool resumed = join(m_join_host, m_join_port);
+  m_request = {};
+  return resumed;
+}
 
-  // Read payload
-  std::string full_msg = *header;
-  if (payload_len > 0) {
-    auto payload = receive_raw(payload_len);
-    if (!payload) {
-      return std::nullopt;
-    }
-    full_msg += *payload;
+bool NetworkManager::watch(const std::string &host_ip, uint16_t port,
+                           uint64_t match_id) {
+  m_request = {protocol::Intent::WATCH, match_id};
+  const bool joined = join(host_ip, port);
+  m_request = {};
+  return joined;
+}
+
+void NetworkManager::disconnect() {
+  ++m_connection_id; // retires the running I/O loops
+  if (m_transport) {
+    m_transport->close();
+  }
+  error_code ec;
+  if (m_acceptor) {
+    m_acceptor->close(ec);
+  }
+  if (m_local_acceptor) {
+    m_local_acceptor->close(ec);
   }
 
-  return Message::deserialize(full_msg);
+  // Aborted handlers still queued see a stale connection id and never
+  // touch the transport again; their own reference keeps it alive
+  m_transport.reset();
+  m_acceptor.reset();
+  m_local_acceptor.reset();
+  m_connected = false;
+  m_writing = false;
+  m_outbox.clear();
+  m_inbox_signal.cancel();
+  m_outbox_signal.cancel();
+  m_flush_signal.cancel();
+  m_ping_timer.cancel();
 }
 
-bool NetworkManager::send_attack(const Position &pos) {
-  Message msg;
-  msg.type = MessageType::ATTACK;
-  msg.payload = pos.to_string();
-  return send(msg);
+bool NetworkManager::send(const Message &msg) {
+  return send(msg.type, msg.payload);
 }
 
-bool NetworkManager::send_result(uint8_t result) {
-  Message msg;
-  msg.type = MessageType::RESULT;
-  msg.payload = std::string(1, static_cast<char>(result));
-  return send(msg);
+bool NetworkManager::send(MessageType type, std::string_view payload) {
+  return queue(type, payload) && flush();
 }
 
-bool NetworkManager::send_board_state(const std::string &rendered_board) {
-  Message msg;
-  msg.type = MessageType::BOARD_STATE;
-  msg.payload = rendered_board;
-  return send(msg);
+bool NetworkManager::queue(MessageType type, std::string_view payload) {
+  if (!m_connected) {
+    return false;
+  }
+  m_outbox.push(type, payload);
+  return true;
 }
 
-bool NetworkManager::send_your_turn() {
-  Message msg;
-  msg.type = MessageType::YOUR_TURN;
-  return send(msg);
+// Runs the write loop until it has sent everything; a failure is reported
+// by the write loop itself
+bool NetworkManager::flush() {
+  start_writing();
+  begin_pump();
+  m_io_context.restart();
+  while (m_writing && m_connected && m_io_context.run_one() > 0) {
+  }
+  end_pump();
+  return m_connected;
 }
 
-bool NetworkManager::send_game_over(const std::string &final_screen) {
-  Message msg;
-  msg.type = MessageType::GAME_OVER;
-  msg.payload = final_screen;
-  return send(msg);
+void NetworkManager::set_no_delay(bool enabled) {
+  m_no_delay = enabled;
+  if (m_transport && m_transport->is_open()) {
+    m_transport->set_no_delay(enabled);
+  }
 }
 
-std::optional<Position> NetworkManager::receive_attack() {
-  auto msg = receive();
-  if (!msg || msg->type != MessageType::ATTACK) {
+// Like async_receive(), without a coroutine to spawn per message
+std::optional<Message> NetworkManager::receive() {
+  const uint64_t cancel_generation = m_cancel_generation;
+
+  begin_pump();
+  m_io_context.restart();
+  while (!has_message() && m_connected && cancel_generation == m_cancel_generation &&
+         m_io_context.run_one() > 0) {
+  }
+  end_pump();
+  if (!has_message()) {
     return std::nullopt;
   }
-  return Position::try_parse(msg->payload);
+  return Message::copy_of(*m_inbox.next());
 }
 
-std::optional<uint8_t> NetworkManager::receive_result() {
-  auto msg = receive();
-  if (!msg || msg->type != MessageType::RESULT || msg->payload.empty()) {
+std::optional<Message> NetworkManager::receive_for(std::chrono::milliseconds timeout) {
+  const auto view = receive_view_for(timeout);
+  if (!view) {
     return std::nullopt;
   }
-  return static_cast<uint8_t>(msg->payload[0]);
+  return Message::copy_of(*view);
 }
 
-bool NetworkManager::send_raw(const std::string &data) {
-  if (!m_connected || !m_socket) {
-    return false;
-  }
+std::optional<MessageView>
+NetworkManager::receive_view_for(std::chrono::milliseconds timeout) {
+  const auto deadline = Clock::now() + timeout;
 
-  try {
-    boost::asio::write(*m_socket, boost::asio::buffer(data));
-    return true;
-  } catch (const std::exception &e) {
-    std::cerr << "Send error: " << e.what() << "\n";
-    m_connected = false;
-    return false;
+  begin_pump();
+  m_io_context.restart();
+  m_io_context.poll();
+  while (!has_message() && m_connected &&
+         m_io_context.run_one_until(deadline) > 0) {
   }
+  end_pump();
+  return has_message() ? m_inbox.next() : std::nullopt;
+}
+
+bool NetworkManager::send_attack(const Position &pos) {
+  return send(MessageType::ATTACK, protocol::encode_attack(pos));
+}
+
+bool NetworkManager::send_result(AttackResult result) {
+  return send(MessageType::RESULT, protocol::encode_result(result));
 }
 
-std::optional<std::string> NetworkManager::receive_raw(std::size_t length) {
-  if (!m_connected || !m_socket) {
+bool NetworkManager::send_board_state(const std::string &rendered_board) {
+  return send(MessageType::BOARD_STATE, rendered_board);
+}
+
+bool NetworkManager::send_your_turn() { return send(MessageType::YOUR_TURN); }
+
+bool NetworkManager::send_game_over(const protocol::GameSummary &summary) {
+  return send(MessageType::GAME_OVER, protocol::encode_game_over(summary));
+}
+
+std::optional<Position> NetworkManager::receive_attack() {
+  const auto msg = receive();
+  if (!msg || msg->type != MessageType::ATTACK) {
     return std::nullopt;
   }
+  return protocol::decode_attack(msg->payload);
+}
 
-  try {
-    std::string buffer(length, '\0');
-    boost::asio::read(*m_socket, boost::asio::buffer(buffer));
-    return buffer;
-  } catch (const std::exception &e) {
-    std::cerr << "Receive error: " << e.what() << "\n";
-    m_connected = false;
+std::optional<AttackResult> NetworkManager::receive_result() {
+  auto msg = receive();
+  if (!msg || msg->type != MessageType::RESULT) {
     return std::nullopt;
   }
+  return protocol::decode_result(msg->payload);
 }
 
 } // namespace battleship::net
@@ -0,0 +1,474 @@
+#include "net/Protocol.hpp"
+
+namespace battleship::net::protocol {
+
+namespace {
+
+constexpr std::string_view HELLO_MAGIC = "BS";
+constexpr uint8_t VERTICAL_BIT = 0x80;
+constexpr uint8_t FIRST_FLAG = 0x01;
+constexpr std::size_t CELL_COUNT = config::GRID_SIZE * config::GRID_SIZE;
+constexpr std::size_t SUMMARY_SIZE = 9; // outcome + 4 x u16
+constexpr std::size_t PING_SIZE = 8;
+constexpr std::size_t TOKEN_SIZE = 8;
+constexpr std::size_t CELL_SET_SIZE = (CELL_COUNT + 7) / 8;
+constexpr uint8_t YOUR_TURN_FLAG = 0x01;
+constexpr std::size_t SHOT_SIZE = 3; // shooter, cell, result
+constexpr std::size_t CREDIT_SIZE = 8; // stream id, bytes
+
+char encode_cell(const Position &pos) noexcept {
+  return static_cast<char>(pos.y * config::GRID_SIZE + pos.x);
+}
+
+std::optional<Position> decode_cell(char byte) noexcept {
+  const auto cell = static_cast<uint8_t>(byte);
+  if (cell >= CELL_COUNT) {
+    return std::nullopt;
+  }
+  return Position{static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                  static_cast<config::GridCoord>(cell / config::GRID_SIZE)};
+}
+
+void append_ship(std::string &out, const ShipPlacement &ship) {
+  out += encode_cell(ship.start);
+  out += static_cast<char>(static_cast<uint8_t>(ship.type) |
+                           (ship.orientation == Orientation::VERTICAL ? VERTICAL_BIT
+                                                                      : 0));
+}
+
+std::optional<ShipPlacement> decode_ship(char cell, char shape) {
+  const auto start = decode_cell(cell);
+  const auto bits = static_cast<uint8_t>(shape);
+  const uint8_t length = bits & ~VERTICAL_BIT;
+  if (!start || length < 1 || length > 4) {
+    return std::nullopt;
+  }
+  const bool vertical = (bits & VERTICAL_BIT) != 0;
+  if ((vertical ? start->y : start->x) + length > config::GRID_SIZE) {
+    return std::nullopt;
+  }
+  return ShipPlacement{static_cast<config::ShipType>(length), *start,
+                       vertical ? Orientation::VERTICAL : Orientation::HORIZONTAL};
+}
+
+void append_u16(std::string &out, uint16_t value) {
+  out += static_cast<char>(value >> 8);
+  out += static_cast<char>(value & 0xFF);
+}
+
+uint16_t read_u16(std::string_view data, std::size_t offset) noexcept {
+  return static_cast<uint16_t>((static_cast<uint8_t>(data[offset]) << 8) |
+                               static_cast<uint8_t>(data[offset + 1]));
+}
+
+void append_u32(std::string &out, uint32_t value) {
+  for (std::size_t i = 0; i < 4; ++i) {
+    out += static_cast<char>(value >> (8 * (3 - i)));
+  }
+}
+
+uint32_t read_u32(std::string_view data, std::size_t offset) noexcept {
+  uint32_t value = 0;
+  for (std::size_t i = 0; i < 4; ++i) {
+    value = (value << 8) | static_cast<uint8_t>(data[offset + i]);
+  }
+  return value;
+}
+
+void append_u64(std::string &out, uint64_t value) {
+  for (std::size_t i = 0; i < 8; ++i) {
+    out += static_cast<char>(value >> (8 * (7 - i)));
+  }
+}
+
+uint64_t read_u64(std::string_view data, std::size_t offset) noexcept {
+  uint64_t value = 0;
+  for (std::size_t i = 0; i < 8; ++i) {
+    value = (value << 8) | static_cast<uint8_t>(data[offset + i]);
+  }
+  return value;
+}
+
+void append_cells(std::string &out, const CellSet &cells) {
+  for (std::size_t byte = 0; byte < CELL_SET_SIZE; ++byte) {
+    uint8_t bits = 0;
+    for (std::size_t bit = 0; bit < 8 && byte * 8 + bit < CELL_COUNT; ++bit) {
+      bits |= static_cast<uint8_t>(cells[byte * 8 + bit] << bit);
+    }
+    out += static_cast<char>(bits);
+  }
+}
+
+CellSet read_cells(std::string_view data, std::size_t offset) noexcept {
+  CellSet cells;
+  for (std::size_t cell = 0; cell < CELL_COUNT; ++cell) {
+    cells[cell] = (static_cast<uint8_t>(data[offset + cell / 8]) >> (cell % 8)) & 1;
+  }
+  return cells;
+}
+
+// `count` ships of two bytes each from `offset`
+bool read_ships(std::string_view data, std::size_t offset, std::size_t count,
+                std::vector<ShipPlacement> &out) {
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto ship = decode_ship(data[offset + 2 * i], data[offset + 2 * i + 1]);
+    if (!ship) {
+      return false;
+    }
+    out.push_back(*ship);
+  }
+  return true;
+}
+
+} // namespace
+
+// ============================================================================
+// HELLO, STREAM_CREDIT, PING, ATTACK, RESULT
+// ============================================================================
+
+std::string encode_hello(const HelloRequest &request) {
+  std::string out(HELLO_MAGIC);
+  out += static_cast<char>(VERSION);
+  if (request.intent != Intent::PLAY) {
+    out += static_cast<char>(request.intent);
+    append_u64(out, request.id);
+  }
+  return out;
+}
+
+std::optional<uint8_t> decode_hello(std::string_view payload) {
+  const std::size_t size = HELLO_MAGIC.size() + 1;
+  if ((payload.size() != size && payload.size() != size + 1 + TOKEN_SIZE) ||
+      !payload.starts_with(HELLO_MAGIC)) {
+    return std::nullopt;
+  }
+  return static_cast<uint8_t>(payload[HELLO_MAGIC.size()]);
+}
+
+std::optional<HelloRequest> decode_hello_request(std::string_view payload) {
+  if (!decode_hello(payload)) {
+    return std::nullopt;
+  }
+  const std::size_t offset = HELLO_MAGIC.size() + 1;
+  if (payload.size() == offset) {
+    return HelloRequest{};
+  }
+  const auto intent = static_cast<Intent>(payload[offset]);
+  if (intent != Intent::RESUME && intent != Intent::WATCH &&
+      intent != Intent::MULTIPLEX) {
+    return std::nullopt;
+  }
+  return HelloRequest{intent, read_u64(payload, offset + 1)};
+}
+
+std::string encode_credit(const Credit &credit) {
+  std::string out;
+  out.reserve(CREDIT_SIZE);
+  append_u32(out, credit.stream);
+  append_u32(out, credit.bytes);
+  return out;
+}
+
+std::optional<Credit> decode_credit(std::string_view payload) {
+  if (payload.size() != CREDIT_SIZE) {
+    return std::nullopt;
+  }
+  return Credit{read_u32(payload, 0), read_u32(payload, 4)};
+}
+
+std::string encode_ping(uint64_t timestamp) {
+  std::string out(PING_SIZE, '\0');
+  for (std::size_t i = 0; i < PING_SIZE; ++i) {
+    out[i] = static_cast<char>(timestamp >> (8 * (PING_SIZE - 1 - i)));
+  }
+  return out;
+}
+
+std::optional<uint64_t> decode_ping(std::string_view payload) {
+  if (payload.size() != PING_SIZE) {
+    return std::nullopt;
+  }
+  uint64_t timestamp = 0;
+  for (const char byte : payload) {
+    timestamp = (timestamp << 8) | static_cast<uint8_t>(byte);
+  }
+  return timestamp;
+}
+
+std::string encode_attack(const Position &pos) {
+  return std::string(1, encode_cell(pos));
+}
+
+std::optional<Position> decode_attack(std::string_view payload) {
+  if (payload.size() != 1) {
+    return std::nullopt;
+  }
+  return decode_cell(payload[0]);
+}
+
+std::string encode_result(AttackResult result) {
+  return std::string(1, static_cast<char>(result));
+}
+
+std::optional<AttackResult> decode_result(std::string_view payload) {
+  if (payload.size() != 1 ||
+      static_cast<uint8_t>(payload[0]) >
+          static_cast<uint8_t>(AttackResult::INVALID_COORD)) {
+    return std::nullopt;
+  }
+  return static_cast<AttackResult>(payload[0]);
+}
+
+// ============================================================================
+// Ships
+// ============================================================================
+
+std::vector<Position> ShipPlacement::cells() const {
+  std::vector<Position> out;
+  const auto length = static_cast<uint8_t>(type);
+  out.reserve(length);
+  for (uint8_t i = 0; i < length; ++i) {
+    out.emplace_back(
+        static_cast<config::GridCoord>(
+            start.x + (orientation == Orientation::HORIZONTAL ? i : 0)),
+        static_cast<config::GridCoord>(
+            start.y + (orientation == Orientation::VERTICAL ? i : 0)));
+  }
+  return out;
+}
+
+ShipPlacement ShipPlacement::of(const Ship &ship) {
+  return ShipPlacement{static_cast<config::ShipType>(ship.size()),
+                       ship.positions().front(), ship.orientation()};
+}
+
+std::string encode_sunk(const Ship &ship) {
+  std::string out;
+  append_ship(out, ShipPlacement::of(ship));
+  return out;
+}
+
+std::optional<ShipPlacement> decode_sunk(std::string_view payload) {
+  if (payload.size() != 2) {
+    return std::nullopt;
+  }
+  return decode_ship(payload[0], payload[1]);
+}
+
+std::string encode_game_start(bool first, uint64_t session, const Board &fleet) {
+  std::string out;
+  out.reserve(1 + TOKEN_SIZE + 2 * fleet.ships().size());
+  out += static_cast<char>(first ? FIRST_FLAG : 0);
+  append_u64(out, session);
+  for (const auto &ship : fleet.ships()) {
+    append_ship(out, ShipPlacement::of(*ship));
+  }
+  return out;
+}
+
+std::optional<GameStart> decode_game_start(std::string_view payload) {
+  constexpr std::size_t FLEET_OFFSET = 1 + TOKEN_SIZE;
+  if (payload.size() != FLEET_OFFSET + 2 * std::size_t{config::TOTAL_SHIPS}) {
+    return std::nullopt;
+  }
+
+  GameStart start;
+  start.first = (static_cast<uint8_t>(payload[0]) & FIRST_FLAG) != 0;
+  start.session = read_u64(payload, 1);
+  if (!read_ships(payload, FLEET_OFFSET, config::TOTAL_SHIPS, start.fleet)) {
+    return std::nullopt;
+  }
+  return start;
+}
+
+// ============================================================================
+// GAME_OVER
+// ============================================================================
+
+GameSummary GameSummary::flipped() const noexcept {
+  GameSummary other = *this;
+  if (outcome == Outcome::WIN) {
+    other.outcome = Outcome::LOSS;
+  } else if (outcome == Outcome::LOSS) {
+    other.outcome = Outcome::WIN;
+  }
+  std::swap(other.shots[0], other.shots[1]);
+  std::swap(other.hits[0], other.hits[1]);
+  return other;
+}
+
+std::string encode_game_over(const GameSummary &summary) {
+  std::string out;
+  out.reserve(SUMMARY_SIZE);
+  out += static_cast<char>(summary.outcome);
+  for (std::size_t i = 0; i < 2; ++i) {
+    append_u16(out, summary.shots[i]);
+    append_u16(out, summary.hits[i]);
+  }
+  return out;
+}
+
+std::optional<GameSummary> decode_game_over(std::string_view payload) {
+  if (payload.size() != SUMMARY_SIZE) {
+    return std::nullopt;
+  }
+
+  GameSummary summary;
+  switch (static_cast<Outcome>(payload[0])) {
+  case Outcome::WIN:
+  case Outcome::LOSS:
+  case Outcome::OPPONENT_LEFT:
+  case Outcome::LEFT:
+    summary.outcome = static_cast<Outcome>(payload[0]);
+    break;
+  default:
+    return std::nullopt;
+  }
+  for (std::size_t i = 0; i < 2; ++i) {
+    summary.shots[i] = read_u16(payload, 1 + 4 * i);
+    summary.hits[i] = read_u16(payload, 3 + 4 * i);
+  }
+  return summary;
+}
+
+// ============================================================================
+// SNAPSHOT
+// ============================================================================
+
+// flags, cursor, fleet, three cell sets, sunk count, sunk ships
+std::string encode_snapshot(const Snapshot &snapshot) {
+  std::string out;
+  out.reserve(4 + 2 * snapshot.fleet.size() + 3 * CELL_SET_SIZE + 1 +
+              2 * snapshot.sunk.size());
+  out += static_cast<char>(snapshot.your_turn ? YOUR_TURN_FLAG : 0);
+  append_u16(out, snapshot.cursor);
+  for (const auto &ship : snapshot.fleet) {
+    append_ship(out, ship);
+  }
+  append_cells(out, snapshot.incoming);
+  append_cells(out, snapshot.shots);
+  append_cells(out, snapshot.hits);
+  out += static_cast<char>(snapshot.sunk.size());
+  for (const auto &ship : snapshot.sunk) {
+    append_ship(out, ship);
+  }
+  return out;
+}
+
+std::optional<Snapshot> decode_snapshot(std::string_view payload) {
+  constexpr std::size_t FLEET_OFFSET = 3;
+  constexpr std::size_t CELLS_OFFSET = FLEET_OFFSET + 2 * std::size_t{config::TOTAL_SHIPS};
+  constexpr std::size_t SUNK_OFFSET = CELLS_OFFSET + 3 * CELL_SET_SIZE;
+  if (payload.size() <= SUNK_OFFSET) {
+    return std::nullopt;
+  }
+  const auto sunk_count = static_cast<uint8_t>(payload[SUNK_OFFSET]);
+  if (sunk_count > config::TOTAL_SHIPS ||
+      payload.size() != SUNK_OFFSET + 1 + 2 * std::size_t{sunk_count}) {
+    return std::nullopt;
+  }
+
+  Snapshot snapshot;
+  snapshot.your_turn = (static_cast<uint8_t>(payload[0]) & YOUR_TURN_FLAG) != 0;
+  snapshot.cursor = read_u16(payload, 1);
+  snapshot.incoming = read_cells(payload, CELLS_OFFSET);
+  snapshot.shots = read_cells(payload, CELLS_OFFSET + CELL_SET_SIZE);
+  snapshot.hits = read_cells(payload, CELLS_OFFSET + 2 * CELL_SET_SIZE);
+  if (!read_ships(payload, FLEET_OFFSET, config::TOTAL_SHIPS, snapshot.fleet) ||
+      !read_ships(payload, SUNK_OFFSET + 1, sunk_count, snapshot.sunk)) {
+    return std::nullopt;
+  }
+  return snapshot;
+}
+
+// ============================================================================
+// Spectators: SHOT, MATCH_VIEW
+// ============================================================================
+
+std::string encode_shot(const ShotEvent &shot) {
+  std::string out;
+  out.reserve(SHOT_SIZE + 2);
+  out += static_cast<char>(shot.shooter);
+  out += encode_cell(shot.target);
+  out += static_cast<char>(shot.result);
+  if (shot.sunk) {
+    append_ship(out, *shot.sunk);
+  }
+  return out;
+}
+
+std::optional<ShotEvent> decode_shot(std::string_view payload) {
+  if (payload.size() != SHOT_SIZE && payload.size() != SHOT_SIZE + 2) {
+    return std::nullopt;
+  }
+  const auto target = decode_cell(payload[1]);
+  const auto result = decode_result(payload.substr(2, 1));
+  if (static_cast<uint8_t>(payload[0]) > 1 || !target || !result) {
+    return std::nullopt;
+  }
+
+  ShotEvent shot{static_cast<uint8_t>(payload[0]), *target, *result, std::nullopt};
+  if (payload.size() > SHOT_SIZE) {
+    shot.sunk = decode_ship(payload[3], payload[4]);
+    if (!shot.sunk) {
+      return std::nullopt;
+    }
+  }
+  return shot;
+}
+
+// match id, turn, cursor, then per side: two cell sets, sunk count, sunk ships
+std::string encode_match_view(const MatchView &view) {
+  std::string out;
+  out.reserve(TOKEN_SIZE + 3 + 2 * (2 * CELL_SET_SIZE + 1) +
+              2 * (view.sides[0].sunk.size() + view.sides[1].sunk.size()));
+  append_u64(out, view.match);
+  out += static_cast<char>(view.turn);
+  append_u16(out, view.cursor);
+  for (const auto &side : view.sides) {
+    append_cells(out, side.shots);
+    append_cells(out, side.hits);
+    out += static_cast<char>(side.sunk.size());
+    for (const auto &ship : side.sunk) {
+      append_ship(out, ship);
+    }
+  }
+  return out;
+}
+
+std::optional<MatchView> decode_match_view(std::string_view payload) {
+  constexpr std::size_t SIDES_OFFSET = TOKEN_SIZE + 3;
+  constexpr std::size_t SUNK_OFFSET = 2 * CELL_SET_SIZE; // within a side
+  if (payload.size() < SIDES_OFFSET || static_cast<uint8_t>(payload[TOKEN_SIZE]) > 1) {
+    return std::nullopt;
+  }
+
+  MatchView view;
+  view.match = read_u64(payload, 0);
+  view.turn = static_cast<uint8_t>(payload[TOKEN_SIZE]);
+  view.cursor = read_u16(payload, TOKEN_SIZE + 1);
+
+  std::size_t offset = SIDES_OFFSET;
+  for (auto &side : view.sides) {
+    if (payload.size() <= offset + SUNK_OFFSET) {
+      return std::nullopt;
+    }
+    const auto sunk_count = static_cast<uint8_t>(payload[offset + SUNK_OFFSET]);
+    if (sunk_count > config::TOTAL_SHIPS ||
+        payload.size() < offset + SUNK_OFFSET + 1 + 2 * std::size_t{sunk_count}) {
+      return std::nullopt;
+    }
+    side.shots = read_cells(payload, offset);
+    side.hits = read_cells(payload, offset + CELL_SET_SIZE);
+    if (!read_ships(payload, offset + SUNK_OFFSET + 1, sunk_count, side.sunk)) {
+      return std::nullopt;
+    }
+    offset += SUNK_OFFSET + 1 + 2 * std::size_t{sunk_count};
+  }
+  if (offset != payload.size()) {
+    return std::nullopt;
+  }
+  return view;
+}
+
+} // namespace battleship::net::protocol
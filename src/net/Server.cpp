@@ -0,0 +1,1290 @@
+#include "net/Server.hpp"
+#include "Player.hpp"
+#include "Simulation.hpp"
+#include "net/Deadline.hpp"
+#include "net/MoveLog.hpp"
+#include "net/Protocol.hpp"
+#include <algorithm>
+#include <array>
+#include <csignal>
+#include <deque>
+#include <format>
+#include <iostream>
+#include <memory_resource>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace battleship::net {
+
+namespace {
+
+namespace asio = boost::asio;
+using boost::system::error_code;
+
+using Strand = asio::strand<asio::io_context::executor_type>;
+
+using ReusePort = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+constexpr std::chrono::milliseconds HELLO_TIMEOUT{5000};
+
+// Clients only ever send a few bytes at a time
+constexpr std::size_t CLIENT_RECEIVE_BUFFER = 256;
+
+// Bytes a spectator may fall behind (about 80 shots, several MATCH_VIEWs'
+// worth) before its queue is replaced by one MATCH_VIEW
+constexpr std::size_t SPECTATOR_BACKLOG = 512;
+
+// Kernel send buffer per spectator. Kept small so thousands of watchers
+// cost little memory, and so a stalled one backs up into its queue, where
+// the backlog is compressed, instead of into the kernel.
+constexpr int SPECTATOR_SEND_BUFFER = 4096;
+
+// Match ids and session tokens carry the index of the shard that owns them
+// in their low bits, so whichever shard a resume lands on can route it
+// there without a shared table
+constexpr unsigned SHARD_BITS = 8;
+constexpr uint64_t MAX_SHARDS = uint64_t{1} << SHARD_BITS;
+
+uint64_t random_seed() {
+  std::random_device rd;
+  return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+void pin_to_core([[maybe_unused]] unsigned core) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core % std::max(1u, std::thread::hardware_concurrency()), &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+// A parked client has nothing to say, so EOF or an error means it hung up
+bool peer_alive(int fd) {
+  char byte;
+  const ssize_t n = ::recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+} // namespace
+
+// ============================================================================
+// Connection and Match
+// ============================================================================
+
+struct Server::Connection {
+  explicit Connection(tcp::socket s) : socket(std::move(s)) {}
+
+  tcp::socket socket;
+  bool matched{false}; // lobby strand only
+};
+
+// Everything one io_context owns: its acceptor, lobby, live sessions and
+// the allocator they come from. Lobby and session table are only touched
+// on `control`, which costs nothing when the shard has a single thread.
+class Server::Shard {
+public:
+  Shard(Server &server, unsigned index, int concurrency,
+        const tcp::endpoint &endpoint);
+  ~Shard();
+
+  Server &server;
+  const unsigned index;
+  // Declared first so it outlives every session allocated from it
+  std::unique_ptr<std::pmr::memory_resource> pool;
+  asio::io_context io_context;
+  tcp::acceptor acceptor;
+  Strand control;
+
+  std::deque<std::shared_ptr<Connection>> lobby; // thread-pool mode
+  std::unordered_map<uint64_t, std::shared_ptr<Match>> sessions; // by match id
+  std::unordered_map<uint64_t, std::shared_ptr<Match>> seats; // by session token
+
+  // Numbers this shard's matches, see tag()
+  std::atomic<uint64_t> next_match{0};
+
+  // Written by this shard's threads, read by stats()
+  alignas(64) std::atomic<uint64_t> connections{0};
+  std::atomic<uint64_t> active_matches{0};
+  std::atomic<uint64_t> completed_matches{0};
+  std::atomic<uint64_t> forfeits{0};
+  std::atomic<uint64_t> shots{0};
+  std::atomic<uint64_t> writes{0};
+  std::atomic<uint64_t> resumes{0};
+  std::atomic<uint64_t> spectators{0};
+  std::atomic<uint64_t> catch_ups{0};
+
+  // A match id or session token owned by this shard
+  uint64_t tag(uint64_t value) const noexcept {
+    return (value << SHARD_BITS) | index;
+  }
+
+  awaitable<void> accept_loop();
+  void finish(uint64_t match_id);
+
+  // Hand a reconnected player's or a spectator's socket to its match (on
+  // `control`)
+  void resume(uint64_t session, int fd);
+  void watch(uint64_t match_id, int fd);
+
+  // ANY_MATCH: compares this shard's matches with the most watched one found
+  // so far, then passes the search on (on `control`)
+  void most_watched(int fd, uint64_t best_id, uint32_t best_watchers);
+
+  // Rebuilds an unfinished match found in the move log
+  void restore(const MoveLog::Match &logged);
+
+  // A house AI-vs-AI match for spectators
+  void start_showcase() { start_match(nullptr, nullptr); }
+
+private:
+  awaitable<void> greet(tcp::socket socket);
+  void enqueue(std::shared_ptr<Connection> connection);
+  void watch_lobby(const std::shared_ptr<Connection> &connection);
+  void pair_or_park(tcp::socket socket);
+  void start_match(std::shared_ptr<Connection> first,
+                   std::shared_ptr<Connection> second);
+  void launch(std::shared_ptr<Match> match);
+
+  template <typename T, typename... Args>
+  std::shared_ptr<T> make(Args &&...args) {
+    return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(pool.get()),
+                                   std::forward<Args>(args)...);
+  }
+};
+
+// Two players and both authoritative boards. Runs entirely on one strand:
+// a read loop per player feeds m_events, play() consumes them in order.
+// Everything one event produces is queued and flushed together, so each
+// player gets at most one write per step. A player whose connection drops
+// is marked away and keeps its seat for the resume grace period; the match
+// goes on around it. A showcase match has no connections: both seats are
+// house AIs that move on a timer. With a move log, nothing a shot produces
+// leaves before the shot is on disk.
+class Server::Match : public std::enable_shared_from_this<Match> {
+public:
+  Match(Shard &shard, uint64_t id, std::shared_ptr<Connection> first,
+        std::shared_ptr<Connection> second, uint64_t seed)
+      : m_shard(shard), m_id(id), m_strand(asio::make_strand(shard.io_context)),
+        m_signal(m_strand),
+        m_wake{asio::steady_timer(m_strand), asio::steady_timer(m_strand)},
+        m_sides{Side{first, Player("Player 1",
+                                   first ? PlayerType::HUMAN : PlayerType::AI,
+                                   config::Difficulty::HARD,
+                                   static_cast<uint32_t>(sim::mix64(seed)))},
+                Side{second, Player("Player 2",
+                                    second ? PlayerType::HUMAN : PlayerType::AI,
+                                    config::Difficulty::HARD,
+                                    static_cast<uint32_t>(sim::mix64(seed) >> 32))}} {
+    m_signal.expires_at(asio::steady_timer::time_point::max());
+    for (auto &wake : m_wake) {
+      wake.expires_at(asio::steady_timer::time_point::max());
+    }
+    for (auto &side : m_sides) {
+      side.player.auto_place_ships();
+      side.session = shard.tag(random_seed());
+    }
+  }
+
+  const Strand &executor() const noexcept { return m_strand; }
+  uint64_t id() const noexcept { return m_id; }
+  uint64_t session(std::size_t side) const noexcept { return m_sides[side].session; }
+  bool showcase() const noexcept { return !m_sides[0].connection; }
+
+  // Read off the match strand to pick the most watched match
+  uint32_t watchers() const noexcept {
+    return m_watchers.load(std::memory_order_relaxed);
+  }
+
+  awaitable<void> play(std::shared_ptr<Match> self);
+
+  // Logs the match's START; play() sends nothing until it is durable
+  void log_start(uint64_t seed);
+  // Replays a logged match and marks both seats away. False if a fleet is
+  // already sunk: the log only missed the match's end.
+  bool restore(const MoveLog::Match &logged);
+
+  // Hands a reconnected player's socket to its seat (on the match strand)
+  void resume(std::shared_ptr<Match> self, uint64_t session, int fd);
+
+  // Adds a spectator on this socket (on the match strand)
+  void watch(std::shared_ptr<Match> self, int fd);
+
+private:
+  struct Side {
+    std::shared_ptr<Connection> connection;
+    Player player;
+    ReceiveBuffer inbox{CLIENT_RECEIVE_BUFFER};
+    SendQueue outbox{};
+    bool writing{false}; // its write loop was flushed and is not parked
+
+    uint64_t session{0};    // token that resumes this seat
+    uint64_t generation{0}; // bumped per connection; older loops retire
+    bool away{false};       // dropped, seat held for a resume
+  };
+
+  struct Event {
+    std::size_t side;
+    std::optional<Message> message; // nullopt = disconnected
+  };
+
+  // Only ever sent shared frames, never anything of its own
+  struct Spectator {
+    std::shared_ptr<Connection> connection;
+    BroadcastQueue outbox{};
+    bool writing{false};
+  };
+
+  Shard &m_shard;
+  uint64_t m_id;
+  Strand m_strand;
+  asio::steady_timer m_signal; // cancelled on every new event or drained outbox
+  std::array<asio::steady_timer, 2> m_wake; // a side's parked write loop waits on it
+  std::array<Side, 2> m_sides;
+  std::deque<Event> m_events;
+  std::size_t m_turn{0};
+  uint16_t m_moves{0}; // shots resolved so far
+  bool m_over{false};
+  uint64_t m_logged{0};  // log position just past our latest record
+  bool m_holding{false}; // flush() waits for the log
+
+  std::vector<std::shared_ptr<Spectator>> m_spectators;
+  std::atomic<uint32_t> m_watchers{0};
+  // MATCH_VIEW at m_view_cursor, shared by every spectator catching up
+  SharedFrame m_view;
+  uint16_t m_view_cursor{0};
+
+  void send(std::size_t side, MessageType type, std::string_view payload = {});
+  void flush();
+  awaitable<Event> next_event();
+  awaitable<void> drain();
+  MoveLog *log() const noexcept;
+  awaitable<void> durable();
+  AttackResult apply_shot(std::size_t shooter, const Position &pos);
+  void resolve_shot(std::size_t shooter, std::string_view payload);
+  protocol::GameSummary summary(std::size_t side, protocol::Outcome outcome) const;
+  protocol::Snapshot snapshot(std::size_t side) const;
+  protocol::MatchView match_view() const;
+  awaitable<std::string> house_move();
+
+  // Queues one event to every spectator, encoded once
+  void broadcast(MessageType type, std::string_view payload);
+  SharedFrame catch_up();
+  void drop(const std::shared_ptr<Spectator> &spectator);
+
+  awaitable<void> read_loop(std::shared_ptr<Match> self, std::size_t side,
+                            uint64_t generation);
+  awaitable<void> write_loop(std::shared_ptr<Match> self, std::size_t side);
+  awaitable<void> hold_seat(std::shared_ptr<Match> self, std::size_t side,
+                            uint64_t generation);
+  awaitable<void> spectator_write_loop(std::shared_ptr<Match> self,
+                                       std::shared_ptr<Spectator> spectator);
+  awaitable<void> spectator_hang_up(std::shared_ptr<Match> self,
+                                    std::shared_ptr<Spectator> spectator);
+};
+
+awaitable<void> Server::Match::play(std::shared_ptr<Match> self) {
+  // Fleets and the first YOUR_TURN go out before any event is read
+  try {
+    co_await durable(); // no session token before its match is logged
+    for (std::size_t side = 0; side < m_sides.size(); ++side) {
+      if (!m_sides[side].connection) {
+        continue; // house AI
+      }
+      asio::co_spawn(m_strand, write_loop(self, side), asio::detached);
+      if (m_sides[side].away) {
+        // Restored from the log: wait for a resume
+        asio::co_spawn(m_strand, hold_seat(self, side, 0), asio::detached);
+        continue;
+      }
+      asio::co_spawn(m_strand, read_loop(self, side, 0), asio::detached);
+      send(side, MessageType::GAME_START,
+           protocol::encode_game_start(side == 0, m_sides[side].session,
+                                       m_sides[side].player.board()));
+    }
+
+    send(m_turn, MessageType::YOUR_TURN);
+    flush();
+
+    while (true) {
+      std::string shot;
+      if (!m_sides[m_turn].connection) {
+        shot = co_await house_move();
+      } else {
+        Event event = co_await next_event();
+
+        if (!event.message) {
+          send(1 - event.side, MessageType::GAME_OVER,
+               protocol::encode_game_over(
+                   summary(1 - event.side, protocol::Outcome::OPPONENT_LEFT)));
+          broadcast(MessageType::GAME_OVER,
+                    protocol::encode_game_over(summary(
+                        0, event.side == 0 ? protocol::Outcome::LEFT
+                                           : protocol::Outcome::OPPONENT_LEFT)));
+          ++m_shard.forfeits;
+          break;
+        }
+        // Only the player on turn may act; anything else is ignored
+        if (event.side != m_turn || event.message->type != MessageType::ATTACK) {
+          continue;
+        }
+        shot = std::move(event.message->payload);
+      }
+
+      resolve_shot(m_turn, shot);
+      co_await durable();
+      if (m_sides[1 - m_turn].player.has_lost()) {
+        const auto won = summary(m_turn, protocol::Outcome::WIN);
+        send(m_turn, MessageType::GAME_OVER, protocol::encode_game_over(won));
+        send(1 - m_turn, MessageType::GAME_OVER,
+             protocol::encode_game_over(won.flipped()));
+        broadcast(MessageType::GAME_OVER,
+                  protocol::encode_game_over(m_turn == 0 ? won : won.flipped()));
+        break;
+      }
+      send(m_turn, MessageType::YOUR_TURN);
+      flush();
+    }
+
+    m_over = true;
+    co_await drain();
+  } catch (const std::exception &e) {
+    std::cerr << "Match error: " << e.what() << "\n";
+  }
+  m_over = true;
+  for (auto &wake : m_wake) {
+    wake.cancel(); // parked write loops see the match is over
+  }
+  if (MoveLog *log = this->log()) {
+    log->end(m_id);
+  }
+
+  for (auto &side : m_sides) {
+    if (!side.connection) {
+      continue;
+    }
+    error_code ignored;
+    side.connection->socket.shutdown(tcp::socket::shutdown_both, ignored);
+    side.connection->socket.close(ignored);
+  }
+  // Spectators still being written to go once their queue drains
+  for (const auto &spectator : std::vector(m_spectators)) {
+    if (!spectator->writing) {
+      drop(spectator);
+    }
+  }
+
+  ++m_shard.completed_matches;
+  --m_shard.active_matches;
+  m_shard.finish(m_id);
+  if (showcase()) {
+    m_shard.start_showcase();
+  }
+}
+
+// Applies one ATTACK to the defender's board, passes the turn on a miss and
+// tells both sides and the spectators. An invalid shot leaves the turn.
+void Server::Match::resolve_shot(std::size_t shooter, std::string_view payload) {
+  const std::size_t defender = 1 - shooter;
+  const auto pos = protocol::decode_attack(payload);
+  if (!pos) {
+    send(shooter, MessageType::RESULT,
+         protocol::encode_result(AttackResult::INVALID_COORD));
+    return;
+  }
+
+  const Ship *ship = m_sides[defender].player.board().get_ship_at(*pos);
+  const AttackResult result = apply_shot(shooter, *pos);
+
+  if (result == AttackResult::ALREADY_ATTACKED ||
+      result == AttackResult::INVALID_COORD) {
+    send(shooter, MessageType::RESULT, protocol::encode_result(result));
+    return;
+  }
+
+  ++m_shard.shots;
+  if (MoveLog *log = this->log()) {
+    m_logged = log->shot(m_id, shooter, *pos);
+  }
+
+  if (result == AttackResult::SUNK && ship) {
+    send(shooter, MessageType::RESULT_SUNK, protocol::encode_sunk(*ship));
+  } else {
+    send(shooter, MessageType::RESULT, protocol::encode_result(result));
+  }
+  send(defender, MessageType::ATTACK, protocol::encode_attack(*pos));
+
+  protocol::ShotEvent event{static_cast<uint8_t>(shooter), *pos, result, std::nullopt};
+  if (result == AttackResult::SUNK && ship) {
+    event.sunk = protocol::ShipPlacement::of(*ship);
+  }
+  broadcast(MessageType::SHOT, protocol::encode_shot(event));
+}
+
+// Fires at the defender's board. A valid shot counts as a move and passes
+// the turn on a miss.
+AttackResult Server::Match::apply_shot(std::size_t shooter, const Position &pos) {
+  const AttackResult result = m_sides[1 - shooter].player.receive_attack(pos);
+  if (result == AttackResult::ALREADY_ATTACKED ||
+      result == AttackResult::INVALID_COORD) {
+    return result;
+  }
+
+  m_sides[shooter].player.record_attack_result(pos, result);
+  ++m_moves;
+  if (result == AttackResult::MISS) {
+    m_turn = 1 - shooter;
+  }
+  return result;
+}
+
+// Final tally as seen by `side`
+protocol::GameSummary Server::Match::summary(std::size_t side,
+                                             protocol::Outcome outcome) const {
+  protocol::GameSummary result;
+  result.outcome = outcome;
+  for (std::size_t i = 0; i < 2; ++i) {
+    const Player &player = m_sides[i == 0 ? side : 1 - side].player;
+    result.shots[i] = player.total_attacks();
+    result.hits[i] = player.successful_hits();
+  }
+  return result;
+}
+
+// The match as `side` sees it: its own fleet and the shots on both boards
+protocol::Snapshot Server::Match::snapshot(std::size_t side) const {
+  const Board &own = m_sides[side].player.board();
+  const Board &target = m_sides[1 - side].player.board();
+
+  protocol::Snapshot out;
+  out.your_turn = m_turn == side;
+  out.cursor = m_moves;
+  for (const auto &ship : own.ships()) {
+    out.fleet.push_back(protocol::ShipPlacement::of(*ship));
+  }
+  for (std::size_t cell = 0; cell < out.shots.size(); ++cell) {
+    const Position pos(static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                       static_cast<config::GridCoord>(cell / config::GRID_SIZE));
+    out.incoming[cell] = own.was_attacked(pos);
+    out.shots[cell] = target.was_attacked(pos);
+    out.hits[cell] = out.shots[cell] && target.get_ship_at(pos) != nullptr;
+  }
+  for (const auto &ship : target.ships()) {
+    if (ship->is_sunk()) {
+      out.sunk.push_back(protocol::ShipPlacement::of(*ship));
+    }
+  }
+  return out;
+}
+
+// What every spectator sees: both sides' shooting, no fleets
+protocol::MatchView Server::Match::match_view() const {
+  protocol::MatchView out;
+  out.match = m_id;
+  out.turn = static_cast<uint8_t>(m_turn);
+  out.cursor = m_moves;
+  for (std::size_t side = 0; side < m_sides.size(); ++side) {
+    const Board &target = m_sides[1 - side].player.board();
+    auto &view = out.sides[side];
+    for (std::size_t cell = 0; cell < view.shots.size(); ++cell) {
+      const Position pos(static_cast<config::GridCoord>(cell % config::GRID_SIZE),
+                         static_cast<config::GridCoord>(cell / config::GRID_SIZE));
+      view.shots[cell] = target.was_attacked(pos);
+      view.hits[cell] = view.shots[cell] && target.get_ship_at(pos) != nullptr;
+    }
+    for (const auto &ship : target.ships()) {
+      if (ship->is_sunk()) {
+        view.sunk.push_back(protocol::ShipPlacement::of(*ship));
+      }
+    }
+  }
+  return out;
+}
+
+// A house AI's turn, paced so spectators can follow it
+awaitable<std::string> Server::Match::house_move() {
+  asio::steady_timer timer(m_strand, m_shard.server.m_config.showcase_pace);
+  error_code ec;
+  co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+
+  Player &player = m_sides[m_turn].player;
+  player.set_state(PlayerState::ACTIVE);
+  co_return protocol::encode_attack(player.get_attack());
+}
+
+// Sent on the strand once Server::resume() found the match. The old
+// connection may not have failed yet on our side; it is dropped either way.
+void Server::Match::resume(std::shared_ptr<Match> self, uint64_t session,
+                           int fd) {
+  const auto seat = std::find_if(m_sides.begin(), m_sides.end(),
+                                 [session](const Side &side) {
+                                   return side.session == session;
+                                 });
+  error_code ec;
+  tcp::socket socket(m_shard.io_context);
+  socket.assign(tcp::v4(), fd, ec);
+  if (ec) {
+    ::close(fd);
+    return;
+  }
+  if (m_over || seat == m_sides.end()) {
+    socket.close(ec);
+    return;
+  }
+
+  Side &player = *seat;
+  const std::size_t side = static_cast<std::size_t>(seat - m_sides.begin());
+  player.connection->socket.close(ec);
+  player.connection = std::make_shared<Connection>(std::move(socket));
+  player.away = false;
+  ++player.generation;
+  player.inbox.clear();
+  // Anything queued was meant for the old connection. A batch still in
+  // flight fails on the closed socket and only then is released.
+  player.outbox.drop_queued();
+  ++m_shard.resumes;
+
+  asio::co_spawn(m_strand, read_loop(std::move(self), side, player.generation),
+                 asio::detached);
+  send(side, MessageType::SNAPSHOT, protocol::encode_snapshot(snapshot(side)));
+  if (m_turn == side) {
+    send(side, MessageType::YOUR_TURN);
+  }
+  flush();
+}
+
+void Server::Match::send(std::size_t side, MessageType type,
+                         std::string_view payload) {
+  if (m_sides[side].connection && !m_sides[side].away) {
+    m_sides[side].outbox.push(type, payload);
+  }
+}
+
+// Wakes the write loop of every side with queued messages; anything queued
+// while a batch is in flight follows in the next one
+void Server::Match::flush() {
+  if (m_holding) {
+    return; // durable() flushes once the log caught up
+  }
+  for (std::size_t side = 0; side < m_sides.size(); ++side) {
+    Side &target = m_sides[side];
+    if (!target.writing && !target.outbox.empty()) {
+      target.writing = true;
+      m_wake[side].cancel();
+    }
+  }
+}
+
+awaitable<Server::Match::Event> Server::Match::next_event() {
+  while (m_events.empty()) {
+    error_code ec;
+    co_await m_signal.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  }
+  Event event = std::move(m_events.front());
+  m_events.pop_front();
+  co_return event;
+}
+
+// Waits until every queued message reached its socket (or failed), but no
+// longer than a dropped player's grace (the hello timeout if there is none):
+// a client that stopped reading has its socket closed so the match can end
+awaitable<void> Server::Match::drain() {
+  flush();
+  const auto grace = m_shard.server.m_config.resume_grace;
+  Deadline deadline(m_strand, grace.count() > 0 ? grace : HELLO_TIMEOUT, [this] {
+    for (Side &side : m_sides) {
+      if (side.writing) {
+        error_code ignored;
+        side.connection->socket.close(ignored); // fails the pending write
+      }
+    }
+  });
+  while (m_sides[0].writing || m_sides[1].writing) {
+    error_code ec;
+    co_await m_signal.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  }
+}
+
+// Both loops take the match by shared_ptr so it outlives their I/O, and
+// hold their connection in case a resume replaces it mid-operation
+awaitable<void> Server::Match::read_loop(std::shared_ptr<Match> self,
+                                         std::size_t side, uint64_t generation) {
+  const std::shared_ptr<Connection> connection = m_sides[side].connection;
+  tcp::socket &socket = connection->socket;
+  ReceiveBuffer &inbox = m_sides[side].inbox;
+  error_code ec;
+
+  while (true) {
+    const std::span<char> space = inbox.prepare();
+    const std::size_t bytes = co_await socket.async_read_some(
+        asio::buffer(space.data(), space.size()),
+        asio::redirect_error(asio::use_awaitable, ec));
+    if (ec) {
+      break;
+    }
+
+    inbox.commit(bytes);
+    bool echoed = false;
+    while (const auto view = inbox.next()) {
+      // PINGs are answered here, without waking the match
+      if (view->type == MessageType::PING) {
+        send(side, MessageType::PONG, view->payload);
+        echoed = true;
+        continue;
+      }
+      m_events.push_back(Event{side, Message::copy_of(*view)});
+    }
+    if (echoed) {
+      flush();
+    }
+    m_signal.cancel();
+  }
+
+  Side &player = m_sides[side];
+  if (generation != player.generation) {
+    co_return; // a resumed connection took over
+  }
+  if (!m_over && m_shard.server.m_config.resume_grace.count() > 0) {
+    player.away = true;
+    asio::co_spawn(m_strand, hold_seat(std::move(self), side, generation),
+                   asio::detached);
+    co_return;
+  }
+  m_events.push_back(Event{side, std::nullopt});
+  m_signal.cancel();
+}
+
+// Forfeits the seat unless its player resumed within the grace period
+awaitable<void> Server::Match::hold_seat(std::shared_ptr<Match> /*self*/,
+                                         std::size_t side, uint64_t generation) {
+  asio::steady_timer timer(m_strand, m_shard.server.m_config.resume_grace);
+  error_code ec;
+  co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+
+  const Side &player = m_sides[side];
+  if (player.away && player.generation == generation) {
+    m_events.push_back(Event{side, std::nullopt});
+    m_signal.cancel();
+  }
+}
+
+// One per seat for the whole match, across resumes: sends what flush()
+// released, then parks until the next flush()
+awaitable<void> Server::Match::write_loop(std::shared_ptr<Match> /*self*/,
+                                          std::size_t side) {
+  Side &target = m_sides[side];
+  error_code ec;
+
+  while (true) {
+    if (!target.writing) {
+      if (m_over) {
+        co_return;
+      }
+      co_await m_wake[side].async_wait(
+          asio::redirect_error(asio::use_awaitable, ec));
+      continue;
+    }
+    if (target.outbox.empty()) {
+      target.writing = false;
+      m_signal.cancel(); // drain() waits for this
+      continue;
+    }
+
+    const std::shared_ptr<Connection> connection = target.connection;
+    co_await asio::async_write(connection->socket, target.outbox.take_batch(),
+                               asio::redirect_error(asio::use_awaitable, ec));
+    target.outbox.release_batch();
+    ++m_shard.writes;
+    // Once resumed, the rest goes to the new connection
+    if (ec && connection == target.connection) {
+      target.outbox.clear(); // the read loop reports the disconnect
+    }
+  }
+}
+
+// ============================================================================
+// Spectators
+// ============================================================================
+
+// Sent on the strand once Server::watch() picked the match. The catch-up
+// view is followed by every event from here on.
+void Server::Match::watch(std::shared_ptr<Match> self, int fd) {
+  error_code ec;
+  tcp::socket socket(m_shard.io_context);
+  socket.assign(tcp::v4(), fd, ec);
+  if (ec) {
+    ::close(fd);
+    return;
+  }
+  if (m_over) {
+    socket.close(ec);
+    return;
+  }
+  socket.set_option(asio::socket_base::send_buffer_size(SPECTATOR_SEND_BUFFER), ec);
+
+  auto spectator = std::make_shared<Spectator>(
+      Spectator{std::make_shared<Connection>(std::move(socket))});
+  m_spectators.push_back(spectator);
+  m_watchers.fetch_add(1, std::memory_order_relaxed);
+  ++m_shard.spectators;
+
+  spectator->outbox.push(catch_up());
+  spectator->writing = true;
+  asio::co_spawn(m_strand, spectator_write_loop(self, spectator), asio::detached);
+  asio::co_spawn(m_strand, spectator_hang_up(std::move(self), std::move(spectator)),
+                 asio::detached);
+}
+
+// The frame is built once however many spectators get it. A spectator more
+// than SPECTATOR_BACKLOG behind gets its queue replaced by the current view
+// instead, which already includes this event unless it is the GAME_OVER.
+void Server::Match::broadcast(MessageType type, std::string_view payload) {
+  if (m_spectators.empty()) {
+    return;
+  }
+
+  const SharedFrame frame = make_shared_frame(type, payload);
+  for (const auto &spectator : m_spectators) {
+    BroadcastQueue &outbox = spectator->outbox;
+    if (outbox.backlog() + frame->size() <= SPECTATOR_BACKLOG) {
+      outbox.push(frame);
+    } else {
+      outbox.drop_queued();
+      outbox.push(catch_up());
+      if (type == MessageType::GAME_OVER) {
+        outbox.push(frame);
+      }
+      ++m_shard.catch_ups;
+    }
+
+    if (!spectator->writing) {
+      spectator->writing = true;
+      asio::co_spawn(m_strand, spectator_write_loop(shared_from_this(), spectator),
+                     asio::detached);
+    }
+  }
+}
+
+// The current MATCH_VIEW frame, rebuilt at most once per move
+SharedFrame Server::Match::catch_up() {
+  if (!m_view || m_view_cursor != m_moves) {
+    m_view = make_shared_frame(MessageType::MATCH_VIEW,
+                               protocol::encode_match_view(match_view()));
+    m_view_cursor = m_moves;
+  }
+  return m_view;
+}
+
+void Server::Match::drop(const std::shared_ptr<Spectator> &spectator) {
+  if (std::erase(m_spectators, spectator) == 0) {
+    return; // already gone
+  }
+  m_watchers.fetch_sub(1, std::memory_order_relaxed);
+  error_code ignored;
+  spectator->connection->socket.shutdown(tcp::socket::shutdown_both, ignored);
+  spectator->connection->socket.close(ignored);
+}
+
+awaitable<void> Server::Match::spectator_write_loop(
+    std::shared_ptr<Match> /*self*/, std::shared_ptr<Spectator> spectator) {
+  error_code ec;
+  while (!spectator->outbox.empty()) {
+    co_await asio::async_write(spectator->connection->socket,
+                               spectator->outbox.take_batch(),
+                               asio::redirect_error(asio::use_awaitable, ec));
+    spectator->outbox.release_batch();
+    if (ec) {
+      break;
+    }
+  }
+
+  spectator->writing = false;
+  if (ec || m_over) {
+    drop(spectator);
+  }
+}
+
+// Spectators have nothing to say, so the socket turning readable means
+// they hung up
+awaitable<void> Server::Match::spectator_hang_up(
+    std::shared_ptr<Match> /*self*/, std::shared_ptr<Spectator> spectator) {
+  error_code ec;
+  co_await spectator->connection->socket.async_wait(
+      tcp::socket::wait_read, asio::redirect_error(asio::use_awaitable, ec));
+  drop(spectator);
+}
+
+// ============================================================================
+// Move log
+// ============================================================================
+
+// Showcases are not logged: a restart simply deals new ones
+MoveLog *Server::Match::log() const noexcept {
+  return showcase() ? nullptr : m_shard.server.m_log.get();
+}
+
+void Server::Match::log_start(uint64_t seed) {
+  if (MoveLog *log = this->log()) {
+    m_logged = log->begin(m_id, seed, {m_sides[0].session, m_sides[1].session});
+  }
+}
+
+bool Server::Match::restore(const MoveLog::Match &logged) {
+  for (std::size_t side = 0; side < m_sides.size(); ++side) {
+    m_sides[side].session = logged.sessions[side];
+    m_sides[side].away = true;
+  }
+  for (const MoveLog::Shot &shot : logged.shots) {
+    if (shot.shooter != m_turn) {
+      return false; // not this build's fleets; nothing sensible to resume
+    }
+    apply_shot(shot.shooter, shot.cell);
+  }
+  return !m_sides[0].player.has_lost() && !m_sides[1].player.has_lost();
+}
+
+// Holds this match's outgoing messages until its latest record is on disk.
+// The log's writer thread wakes us through the strand.
+awaitable<void> Server::Match::durable() {
+  MoveLog *log = this->log();
+  if (!log || log->durable() >= m_logged) {
+    co_return;
+  }
+
+  m_holding = true;
+  log->when_durable(m_logged, [self = shared_from_this()] {
+    asio::post(self->m_strand, [self] { self->m_signal.cancel(); });
+  });
+  while (log->durable() < m_logged) {
+    error_code ec;
+    co_await m_signal.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  }
+  m_holding = false;
+}
+
+// ============================================================================
+// Shard
+// ============================================================================
+
+Server::Shard::Shard(Server &owner, unsigned shard_index, int concurrency,
+                     const tcp::endpoint &endpoint)
+    : server(owner), index(shard_index),
+      pool(concurrency == 1
+               ? std::unique_ptr<std::pmr::memory_resource>(
+                     std::make_unique<std::pmr::unsynchronized_pool_resource>())
+               : std::make_unique<std::pmr::synchronized_pool_resource>()),
+      io_context(concurrency), acceptor(io_context),
+      control(asio::make_strand(io_context)) {
+  acceptor.open(endpoint.protocol());
+  acceptor.set_option(tcp::acceptor::reuse_address(true));
+  if (server.m_config.sharded) {
+    acceptor.set_option(ReusePort(true)); // kernel spreads connections
+  }
+  acceptor.bind(endpoint);
+  acceptor.listen(asio::socket_base::max_listen_connections);
+}
+
+Server::Shard::~Shard() {
+  // Sessions hold strands on io_context; release them while it still runs
+  seats.clear();
+  sessions.clear();
+  lobby.clear();
+}
+
+awaitable<void> Server::Shard::accept_loop() {
+  asio::steady_timer backoff(io_context);
+
+  while (true) {
+    error_code ec;
+    tcp::socket socket =
+        co_await acceptor.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+
+    if (ec == asio::error::operation_aborted) {
+      co_return;
+    }
+    if (ec) {
+      // Typically EMFILE: back off instead of spinning on the listen queue
+      std::cerr << "Accept error: " << ec.message() << "\n";
+      backoff.expires_after(std::chrono::milliseconds(100));
+      co_await backoff.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+      continue;
+    }
+
+    socket.set_option(tcp::no_delay(server.m_config.no_delay), ec);
+    enable_keepalive(socket, server.m_config.keepalive);
+    ++connections;
+    asio::co_spawn(asio::make_strand(io_context), greet(std::move(socket)),
+                   asio::detached);
+  }
+}
+
+// Sends our HELLO and waits for the client's. A client on another protocol
+// version still gets ours, so it can report the mismatch, then is dropped.
+awaitable<void> Server::Shard::greet(tcp::socket socket) {
+  error_code ec;
+  FrameHeader header{};
+  std::string payload;
+  {
+    Deadline deadline(co_await asio::this_coro::executor, HELLO_TIMEOUT,
+                      [&socket] {
+                        error_code ignored;
+                        socket.cancel(ignored);
+                      });
+
+    const std::string hello =
+        Message{MessageType::HELLO, protocol::encode_hello()}.serialize();
+    const std::size_t longest_hello =
+        FRAME_HEADER_SIZE +
+        protocol::encode_hello({protocol::Intent::WATCH, 0}).size();
+    co_await asio::async_write(socket, asio::buffer(hello),
+                               asio::redirect_error(asio::use_awaitable, ec));
+    if (!ec) {
+      co_await asio::async_read(socket, asio::buffer(header),
+                                asio::redirect_error(asio::use_awaitable, ec));
+    }
+    // Anything but a short HELLO is not worth reading
+    const std::size_t size = frame_size(header.data());
+    if (!ec && static_cast<MessageType>(header[0]) == MessageType::HELLO &&
+        size <= longest_hello) {
+      payload.resize(size - FRAME_HEADER_SIZE);
+      co_await asio::async_read(socket, asio::buffer(payload),
+                                asio::redirect_error(asio::use_awaitable, ec));
+    }
+  }
+
+  const auto request = protocol::decode_hello_request(payload);
+  // Matches are one per connection here; MULTIPLEX is for peer bot farms
+  if (ec || !request || protocol::decode_hello(payload) != protocol::VERSION ||
+      request->intent == protocol::Intent::MULTIPLEX) {
+    socket.shutdown(tcp::socket::shutdown_both, ec);
+    socket.close(ec);
+    co_return;
+  }
+
+  if (request->intent == protocol::Intent::RESUME) {
+    server.resume(request->id, std::move(socket));
+  } else if (request->intent == protocol::Intent::WATCH) {
+    server.watch(request->id, std::move(socket));
+  } else if (server.m_config.sharded) {
+    pair_or_park(std::move(socket));
+  } else {
+    enqueue(make<Connection>(std::move(socket)));
+  }
+}
+
+void Server::Shard::enqueue(std::shared_ptr<Connection> connection) {
+  asio::post(control, [this, connection = std::move(connection)] {
+    if (lobby.empty()) {
+      lobby.push_back(connection);
+      watch_lobby(connection);
+      return;
+    }
+
+    auto opponent = std::move(lobby.front());
+    lobby.pop_front();
+    opponent->matched = true;
+    error_code ignored;
+    opponent->socket.cancel(ignored); // ends the lobby watch
+    start_match(std::move(opponent), connection);
+  });
+}
+
+// A queued client has nothing to say, so the socket turning readable means
+// it hung up; drop it before it gets paired with a real player
+void Server::Shard::watch_lobby(const std::shared_ptr<Connection> &connection) {
+  connection->socket.async_wait(
+      tcp::socket::wait_read,
+      asio::bind_executor(control, [this, connection](const error_code &) {
+        if (connection->matched) {
+          return;
+        }
+        std::erase(lobby, connection);
+        error_code ignored;
+        connection->socket.close(ignored);
+      }));
+}
+
+// Sharded matchmaking: a single atomic slot holds the waiting player's fd.
+// Whoever finds it occupied takes it and hosts the match on its own core.
+void Server::Shard::pair_or_park(tcp::socket socket) {
+  std::atomic<int> &slot = server.m_parked_fd;
+
+  while (true) {
+    const int parked = slot.exchange(-1, std::memory_order_acq_rel);
+    if (parked >= 0) {
+      if (!peer_alive(parked)) {
+        ::close(parked);
+        continue;
+      }
+      error_code ec;
+      tcp::socket opponent(io_context);
+      opponent.assign(tcp::v4(), parked, ec);
+      if (ec) {
+        ::close(parked);
+        continue;
+      }
+      start_match(make<Connection>(std::move(opponent)),
+                  make<Connection>(std::move(socket)));
+      return;
+    }
+
+    int expected = -1;
+    const int fd = socket.release();
+    if (slot.compare_exchange_strong(expected, fd, std::memory_order_acq_rel)) {
+      return;
+    }
+    // Someone parked first: take back our socket and pair with them
+    error_code ec;
+    socket.assign(tcp::v4(), fd, ec);
+    if (ec) {
+      ::close(fd);
+      return;
+    }
+  }
+}
+
+void Server::Shard::start_match(std::shared_ptr<Connection> first,
+                                std::shared_ptr<Connection> second) {
+  const uint64_t id = tag(next_match++);
+  const uint64_t seed =
+      server.m_config.seed ? sim::game_seed(*server.m_config.seed, id) : random_seed();
+  auto match = make<Match>(*this, id, std::move(first), std::move(second), seed);
+  match->log_start(seed);
+  launch(std::move(match));
+}
+
+void Server::Shard::restore(const MoveLog::Match &logged) {
+  // Closed placeholders until the players resume
+  auto match = make<Match>(*this, logged.id, make<Connection>(tcp::socket(io_context)),
+                           make<Connection>(tcp::socket(io_context)), logged.seed);
+  if (!match->restore(logged)) {
+    server.m_log->end(logged.id);
+    return;
+  }
+  ++server.m_restored;
+  launch(std::move(match));
+}
+
+void Server::Shard::launch(std::shared_ptr<Match> match) {
+  const uint64_t id = match->id();
+  ++active_matches;
+  asio::dispatch(control, [this, id, match] {
+    sessions.emplace(id, match);
+    if (!match->showcase()) {
+      seats.emplace(match->session(0), match);
+      seats.emplace(match->session(1), match);
+    }
+  });
+  asio::co_spawn(match->executor(), match->play(match), asio::detached);
+}
+
+void Server::Shard::finish(uint64_t match_id) {
+  asio::post(control, [this, match_id] {
+    const auto it = sessions.find(match_id);
+    if (it == sessions.end()) {
+      return;
+    }
+    if (!it->second->showcase()) {
+      seats.erase(it->second->session(0));
+      seats.erase(it->second->session(1));
+    }
+    sessions.erase(it);
+  });
+}
+
+void Server::Shard::resume(uint64_t session, int fd) {
+  const auto it = seats.find(session);
+  if (it == seats.end()) {
+    ::close(fd); // match over or never existed
+    return;
+  }
+  asio::post(it->second->executor(), [match = it->second, session, fd] {
+    match->resume(match, session, fd);
+  });
+}
+
+void Server::Shard::watch(uint64_t match_id, int fd) {
+  const auto it = sessions.find(match_id);
+  if (it == sessions.end()) {
+    ::close(fd);
+    return;
+  }
+  asio::post(it->second->executor(),
+             [match = it->second, fd] { match->watch(match, fd); });
+}
+
+// Only ids travel between shards, so every match is released on its own
+void Server::Shard::most_watched(int fd, uint64_t best_id, uint32_t best_watchers) {
+  for (const auto &[id, match] : sessions) {
+    // Most watched, the newest on a tie
+    const uint32_t watchers = match->watchers();
+    if (best_id == protocol::ANY_MATCH || watchers > best_watchers ||
+        (watchers == best_watchers && id > best_id)) {
+      best_id = id;
+      best_watchers = watchers;
+    }
+  }
+
+  if (index + 1 < server.m_shards.size()) {
+    Shard &next = *server.m_shards[index + 1];
+    asio::post(next.control, [&next, fd, best_id, best_watchers] {
+      next.most_watched(fd, best_id, best_watchers);
+    });
+  } else if (best_id == protocol::ANY_MATCH) {
+    ::close(fd); // nothing to watch
+  } else {
+    Shard &owner = server.shard_of(best_id);
+    asio::post(owner.control, [&owner, best_id, fd] { owner.watch(best_id, fd); });
+  }
+}
+
+// ============================================================================
+// Server
+// ============================================================================
+
+Server::Server(ServerConfig config)
+    : m_config(config),
+      m_thread_count(config.threads > 0
+                         ? config.threads
+                         : std::max(1u, std::thread::hardware_concurrency())) {
+  tcp::endpoint endpoint(tcp::v4(), m_config.port);
+
+  const unsigned shard_count = m_config.sharded ? m_thread_count : 1;
+  if (shard_count > MAX_SHARDS) {
+    throw std::invalid_argument(
+        std::format("Sharded mode supports at most {} threads", MAX_SHARDS));
+  }
+  const int concurrency =
+      m_config.sharded ? 1 : static_cast<int>(m_thread_count);
+  for (unsigned i = 0; i < shard_count; ++i) {
+    m_shards.push_back(std::make_unique<Shard>(*this, i, concurrency, endpoint));
+    endpoint.port(m_shards.back()->acceptor.local_endpoint().port());
+  }
+
+  if (!m_config.log_directory.empty()) {
+    m_log = std::make_unique<MoveLog>(m_config.log_directory, m_config.log_delay);
+    // Past every logged id, whichever shard it came from
+    const uint64_t first = (m_log->next_match() + MAX_SHARDS - 1) >> SHARD_BITS;
+    for (auto &shard : m_shards) {
+      shard->next_match = first;
+    }
+    // After a restart with fewer shards, shard_of() still sends a match's
+    // tokens to the shard it is restored on
+    for (const MoveLog::Match &logged : m_log->recovered()) {
+      shard_of(logged.id).restore(logged);
+    }
+  }
+}
+
+Server::~Server() {
+  stop();
+  m_log.reset(); // commits the rest while the shards can still take wake-ups
+  m_shards.clear();
+  if (const int parked = m_parked_fd.exchange(-1); parked >= 0) {
+    ::close(parked);
+  }
+}
+
+void Server::run() {
+  asio::signal_set signals(m_shards.front()->io_context, SIGINT, SIGTERM);
+  signals.async_wait([this](const error_code &ec, int) {
+    if (!ec) {
+      stop();
+    }
+  });
+
+  for (auto &shard : m_shards) {
+    asio::co_spawn(shard->io_context, shard->accept_loop(), asio::detached);
+  }
+  for (unsigned i = 0; i < m_config.showcase; ++i) {
+    Shard &shard = *m_shards[i % m_shards.size()];
+    asio::post(shard.io_context, [&shard] { shard.start_showcase(); });
+  }
+
+  std::vector<std::thread> pool;
+  pool.reserve(m_thread_count - 1);
+  for (unsigned i = 1; i < m_thread_count; ++i) {
+    Shard &shard = *m_shards[m_config.sharded ? i : 0];
+    pool.emplace_back([this, &shard, i] {
+      if (m_config.sharded) {
+        pin_to_core(i);
+      }
+      shard.io_context.run();
+    });
+  }
+  if (m_config.sharded) {
+    pin_to_core(0);
+  }
+  m_shards.front()->io_context.run();
+
+  for (auto &thread : pool) {
+    thread.join();
+  }
+}
+
+void Server::stop() {
+  for (auto &shard : m_shards) {
+    shard->io_context.stop();
+  }
+}
+
+Server::Shard &Server::shard_of(uint64_t tagged) const noexcept {
+  return *m_shards[(tagged & (MAX_SHARDS - 1)) % m_shards.size()];
+}
+
+void Server::resume(uint64_t session, tcp::socket socket) {
+  // The match may live on another shard's io_context: pass the bare fd
+  Shard &owner = shard_of(session);
+  const int fd = socket.release();
+  asio::post(owner.control, [&owner, session, fd] { owner.resume(session, fd); });
+}
+
+void Server::watch(uint64_t match_id, tcp::socket socket) {
+  const int fd = socket.release();
+  if (match_id != protocol::ANY_MATCH) {
+    Shard &owner = shard_of(match_id);
+    asio::post(owner.control, [&owner, match_id, fd] { owner.watch(match_id, fd); });
+    return;
+  }
+  // Asks each shard in turn, from the first
+  Shard &first = *m_shards.front();
+  asio::post(first.control, [&first, fd] {
+    first.most_watched(fd, protocol::ANY_MATCH, 0);
+  });
+}
+
+uint16_t Server::port() const {
+  return m_shards.front()->acceptor.local_endpoint().port();
+}
+
+ServerStats Server::stats() const noexcept {
+  ServerStats totals;
+  for (const auto &shard : m_shards) {
+    totals.connections += shard->connections.load(std::memory_order_relaxed);
+    totals.active_matches += shard->active_matches.load(std::memory_order_relaxed);
+    totals.completed_matches +=
+        shard->completed_matches.load(std::memory_order_relaxed);
+    totals.forfeits += shard->forfeits.load(std::memory_order_relaxed);
+    totals.shots += shard->shots.load(std::memory_order_relaxed);
+    totals.writes += shard->writes.load(std::memory_order_relaxed);
+    totals.resumes += shard->resumes.load(std::memory_order_relaxed);
+    totals.spectators += shard->spectators.load(std::memory_order_relaxed);
+    totals.catch_ups += shard->catch_ups.load(std::memory_order_relaxed);
+  }
+  totals.restored = m_restored;
+  if (m_log) {
+    totals.log_records = m_log->records();
+    totals.log_commits = m_log->commits();
+  }
+  return totals;
+}
+
+} // namespace battleship::net
@@ -0,0 +1,228 @@
+#include "net/Transport.hpp"
+#include <algorithm>
+#include <cstring>
+#ifdef __linux__
+#include <netinet/tcp.h>
+#endif
+
+namespace battleship::net {
+
+namespace asio = boost::asio;
+using boost::system::error_code;
+
+void enable_keepalive(tcp::socket &socket, std::chrono::milliseconds interval) {
+  if (interval.count() <= 0) {
+    return;
+  }
+  error_code ignored;
+  socket.set_option(asio::socket_base::keep_alive(true), ignored);
+#ifdef __linux__
+  using IdleSeconds = asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPIDLE>;
+  using IntervalSeconds = asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPINTVL>;
+  using Probes = asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPCNT>;
+  // Also bounds how long sent data may go unacknowledged
+  using UserTimeout = asio::detail::socket_option::integer<IPPROTO_TCP, TCP_USER_TIMEOUT>;
+
+  const int seconds = static_cast<int>(std::max<int64_t>(
+      1, std::chrono::duration_cast<std::chrono::seconds>(interval).count()));
+  socket.set_option(IdleSeconds(seconds), ignored);
+  socket.set_option(IntervalSeconds(seconds), ignored);
+  socket.set_option(Probes(KEEPALIVE_PROBES), ignored);
+  socket.set_option(UserTimeout(seconds * 1000 * (KEEPALIVE_PROBES + 1)), ignored);
+#endif
+}
+
+// ============================================================================
+// ChannelTransport
+// ============================================================================
+
+std::pair<std::unique_ptr<ChannelTransport>, std::unique_ptr<ChannelTransport>>
+ChannelTransport::make_pair(asio::io_context &first, asio::io_context &second) {
+  auto channel = std::make_shared<Channel>();
+  return {std::unique_ptr<ChannelTransport>(new ChannelTransport(first, channel, 0)),
+          std::unique_ptr<ChannelTransport>(new ChannelTransport(second, channel, 1))};
+}
+
+ChannelTransport::ChannelTransport(asio::io_context &io, std::shared_ptr<Channel> channel,
+                                   std::size_t side)
+    : m_io(io), m_channel(std::move(channel)), m_side(side), m_readable(io),
+      m_writable(io) {
+  m_readable.expires_at(asio::steady_timer::time_point::max());
+  m_writable.expires_at(asio::steady_timer::time_point::max());
+
+  Side &self = m_channel->sides[m_side];
+  const std::lock_guard lock(self.mutex);
+  self.io = &io;
+  self.owner = this;
+}
+
+ChannelTransport::~ChannelTransport() {
+  close();
+  Side &self = m_channel->sides[m_side];
+  const std::lock_guard lock(self.mutex);
+  self.owner = nullptr;
+}
+
+// Posted rather than done here: the peer's timers belong to its thread
+void ChannelTransport::wake_peer(Event event) {
+  const std::size_t peer = 1 - m_side;
+  Side &target = m_channel->sides[peer];
+  const std::lock_guard lock(target.mutex);
+  if (!target.owner) {
+    return;
+  }
+  asio::post(*target.io,
+             bind_memory(target.wake_memory[static_cast<std::size_t>(event)],
+                         [channel = m_channel, peer, event] {
+                           Side &side = channel->sides[peer];
+                           const std::lock_guard lock(side.mutex);
+                           if (ChannelTransport *owner = side.owner) {
+                             (event == Event::READABLE ? owner->m_readable
+                                                       : owner->m_writable)
+                                 .cancel();
+                           }
+                         }));
+}
+
+void ChannelTransport::async_read_some(std::span<char> into, TransportHandler &handler) {
+  m_read_into = into;
+  m_read_handler = &handler;
+  continue_read();
+}
+
+void ChannelTransport::continue_read() {
+  Ring &ring = inbound();
+  error_code ec;
+  std::size_t bytes = 0;
+
+  while (true) {
+    if (!m_open) {
+      ec = asio::error::operation_aborted;
+      break;
+    }
+    const uint64_t read = ring.read.load(std::memory_order_relaxed);
+    const uint64_t available = ring.written.load(std::memory_order_acquire) - read;
+
+    if (available > 0) {
+      bytes = std::min<std::size_t>(available, m_read_into.size());
+      const std::size_t offset = read % CAPACITY;
+      const std::size_t first = std::min(bytes, CAPACITY - offset);
+      std::memcpy(m_read_into.data(), ring.bytes.get() + offset, first);
+      std::memcpy(m_read_into.data() + first, ring.bytes.get(), bytes - first);
+      ring.read.store(read + bytes, std::memory_order_seq_cst);
+      if (ring.writer_waiting.exchange(false)) {
+        wake_peer(Event::WRITABLE);
+      }
+      break;
+    }
+    if (ring.closed.load(std::memory_order_acquire)) {
+      ec = asio::error::eof;
+      break;
+    }
+
+    // Announce the wait, then look again: a write that missed the flag
+    // must have landed before it
+    ring.reader_waiting.store(true, std::memory_order_seq_cst);
+    if (ring.written.load(std::memory_order_seq_cst) == read && !ring.closed.load()) {
+      m_readable.async_wait(bind_memory(
+          m_read_memory, [self = shared_from_this(), this](const error_code &) {
+            inbound().reader_waiting.store(false, std::memory_order_relaxed);
+            continue_read();
+          }));
+      return;
+    }
+    ring.reader_waiting.store(false, std::memory_order_relaxed);
+  }
+
+  asio::post(m_io, bind_memory(m_read_memory, [self = shared_from_this(),
+                                               handler = m_read_handler, ec, bytes] {
+               handler->on_read(*self, ec, bytes);
+             }));
+}
+
+void ChannelTransport::async_write(std::span<const asio::const_buffer> buffers,
+                                   TransportHandler &handler) {
+  m_write_buffers = buffers;
+  m_write_offset = 0;
+  m_write_handler = &handler;
+  continue_write();
+}
+
+void ChannelTransport::continue_write() {
+  Ring &ring = outbound();
+  uint64_t written = ring.written.load(std::memory_order_relaxed);
+  error_code ec;
+
+  // Copies as much as fits, publishing once per batch or when full
+  const auto publish = [&] {
+    ring.written.store(written, std::memory_order_seq_cst);
+    if (ring.reader_waiting.exchange(false)) {
+      wake_peer(Event::READABLE);
+    }
+  };
+
+  while (!m_write_buffers.empty()) {
+    const asio::const_buffer &buffer = m_write_buffers.front();
+    if (m_write_offset == buffer.size()) {
+      m_write_buffers = m_write_buffers.subspan(1);
+      m_write_offset = 0;
+      continue;
+    }
+    if (!m_open) {
+      ec = asio::error::operation_aborted;
+      break;
+    }
+    if (ring.closed.load(std::memory_order_acquire)) {
+      ec = asio::error::broken_pipe;
+      break;
+    }
+
+    const uint64_t read = ring.read.load(std::memory_order_acquire);
+    const std::size_t space = CAPACITY - static_cast<std::size_t>(written - read);
+    if (space == 0) {
+      publish();
+      ring.writer_waiting.store(true, std::memory_order_seq_cst);
+      if (ring.read.load(std::memory_order_seq_cst) == read && !ring.closed.load()) {
+        m_writable.async_wait(bind_memory(
+            m_write_memory, [self = shared_from_this(), this](const error_code &) {
+              outbound().writer_waiting.store(false, std::memory_order_relaxed);
+              continue_write();
+            }));
+        return;
+      }
+      ring.writer_waiting.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    const char *data = static_cast<const char *>(buffer.data()) + m_write_offset;
+    const std::size_t bytes = std::min(buffer.size() - m_write_offset, space);
+    const std::size_t offset = written % CAPACITY;
+    const std::size_t first = std::min(bytes, CAPACITY - offset);
+    std::memcpy(ring.bytes.get() + offset, data, first);
+    std::memcpy(ring.bytes.get(), data + first, bytes - first);
+    written += bytes;
+    m_write_offset += bytes;
+  }
+  publish();
+
+  asio::post(m_io, bind_memory(m_write_memory, [self = shared_from_this(),
+                                                handler = m_write_handler, ec] {
+               handler->on_written(*self, ec);
+             }));
+}
+
+// Like a socket close: the peer still reads what was sent, then eof
+void ChannelTransport::close() noexcept {
+  if (!m_open) {
+    return;
+  }
+  m_open = false;
+  inbound().closed.store(true);
+  outbound().closed.store(true);
+  wake_peer(Event::READABLE);
+  wake_peer(Event::WRITABLE);
+  m_readable.cancel();
+  m_writable.cancel();
+}
+
+} // namespace battleship::net
@@ -0,0 +1,546 @@
+#include "net/Buffers.hpp"
+#include "net/Latency.hpp"
+#include "net/NetworkManager.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+namespace asio = boost::asio;
+using boost::system::error_code;
+using net::awaitable;
+using net::tcp;
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+struct Options {
+  uint16_t listen_port{7778};
+  std::string host{"127.0.0.1"};
+  uint16_t port{net::NetworkManager::DEFAULT_PORT};
+  milliseconds latency{0}; // one way, added to each direction
+  milliseconds jitter{0};  // latency varies by up to this much either way
+  uint64_t bandwidth{0};   // bytes/s each way, 0 = unlimited
+  double reset_rate{0.0};  // chance per frame of resetting the connection
+  uint64_t seed{1};
+  std::string log_path;
+};
+
+constexpr std::size_t RECEIVE_BUFFER = 4096;
+
+void print_usage() {
+  std::cout << "Usage: battleship-netem [options]\n"
+               "  --listen PORT       where peers connect (default 7778)\n"
+               "  --connect HOST:PORT where they are forwarded (default 127.0.0.1:7777)\n"
+               "  --latency MS        one-way delay added each way (default 0)\n"
+               "  --jitter MS         delay varies by up to MS either way (default 0)\n"
+               "  --bandwidth KBIT    cap each direction at KBIT kbit/s (default: none)\n"
+               "  --reset P           chance per message of resetting the connection,\n"
+               "                      e.g. 0.01 (default 0)\n"
+               "  --seed S            seeds jitter and resets (default 1)\n"
+               "  --log FILE          per-message timing as CSV\n";
+}
+
+std::optional<uint64_t> parse_number(std::string_view text) {
+  uint64_t value = 0;
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<double> parse_chance(std::string_view text) {
+  double value = 0.0;
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr != text.data() + text.size() || value < 0.0 ||
+      value > 1.0) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<Options> parse_args(int argc, char **argv) {
+  Options opts;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      return std::nullopt;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << std::format("Missing value for {}\n", arg);
+      return std::nullopt;
+    }
+    const std::string_view value = argv[++i];
+
+    if (arg == "--connect") {
+      const auto colon = value.rfind(':');
+      const auto port = colon == std::string_view::npos
+                            ? std::nullopt
+                            : parse_number(value.substr(colon + 1));
+      if (!port || *port > UINT16_MAX) {
+        std::cerr << std::format("Invalid address (expected HOST:PORT): {}\n", value);
+        return std::nullopt;
+      }
+      opts.host = value.substr(0, colon);
+      opts.port = static_cast<uint16_t>(*port);
+    } else if (arg == "--reset") {
+      const auto chance = parse_chance(value);
+      if (!chance) {
+        std::cerr << std::format("Invalid chance (expected 0 to 1): {}\n", value);
+        return std::nullopt;
+      }
+      opts.reset_rate = *chance;
+    } else if (arg == "--log") {
+      opts.log_path = value;
+    } else {
+      const auto number = parse_number(value);
+      if (!number) {
+        std::cerr << std::format("Invalid number for {}: {}\n", arg, value);
+        return std::nullopt;
+      }
+      if (arg == "--listen" && *number <= UINT16_MAX) {
+        opts.listen_port = static_cast<uint16_t>(*number);
+      } else if (arg == "--latency") {
+        opts.latency = milliseconds(*number);
+      } else if (arg == "--jitter") {
+        opts.jitter = milliseconds(*number);
+      } else if (arg == "--bandwidth") {
+        opts.bandwidth = *number * 1000 / 8;
+      } else if (arg == "--seed") {
+        opts.seed = *number;
+      } else {
+        std::cerr << std::format("Unknown option: {}\n", arg);
+        return std::nullopt;
+      }
+    }
+  }
+  return opts;
+}
+
+std::string_view type_name(net::MessageType type) {
+  switch (type) {
+  case net::MessageType::ATTACK:      return "ATTACK";
+  case net::MessageType::RESULT:      return "RESULT";
+  case net::MessageType::RESULT_SUNK: return "RESULT_SUNK";
+  case net::MessageType::BOARD_STATE: return "BOARD_STATE";
+  case net::MessageType::GAME_START:  return "GAME_START";
+  case net::MessageType::GAME_OVER:   return "GAME_OVER";
+  case net::MessageType::YOUR_TURN:   return "YOUR_TURN";
+  case net::MessageType::PING:        return "PING";
+  case net::MessageType::PONG:        return "PONG";
+  case net::MessageType::HELLO:       return "HELLO";
+  case net::MessageType::SNAPSHOT:    return "SNAPSHOT";
+  case net::MessageType::SHOT:        return "SHOT";
+  case net::MessageType::MATCH_VIEW:  return "MATCH_VIEW";
+  case net::MessageType::STREAM:      return "STREAM";
+  case net::MessageType::STREAM_CREDIT: return "STREAM_CREDIT";
+  }
+  return "UNKNOWN";
+}
+
+// ============================================================================
+// Link model
+// ============================================================================
+
+// UP: the connecting peer to the one behind the proxy; DOWN: the way back
+enum Direction : std::size_t { UP = 0, DOWN = 1 };
+constexpr std::array<std::string_view, 2> DIRECTION_NAMES{"up", "down"};
+
+// A whole frame held back until the impaired link would have delivered
+// it. An empty frame stands for the sender's FIN.
+struct Pending {
+  Clock::time_point arrived;
+  Clock::time_point due;
+  net::MessageType type{};
+  std::string frame;
+};
+
+// One direction of one connection. Frames leave in the order they came:
+// like TCP, a delayed frame holds back everything behind it.
+struct Pipe {
+  explicit Pipe(asio::io_context &io_context) : wake(io_context) {
+    wake.expires_at(asio::steady_timer::time_point::max());
+  }
+
+  std::deque<Pending> queue;
+  asio::steady_timer wake; // cancelled when a frame lands in an empty queue
+  Clock::time_point link_free{}; // the bandwidth cap's sender is busy until then
+  Clock::time_point last_due{};
+  std::optional<Clock::time_point> attack; // unanswered ATTACK sent this way
+};
+
+struct Session {
+  Session(asio::io_context &io_context, uint64_t id, tcp::socket client, uint64_t seed)
+      : id(id), sockets{std::move(client), tcp::socket(io_context)},
+        pipes{Pipe(io_context), Pipe(io_context)}, rng(seed ^ (id * 0x9E3779B97F4A7C15ull)) {}
+
+  uint64_t id;
+  std::array<tcp::socket, 2> sockets; // [UP] reads from the client, [DOWN] from the server
+  std::array<Pipe, 2> pipes;
+  std::mt19937_64 rng;
+  bool closed{false};
+};
+
+using SessionPtr = std::shared_ptr<Session>;
+
+// ============================================================================
+// Proxy
+// ============================================================================
+
+class Proxy {
+public:
+  Proxy(asio::io_context &io_context, const Options &options)
+      : m_io_context(io_context), m_options(options),
+        m_acceptor(io_context, tcp::endpoint(tcp::v4(), options.listen_port)),
+        m_started(Clock::now()) {
+    if (!options.log_path.empty()) {
+      m_log.open(options.log_path);
+      if (!m_log) {
+        throw std::runtime_error(std::format("Cannot write {}", options.log_path));
+      }
+      m_log << "conn,dir,type,bytes,arrived_us,sent_us,held_us,turn_us\n";
+    }
+  }
+
+  awaitable<void> accept_loop();
+  void stop();
+  void report() const;
+
+private:
+  asio::io_context &m_io_context;
+  const Options &m_options;
+  tcp::acceptor m_acceptor;
+  Clock::time_point m_started;
+  std::ofstream m_log;
+
+  uint64_t m_connections{0};
+  uint64_t m_failed{0}; // the forwarding target refused
+  uint64_t m_resets{0}; // injected; a peer hanging up is not counted
+  std::array<uint64_t, 2> m_frames{};
+  std::array<uint64_t, 2> m_bytes{};
+  net::FineHistogram m_held;  // time each frame spent in the proxy
+  net::FineHistogram m_turns; // ATTACK in to its result out, as the shooter sees it
+
+  awaitable<void> serve(SessionPtr session);
+  awaitable<void> read_loop(SessionPtr session, Direction from);
+  awaitable<void> write_loop(SessionPtr session, Direction to);
+
+  void schedule(Session &session, Direction dir, Pending pending);
+  void deliver(Session &session, Direction dir, const Pending &pending,
+               Clock::time_point sent);
+  void reset(Session &session, bool injected);
+
+  int64_t since_start(Clock::time_point t) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - m_started).count();
+  }
+};
+
+awaitable<void> Proxy::accept_loop() {
+  while (m_acceptor.is_open()) {
+    error_code ec;
+    tcp::socket client(m_io_context);
+    co_await m_acceptor.async_accept(client, asio::redirect_error(asio::use_awaitable, ec));
+    if (ec) {
+      continue;
+    }
+    auto session = std::make_shared<Session>(m_io_context, ++m_connections,
+                                             std::move(client), m_options.seed);
+    asio::co_spawn(m_io_context, serve(std::move(session)), asio::detached);
+  }
+}
+
+void Proxy::stop() {
+  error_code ec;
+  m_acceptor.close(ec);
+}
+
+awaitable<void> Proxy::serve(SessionPtr session) {
+  error_code ec;
+  tcp::resolver resolver(m_io_context);
+  const auto endpoints = co_await resolver.async_resolve(
+      m_options.host, std::to_string(m_options.port),
+      asio::redirect_error(asio::use_awaitable, ec));
+  if (!ec) {
+    co_await asio::async_connect(session->sockets[DOWN], endpoints,
+                                 asio::redirect_error(asio::use_awaitable, ec));
+  }
+  if (ec) {
+    ++m_failed;
+    std::cerr << std::format("Connection {}: cannot reach {}:{}: {}\n", session->id,
+                             m_options.host, m_options.port, ec.message());
+    co_return;
+  }
+
+  // The delays are ours to add; Nagle would only blur them
+  for (auto &socket : session->sockets) {
+    socket.set_option(tcp::no_delay(true), ec);
+  }
+
+  for (const Direction dir : {UP, DOWN}) {
+    asio::co_spawn(m_io_context, read_loop(session, dir), asio::detached);
+    asio::co_spawn(m_io_context, write_loop(session, dir), asio::detached);
+  }
+}
+
+// Splits the incoming stream into frames and hands each to the link model
+awaitable<void> Proxy::read_loop(SessionPtr session, Direction from) {
+  net::ReceiveBuffer inbox(RECEIVE_BUFFER);
+  std::bernoulli_distribution reset_roll(m_options.reset_rate);
+  error_code ec;
+
+  while (!session->closed) {
+    const std::span<char> space = inbox.prepare();
+    const std::size_t bytes = co_await session->sockets[from].async_read_some(
+        asio::buffer(space.data(), space.size()),
+        asio::redirect_error(asio::use_awaitable, ec));
+    if (session->closed) {
+      co_return;
+    }
+    const auto arrived = Clock::now();
+    if (ec) {
+      schedule(*session, from, Pending{arrived, arrived, {}, {}}); // pass the FIN on
+      co_return;
+    }
+    inbox.commit(bytes);
+
+    while (const auto view = inbox.next()) {
+      if (m_options.reset_rate > 0.0 && reset_roll(session->rng)) {
+        reset(*session, true);
+        co_return;
+      }
+      const auto header = net::encode_frame_header(view->type, view->payload.size());
+      std::string frame;
+      frame.reserve(header.size() + view->payload.size());
+      frame.append(header.data(), header.size());
+      frame.append(view->payload);
+      schedule(*session, from, Pending{arrived, arrived, view->type, std::move(frame)});
+    }
+  }
+}
+
+// Writes every frame that is due in one go, then sleeps until the next
+awaitable<void> Proxy::write_loop(SessionPtr session, Direction to) {
+  Pipe &pipe = session->pipes[to];
+  tcp::socket &socket = session->sockets[1 - to];
+  std::vector<asio::const_buffer> gather;
+  error_code ec;
+
+  while (!session->closed) {
+    if (pipe.queue.empty()) {
+      pipe.wake.expires_at(asio::steady_timer::time_point::max());
+      co_await pipe.wake.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+      continue;
+    }
+    if (pipe.queue.front().due > Clock::now()) {
+      pipe.wake.expires_at(pipe.queue.front().due);
+      co_await pipe.wake.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+      continue;
+    }
+
+    const auto now = Clock::now();
+    std::size_t batch = 0;
+    bool fin = false;
+    gather.clear();
+    for (const auto &pending : pipe.queue) {
+      if (pending.due > now) {
+        break;
+      }
+      ++batch;
+      if (pending.frame.empty()) {
+        fin = true;
+        break;
+      }
+      gather.push_back(asio::buffer(pending.frame));
+    }
+
+    if (!gather.empty()) {
+      co_await asio::async_write(socket, gather,
+                                 asio::redirect_error(asio::use_awaitable, ec));
+      if (session->closed) {
+        co_return;
+      }
+      if (ec) {
+        reset(*session, false);
+        co_return;
+      }
+    }
+    const auto sent = Clock::now();
+    for (std::size_t i = 0; i < batch; ++i) {
+      if (!pipe.queue.front().frame.empty()) {
+        deliver(*session, to, pipe.queue.front(), sent);
+      }
+      pipe.queue.pop_front();
+    }
+
+    if (fin) {
+      socket.shutdown(tcp::socket::shutdown_send, ec);
+      co_return;
+    }
+  }
+}
+
+// Bandwidth first (the frame waits for the link, then takes size/rate to
+// send), then propagation delay with jitter; never ahead of the frame before
+void Proxy::schedule(Session &session, Direction dir, Pending pending) {
+  Pipe &pipe = session.pipes[dir];
+  Clock::time_point sent = pending.arrived;
+
+  if (m_options.bandwidth > 0 && !pending.frame.empty()) {
+    sent = std::max(sent, pipe.link_free) +
+           std::chrono::microseconds(pending.frame.size() * 1'000'000 /
+                                     m_options.bandwidth);
+    pipe.link_free = sent;
+  }
+
+  auto delay = std::chrono::duration_cast<std::chrono::microseconds>(m_options.latency);
+  if (m_options.jitter.count() > 0) {
+    const auto spread =
+        std::chrono::duration_cast<std::chrono::microseconds>(m_options.jitter).count();
+    std::uniform_int_distribution<int64_t> jitter(-spread, spread);
+    delay = std::max(delay + std::chrono::microseconds(jitter(session.rng)),
+                     std::chrono::microseconds{0});
+  }
+
+  pending.due = std::max(sent + delay, pipe.last_due);
+  pipe.last_due = pending.due;
+
+  if (pending.type == net::MessageType::ATTACK && !pending.frame.empty()) {
+    pipe.attack = pending.arrived;
+  }
+  const bool idle = pipe.queue.empty();
+  pipe.queue.push_back(std::move(pending));
+  if (idle) {
+    pipe.wake.cancel();
+  }
+}
+
+// A result travelling back completes the turn its ATTACK started
+void Proxy::deliver(Session &session, Direction dir, const Pending &pending,
+                    Clock::time_point sent) {
+  const auto held = std::chrono::duration_cast<net::Micros>(sent - pending.arrived);
+  ++m_frames[dir];
+  m_bytes[dir] += pending.frame.size();
+  m_held.add(held);
+
+  std::optional<net::Micros> turn;
+  auto &attack = session.pipes[1 - dir].attack;
+  if (attack && (pending.type == net::MessageType::RESULT ||
+                 pending.type == net::MessageType::RESULT_SUNK)) {
+    turn = std::chrono::duration_cast<net::Micros>(sent - *attack);
+    m_turns.add(*turn);
+    attack.reset();
+  }
+
+  if (m_log.is_open()) {
+    m_log << std::format("{},{},{},{},{},{},{},{}\n", session.id, DIRECTION_NAMES[dir],
+                         type_name(pending.type), pending.frame.size(),
+                         since_start(pending.arrived), since_start(sent), held.count(),
+                         turn ? std::to_string(turn->count()) : std::string{});
+  }
+}
+
+// Both ends get an RST: injected, as if a middlebox dropped the
+// connection, or because one end is gone and the other must not hang
+void Proxy::reset(Session &session, bool injected) {
+  if (session.closed) {
+    return;
+  }
+  session.closed = true;
+
+  error_code ec;
+  for (auto &socket : session.sockets) {
+    socket.set_option(asio::socket_base::linger(true, 0), ec);
+    socket.close(ec);
+  }
+  for (auto &pipe : session.pipes) {
+    pipe.wake.cancel();
+  }
+
+  if (injected) {
+    ++m_resets;
+    if (m_log.is_open()) {
+      const auto now = since_start(Clock::now());
+      m_log << std::format("{},both,RESET,0,{},{},0,\n", session.id, now, now);
+    }
+  }
+}
+
+void Proxy::report() const {
+  const auto ms = [](net::Micros us) { return static_cast<double>(us.count()) / 1000.0; };
+  const auto summary = [&ms](const net::FineHistogram &histogram) {
+    return std::format("mean {:.3f} ms, p50 {:.3f} ms, p99 {:.3f} ms, p999 {:.3f} ms",
+                       histogram.mean_ms(), ms(histogram.percentile(50)),
+                       ms(histogram.percentile(99)), ms(histogram.percentile(99.9)));
+  };
+
+  std::cout << std::format("Connections: {} ({} could not reach the target, {} reset)\n",
+                           m_connections, m_failed, m_resets);
+  for (const Direction dir : {UP, DOWN}) {
+    std::cout << std::format("Frames {:<5} {} ({} bytes)\n",
+                             std::format("{}:", DIRECTION_NAMES[dir]), m_frames[dir],
+                             m_bytes[dir]);
+  }
+  std::cout << std::format("Held:        {}\n", summary(m_held));
+  std::cout << std::format("Turns:       {} (ATTACK in -> result out), {}\n",
+                           m_turns.count(), summary(m_turns));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse_args(argc, argv);
+  if (!options) {
+    print_usage();
+    return 1;
+  }
+
+  try {
+    asio::io_context io_context{1};
+    Proxy proxy(io_context, *options);
+
+    asio::signal_set signals(io_context, SIGINT, SIGTERM);
+    signals.async_wait([&](const error_code &ec, int) {
+      if (!ec) {
+        proxy.stop();
+        io_context.stop();
+      }
+    });
+
+    std::cout << std::format(
+        "Forwarding :{} -> {}:{}, latency {} ms +/- {} ms, bandwidth {}, reset {}\n",
+        options->listen_port, options->host, options->port, options->latency.count(),
+        options->jitter.count(),
+        options->bandwidth > 0 ? std::format("{} kbit/s", options->bandwidth * 8 / 1000)
+                               : std::string("unlimited"),
+        options->reset_rate);
+
+    asio::co_spawn(io_context, proxy.accept_loop(), asio::detached);
+    io_context.run();
+
+    proxy.report();
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
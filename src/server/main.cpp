@@ -0,0 +1,122 @@
+#include "net/Server.hpp"
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+using namespace battleship;
+
+namespace {
+
+void print_usage() {
+  std::cout << "Usage: battleship-server [options]\n"
+               "  --port P         listen port (default 7777)\n"
+               "  --threads T      I/O threads (default: all cores)\n"
+               "  --seed S         deal fleets deterministically from S\n"
+               "  --sharded        one pinned event loop and acceptor per thread\n"
+               "  --nodelay 0|1    TCP_NODELAY on client sockets (default 1)\n"
+               "  --keepalive MS   TCP keepalive period, 0 = off (default 5000)\n"
+               "  --grace MS       how long a dropped player may resume (default 30000)\n"
+               "  --showcase N     keep N AI-vs-AI matches running for spectators\n"
+               "  --pace MS        delay between showcase shots (default 500)\n"
+               "  --log DIR        write-ahead move log; restarts resume its matches\n"
+               "  --log-delay US   longest a log batch waits for more shots (default 1000)\n";
+}
+
+std::optional<uint64_t> parse_number(std::string_view text) {
+  uint64_t value = 0;
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<net::ServerConfig> parse_args(int argc, char **argv) {
+  net::ServerConfig config;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--sharded") {
+      config.sharded = true;
+      continue;
+    }
+    if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+      return std::nullopt;
+    }
+    const std::string_view value = argv[++i];
+    if (arg == "--log") {
+      config.log_directory = value;
+      continue;
+    }
+    const auto number = parse_number(value);
+    if (!number) {
+      std::cerr << std::format("Invalid number for {}: {}\n", arg, value);
+      return std::nullopt;
+    }
+
+    if (arg == "--port" && *number <= UINT16_MAX) {
+      config.port = static_cast<uint16_t>(*number);
+    } else if (arg == "--threads") {
+      config.threads = static_cast<unsigned>(*number);
+    } else if (arg == "--seed") {
+      config.seed = *number;
+    } else if (arg == "--nodelay" && *number <= 1) {
+      config.no_delay = *number != 0;
+    } else if (arg == "--keepalive") {
+      config.keepalive = std::chrono::milliseconds(*number);
+    } else if (arg == "--grace") {
+      config.resume_grace = std::chrono::milliseconds(*number);
+    } else if (arg == "--showcase") {
+      config.showcase = static_cast<unsigned>(*number);
+    } else if (arg == "--pace") {
+      config.showcase_pace = std::chrono::milliseconds(*number);
+    } else if (arg == "--log-delay") {
+      config.log_delay = std::chrono::microseconds(*number);
+    } else {
+      std::cerr << std::format("Unknown option: {}\n", arg);
+      return std::nullopt;
+    }
+  }
+  return config;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto config = parse_args(argc, argv);
+  if (!config) {
+    print_usage();
+    return 1;
+  }
+
+  try {
+    net::Server server(*config);
+    std::cout << std::format("Listening on port {} ({}{})\n", server.port(),
+                             net::IO_BACKEND, config->sharded ? ", sharded" : "");
+    if (!config->log_directory.empty()) {
+      std::cout << std::format("Move log {}: {} unfinished matches restored\n",
+                               config->log_directory, server.stats().restored);
+    }
+    server.run();
+
+    const auto stats = server.stats();
+    std::cout << std::format(
+        "Shut down: {} connections, {} matches ({} forfeited, {} unfinished), "
+        "{} resumes, {} shots, {} writes, {} spectators ({} caught up)\n",
+        stats.connections, stats.completed_matches, stats.forfeits,
+        stats.active_matches, stats.resumes, stats.shots, stats.writes,
+        stats.spectators, stats.catch_ups);
+    if (!config->log_directory.empty()) {
+      std::cout << std::format("Move log: {} records in {} commits\n",
+                               stats.log_records, stats.log_commits);
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
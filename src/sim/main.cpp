@@ -0,0 +1,347 @@
+#include "Engine.hpp"
+#include "Simulation.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <chrono>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+struct Options {
+  uint64_t games{10000};
+  uint64_t seed{1};
+  unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+  sim::MatchConfig match;
+  std::string csv_path;
+  std::string json_path;
+  std::string replay_path;
+  std::string out_prefix;
+  sim::ShardSpec shard;
+  std::string engine;   // external engine against match.second
+  uint64_t pipeline{64}; // engine games in flight per thread
+  std::chrono::milliseconds engine_timeout{engine::EngineClient::DEFAULT_MOVE_TIMEOUT};
+};
+
+void print_usage() {
+  std::cout << "Usage: battleship-sim [options]\n"
+               "       battleship-sim merge --out PREFIX SHARD_PREFIX...\n"
+               "  --games N        games to play (default 10000)\n"
+               "  --seed S         master seed (default 1)\n"
+               "  --threads T      worker threads (default: all cores)\n"
+               "  --first LEVEL    easy|medium|hard, shoots first (default hard)\n"
+               "  --second LEVEL   easy|medium|hard (default hard)\n"
+               "  --csv FILE       write aggregate statistics as CSV\n"
+               "  --json FILE      write aggregate statistics as JSON\n"
+               "  --replay FILE    record every game to a binary replay file\n"
+               "  --shard I/N      play only slice I of N of the game range\n"
+               "  --out PREFIX     write PREFIX.stats and PREFIX.bsr for merge\n"
+               "  --engine CMD     external engine (see Engine.hpp) against --second\n"
+               "  --pipeline K     engine games in flight per thread (default 64)\n"
+               "  --engine-timeout MS  forfeit games the engine leaves unanswered\n"
+               "                   this long (default 10000)\n";
+}
+
+std::optional<uint64_t> parse_number(std::string_view text) {
+  uint64_t value = 0;
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<sim::ShardSpec> parse_shard(std::string_view text) {
+  const auto slash = text.find('/');
+  if (slash == std::string_view::npos) {
+    return std::nullopt;
+  }
+  const auto index = parse_number(text.substr(0, slash));
+  const auto count = parse_number(text.substr(slash + 1));
+  if (!index || !count || *count == 0 || *index >= *count ||
+      *count > UINT32_MAX) {
+    return std::nullopt;
+  }
+  return sim::ShardSpec{static_cast<uint32_t>(*index),
+                        static_cast<uint32_t>(*count)};
+}
+
+std::optional<config::Difficulty> parse_difficulty(std::string_view text) {
+  for (const auto level : {config::Difficulty::EASY, config::Difficulty::MEDIUM,
+                           config::Difficulty::HARD}) {
+    if (text == stats::strategy_name(level)) {
+      return level;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<Options> parse_args(int argc, char **argv) {
+  Options opts;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      return std::nullopt;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << std::format("Missing value for {}\n", arg);
+      return std::nullopt;
+    }
+    const std::string_view value = argv[++i];
+
+    if (arg == "--games" || arg == "--seed" || arg == "--threads" ||
+        arg == "--pipeline" || arg == "--engine-timeout") {
+      const auto number = parse_number(value);
+      if (!number) {
+        std::cerr << std::format("Invalid number for {}: {}\n", arg, value);
+        return std::nullopt;
+      }
+      if (arg == "--games") {
+        opts.games = *number;
+      } else if (arg == "--seed") {
+        opts.seed = *number;
+      } else if (arg == "--pipeline") {
+        opts.pipeline = std::max<uint64_t>(*number, 1);
+      } else if (arg == "--engine-timeout") {
+        opts.engine_timeout = std::chrono::milliseconds(std::max<uint64_t>(*number, 1));
+      } else {
+        opts.threads = static_cast<unsigned>(*number);
+      }
+    } else if (arg == "--first" || arg == "--second") {
+      const auto level = parse_difficulty(value);
+      if (!level) {
+        std::cerr << std::format("Unknown strategy: {}\n", value);
+        return std::nullopt;
+      }
+      (arg == "--first" ? opts.match.first : opts.match.second) = *level;
+    } else if (arg == "--csv") {
+      opts.csv_path = value;
+    } else if (arg == "--json") {
+      opts.json_path = value;
+    } else if (arg == "--replay") {
+      opts.replay_path = value;
+    } else if (arg == "--out") {
+      opts.out_prefix = value;
+    } else if (arg == "--engine") {
+      opts.engine = value;
+    } else if (arg == "--shard") {
+      const auto shard = parse_shard(value);
+      if (!shard) {
+        std::cerr << std::format("Invalid shard (expected I/N): {}\n", value);
+        return std::nullopt;
+      }
+      opts.shard = *shard;
+    } else {
+      std::cerr << std::format("Unknown option: {}\n", arg);
+      return std::nullopt;
+    }
+  }
+
+  if (opts.shard.count > 1 && opts.out_prefix.empty()) {
+    std::cerr << "--shard requires --out\n";
+    return std::nullopt;
+  }
+  if (!opts.engine.empty() &&
+      (!opts.out_prefix.empty() || !opts.replay_path.empty() ||
+       !opts.csv_path.empty() || !opts.json_path.empty())) {
+    std::cerr << "--engine only prints a summary\n";
+    return std::nullopt;
+  }
+  if (!opts.out_prefix.empty()) {
+    opts.replay_path = opts.out_prefix + std::string(sim::REPLAY_EXTENSION);
+  }
+  return opts;
+}
+
+bool write_file(const std::string &path, const std::string &content) {
+  std::ofstream out(path, std::ios::binary);
+  out << content;
+  if (!out) {
+    std::cerr << std::format("Failed to write {}\n", path);
+    return false;
+  }
+  return true;
+}
+
+void print_summary(const stats::SimStats &totals) {
+  for (const auto level : {config::Difficulty::EASY, config::Difficulty::MEDIUM,
+                           config::Difficulty::HARD}) {
+    const auto &s = totals.strategy(level);
+    if (s.games == 0) {
+      continue;
+    }
+    std::cout << std::format(
+        "  {:<6} games {:>9}  wins {:>9}  shots/win mean {:5.1f} p50 {:3} "
+        "p90 {:3} p99 {:3}  shots hunt {:5.1f} target {:5.1f}\n",
+        stats::strategy_name(level), s.games, s.wins, s.shots_to_win.mean(),
+        s.shots_to_win.percentile(50), s.shots_to_win.percentile(90),
+        s.shots_to_win.percentile(99), s.avg_hunt_shots(),
+        s.avg_target_shots());
+  }
+}
+
+// Each thread drives its own engine process over a slice of the games
+int run_engine(const Options &opts) {
+  const uint64_t first_game = opts.shard.first_game(opts.games);
+  const uint64_t game_count = opts.shard.game_count(opts.games);
+  const unsigned threads = static_cast<unsigned>(
+      std::clamp<uint64_t>(opts.threads, 1, std::max<uint64_t>(game_count, 1)));
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<engine::ArenaStats> results(threads);
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  std::string name;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      try {
+        const uint64_t begin = game_count * t / threads;
+        const uint64_t end = game_count * (t + 1) / threads;
+        results[t] = engine::run_arena(opts.engine, opts.match.second, opts.seed,
+                                       first_game + begin, end - begin,
+                                       static_cast<unsigned>(opts.pipeline),
+                                       opts.engine_timeout);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  engine::ArenaStats totals;
+  for (const auto &result : results) {
+    totals.merge(result);
+  }
+  const uint64_t builtin_wins = totals.games - totals.engine_wins;
+  const auto mean = [](uint64_t sum, uint64_t n) {
+    return n == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(n);
+  };
+
+  std::cout << std::format(
+      "{} games (engine vs {}) in {:.2f}s, {:.0f} games/s, {:.0f} moves/s\n",
+      totals.games, stats::strategy_name(opts.match.second), elapsed.count(),
+      static_cast<double>(totals.games) / std::max(elapsed.count(), 1e-9),
+      static_cast<double>(totals.engine_moves) / std::max(elapsed.count(), 1e-9));
+  std::cout << std::format(
+      "  engine  wins {:>9} ({:.1f}%)  shots/win mean {:5.1f}  forfeits {} ({} on time)\n",
+      totals.engine_wins, 100.0 * mean(totals.engine_wins, totals.games),
+      mean(totals.engine_win_shots, totals.engine_wins), totals.forfeits,
+      totals.timeouts);
+  std::cout << std::format("  {:<6}  wins {:>9} ({:.1f}%)  shots/win mean {:5.1f}\n",
+                           stats::strategy_name(opts.match.second), builtin_wins,
+                           100.0 * mean(builtin_wins, totals.games),
+                           mean(totals.builtin_win_shots, builtin_wins));
+  std::cout << std::format(
+      "  IPC     {} round trips, {:.1f} moves each, {:.2f}s waiting on the engine\n",
+      totals.round_trips, mean(totals.engine_moves, totals.round_trips),
+      std::chrono::duration<double>(totals.waiting).count() / threads);
+  return totals.forfeits == 0 ? 0 : 1;
+}
+
+int run_merge(int argc, char **argv) {
+  std::string out_prefix;
+  std::vector<std::string> inputs;
+
+  for (int i = 2; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--out" && i + 1 < argc) {
+      out_prefix = argv[++i];
+    } else {
+      inputs.emplace_back(arg);
+    }
+  }
+  if (out_prefix.empty() || inputs.empty()) {
+    print_usage();
+    return 1;
+  }
+
+  try {
+    const auto header = sim::merge_shards(inputs, out_prefix);
+    std::cout << std::format("Merged {} shards: {} games, seed {}\n",
+                             inputs.size(), header.total_games,
+                             header.master_seed);
+    print_summary(sim::read_shard_stats(out_prefix +
+                                        std::string(sim::STATS_EXTENSION))
+                      .second);
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string_view(argv[1]) == "merge") {
+    return run_merge(argc, argv);
+  }
+
+  const auto opts = parse_args(argc, argv);
+  if (!opts) {
+    print_usage();
+    return 1;
+  }
+
+  try {
+    if (!opts->engine.empty()) {
+      return run_engine(*opts);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t first_game = opts->shard.first_game(opts->games);
+    const uint64_t game_count = opts->shard.game_count(opts->games);
+    const stats::SimStats totals =
+        sim::run_parallel(opts->match, opts->seed, first_game, game_count,
+                          opts->threads, opts->replay_path);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::format(
+        "{} games ({} vs {}) in {:.2f}s, {:.0f} games/s\n", game_count,
+        stats::strategy_name(opts->match.first),
+        stats::strategy_name(opts->match.second), elapsed.count(),
+        static_cast<double>(game_count) / std::max(elapsed.count(), 1e-9));
+    print_summary(totals);
+
+    if (!opts->out_prefix.empty()) {
+      sim::write_shard_stats(
+          opts->out_prefix + std::string(sim::STATS_EXTENSION),
+          sim::ShardHeader{opts->match, opts->seed, opts->games, opts->shard},
+          totals);
+    }
+
+    if (!opts->csv_path.empty() && !write_file(opts->csv_path, totals.to_csv())) {
+      return 1;
+    }
+    if (!opts->json_path.empty() &&
+        !write_file(opts->json_path, totals.to_json())) {
+      return 1;
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Fatal error: {}\n", e.what());
+    return 1;
+  }
+}
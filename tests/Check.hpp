@@ -0,0 +1,27 @@
+#pragma once
+
+#include <iostream>
+#include <source_location>
+#include <string_view>
+
+// Minimal assertions for the unit tests. A failed check is reported and the
+// test keeps going; main() returns failures() so ctest sees it.
+namespace battleship::test {
+
+inline int &failure_count() noexcept {
+  static int count = 0;
+  return count;
+}
+
+inline bool check(bool condition, std::string_view what,
+                  std::source_location where = std::source_location::current()) {
+  if (!condition) {
+    ++failure_count();
+    std::cerr << where.file_name() << ':' << where.line() << ": " << what << "\n";
+  }
+  return condition;
+}
+
+inline int failures() noexcept { return failure_count() == 0 ? 0 : 1; }
+
+} // namespace battleship::test
@@ -0,0 +1,67 @@
+#include "Check.hpp"
+#include "Engine.hpp"
+#include "Player.hpp"
+#include "Simulation.hpp"
+#include <chrono>
+#include <format>
+#include <sstream>
+#include <string>
+
+using namespace battleship;
+using battleship::test::check;
+
+namespace {
+
+// The fleet line `battleship-engine` answers a place with
+std::string served_fleet(uint64_t seed, config::Difficulty level) {
+  std::istringstream in(std::format("newgame 1 {}\nplace 1\nquit\n", seed));
+  std::ostringstream out;
+  engine::serve(in, out, level);
+  return out.str();
+}
+
+std::string builtin_fleet(uint64_t seed, config::Difficulty level) {
+  Player player("Built-in", PlayerType::AI, level, engine::builtin_seed(seed));
+  player.auto_place_ships();
+  std::string line = "fleet 1";
+  for (const auto &ship : player.board().ships()) {
+    line += ' ';
+    line += engine::format_ship(net::protocol::ShipPlacement::of(*ship));
+  }
+  return line + '\n';
+}
+
+} // namespace
+
+int main() {
+  // A mirrored matchup must not replay one game on both sides
+  for (uint64_t game = 0; game < 100; ++game) {
+    const uint64_t seed = sim::game_seed(42, game);
+    const std::string served = served_fleet(seed, config::Difficulty::EASY);
+    check(served.starts_with("fleet 1 "), "engine answers place with a fleet");
+    check(served != builtin_fleet(seed, config::Difficulty::EASY),
+          std::format("game {}: both sides got the same fleet", game));
+  }
+  check(engine::engine_seed(7) != engine::builtin_seed(7), "distinct player seeds");
+
+  // Requests that owe a reply get one even for a game the engine lacks
+  {
+    std::istringstream in("place 9\ngo 9\nobserve 9 A1 miss\n");
+    std::ostringstream out;
+    engine::serve(in, out, config::Difficulty::EASY);
+    check(out.str() == "error 9 unknown game\nerror 9 unknown game\n",
+          "unknown games are answered with errors");
+  }
+
+  // An engine that never answers loses every game on time instead of
+  // hanging the arena
+  {
+    const auto stats = engine::run_arena(
+        "printf 'id name mute\\nbeiok\\n'; cat >/dev/null", config::Difficulty::EASY,
+        1, 0, 3, 2, std::chrono::milliseconds(50));
+    check(stats.games == 3 && stats.timeouts == 3 && stats.engine_wins == 0,
+          "a mute engine forfeits on time");
+  }
+
+  return battleship::test::failures();
+}
@@ -0,0 +1,101 @@
+#include "Check.hpp"
+#include "net/Multiplexer.hpp"
+#include <cstring>
+#include <format>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace battleship;
+using namespace battleship::net;
+using battleship::test::check;
+
+namespace {
+
+std::string payload_costing(std::size_t cost) {
+  return std::string(cost - stream_cost(0), 'x');
+}
+
+// Writes everything `from` queued into `to`, which consumes each stream
+// message right away. Returns how many it got.
+std::size_t deliver(Multiplexer &from, Multiplexer &to) {
+  ReceiveBuffer wire(64 * 1024);
+  for (const auto &buffer : from.outbox().take_batch()) {
+    const auto space = wire.prepare();
+    std::memcpy(space.data(), buffer.data(), buffer.size());
+    wire.commit(buffer.size());
+  }
+  from.outbox().release_batch();
+
+  std::size_t messages = 0;
+  while (const auto frame = wire.next()) {
+    if (const auto message = to.receive(*frame)) {
+      ++messages;
+      to.consumed(*message);
+    }
+  }
+  return messages;
+}
+
+// Runs both directions until neither side has anything left to send
+std::size_t settle(Multiplexer &sender, Multiplexer &receiver) {
+  std::size_t messages = 0;
+  while (!sender.outbox().empty() || !receiver.outbox().empty()) {
+    messages += deliver(sender, receiver);
+    deliver(receiver, sender);
+  }
+  return messages;
+}
+
+} // namespace
+
+int main() {
+  // A small frame leaves too little credit for a large one, and too little
+  // consumed for the receiver to return any on its own account
+  {
+    Multiplexer sender(true), receiver(false);
+    const StreamId stream = sender.open();
+    sender.send(stream, MessageType::ATTACK, payload_costing(1500));
+    sender.send(stream, MessageType::ATTACK, payload_costing(Multiplexer::MAX_FRAME_COST));
+    sender.send(stream, MessageType::ATTACK, payload_costing(Multiplexer::MAX_FRAME_COST));
+    check(sender.stalls() == 1, "the third frame waits for credit");
+    check(settle(sender, receiver) == 3, "every frame arrives once credit returns");
+  }
+
+  // After a consumed 1500-byte frame, 2596 bytes of credit are left and
+  // only 1500 are owed back, below the half window that returns them: a
+  // 3000-byte frame would wait forever, so it is refused up front
+  {
+    Multiplexer sender(true), receiver(false);
+    const StreamId stream = sender.open();
+    sender.send(stream, MessageType::ATTACK, payload_costing(1500));
+    check(settle(sender, receiver) == 1, "the small frame arrives");
+    bool refused = false;
+    try {
+      sender.send(stream, MessageType::ATTACK, payload_costing(3000));
+    } catch (const std::invalid_argument &) {
+      refused = true;
+    }
+    check(refused, "a frame over half a window is refused");
+    check(sender.stalls() == 0, "nothing was left waiting");
+  }
+
+  // Any mix of allowed sizes flows, however it straddles the credit batches
+  {
+    Multiplexer sender(true), receiver(false);
+    const StreamId stream = sender.open();
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<std::size_t> cost(stream_cost(0),
+                                                    Multiplexer::MAX_FRAME_COST);
+    for (int round = 0; round < 200; ++round) {
+      const int count = 1 + round % 5;
+      for (int i = 0; i < count; ++i) {
+        sender.send(stream, MessageType::ATTACK, payload_costing(cost(rng)));
+      }
+      check(settle(sender, receiver) == static_cast<std::size_t>(count),
+            std::format("round {}: frames stuck without credit", round));
+    }
+  }
+
+  return battleship::test::failures();
+}